@@ -309,6 +309,7 @@ void psl__WriteDbl(uint16_t* buffer, double value);
 
 int psl__XMAP_WriteBufferHeader_MM1(MMC1_Data* mm1);
 int psl__XMAP_UpdateBufferHeader_MM1(MMC1_Data* mm1);
+int psl__XMAP_DropPixels_MM1(MMC1_Data* mm1, uint32_t drops);
 int psl__XMAP_WritePixelHeader_MM1(MMC1_Data* mm1, MM_Pixel_Stats* stats);
 
 #endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FALCONXN_CAPTURE_H
+#define FALCONXN_CAPTURE_H
+
+/*
+ * FalconXN SINC Wire Stream Capture.
+ *
+ * A capture file holds every SINC packet a module received, in order,
+ * with the time it was received. The file is a header followed by a
+ * record per packet. All fields are little endian.
+ *
+ *  Header (16 bytes):
+ *    magic    8 bytes  "SINCCAP" and a nul
+ *    version  uint32   FALCONXN_CAPTURE_VERSION
+ *    reserved uint32   0
+ *
+ *  Record (16 bytes plus the payload):
+ *    time     uint64   nanoseconds since the capture was opened
+ *    type     uint32   SINC message type
+ *    length   uint32   payload length in bytes
+ *    payload           the packet without the SINC header
+ */
+
+#include <stdio.h>
+
+#include <sinc.h>
+
+#define FALCONXN_CAPTURE_VERSION (1)
+
+/*
+ * Stdio buffer for writing so a capture does not make a system call per
+ * packet.
+ */
+#define FALCONXN_CAPTURE_WRITE_BUFFER (1024 * 1024)
+
+/*
+ * Largest packet accepted when reading. Anything bigger is taken as a
+ * corrupt file.
+ */
+#define FALCONXN_CAPTURE_MAX_PACKET (64 * 1024 * 1024)
+
+typedef struct
+{
+    FILE*    fp;
+    char*    buffer;   /* Stdio write buffer or the read packet data. */
+    size_t   size;     /* Size of the buffer. */
+    uint64_t start;    /* Monotonic time the capture was opened. */
+    uint64_t packets;  /* Packets written or read. */
+    uint64_t bytes;    /* Payload bytes written or read. */
+} FalconXNCapture;
+
+uint64_t psl__CaptureNow(void);
+
+int  psl__CaptureOpen(FalconXNCapture* capture, const char* path);
+int  psl__CaptureWrite(FalconXNCapture* capture,
+                       SiToro__Sinc__MessageType msgType,
+                       SincBuffer* packet);
+int  psl__CaptureOpenReplay(FalconXNCapture* capture, const char* path);
+int  psl__CaptureRead(FalconXNCapture* capture,
+                      uint64_t* time,
+                      SiToro__Sinc__MessageType* msgType,
+                      SincBuffer* packet);
+void psl__CaptureClose(FalconXNCapture* capture);
+boolean_t psl__CaptureIsOpen(FalconXNCapture* capture);
+
+#endif /* FALCONXN_CAPTURE_H */
@@ -46,6 +46,8 @@
 #include <sinc.h>
 
 #include "falconx_mm.h"
+#include "falconxn_capture.h"
+#include "xia_map.h"
 
 #define FALCONXN_MAX_CHANNELS (8)
 
@@ -59,6 +61,12 @@
  */
 #define FALCONXN_MAX_ADC_SAMPLES (0x80000)
 
+/*
+ * ADC traces held per channel while the oscilloscope runs
+ * continuously. The oldest trace is dropped when it is full.
+ */
+#define FALCONXN_SCOPE_RING_SIZE (4)
+
 /*
  * Timeout to wait for a DC offset calculation response, typical 520ms.
  */
@@ -74,6 +82,19 @@
  */
 #define FALCONXN_RESPONSE_TIMEOUT (2)
 
+/*
+ * Delay between attempts to reconnect to a box once the connection is
+ * lost. The delay doubles after each failed attempt up to the maximum.
+ */
+#define FALCONXN_RECONNECT_MIN_MSECS (250)
+#define FALCONXN_RECONNECT_MAX_MSECS (30000)
+
+/*
+ * Channel param holding the hash of the detector characterization last
+ * uploaded. Firmware without the param always has the data uploaded.
+ */
+#define FALCONXN_CALIBRATION_HASH_PARAM "pulse.calibration.hash"
+
 /*
  * Sinc response handle. This allows us to map the response back to
  * the type and so the call to free a response.
@@ -105,6 +126,16 @@ typedef enum {
     CalibrationReady
 } CalibrationState;
 
+/* The state of a module's connection to the box. Restoring is set from
+ * the time the connection is made again until the box's state has been
+ * restored.
+ */
+typedef enum {
+    LinkConnected,
+    LinkDisconnected,
+    LinkRestoring
+} LinkState;
+
 #define DAC_OFFSET_MIN        -2048
 #define DAC_OFFSET_MAX         2047
 #define DISCHARGE_THRESH_MIN       0.0
@@ -228,6 +259,20 @@ typedef struct _BoardOperation {
 #define FALCONXN_STATS_PULSES_REJECTED  (12)
 #define FALCONXN_STATS_DEADTIME         (13)
 
+/*
+ * A box parameter mirrored on the host. The key is allocated with the
+ * entry and is the entry's key in the detector's parameter map.
+ */
+typedef struct {
+    SiToro__Sinc__KeyValue__ParamType type;
+    int64_t   intval;
+    double    floatval;
+    boolean_t boolval;
+    boolean_t settable; /* False if the box lists it as read-only. */
+    char*     str;      /* String and option values. */
+    char      key[];
+} FalconXNParam;
+
 /*
  * The SiToro Module PSL Data. It contains the detectors.
  */
@@ -267,6 +312,17 @@ struct _FalconXNModule {
     boolean_t receiverActive;
     boolean_t receiverRunning;
 
+    /* Receive engine worker servicing the module's connection, -1 if
+     * the module has its own receiver thread.
+     */
+    int receiveWorker;
+
+    /* Link in the receive engine worker's backlog. Only changed with the
+     * worker's lock held.
+     */
+    Module*   receiveNext;
+    boolean_t receivePending;
+
     /* Module's receiver event.
      */
     handel_md_Event receiverEvent;
@@ -287,6 +343,49 @@ struct _FalconXNModule {
     /* One Sinc connection for the module.
      */
     Sinc sinc;
+
+    /* Decode arena for asynchronous messages. Reset after each message
+     * is processed.
+     */
+    SincArena arena;
+
+    /* Set if the module does not support the calibration hash param so
+     * the characterization is always uploaded.
+     */
+    boolean_t calibHashUnsupported;
+
+    /* Capture of the received SINC stream, enabled by the inet_capture
+     * module item.
+     */
+    FalconXNCapture capture;
+
+    /* Set while a capture is replayed into the module. Live asynchronous
+     * data is dropped so only the captured data is processed.
+     */
+    boolean_t replaying;
+
+    /* Connection state. The receiver marks the link down when a read
+     * fails and the reconnect thread connects again and restores the
+     * box's state.
+     */
+    LinkState        linkState;
+    handel_md_Thread reconnector;
+    boolean_t        reconnectActive;
+    boolean_t        reconnectRunning;
+
+    /* Outage statistics for get_connection_status. */
+    uint32_t outages;
+    uint32_t reconnectAttempts;
+    uint64_t outageStart;      /* Monotonic time in nsecs. */
+    uint64_t outageLength;     /* Length of the last outage in nsecs. */
+    uint32_t paramsRestored;
+
+    /* Characterization collector thread. It collects the results of the
+     * module's channels in the characterization job as each finishes.
+     */
+    handel_md_Thread collector;
+    boolean_t        collectorActive;
+    boolean_t        collectorRunning;
 };
 
 /*
@@ -322,6 +421,13 @@ struct _FalconXNDetector {
     /* Track state of calibration data */
     CalibrationState calibrationState;
 
+    /* Mirror of the channel's box parameters. It is filled when the
+     * channel is set up and kept current by the parameter updates the
+     * channel monitor pushes. Reads are served from it once valid.
+     */
+    xia_map_t params;
+    boolean_t paramsValid;
+
     struct FirmwareFeatures {
         boolean_t mcaGateVeto;
         boolean_t termination50ohm;
@@ -338,9 +444,24 @@ struct _FalconXNDetector {
     SincCalibrationPlot calibModel;
     SincCalibrationPlot calibFinal;
 
+    /* Characterization job. A channel joins the job when it is started
+     * and is done once its results have been collected.
+     */
+    boolean_t detcJob;
+    boolean_t detcDone;
+    boolean_t detcSuccessful;
+
     /* The buffer size used when reading OSC data. */
     SincOscPlot adcTrace;
 
+    /* Traces received while the oscilloscope runs continuously. */
+    boolean_t   scopeContinuous;
+    SincOscPlot scopeRing[FALCONXN_SCOPE_RING_SIZE];
+    int         scopeHead;
+    int         scopeCount;
+    uint64_t    scopeTraces;
+    uint64_t    scopeDropped;
+
     /* The DC offset returned from the calculate command. */
     double dcOffset;
 
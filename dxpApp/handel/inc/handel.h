@@ -119,6 +119,7 @@ extern "C" {
     HANDEL_IMPORT int HANDEL_API xiaSuppressLogOutput(void);
     HANDEL_IMPORT int HANDEL_API xiaSetLogLevel(int level);
     HANDEL_IMPORT int HANDEL_API xiaSetLogOutput(const char *fileName);
+    HANDEL_IMPORT int HANDEL_API xiaSetLogAsynchronous(int enable);
     HANDEL_IMPORT int HANDEL_API xiaCloseLog(void);
 
     HANDEL_IMPORT int HANDEL_API xiaSetIOPriority(int pri);
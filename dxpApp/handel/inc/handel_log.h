@@ -46,10 +46,33 @@
 extern void (*handel_md_log)(int level, const char *func, const char *msg, int status,
 			     const char *file, int line);
 
+/*
+ * Returns TRUE_ if a message at the level would be logged.
+ */
+extern boolean_t (*handel_md_log_enabled)(int level);
+
 
 #define XIA_LOG_ERROR   MD_ERROR, XIA_FILE, __LINE__
 #define XIA_LOG_WARNING MD_WARNING, XIA_FILE, __LINE__, 0
 #define XIA_LOG_INFO    MD_INFO, XIA_FILE, __LINE__, 0
 #define XIA_LOG_DEBUG   MD_DEBUG, XIA_FILE, __LINE__, 0
 
+/*
+ * The level is the first value of the XIA_LOG_* and PSL_LOG_* lists. The
+ * expand step is for MSVC, which passes __VA_ARGS__ on as a single
+ * argument.
+ */
+#define XIA_LOG_EXPAND(_x) _x
+#define XIA_LOG_FIRST(_level, ...) _level
+#define XIA_LOG_LEVEL_OF(...) XIA_LOG_EXPAND(XIA_LOG_FIRST(__VA_ARGS__, 0))
+
+/*
+ * Log a message. The level is checked before the arguments are evaluated
+ * or formatted so a filtered message costs a single call.
+ */
+#define xiaLog(...)                                                     \
+    ((handel_md_log_enabled == NULL ||                                  \
+      handel_md_log_enabled(XIA_LOG_LEVEL_OF(__VA_ARGS__))) ?           \
+     xiaLogMessage(__VA_ARGS__) : (void) 0)
+
 #endif /* HANDEL_LOG_H */
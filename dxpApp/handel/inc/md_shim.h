@@ -40,6 +40,7 @@
 #include <time.h>
 
 #include "Dlldefs.h"
+#include "xia_common.h"
 
 
 XIA_SHARED int dxp_md_wait(float *time);
@@ -47,6 +48,8 @@ XIA_SHARED char *dxp_md_fgets(char *s, int length, FILE *stream);
 XIA_SHARED int dxp_md_enable_log(void);
 XIA_SHARED int dxp_md_suppress_log(void);
 XIA_SHARED int dxp_md_set_log_level(int level);
+XIA_SHARED boolean_t dxp_md_log_enabled(int level);
+XIA_SHARED int dxp_md_log_async(boolean_t enable);
 XIA_SHARED void dxp_md_log(int level, const char *routine, const char *message,
                            int error, const char *file, int line);
 XIA_SHARED void dxp_md_output(const char *filename);
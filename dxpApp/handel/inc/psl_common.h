@@ -46,6 +46,7 @@
 
 #include "md_shim.h"
 #include "md_generic.h"
+#include "handel_log.h"
 
 #if __GNUC__
 #define PSL_PRINTF(_s, _f) __attribute__ ((format (printf, _s, _f)))
@@ -76,10 +77,18 @@
 #  define CHECK_CONST(_expr) _expr
 #endif
 
+/* Log a message. Filtered levels are skipped before the arguments are
+ * evaluated or formatted.
+ */
+#define pslLog(...)                                                     \
+    ((handel_md_log_enabled == NULL ||                                  \
+      handel_md_log_enabled(XIA_LOG_LEVEL_OF(__VA_ARGS__))) ?           \
+     pslLogMessage(__VA_ARGS__) : (void) 0)
+
 /* Shared routines */
-PSL_SHARED void PSL_API pslLog(int level, const char* file, int line,
-                               const char* routine, int error,
-                               const char* message, ...) PSL_PRINTF(6, 7);
+PSL_SHARED void PSL_API pslLogMessage(int level, const char* file, int line,
+                                      const char* routine, int error,
+                                      const char* message, ...) PSL_PRINTF(6, 7);
 PSL_SHARED int PSL_API pslGetDefault(const char *name, void *value,
                                      XiaDefaults *defaults);
 PSL_SHARED int PSL_API pslSetDefault(const char *name, void *value,
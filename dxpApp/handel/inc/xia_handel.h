@@ -216,9 +216,9 @@ HANDEL_SHARED int HANDEL_API xiaRemoveAllDefaults(void);
 
 HANDEL_SHARED int HANDEL_API xiaReadIniFile(const char *inifile);
 
-HANDEL_SHARED void HANDEL_API xiaLog(int level, const char* file, int line,
-                                     int status, const char* func,
-                                     const char* fmt, ...) HANDEL_PRINTF(6, 7);
+HANDEL_SHARED void HANDEL_API xiaLogMessage(int level, const char* file, int line,
+                                            int status, const char* func,
+                                            const char* fmt, ...) HANDEL_PRINTF(6, 7);
 
 HANDEL_SHARED int HANDEL_API xiaSetupModule(const char* alias);
 HANDEL_SHARED int HANDEL_API xiaEndModule(const char* alias);
@@ -271,6 +271,11 @@ HANDEL_SHARED int HANDEL_API xiaGetAbsoluteChannel(int detChan,
                                                    Module *module, int *chan);
 HANDEL_SHARED int HANDEL_API xiaGetModDetectorChan(int detChan);
 HANDEL_SHARED int HANDEL_API xiaTagAllRunActive(Module *module, boolean_t state);
+
+/* Broadcast an operation to each detChan of a detChan set. */
+typedef int (*xiaBroadcastOp)(int detChan, void *arg);
+HANDEL_SHARED int HANDEL_API xiaBroadcast(int detChanSet, xiaBroadcastOp op,
+                                          void *arg);
 HANDEL_SHARED int HANDEL_API xiaGetDefaultStrFromDetChan(int detChan,
                                                          char* defaultStr);
 HANDEL_SHARED XiaDefaults* HANDEL_API xiaGetDefaultFromDetChan(int detChan);
@@ -313,6 +318,7 @@ extern char * (*handel_md_fgets)(char *s, int size, FILE *stream);
 extern int (*handel_md_enable_log)(void);
 extern int (*handel_md_suppress_log)(void);
 extern int (*handel_md_set_log_level)(int level);
+extern int (*handel_md_log_async)(boolean_t enable);
 
 
 #define XIA_BEFORE 0
@@ -316,6 +316,12 @@ typedef struct Interface_Inet {
     char* address;
     unsigned int port;
     unsigned int timeout;
+    /* Optional, 0 uses a receive thread per module. */
+    unsigned int receive_threads;
+    /* Optional socket receive buffer size in bytes, 0 for the default. */
+    unsigned int receive_buffer;
+    /* Optional file to capture the received SINC stream to, NULL for none. */
+    char* capture;
 } Interface_Inet;
 
 /*
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef XIA_MAP_H
+#define XIA_MAP_H
+
+#include <stddef.h>
+
+#include "Dlldefs.h"
+
+
+/* A hash map from alias strings to list elements, kept alongside the
+ * Handel linked lists so lookups by alias do not walk the lists. The
+ * keys are not copied: a key must stay valid until it is removed, which
+ * is the case when it is the alias owned by the element it maps to.
+ */
+typedef struct _xia_map_entry {
+    const char *key;
+    void *value;
+} xia_map_entry_t;
+
+typedef struct _xia_map {
+    xia_map_entry_t *entries;
+    size_t size;
+    size_t count;
+} xia_map_t;
+
+#define XIA_MAP_INITIALIZER {NULL, 0, 0}
+
+
+XIA_SHARED int   xia_map_put(xia_map_t *map, const char *key, void *value);
+XIA_SHARED void *xia_map_get(const xia_map_t *map, const char *key);
+XIA_SHARED void *xia_map_remove(xia_map_t *map, const char *key);
+XIA_SHARED void  xia_map_clear(xia_map_t *map);
+
+#endif /* XIA_MAP_H */
@@ -256,6 +256,13 @@ struct PSLHandlers
     getSpecialRunData_FP    getSpecialRunData;
     canRemoveName_FP        canRemoveName;
     freeSCAs_FP             freeSCAs;
+
+    /*
+     * Set if the PSL can run operations on different modules at the same
+     * time. Handel then broadcasts operations on a detChan set to all the
+     * modules in parallel. See xiaBroadcast.
+     */
+    boolean_t               concurrentModules;
 };
 
 /**
@@ -53,6 +53,8 @@ bool SincInit(Sinc *sc)
     sc->datagramFd = -1;
     sc->datagramIsOpen = false;
     sc->inSocketWait = false;
+    sc->transport = &SincSocketTransport;
+    sc->transportContext = NULL;
 
     return true;
 }
@@ -92,6 +94,49 @@ void SincSetTimeout(Sinc *sc, int timeoutMs)
 }
 
 
+/*
+ * NAME:        SincSetReceiveBufferSize
+ * ACTION:      Sets the socket receive buffer size. Takes effect on the next connect.
+ * PARAMETERS:  int size - the size in bytes. 0 for the system default.
+ */
+
+void SincSetReceiveBufferSize(Sinc *sc, int size)
+{
+    sc->rcvBufSize = size;
+}
+
+
+/*
+ * NAME:        SincSetTransport
+ * ACTION:      Sets how the channel talks to the device. Takes effect on the next connect.
+ * PARAMETERS:  const SincTransport *transport - the transport. NULL for the TCP socket default.
+ *              void *context                  - passed to the transport's functions.
+ */
+
+void SincSetTransport(Sinc *sc, const SincTransport *transport, void *context)
+{
+    sc->transport = transport != NULL ? transport : &SincSocketTransport;
+    sc->transportContext = context;
+}
+
+
+/*
+ * NAME:        SincGetReadStats
+ * ACTION:      Gets the receive counters for the channel.
+ * PARAMETERS:  Sinc *sc             - the sinc connection.
+ *              SincReadStats *stats - where to put the counters.
+ *              bool reset           - clear the counters after reading them.
+ */
+
+void SincGetReadStats(Sinc *sc, SincReadStats *stats, bool reset)
+{
+    *stats = sc->readStats;
+
+    if (reset)
+        memset(&sc->readStats, 0, sizeof(sc->readStats));
+}
+
+
 /*
  * NAME:        SincConnect
  * ACTION:      Connects a Sinc channel to a device on a given host and port.
@@ -104,7 +149,7 @@ void SincSetTimeout(Sinc *sc, int timeoutMs)
 
 bool SincConnect(Sinc *sc, const char *host, int port)
 {
-    int err = SincSocketConnect(&sc->fd, host, port, sc->timeout);
+    int err = sc->transport->connect(sc->transportContext, &sc->fd, host, port, sc->timeout, sc->rcvBufSize);
     if (err != 0)
     {
         SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)err);
@@ -113,6 +158,9 @@ bool SincConnect(Sinc *sc, const char *host, int port)
 
     sc->connected = true;
 
+    // Data left from a previous connection is not part of the new stream.
+    sc->readBuf.cbuf.len = 0;
+
     return true;
 }
 
@@ -127,7 +175,7 @@ bool SincConnect(Sinc *sc, const char *host, int port)
 
 bool SincDisconnect(Sinc *sc)
 {
-    int success = SincSocketDisconnect(sc->fd) == SI_TORO__SINC__ERROR_CODE__NO_ERROR;
+    int success = sc->transport->disconnect(sc->transportContext, sc->fd) == SI_TORO__SINC__ERROR_CODE__NO_ERROR;
     if (success)
     {
         sc->fd = -1;
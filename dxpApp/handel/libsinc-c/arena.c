@@ -0,0 +1,192 @@
+/********************************************************************
+ ***                                                              ***
+ ***                  libsinc decode arena allocator              ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * This module provides a bump allocator which can be handed to the
+ * protobuf decoder through a SincBuffer. Each decoded message takes
+ * its memory from the arena and it's all released in one go by
+ * SincArenaReset() once the message has been processed.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "sinc.h"
+#include "sinc_internal.h"
+
+
+// Allocations are aligned to suit any type the decoder stores.
+#define SINC_ARENA_ALIGN 16
+#define SINC_ARENA_ALIGN_UP(x) (((x) + (SINC_ARENA_ALIGN - 1)) & ~((size_t)SINC_ARENA_ALIGN - 1))
+
+// The largest single block kept between messages.
+#define SINC_ARENA_MAX_RETAIN (1024 * 1024)
+
+
+struct SincArenaBlock
+{
+    SincArenaBlock *next;       // The next older block.
+    size_t          size;       // The usable size of this block.
+};
+
+#define SINC_ARENA_BLOCK_DATA(b) ((uint8_t *)(b) + SINC_ARENA_ALIGN_UP(sizeof(SincArenaBlock)))
+
+
+/*
+ * NAME:        SincArenaNewBlock
+ * ACTION:      Allocates a new block and makes it the current block.
+ * PARAMETERS:  SincArena *arena - the arena.
+ *              size_t size      - the usable size of the block.
+ * RETURNS:     true on success, false if out of memory.
+ */
+
+static bool SincArenaNewBlock(SincArena *arena, size_t size)
+{
+    SincArenaBlock *block = malloc(SINC_ARENA_ALIGN_UP(sizeof(SincArenaBlock)) + size);
+    if (block == NULL)
+        return false;
+
+    block->next = arena->blocks;
+    block->size = size;
+    arena->blocks = block;
+    arena->used = 0;
+    arena->blockAllocs++;
+
+    return true;
+}
+
+
+/*
+ * NAME:        SincArenaAlloc
+ * ACTION:      The protobuf allocator alloc function. Bumps the current block
+ *              and falls back to a new block if the current one is full.
+ * PARAMETERS:  void *allocatorData - the arena.
+ *              size_t size         - the number of bytes required.
+ * RETURNS:     The memory or NULL if out of memory.
+ */
+
+static void *SincArenaAlloc(void *allocatorData, size_t size)
+{
+    SincArena *arena = (SincArena *)allocatorData;
+    void *mem;
+
+    size = SINC_ARENA_ALIGN_UP(size);
+
+    if (arena->blocks == NULL || arena->used + size > arena->blocks->size)
+    {
+        size_t blockSize = arena->blockSize;
+        if (size > blockSize)
+            blockSize = size;
+
+        if (!SincArenaNewBlock(arena, blockSize))
+            return NULL;
+    }
+
+    mem = SINC_ARENA_BLOCK_DATA(arena->blocks) + arena->used;
+    arena->used += size;
+    arena->total += size;
+
+    return mem;
+}
+
+
+/*
+ * NAME:        SincArenaFreeMem
+ * ACTION:      The protobuf allocator free function. Memory is only released
+ *              by SincArenaReset() so this does nothing.
+ */
+
+static void SincArenaFreeMem(void *allocatorData, void *mem)
+{
+    (void)allocatorData;
+    (void)mem;
+}
+
+
+/*
+ * NAME:        SincArenaFreeBlocks
+ * ACTION:      Frees all the blocks in an arena.
+ * PARAMETERS:  SincArena *arena - the arena.
+ */
+
+static void SincArenaFreeBlocks(SincArena *arena)
+{
+    while (arena->blocks != NULL)
+    {
+        SincArenaBlock *next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+
+    arena->used = 0;
+}
+
+
+/*
+ * NAME:        SincArenaInit
+ * ACTION:      Initialises an arena and allocates its first block.
+ * PARAMETERS:  SincArena *arena - the arena to initialise.
+ *              size_t blockSize - the size of the arena's blocks. 0 for a default size.
+ * RETURNS:     true on success, false if out of memory.
+ */
+
+bool SincArenaInit(SincArena *arena, size_t blockSize)
+{
+    memset(arena, 0, sizeof(*arena));
+
+    if (blockSize == 0)
+        blockSize = SINC_ARENA_DEFAULT_BLOCK_SIZE;
+
+    arena->blockSize = SINC_ARENA_ALIGN_UP(blockSize);
+    arena->allocator.alloc = SincArenaAlloc;
+    arena->allocator.free = SincArenaFreeMem;
+    arena->allocator.allocator_data = arena;
+
+    return SincArenaNewBlock(arena, arena->blockSize);
+}
+
+
+/*
+ * NAME:        SincArenaReset
+ * ACTION:      Releases everything allocated from the arena. If the last message
+ *              needed more than one block they are replaced by a single block
+ *              big enough for it so the next message of that size doesn't allocate.
+ * PARAMETERS:  SincArena *arena - the arena.
+ */
+
+void SincArenaReset(SincArena *arena)
+{
+    if (arena->blocks != NULL && arena->blocks->next != NULL)
+    {
+        size_t size = SINC_ARENA_ALIGN_UP(arena->total);
+
+        if (size < arena->blockSize)
+            size = arena->blockSize;
+        else if (size > SINC_ARENA_MAX_RETAIN)
+            size = arena->blockSize;
+
+        SincArenaFreeBlocks(arena);
+
+        // If this fails the next alloc will try again.
+        SincArenaNewBlock(arena, size);
+    }
+
+    arena->used = 0;
+    arena->total = 0;
+}
+
+
+/*
+ * NAME:        SincArenaFree
+ * ACTION:      Frees all the memory held by an arena.
+ * PARAMETERS:  SincArena *arena - the arena.
+ */
+
+void SincArenaFree(SincArena *arena)
+{
+    SincArenaFreeBlocks(arena);
+    arena->total = 0;
+}
@@ -51,14 +51,14 @@ static bool SincWaitForData(Sinc *sc, int timeout, bool *readOk)
         fds[0] = sc->fd;
         fds[1] = sc->datagramFd;
 
-        errCode = SincSocketWaitMulti(fds, 2, timeout, readAvailable);
+        errCode = sc->transport->waitMulti(sc->transportContext, fds, 2, timeout, readAvailable);
         readOk[0] = readAvailable[0];
         readOk[1] = readAvailable[1];
     }
     else
     {
         // Datagrams aren't enabled - just read the stream.
-        errCode = SincSocketWait(sc->fd, timeout, &readAvailable[0]);
+        errCode = sc->transport->waitMulti(sc->transportContext, &sc->fd, 1, timeout, &readAvailable[0]);
         readOk[0] = readAvailable[0];
     }
 
@@ -74,6 +74,100 @@ static bool SincWaitForData(Sinc *sc, int timeout, bool *readOk)
 }
 
 
+/*
+ * NAME:        SincReadBufReserve
+ * ACTION:      Makes sure there is free space at the end of the read buffer,
+ *              growing the buffer if necessary.
+ * PARAMETERS:  Sinc *sc     - the sinc connection.
+ *              size_t space - the number of free bytes required.
+ * RETURNS:     true on success, false if out of memory.
+ */
+
+static bool SincReadBufReserve(Sinc *sc, size_t space)
+{
+    size_t newSize;
+    uint8_t *mem;
+
+    if (sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len >= space)
+        return true;
+
+    newSize = sc->readBuf.cbuf.alloced > 0 ? sc->readBuf.cbuf.alloced : SINC_READBUF_DEFAULT_SIZE;
+    while (newSize - sc->readBuf.cbuf.len < space)
+        newSize *= 2;
+
+    mem = realloc(sc->readBuf.cbuf.data, newSize);
+    if (!mem)
+    {
+        SincReadErrorSetCode(sc, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
+        return false;
+    }
+
+    sc->readBuf.cbuf.data = mem;
+    sc->readBuf.cbuf.alloced = newSize;
+
+    return true;
+}
+
+
+/*
+ * NAME:        SincReadStream
+ * ACTION:      Reads all the stream data the kernel currently has for us straight
+ *              into the read buffer. A short read means the socket has been drained
+ *              so we don't need a poll before each read or an extra read to find
+ *              the end of the data.
+ * PARAMETERS:  Sinc *sc          - the sinc connection.
+ *              int *readSomeData - set to true if any data was read.
+ * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
+ *                  SincStrError() to get the error status.
+ */
+
+static bool SincReadStream(Sinc *sc, int *readSomeData)
+{
+    while (true)
+    {
+        int errCode;
+        int bytesRead = 0;
+        int readBufBytesAvailable;
+
+        // Only grow the buffer for the first read. After that we're just
+        // draining the kernel and the caller can decode what we have.
+        if (sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len < SINC_READBUF_MIN_SPACE)
+        {
+            if (*readSomeData)
+                break;
+
+            if (!SincReadBufReserve(sc, SINC_READBUF_MIN_SPACE))
+                return false;
+        }
+
+        readBufBytesAvailable = (int)(sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len);
+        errCode = sc->transport->readNonBlocking(sc->transportContext, sc->fd, &sc->readBuf.cbuf.data[sc->readBuf.cbuf.len], readBufBytesAvailable, &bytesRead);
+        if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
+        {
+            SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
+            return false;
+        }
+
+        if (bytesRead == 0)
+            break;
+
+#ifdef PROTOCOL_VERBOSE_DEBUG
+        printf("SincReadMessage() %d bytes from fd %d\n", bytesRead, sc->fd);
+#endif
+
+        sc->readBuf.cbuf.len += (size_t)bytesRead;
+        sc->readStats.bytes += (uint64_t)bytesRead;
+        sc->readStats.reads++;
+        *readSomeData = true;
+
+        if (bytesRead < readBufBytesAvailable)
+            break;
+    }
+
+    return true;
+}
+
+
 /*
  * NAME:        SincReadMessage
  * ACTION:      Reads the next message. This may block waiting for a message to be received.
@@ -107,149 +201,83 @@ bool SincReadMessage(Sinc *sc, int timeout, SincBuffer *buf, SiToro__Sinc__Messa
     // We'll have to read some more data.
     while (true)
     {
-        // Read any data which is currently available.
         int readSomeData = false;
         bool readAvailable[2];
-        readAvailable[0] = false;
-        readAvailable[1] = false;
 
-        do
+        // Read everything the kernel has for the stream without waiting.
+        if (!SincReadStream(sc, &readSomeData))
+            return false;
+
+        // Is there datagram data available?
+        while (sc->datagramFd >= 0)
         {
+            uint8_t *bufPos;
+            size_t bytesRead;
             int errCode;
             int readBufAvailable;
 
-            // Check for data being available.
-            if (!SincWaitForData(sc, 0, readAvailable))
-                return false;
-
-            // Is there stream data available?
-            if (readAvailable[0])
+            errCode = SincSocketWait(sc->datagramFd, 0, &readAvailable[1]);
+            if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
             {
-                int readBufBytesAvailable;
-                int bytesRead = 0;
-
-                if (sc->readBuf.cbuf.len == sc->readBuf.cbuf.alloced)
-                {
-                    // Out of buffer space - read and expand the buffer.
-                    uint8_t tempReadBuf[65536];
-                    errCode = SincSocketRead(sc->fd, tempReadBuf, sizeof(tempReadBuf), &bytesRead);
-                    if (errCode == 0 && bytesRead > 0)
-                    {
-                        // Append to the buffer.
-                        sc->readBuf.cbuf.base.append(&sc->readBuf.cbuf.base, (size_t)bytesRead, tempReadBuf);
-                    }
-                }
-                else
-                {
-                    // Read some data into our existing buffer.
-                    readBufBytesAvailable = (int)(sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len);
-                    errCode = SincSocketRead(sc->fd, &sc->readBuf.cbuf.data[sc->readBuf.cbuf.len], readBufBytesAvailable, &bytesRead);
-                    if (errCode == 0 && bytesRead > 0)
-                    {
-#ifdef PROTOCOL_VERBOSE_DEBUG
-                        printf("SincReadMessage() %d bytes from fd %d\n", bytesRead, sc->fd);
-                        printf("read data: ");
-
-                        int i;
-                        for (i = 0; i < bytesRead; i++)
-                            printf("%02x ", sc->readBuf.buf.data[sc->readBuf.buf.len + i]);
-
-                        printf("\n");
-#endif
-
-                        sc->readBuf.cbuf.len += (size_t)bytesRead;
-                    }
-                }
-
-                if (errCode != 0)
-                {
-                    SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
-                    return false;
-                }
-
-                if (bytesRead < 0)
-                {
-                    SincReadErrorSetCode(sc, SI_TORO__SINC__ERROR_CODE__READ_FAILED);
-                    return false;
-                }
-                else if (bytesRead == 0)
-                {
-                    SincReadErrorSetCode(sc, SI_TORO__SINC__ERROR_CODE__SOCKET_CLOSED_UNEXPECTEDLY);
-                    return false;
-                }
-
-                readSomeData = true;
+                SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
+                return false;
             }
 
-            // Is there datagram data available?
-            if (readAvailable[1])
-            {
-                uint8_t *bufPos;
-                size_t bytesRead;
-
-                // Make sure we have at least 64k available in the buffer for reading (datagrams can't be bigger than this).
-                if (sc->readBuf.cbuf.len + SINC_MAX_DATAGRAM_BYTES + SINC_HEADER_LENGTH > sc->readBuf.cbuf.alloced)
-                {
-                    // Expand the buffer.
-                    size_t newSize = sc->readBuf.cbuf.len + SINC_MAX_DATAGRAM_BYTES + SINC_HEADER_LENGTH;
-                    uint8_t *mem = realloc(sc->readBuf.cbuf.data, newSize);
-                    if (!mem)
-                    {
-                        SincReadErrorSetCode(sc, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
-                        return false;
-                    }
+            if (!readAvailable[1])
+                break;
 
-                    sc->readBuf.cbuf.data = mem;
-                    sc->readBuf.cbuf.alloced = newSize;
-                }
+            // Make sure we have at least 64k available in the buffer for reading (datagrams can't be bigger than this).
+            if (!SincReadBufReserve(sc, SINC_MAX_DATAGRAM_BYTES + SINC_HEADER_LENGTH))
+                return false;
 
-                // Read the datagram.
-                readBufAvailable = (int)(sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len);
-                bufPos = &sc->readBuf.cbuf.data[sc->readBuf.cbuf.len];
-                bytesRead = (size_t)readBufAvailable - SINC_HEADER_LENGTH;
-                errCode = SincSocketReadDatagram(sc->datagramFd, bufPos + SINC_HEADER_LENGTH, &bytesRead, true);
-                if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
-                {
-                    SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
-                    return false;
-                }
+            // Read the datagram.
+            readBufAvailable = (int)(sc->readBuf.cbuf.alloced - sc->readBuf.cbuf.len);
+            bufPos = &sc->readBuf.cbuf.data[sc->readBuf.cbuf.len];
+            bytesRead = (size_t)readBufAvailable - SINC_HEADER_LENGTH;
+            errCode = SincSocketReadDatagram(sc->datagramFd, bufPos + SINC_HEADER_LENGTH, &bytesRead, true);
+            if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
+            {
+                SincReadErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
+                return false;
+            }
 
-                if (bytesRead > 0)
-                {
-                    // Make a fake SINC header since we don't get them with datagrams.
-                    uint8_t fakeMsgType = SI_TORO__SINC__MESSAGE_TYPE__HISTOGRAM_DATAGRAM_RESPONSE;
-                    if (bytesRead >= 4)
-                        fakeMsgType = bufPos[SINC_HEADER_LENGTH + 6];
+            if (bytesRead == 0)
+                break;
 
-                    SincProtocolEncodeHeaderGeneric(bufPos, (int)bytesRead, fakeMsgType, SINC_RESPONSE_MARKER);
+            // Make a fake SINC header since we don't get them with datagrams.
+            uint8_t fakeMsgType = SI_TORO__SINC__MESSAGE_TYPE__HISTOGRAM_DATAGRAM_RESPONSE;
+            if (bytesRead >= 4)
+                fakeMsgType = bufPos[SINC_HEADER_LENGTH + 6];
 
-                    sc->readBuf.cbuf.len += bytesRead + SINC_HEADER_LENGTH;
-                    readSomeData = true;
-                }
-            }
+            SincProtocolEncodeHeaderGeneric(bufPos, (int)bytesRead, fakeMsgType, SINC_RESPONSE_MARKER);
 
-        } while (readAvailable[0] || readAvailable[1]);
+            sc->readBuf.cbuf.len += bytesRead + SINC_HEADER_LENGTH;
+            readSomeData = true;
+        }
 
         // Try to get a message from the read buffer.
         if (readSomeData)
         {
 #ifdef PROTOCOL_VERBOSE_DEBUG
-            printf("read some data: %ld bytes in buffer\n", sc->readBuf.buf.len);
+            printf("read some data: %ld bytes in buffer\n", sc->readBuf.cbuf.len);
 #endif
             SincGetNextPacketFromBuffer(&sc->readBuf, msgType, buf, &packetFound);
             if (packetFound)
                 return true;
         }
 
-        // Wait for more data?
-        if (!SincWaitForData(sc, timeout, readAvailable))
-            return false;
-
+        // We've drained the socket so there's no point in waiting if we're polling.
         if (timeout == 0)
         {
             SincReadErrorSetCode(sc, SI_TORO__SINC__ERROR_CODE__TIMEOUT);
             break;
         }
+
+        // Wait for more data.
+        if (!SincWaitForData(sc, timeout, readAvailable))
+            return false;
+
+        sc->readStats.wakeups++;
     }
 
     return false;
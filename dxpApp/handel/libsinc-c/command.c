@@ -426,7 +426,7 @@ bool SincProbeDatagram(Sinc *sc, bool *datagramsOk)
         readOk[0] = false;
         readOk[1] = false;
 
-        err = SincSocketWaitMulti(fds, 2, sc->timeout, readOk);
+        err = sc->transport->waitMulti(sc->transportContext, fds, 2, sc->timeout, readOk);
 
         sc->inSocketWait = false;
 
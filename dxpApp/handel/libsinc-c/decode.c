@@ -18,6 +18,9 @@
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 
+// The largest protobuf header a histogram packet may carry.
+#define SINC_HISTOGRAM_HEADER_MAX_LEN 200
+
 
 /*
  * NAME:        SincDecodeSuccessResponse
@@ -26,7 +29,7 @@
  * PARAMETERS:  SincError *err                            - the sinc error structure.
  *              SincBuffer *packet                        - the de-encapsulated packet to decode.
  *              SiToro__Sinc__SuccessResponse **resp      - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__success_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__success_response__free_unpacked(resp, packet->allocator) after use.
  *              int *fromChannelId                        - set to the received channel id. NULL to not use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
@@ -35,7 +38,7 @@
 bool SincDecodeSuccessResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__SuccessResponse **resp, int *fromChannelId)
 {
     int ok;
-    SiToro__Sinc__SuccessResponse *r = si_toro__sinc__success_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__SuccessResponse *r = si_toro__sinc__success_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -51,7 +54,7 @@ bool SincDecodeSuccessResponse(SincError *err, SincBuffer *packet, SiToro__Sinc_
     ok = SincInterpretSuccessError(err, r);
 
     if (resp == NULL)
-        si_toro__sinc__success_response__free_unpacked(r, NULL);
+        si_toro__sinc__success_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -63,7 +66,7 @@ bool SincDecodeSuccessResponse(SincError *err, SincBuffer *packet, SiToro__Sinc_
  * PARAMETERS:  SincError *err                            - the sinc error structure.
  *              SincBuffer *packet                        - the de-encapsulated packet to decode.
  *              SiToro__Sinc__GetParamResponse **resp     - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__get_param_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__get_param_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -71,7 +74,7 @@ bool SincDecodeSuccessResponse(SincError *err, SincBuffer *packet, SiToro__Sinc_
 bool SincDecodeGetParamResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__GetParamResponse **resp, int *fromChannelId)
 {
     int ok;
-    SiToro__Sinc__GetParamResponse *r = si_toro__sinc__get_param_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__GetParamResponse *r = si_toro__sinc__get_param_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -87,7 +90,7 @@ bool SincDecodeGetParamResponse(SincError *err, SincBuffer *packet, SiToro__Sinc
     ok = SincInterpretSuccessError(err, r->success);
 
     if (resp == NULL)
-        si_toro__sinc__get_param_response__free_unpacked(r, NULL);
+        si_toro__sinc__get_param_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -99,14 +102,14 @@ bool SincDecodeGetParamResponse(SincError *err, SincBuffer *packet, SiToro__Sinc
  * PARAMETERS:  SincError *err                            - the sinc error structure.
  *              SincBuffer *packet                        - the de-encapsulated packet to decode.
  *              SiToro__Sinc__GetParamResponse **resp     - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__param_updated_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__param_updated_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
 
 bool SincDecodeParamUpdatedResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__ParamUpdatedResponse **resp, int *fromChannelId)
 {
-    SiToro__Sinc__ParamUpdatedResponse *r = si_toro__sinc__param_updated_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__ParamUpdatedResponse *r = si_toro__sinc__param_updated_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -120,7 +123,7 @@ bool SincDecodeParamUpdatedResponse(SincError *err, SincBuffer *packet, SiToro__
         *fromChannelId = r->channelid + packet->channelIdOffset;
 
     if (resp == NULL)
-        si_toro__sinc__param_updated_response__free_unpacked(r, NULL);
+        si_toro__sinc__param_updated_response__free_unpacked(r, packet->allocator);
 
     return true;
 }
@@ -132,7 +135,7 @@ bool SincDecodeParamUpdatedResponse(SincError *err, SincBuffer *packet, SiToro__
  * PARAMETERS:  SincError *err                            - the sinc error structure.
  *              SincBuffer *packet                        - the de-encapsulated packet to decode.
  *              SiToro__Sinc__CalibrationProgressResponse **resp      - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__calbration_progress_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__calbration_progress_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -140,7 +143,7 @@ bool SincDecodeParamUpdatedResponse(SincError *err, SincBuffer *packet, SiToro__
 bool SincDecodeCalibrationProgressResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__CalibrationProgressResponse **resp, double *progress, int *complete, char **stage, int *fromChannelId)
 {
     int ok;
-    SiToro__Sinc__CalibrationProgressResponse *r = si_toro__sinc__calibration_progress_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__CalibrationProgressResponse *r = si_toro__sinc__calibration_progress_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -165,7 +168,7 @@ bool SincDecodeCalibrationProgressResponse(SincError *err, SincBuffer *packet, S
     ok = SincInterpretSuccessError(err, r->success);
 
     if (resp == NULL)
-        si_toro__sinc__calibration_progress_response__free_unpacked(r, NULL);
+        si_toro__sinc__calibration_progress_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -177,7 +180,7 @@ bool SincDecodeCalibrationProgressResponse(SincError *err, SincBuffer *packet, S
  * PARAMETERS:  Sinc *sc                                     - the sinc connection.
  *              SincBuffer *packet                           - the de-encapsulated packet to decode.
  *              SiToro__Sinc__GetCalibrationResponse **resp  - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__get_calibration_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__get_calibration_response__free_unpacked(resp, packet->allocator) after use.
  *              SincCalibrationData *calibData  - the calibration data is stored here.
  *              calibData must be free()d after use.
  *              SincPlot *example, model, final - the pulse shapes are set here.
@@ -202,7 +205,7 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
         memset(final, 0, sizeof(*final));
 
     // Unpack the packet.
-    SiToro__Sinc__GetCalibrationResponse *r = si_toro__sinc__get_calibration_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__GetCalibrationResponse *r = si_toro__sinc__get_calibration_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -215,7 +218,7 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
     // Check success.
     if (!SincInterpretSuccessError(err, r->success))
     {
-        si_toro__sinc__get_calibration_response__free_unpacked(r, NULL);
+        si_toro__sinc__get_calibration_response__free_unpacked(r, packet->allocator);
         if (resp)
         {
             *resp = NULL;
@@ -237,7 +240,7 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
             if (calibData->data == NULL)
             {
                 SincErrorSetCode(err, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
-                si_toro__sinc__get_calibration_response__free_unpacked(r, NULL);
+                si_toro__sinc__get_calibration_response__free_unpacked(r, packet->allocator);
                 return false;
             }
 
@@ -250,14 +253,14 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
          (model != NULL   && !SincCopyCalibrationPulse(err, model,   (int)r->n_modely,   r->modelx,   r->modely)) ||
          (final != NULL   && !SincCopyCalibrationPulse(err, final,   (int)r->n_finaly,   r->finalx,   r->finaly)) )
     {
-        si_toro__sinc__get_calibration_response__free_unpacked(r, NULL);
+        si_toro__sinc__get_calibration_response__free_unpacked(r, packet->allocator);
         SincSFreeCalibration(calibData, example, model, final);
         return false;
     }
 
     // Clean up.
     if (resp == NULL)
-        si_toro__sinc__get_calibration_response__free_unpacked(r, NULL);
+        si_toro__sinc__get_calibration_response__free_unpacked(r, packet->allocator);
 
     return true;
 }
@@ -269,7 +272,7 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
  * PARAMETERS:  Sinc *sc                            - the channel to listen to.
  *              SincBuffer *packet                  - the de-encapsulated packet to decode.
  *              SiToro__Sinc__CalculateDCOffsetResponse **resp      - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__calculate_dc_offset_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__calculate_dc_offset_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -277,7 +280,7 @@ bool SincDecodeGetCalibrationResponse(SincError *err, SincBuffer *packet, SiToro
 bool SincDecodeCalculateDCOffsetResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__CalculateDcOffsetResponse **resp, double *dcOffset, int *fromChannelId)
 {
     int ok;
-    SiToro__Sinc__CalculateDcOffsetResponse *r = si_toro__sinc__calculate_dc_offset_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__CalculateDcOffsetResponse *r = si_toro__sinc__calculate_dc_offset_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -297,7 +300,7 @@ bool SincDecodeCalculateDCOffsetResponse(SincError *err, SincBuffer *packet, SiT
 
     // Clean up.
     if (resp == NULL)
-        si_toro__sinc__calculate_dc_offset_response__free_unpacked(r, NULL);
+        si_toro__sinc__calculate_dc_offset_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -309,7 +312,7 @@ bool SincDecodeCalculateDCOffsetResponse(SincError *err, SincBuffer *packet, SiT
  * PARAMETERS:  Sinc *sc                                      - the channel to listen to.
  *              SincBuffer *packet                            - the de-encapsulated packet to decode.
  *              SiToro__Sinc__ListParamDetailsResponse **resp - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -317,7 +320,7 @@ bool SincDecodeCalculateDCOffsetResponse(SincError *err, SincBuffer *packet, SiT
 bool SincDecodeListParamDetailsResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__ListParamDetailsResponse **resp, int *fromChannelId)
 {
     int ok;
-    SiToro__Sinc__ListParamDetailsResponse *r = si_toro__sinc__list_param_details_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__ListParamDetailsResponse *r = si_toro__sinc__list_param_details_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -333,7 +336,7 @@ bool SincDecodeListParamDetailsResponse(SincError *err, SincBuffer *packet, SiTo
     ok = SincInterpretSuccessError(err, r->success);
 
     if (resp == NULL)
-        si_toro__sinc__list_param_details_response__free_unpacked(r, NULL);
+        si_toro__sinc__list_param_details_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -345,7 +348,7 @@ bool SincDecodeListParamDetailsResponse(SincError *err, SincBuffer *packet, SiTo
  * PARAMETERS:  Sinc *sc                                    - the channel to listen to.
  *              SincBuffer *packet                          - the de-encapsulated packet to decode.
  *              SiToro__Sinc__SynchronizeLogResponse **resp - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__synchronize_log_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__synchronize_log_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -353,7 +356,7 @@ bool SincDecodeListParamDetailsResponse(SincError *err, SincBuffer *packet, SiTo
 bool SincDecodeSynchronizeLogResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__SynchronizeLogResponse **resp)
 {
     int ok;
-    SiToro__Sinc__SynchronizeLogResponse *r = si_toro__sinc__synchronize_log_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__SynchronizeLogResponse *r = si_toro__sinc__synchronize_log_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -366,7 +369,7 @@ bool SincDecodeSynchronizeLogResponse(SincError *err, SincBuffer *packet, SiToro
     ok = SincInterpretSuccessError(err, r->success);
 
     if (resp == NULL)
-        si_toro__sinc__synchronize_log_response__free_unpacked(r, NULL);
+        si_toro__sinc__synchronize_log_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -378,7 +381,7 @@ bool SincDecodeSynchronizeLogResponse(SincError *err, SincBuffer *packet, SiToro
  * PARAMETERS:  Sinc *sc                                      - the channel to listen to.
  *              SincBuffer *packet                            - the de-encapsulated packet to decode.
  *              SiToro__Sinc__ListParamDetailsResponse **resp - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
@@ -386,7 +389,7 @@ bool SincDecodeSynchronizeLogResponse(SincError *err, SincBuffer *packet, SiToro
 bool SincDecodeMonitorChannelsCommand(SincError *err, SincBuffer *packet, uint64_t *channelBitSet)
 {
     unsigned int i;
-    SiToro__Sinc__MonitorChannelsCommand *cmd = si_toro__sinc__monitor_channels_command__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__MonitorChannelsCommand *cmd = si_toro__sinc__monitor_channels_command__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
 
     if (cmd == NULL)
     {
@@ -398,7 +401,7 @@ bool SincDecodeMonitorChannelsCommand(SincError *err, SincBuffer *packet, uint64
     for (i = 0; i < cmd->n_channelid; i++)
         *channelBitSet |= (((uint64_t)1) << cmd->channelid[i]);
 
-    si_toro__sinc__monitor_channels_command__free_unpacked(cmd, NULL);
+    si_toro__sinc__monitor_channels_command__free_unpacked(cmd, packet->allocator);
 
     return true;
 }
@@ -590,7 +593,7 @@ bool SincDecodeOscilloscopeDataResponse(SincError *err, SincBuffer *packet, int
     }
 
     // Unpack it.
-    resp = si_toro__sinc__oscilloscope_data_response__unpack(NULL, protobufHeaderLen, &packet->cbuf.data[startPos]);
+    resp = si_toro__sinc__oscilloscope_data_response__unpack(packet->allocator, protobufHeaderLen, &packet->cbuf.data[startPos]);
     if (resp == NULL)
     {
         SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted oscilloscope packet");
@@ -710,7 +713,7 @@ bool SincDecodeOscilloscopeDataResponse(SincError *err, SincBuffer *packet, int
         }
     }
 
-    si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, NULL);
+    si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, packet->allocator);
 
     return true;
 
@@ -718,7 +721,7 @@ bool SincDecodeOscilloscopeDataResponse(SincError *err, SincBuffer *packet, int
 errorExitDecodeOsc:
     if (resp != NULL)
     {
-        si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, NULL);
+        si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, packet->allocator);
     }
 
     if (rawCurve != NULL)
@@ -788,7 +791,7 @@ bool SincDecodeOscilloscopeDataResponseAsPlotArray(SincError *err, SincBuffer *p
     }
 
     // Unpack it.
-    SiToro__Sinc__OscilloscopeDataResponse *resp = si_toro__sinc__oscilloscope_data_response__unpack(NULL, protobufHeaderLen, &packet->cbuf.data[startPos]);
+    SiToro__Sinc__OscilloscopeDataResponse *resp = si_toro__sinc__oscilloscope_data_response__unpack(packet->allocator, protobufHeaderLen, &packet->cbuf.data[startPos]);
     if (resp == NULL)
     {
         SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted oscilloscope packet");
@@ -821,6 +824,7 @@ bool SincDecodeOscilloscopeDataResponseAsPlotArray(SincError *err, SincBuffer *p
             plotArray[i].intData = malloc((size_t)plotArray[i].len * sizeof(int32_t));
             if (plotArray[i].intData == NULL)
             {
+                si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, packet->allocator);
                 SincErrorSetCode(err, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
                 goto errorExitDecodeOsc;
             }
@@ -841,6 +845,8 @@ bool SincDecodeOscilloscopeDataResponseAsPlotArray(SincError *err, SincBuffer *p
         *plotArraySize = numIntPlots;
     }
 
+    si_toro__sinc__oscilloscope_data_response__free_unpacked(resp, packet->allocator);
+
     return true;
 
     /* Using a linux kernel-style cleanup method to make sure resources are freed on any failure. */
@@ -860,6 +866,157 @@ errorExitDecodeOsc:
 }
 
 
+/*
+ * NAME:        SincScanVarint
+ * ACTION:      Reads a protobuf base 128 varint.
+ * PARAMETERS:  const uint8_t **pos - the read position. Advanced past the varint.
+ *              const uint8_t *end  - the end of the buffer.
+ *              uint64_t *val       - the value is written here.
+ * RETURNS:     true on success, false if the varint is truncated or too long.
+ */
+
+static inline bool SincScanVarint(const uint8_t **pos, const uint8_t *end, uint64_t *val)
+{
+    const uint8_t *p = *pos;
+    uint64_t v = 0;
+    unsigned int shift;
+
+    // Most keys and small values fit in one byte.
+    if (p < end && (*p & 0x80) == 0)
+    {
+        *val = *p;
+        *pos = p + 1;
+        return true;
+    }
+
+    for (shift = 0; shift < 64 && p < end; shift += 7)
+    {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+        {
+            *val = v;
+            *pos = p;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+ * NAME:        SincScanHistogramHeader
+ * ACTION:      A fast path for decoding the protobuf header of a histogram packet.
+ *              Scans the fields of a HistogramDataResponse directly instead of
+ *              using the generic protobuf-c unpacker. Only the fields we know
+ *              about are handled - anything else makes the scan fail so the
+ *              caller can fall back to the generic unpacker.
+ * PARAMETERS:  const uint8_t *data  - the protobuf header.
+ *              size_t len           - the length of the header. At most SINC_HISTOGRAM_HEADER_MAX_LEN.
+ *              SiToro__Sinc__HistogramDataResponse *resp - an initialised response to fill in.
+ *              uint32_t *plotLen    - storage for resp->plotlen. SINC_HISTOGRAM_HEADER_MAX_LEN entries.
+ *              uint32_t *intensity  - storage for resp->intensity. SINC_HISTOGRAM_HEADER_MAX_LEN entries.
+ * RETURNS:     true if the header was fully decoded, false otherwise.
+ */
+
+static bool SincScanHistogramHeader(const uint8_t *data, size_t len, SiToro__Sinc__HistogramDataResponse *resp, uint32_t *plotLen, uint32_t *intensity)
+{
+    const uint8_t *pos = data;
+    const uint8_t *end = data + len;
+    const uint8_t *packedEnd;
+    double val_double;
+    uint64_t key;
+    uint64_t v;
+
+    resp->plotlen = plotLen;
+    resp->intensity = intensity;
+
+    while (pos < end)
+    {
+        if (!SincScanVarint(&pos, end, &key))
+            return false;
+
+        switch (key & 0x7)
+        {
+        case 0:
+            // Varint.
+            if (!SincScanVarint(&pos, end, &v))
+                return false;
+
+            switch (key >> 3)
+            {
+            case 2:  resp->has_datasetid = true;              resp->datasetid = v; break;
+            case 4:  resp->has_samplesdetected = true;        resp->samplesdetected = v; break;
+            case 5:  resp->has_sampleserased = true;          resp->sampleserased = v; break;
+            case 6:  resp->has_pulsesaccepted = true;         resp->pulsesaccepted = v; break;
+            case 7:  resp->has_pulsesrejected = true;         resp->pulsesrejected = v; break;
+            case 11: resp->has_gatestate = true;              resp->gatestate = (uint32_t)v; break;
+            case 12: resp->has_spectrumselectionmask = true;  resp->spectrumselectionmask = (uint32_t)v; break;
+            case 13: resp->has_subregionstartindex = true;    resp->subregionstartindex = (uint32_t)v; break;
+            case 14: resp->has_subregionendindex = true;      resp->subregionendindex = (uint32_t)v; break;
+            case 15: resp->has_refreshrate = true;            resp->refreshrate = (uint32_t)v; break;
+            case 17: resp->has_channelid = true;              resp->channelid = (int32_t)v; break;
+            case 18: resp->has_positiverailhitcount = true;   resp->positiverailhitcount = (uint32_t)v; break;
+            case 19: resp->has_negativerailhitcount = true;   resp->negativerailhitcount = (uint32_t)v; break;
+            case 20: resp->has_trigger = true;                resp->trigger = (SiToro__Sinc__HistogramTrigger)v; break;
+
+            // Each element of a repeated field takes at least one byte of the
+            // header so the storage can't overflow.
+            case 16: plotLen[resp->n_plotlen++] = (uint32_t)v; break;
+            case 21: intensity[resp->n_intensity++] = (uint32_t)v; break;
+            default: return false;
+            }
+            break;
+
+        case 1:
+            // 64 bit.
+            if (end - pos < 8)
+                return false;
+
+            (void)SINC_PROTOCOL_READ_DOUBLE(pos);
+            pos += 8;
+
+            switch (key >> 3)
+            {
+            case 3:  resp->has_timeelapsed = true;      resp->timeelapsed = val_double; break;
+            case 8:  resp->has_inputcountrate = true;   resp->inputcountrate = val_double; break;
+            case 9:  resp->has_outputcountrate = true;  resp->outputcountrate = val_double; break;
+            case 10: resp->has_deadtimepercent = true;  resp->deadtimepercent = val_double; break;
+            default: return false;
+            }
+            break;
+
+        case 2:
+            // Length delimited - only packed repeated fields are expected.
+            if ((key >> 3) != 16 && (key >> 3) != 21)
+                return false;
+
+            if (!SincScanVarint(&pos, end, &v) || v > (uint64_t)(end - pos))
+                return false;
+
+            packedEnd = pos + v;
+            while (pos < packedEnd)
+            {
+                if (!SincScanVarint(&pos, packedEnd, &v))
+                    return false;
+
+                if ((key >> 3) == 16)
+                    plotLen[resp->n_plotlen++] = (uint32_t)v;
+                else
+                    intensity[resp->n_intensity++] = (uint32_t)v;
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 /*
  * NAME:        SincDecodeHistogramDataResponse
  * ACTION:      Decodes an update from the histogram. Waits for the next histogram update to
@@ -897,18 +1054,27 @@ bool SincDecodeHistogramDataResponse(SincError *err, SincBuffer *packet, int *fr
         startPos += sizeof(uint32_t);
     }
 
-    if (protobufHeaderLen > 200 || protobufHeaderLen + startPos > packet->cbuf.len)
+    if (protobufHeaderLen > SINC_HISTOGRAM_HEADER_MAX_LEN || protobufHeaderLen + startPos > packet->cbuf.len)
     {
         SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted histogram packet");
         return false;
     }
 
-    SiToro__Sinc__HistogramDataResponse *resp = si_toro__sinc__histogram_data_response__unpack(NULL, protobufHeaderLen, &packet->cbuf.data[startPos]);
-    if (resp == NULL)
+    // Try the fast header scanner first and fall back to the generic unpacker
+    // for anything it doesn't understand.
+    SiToro__Sinc__HistogramDataResponse scanned = SI_TORO__SINC__HISTOGRAM_DATA_RESPONSE__INIT;
+    uint32_t scannedPlotLen[SINC_HISTOGRAM_HEADER_MAX_LEN];
+    uint32_t scannedIntensity[SINC_HISTOGRAM_HEADER_MAX_LEN];
+    SiToro__Sinc__HistogramDataResponse *resp = &scanned;
+
+    if (!SincScanHistogramHeader(&packet->cbuf.data[startPos], protobufHeaderLen, &scanned, scannedPlotLen, scannedIntensity))
     {
-        SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted histogram header");
-        si_toro__sinc__histogram_data_response__free_unpacked(resp, NULL);
-        return false;
+        resp = si_toro__sinc__histogram_data_response__unpack(packet->allocator, protobufHeaderLen, &packet->cbuf.data[startPos]);
+        if (resp == NULL)
+        {
+            SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted histogram header");
+            return false;
+        }
     }
 
     // Get the channel.
@@ -984,6 +1150,12 @@ bool SincDecodeHistogramDataResponse(SincError *err, SincBuffer *packet, int *fr
         if (resp->has_refreshrate)
             stats->refreshRate = resp->refreshrate;
 
+        if (resp->has_positiverailhitcount)
+            stats->positiveRailHitCount = resp->positiverailhitcount;
+
+        if (resp->has_negativerailhitcount)
+            stats->negativeRailHitCount = resp->negativerailhitcount;
+
         if (resp->has_trigger)
             stats->trigger = resp->trigger;
 
@@ -994,6 +1166,9 @@ bool SincDecodeHistogramDataResponse(SincError *err, SincBuffer *packet, int *fr
             if (stats->intensityData == NULL)
             {
                 SincErrorSetCode(err, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
+                if (resp != &scanned)
+                    si_toro__sinc__histogram_data_response__free_unpacked(resp, packet->allocator);
+
                 goto errorExit;
             }
 
@@ -1001,7 +1176,8 @@ bool SincDecodeHistogramDataResponse(SincError *err, SincBuffer *packet, int *fr
         }
     }
 
-    si_toro__sinc__histogram_data_response__free_unpacked(resp, NULL);
+    if (resp != &scanned)
+        si_toro__sinc__histogram_data_response__free_unpacked(resp, packet->allocator);
 
     // Copy the accepted data.
     uint8_t *bPos = &packet->cbuf.data[protobufHeaderLen + 2];  // Skip the initial protocol buffer info.
@@ -1331,11 +1507,11 @@ bool SincDecodeListModeDataResponse(SincError *err, SincBuffer *packet, int *fro
         return false;
     }
 
-    SiToro__Sinc__ListModeDataResponse *resp = si_toro__sinc__list_mode_data_response__unpack(NULL, protobufHeaderLen, &packet->cbuf.data[startPos]);
+    SiToro__Sinc__ListModeDataResponse *resp = si_toro__sinc__list_mode_data_response__unpack(packet->allocator, protobufHeaderLen, &packet->cbuf.data[startPos]);
     if (resp == NULL)
     {
         SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted list mode header");
-        si_toro__sinc__list_mode_data_response__free_unpacked(resp, NULL);
+        si_toro__sinc__list_mode_data_response__free_unpacked(resp, packet->allocator);
         return false;
     }
 
@@ -1351,7 +1527,7 @@ bool SincDecodeListModeDataResponse(SincError *err, SincBuffer *packet, int *fro
     if (dataSetId != NULL && resp->has_datasetid)
         *dataSetId = resp->datasetid;
 
-    si_toro__sinc__list_mode_data_response__free_unpacked(resp, NULL);
+    si_toro__sinc__list_mode_data_response__free_unpacked(resp, packet->allocator);
 
     // Get the list mode data.
     uint8_t *bPos = &packet->cbuf.data[protobufHeaderLen + 2];  // Skip the initial protocol buffer info.
@@ -1385,7 +1561,7 @@ bool SincDecodeListModeDataResponse(SincError *err, SincBuffer *packet, int *fro
  * PARAMETERS:  SincError *err                                 - the sinc error structure.
  *              SincBuffer *packet                             - the de-encapsulated packet to decode.
  *              SiToro__Sinc__AsynchronousErrorResponse **resp - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__asynchronous_error_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__asynchronous_error_response__free_unpacked(resp, packet->allocator) after use.
  *              int *fromChannelId                        - set to the received channel id. NULL to not use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
@@ -1393,7 +1569,7 @@ bool SincDecodeListModeDataResponse(SincError *err, SincBuffer *packet, int *fro
 
 bool SincDecodeAsynchronousErrorResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__AsynchronousErrorResponse **resp, int *fromChannelId)
 {
-    SiToro__Sinc__AsynchronousErrorResponse *r = si_toro__sinc__asynchronous_error_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__AsynchronousErrorResponse *r = si_toro__sinc__asynchronous_error_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -1413,7 +1589,7 @@ bool SincDecodeAsynchronousErrorResponse(SincError *err, SincBuffer *packet, SiT
     }
 
     if (resp == NULL)
-        si_toro__sinc__asynchronous_error_response__free_unpacked(r, NULL);
+        si_toro__sinc__asynchronous_error_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -1430,7 +1606,7 @@ bool SincDecodeAsynchronousErrorResponse(SincError *err, SincBuffer *packet, SiT
 
 bool SincDecodeSoftwareUpdateCompleteResponse(SincError *err, SincBuffer *packet)
 {
-    SiToro__Sinc__SoftwareUpdateCompleteResponse *r = si_toro__sinc__software_update_complete_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__SoftwareUpdateCompleteResponse *r = si_toro__sinc__software_update_complete_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (r == NULL)
     {
         SincErrorSetMessage(err, SI_TORO__SINC__ERROR_CODE__READ_FAILED, "corrupted software update complete packet");
@@ -1443,7 +1619,7 @@ bool SincDecodeSoftwareUpdateCompleteResponse(SincError *err, SincBuffer *packet
         ok = SincInterpretSuccessError(err, r->success);
     }
 
-    si_toro__sinc__software_update_complete_response__free_unpacked(r, NULL);
+    si_toro__sinc__software_update_complete_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -1455,14 +1631,14 @@ bool SincDecodeSoftwareUpdateCompleteResponse(SincError *err, SincBuffer *packet
  * PARAMETERS:  SincError *err                                 - the sinc error structure.
  *              SincBuffer *packet                             - the de-encapsulated packet to decode.
  *              SiToro__Sinc__ListParamDetailsResponse **resp - where to put the response received. NULL to not use.
- *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, NULL) after use.
+ *                  This message should be freed with si_toro__sinc__list_param_details_response__free_unpacked(resp, packet->allocator) after use.
  * RETURNS:     true on success, false otherwise. On failure use SincErrno() and
  *                  SincStrError() to get the error status.
  */
 
 bool SincDecodeCheckParamConsistencyResponse(SincError *err, SincBuffer *packet, SiToro__Sinc__CheckParamConsistencyResponse **resp, int *fromChannelId)
 {
-    SiToro__Sinc__CheckParamConsistencyResponse *r = si_toro__sinc__check_param_consistency_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__CheckParamConsistencyResponse *r = si_toro__sinc__check_param_consistency_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
     if (resp != NULL)
         *resp = r;
 
@@ -1482,7 +1658,7 @@ bool SincDecodeCheckParamConsistencyResponse(SincError *err, SincBuffer *packet,
     }
 
     if (resp == NULL)
-        si_toro__sinc__check_param_consistency_response__free_unpacked(r, NULL);
+        si_toro__sinc__check_param_consistency_response__free_unpacked(r, packet->allocator);
 
     return ok;
 }
@@ -1502,7 +1678,7 @@ bool SincDecodeCheckParamConsistencyResponse(SincError *err, SincBuffer *packet,
 
 bool SincDecodeDownloadCrashDumpResponse(SincError *err, SincBuffer *packet, bool *newDump, uint8_t **dumpData, size_t *dumpSize)
 {
-    SiToro__Sinc__DownloadCrashDumpResponse *r = si_toro__sinc__download_crash_dump_response__unpack(NULL, packet->cbuf.len, packet->cbuf.data);
+    SiToro__Sinc__DownloadCrashDumpResponse *r = si_toro__sinc__download_crash_dump_response__unpack(packet->allocator, packet->cbuf.len, packet->cbuf.data);
 
     if (r == NULL)
     {
@@ -1514,7 +1690,7 @@ bool SincDecodeDownloadCrashDumpResponse(SincError *err, SincBuffer *packet, boo
     {
         if (!SincInterpretSuccessError(err, r->success))
         {
-            si_toro__sinc__download_crash_dump_response__free_unpacked(r, NULL);
+            si_toro__sinc__download_crash_dump_response__free_unpacked(r, packet->allocator);
             return false;
         }
     }
@@ -1533,7 +1709,7 @@ bool SincDecodeDownloadCrashDumpResponse(SincError *err, SincBuffer *packet, boo
         *dumpData = calloc(r->content.len, 1);
         if (!*dumpData)
         {
-            si_toro__sinc__download_crash_dump_response__free_unpacked(r, NULL);
+            si_toro__sinc__download_crash_dump_response__free_unpacked(r, packet->allocator);
             SincErrorSetCode(err, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY);
             return false;
         }
@@ -1542,7 +1718,7 @@ bool SincDecodeDownloadCrashDumpResponse(SincError *err, SincBuffer *packet, boo
         *dumpSize = r->content.len;
     }
 
-    si_toro__sinc__download_crash_dump_response__free_unpacked(r, NULL);
+    si_toro__sinc__download_crash_dump_response__free_unpacked(r, packet->allocator);
 
     return true;
 }
@@ -0,0 +1,262 @@
+/********************************************************************
+ ***                                                              ***
+ ***                libsinc histogram decode test                 ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * Checks the fast histogram header scanner in SincDecodeHistogramDataResponse()
+ * against the generic protobuf-c unpacker, then times the two. Doesn't need
+ * any hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sinc.h"
+
+#define NUM_RANDOM_TESTS  100000
+#define NUM_TIMING_LOOPS  1000000
+#define PLOT_LEN          16
+
+
+static int failures = 0;
+
+
+// Fills a histogram header with random fields.
+static void randomHeader(SiToro__Sinc__HistogramDataResponse *resp, uint32_t *plotLen, uint32_t *intensity)
+{
+    si_toro__sinc__histogram_data_response__init(resp);
+
+    resp->has_datasetid = rand() & 1;           resp->datasetid = ((uint64_t)rand() << 32) | rand();
+    resp->has_timeelapsed = rand() & 1;         resp->timeelapsed = rand() / 1000.0;
+    resp->has_samplesdetected = rand() & 1;     resp->samplesdetected = ((uint64_t)rand() << 20) | rand();
+    resp->has_sampleserased = rand() & 1;       resp->sampleserased = rand();
+    resp->has_pulsesaccepted = rand() & 1;      resp->pulsesaccepted = rand();
+    resp->has_pulsesrejected = rand() & 1;      resp->pulsesrejected = rand() & 0xff;
+    resp->has_inputcountrate = rand() & 1;      resp->inputcountrate = rand() / 7.0;
+    resp->has_outputcountrate = rand() & 1;     resp->outputcountrate = rand() / 9.0;
+    resp->has_deadtimepercent = rand() & 1;     resp->deadtimepercent = (rand() % 10000) / 100.0;
+    resp->has_gatestate = rand() & 1;           resp->gatestate = rand() & 1;
+    resp->has_spectrumselectionmask = true;     resp->spectrumselectionmask = rand() & 3;
+    resp->has_subregionstartindex = rand() & 1; resp->subregionstartindex = rand() & 0xfff;
+    resp->has_subregionendindex = rand() & 1;   resp->subregionendindex = rand() & 0xfff;
+    resp->has_refreshrate = rand() & 1;         resp->refreshrate = rand() & 0xffff;
+    resp->has_channelid = rand() & 1;           resp->channelid = (rand() % 64) - 8;
+    resp->has_positiverailhitcount = rand() & 1; resp->positiverailhitcount = rand();
+    resp->has_negativerailhitcount = rand() & 1; resp->negativerailhitcount = rand();
+    resp->has_trigger = rand() & 1;             resp->trigger = rand() & 3;
+
+    plotLen[0] = PLOT_LEN;
+    plotLen[1] = PLOT_LEN;
+    resp->n_plotlen = 2;
+    resp->plotlen = plotLen;
+
+    resp->n_intensity = rand() % 4;
+    resp->intensity = intensity;
+    size_t i;
+    for (i = 0; i < resp->n_intensity; i++)
+    {
+        intensity[i] = rand();
+    }
+}
+
+
+// Builds a histogram packet from a protobuf header and two plots.
+static void buildPacket(SincBuffer *packet, const uint8_t *header, size_t headerLen)
+{
+    uint16_t len16 = (uint16_t)headerLen;
+    uint32_t plot[PLOT_LEN * 2];
+    int i;
+
+    for (i = 0; i < PLOT_LEN * 2; i++)
+    {
+        plot[i] = (uint32_t)i * 3;
+    }
+
+    packet->cbuf.len = 0;
+    packet->cbuf.base.append(&packet->cbuf.base, sizeof(len16), (uint8_t *)&len16);
+    packet->cbuf.base.append(&packet->cbuf.base, headerLen, header);
+    packet->cbuf.base.append(&packet->cbuf.base, sizeof(plot), (uint8_t *)plot);
+}
+
+
+// Decodes the stats using the generic unpacker.
+static bool referenceDecode(SincBuffer *packet, int *channelId, SincHistogramCountStats *stats)
+{
+    uint16_t headerLen;
+    memcpy(&headerLen, packet->cbuf.data, sizeof(headerLen));
+
+    SiToro__Sinc__HistogramDataResponse *resp = si_toro__sinc__histogram_data_response__unpack(NULL, headerLen, &packet->cbuf.data[2]);
+    if (resp == NULL)
+        return false;
+
+    memset(stats, 0, sizeof(*stats));
+    *channelId = resp->has_channelid ? resp->channelid : -1;
+    stats->dataSetId = resp->datasetid;
+    stats->timeElapsed = resp->timeelapsed;
+    stats->samplesDetected = resp->samplesdetected;
+    stats->samplesErased = resp->sampleserased;
+    stats->pulsesAccepted = resp->pulsesaccepted;
+    stats->pulsesRejected = resp->pulsesrejected;
+    stats->inputCountRate = resp->inputcountrate;
+    stats->outputCountRate = resp->outputcountrate;
+    stats->deadTime = resp->deadtimepercent;
+    stats->gateState = (int)resp->gatestate;
+    stats->spectrumSelectionMask = resp->spectrumselectionmask;
+    stats->subRegionStartIndex = resp->subregionstartindex;
+    stats->subRegionEndIndex = resp->subregionendindex;
+    stats->refreshRate = resp->refreshrate;
+    stats->positiveRailHitCount = resp->positiverailhitcount;
+    stats->negativeRailHitCount = resp->negativerailhitcount;
+    stats->trigger = resp->trigger;
+    stats->numIntensity = (uint32_t)resp->n_intensity;
+    stats->intensityData = NULL;
+    if (resp->n_intensity > 0)
+    {
+        stats->intensityData = calloc(resp->n_intensity, sizeof(uint32_t));
+        memcpy(stats->intensityData, resp->intensity, resp->n_intensity * sizeof(uint32_t));
+    }
+
+    si_toro__sinc__histogram_data_response__free_unpacked(resp, NULL);
+
+    return true;
+}
+
+
+// Decodes a packet both ways and compares the results.
+static void check(const char *name, SincBuffer *packet)
+{
+    SincError err;
+    SincHistogramCountStats stats;
+    SincHistogramCountStats refStats;
+    SincHistogram accepted;
+    SincHistogram rejected;
+    int channelId;
+    int refChannelId;
+
+    memset(&err, 0, sizeof(err));
+    bool ok = SincDecodeHistogramDataResponse(&err, packet, &channelId, &accepted, &rejected, &stats);
+    bool refOk = referenceDecode(packet, &refChannelId, &refStats);
+    if (ok != refOk)
+    {
+        printf("%s: decode result mismatch (fast %d, generic %d)\n", name, ok, refOk);
+        failures++;
+        return;
+    }
+
+    if (!ok)
+        return;
+
+    uint32_t *intensity = stats.intensityData;
+    uint32_t *refIntensity = refStats.intensityData;
+    stats.intensityData = NULL;
+    refStats.intensityData = NULL;
+
+    if (channelId != refChannelId ||
+        memcmp(&stats, &refStats, sizeof(stats)) != 0 ||
+        (stats.numIntensity > 0 && memcmp(intensity, refIntensity, stats.numIntensity * sizeof(uint32_t)) != 0))
+    {
+        printf("%s: stats mismatch\n", name);
+        failures++;
+    }
+
+    free(intensity);
+    free(refIntensity);
+    free(accepted.data);
+    free(rejected.data);
+}
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+int main()
+{
+    uint8_t pad[1024];
+    SincBuffer packet = SINC_BUFFER_INIT(pad);
+    SiToro__Sinc__HistogramDataResponse resp;
+    uint32_t plotLen[2];
+    uint32_t intensity[4];
+    uint8_t header[256];
+    size_t headerLen;
+    int i;
+
+    printf("sinc histogram decode test.\n");
+    srand(1234);
+
+    // Random headers as protobuf-c encodes them.
+    for (i = 0; i < NUM_RANDOM_TESTS; i++)
+    {
+        randomHeader(&resp, plotLen, intensity);
+        headerLen = si_toro__sinc__histogram_data_response__pack(&resp, header);
+        buildPacket(&packet, header, headerLen);
+        check("random", &packet);
+    }
+
+    // Packed repeated fields: plotLen = { 16, 16 }, intensity = { 1, 300 }.
+    {
+        static const uint8_t packed[] = { 0x60, 0x03, 0x82, 0x01, 0x02, 0x10, 0x10, 0xaa, 0x01, 0x03, 0x01, 0xac, 0x02 };
+        buildPacket(&packet, packed, sizeof(packed));
+        check("packed", &packet);
+    }
+
+    // An unknown field forces the fallback to the generic unpacker.
+    randomHeader(&resp, plotLen, intensity);
+    headerLen = si_toro__sinc__histogram_data_response__pack(&resp, header);
+    header[headerLen++] = 0xf0;     // Field 30, varint.
+    header[headerLen++] = 0x01;
+    header[headerLen++] = 0x2a;
+    buildPacket(&packet, header, headerLen);
+    check("unknown field", &packet);
+
+    // A truncated header must fail both ways.
+    headerLen = si_toro__sinc__histogram_data_response__pack(&resp, header);
+    buildPacket(&packet, header, headerLen - 1);
+    check("truncated", &packet);
+
+    // Time the fast decode against the generic unpacker.
+    randomHeader(&resp, plotLen, intensity);
+    resp.n_intensity = 0;
+    headerLen = si_toro__sinc__histogram_data_response__pack(&resp, header);
+    buildPacket(&packet, header, headerLen);
+
+    SincError err;
+    SincHistogramCountStats stats;
+    int channelId;
+    double start = now();
+    for (i = 0; i < NUM_TIMING_LOOPS; i++)
+    {
+        SincDecodeHistogramDataResponse(&err, &packet, &channelId, NULL, NULL, &stats);
+    }
+    double fastTime = now() - start;
+
+    start = now();
+    for (i = 0; i < NUM_TIMING_LOOPS; i++)
+    {
+        referenceDecode(&packet, &channelId, &stats);
+    }
+    double genericTime = now() - start;
+
+    printf("header decode: fast %.1f ns, generic %.1f ns\n",
+           fastTime * 1e9 / NUM_TIMING_LOOPS, genericTime * 1e9 / NUM_TIMING_LOOPS);
+
+    SINC_BUFFER_CLEAR(&packet);
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("passed\n");
+
+    return 0;
+}
@@ -21,6 +21,8 @@
 /* The initial size of the input data buffer. */
 #define LMBUF_HEADER_LINE_LEN 28
 #define LMBUF_INITIAL_SIZE 65536
+#define LMBUF_RING_MIRROR_SIZE 4096
+#define LMBUF_RING_READ_END(lm) ( (lm)->ringHead < (lm)->bufSize + LMBUF_RING_MIRROR_SIZE ? (lm)->ringHead : (lm)->bufSize + LMBUF_RING_MIRROR_SIZE )
 #define LMBUF_CHECK_WORD_AVAILABLE(lmbuf, offset) ( (lmbuf)->bufTail + ((offset)+1) * sizeof(uint32_t) < (lmbuf)->bufHead )
 #define LMBUF_RAW_GET_WORD(buf, offset) ( memcpy(&val_u32, ((uint8_t *)(buf)) + ((offset) * sizeof(val_u32)), sizeof(val_u32)), val_u32 )
 #define LMBUF_LM_GET_WORD(lm, offset) ( LMBUF_RAW_GET_WORD(&(lm)->buf[(lm)->bufTail], (offset)) )
@@ -62,6 +64,7 @@ bool LmBufInit(LmBuf *lm)
         return false;
 
     lm->bufSize = LMBUF_INITIAL_SIZE;
+    lm->ring = false;
 
     LmBufClear(lm);
 
@@ -93,11 +96,14 @@ void LmBufClose(LmBuf *lm)
 
 void LmBufClear(LmBuf *lm)
 {
-    lm->bufSize = 0;
+    if (!lm->ring)
+        lm->bufSize = 0;
+
     lm->bufHead = 0;
     lm->bufTail = 0;
     lm->srcTailPos = 0;
     lm->scanStreamAlign = false;
+    lm->ringHead = 0;
 }
 
 
@@ -166,27 +172,187 @@ static bool LmBufExpand(LmBuf *lm, size_t minSize)
 }
 
 
+/*
+ * NAME:        LmBufInitRing
+ * ACTION:      Initialises a list mode buffer as a fixed size circular buffer.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t size - the ring size. Rounded up to a power of two.
+ * RETURNS:     bool - true on success, false if out of memory.
+ */
+
+bool LmBufInitRing(LmBuf *lm, size_t size)
+{
+    if (size < LMBUF_INITIAL_SIZE)
+        size = LMBUF_INITIAL_SIZE;
+
+    size = HigherPowerOfTwo((uint32_t)size);
+
+    /* The start of the ring is mirrored after the end so packets which wrap are contiguous. */
+    lm->buf = malloc(size + LMBUF_RING_MIRROR_SIZE);
+    if (lm->buf == NULL)
+        return false;
+
+    lm->bufSize = size;
+    lm->ring = true;
+
+    LmBufClear(lm);
+
+    return true;
+}
+
+
+/*
+ * NAME:        LmBufRingSync
+ * ACTION:      Once the read position has passed the end of the ring,
+ *              moves it back to the equivalent position at the start.
+ *              Also updates how much data can be read contiguously.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ * RETURNS:     bool - true if the read position was moved.
+ */
+
+static bool LmBufRingSync(LmBuf *lm)
+{
+    bool wrapped = false;
+
+    if (lm->bufTail >= lm->bufSize)
+    {
+        lm->bufTail -= lm->bufSize;
+        lm->ringHead -= lm->bufSize;
+        wrapped = true;
+    }
+
+    lm->bufHead = LMBUF_RING_READ_END(lm);
+
+    return wrapped;
+}
+
+
+/*
+ * NAME:        LmBufGetWriteSpace
+ * ACTION:      Gets free space at the head of the buffer so data can be
+ *              written directly into the buffer.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t minLen - the space wanted. A linear buffer grows to
+ *                  provide at least this much. A ring may provide less.
+ *              size_t *space - set to the number of bytes available.
+ * RETURNS:     uint8_t * - where to write the data, or NULL if out of
+ *                  memory or the ring is full.
+ */
+
+uint8_t *LmBufGetWriteSpace(LmBuf *lm, size_t minLen, size_t *space)
+{
+    if (lm->ring)
+    {
+        /* Free space runs to the end of the ring or up to the unread data. */
+        size_t pos = lm->ringHead & (lm->bufSize - 1);
+        size_t avail = lm->bufSize - (lm->ringHead - lm->bufTail);
+        if (avail > lm->bufSize - pos)
+            avail = lm->bufSize - pos;
+
+        *space = avail;
+        return avail > 0 ? &lm->buf[pos] : NULL;
+    }
+
+    /* Only move the unread data back to the start when it's needed to make room. */
+    if (lm->bufHead + minLen > lm->bufSize)
+    {
+        LmBufCompact(lm);
+
+        /* Make sure the buffer's big enough to hold our new data. */
+        if (!LmBufExpand(lm, lm->bufHead + minLen))
+        {
+            *space = 0;
+            return NULL;
+        }
+    }
+
+    *space = lm->bufSize - lm->bufHead;
+    return &lm->buf[lm->bufHead];
+}
+
+
+/*
+ * NAME:        LmBufCommitWrite
+ * ACTION:      Adds data written to the space from LmBufGetWriteSpace()
+ *              to the buffer.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t len - the number of bytes written.
+ */
+
+void LmBufCommitWrite(LmBuf *lm, size_t len)
+{
+    if (lm->ring)
+    {
+        /* Keep the mirror of the start of the ring up to date. */
+        size_t pos = lm->ringHead & (lm->bufSize - 1);
+        if (pos < LMBUF_RING_MIRROR_SIZE)
+        {
+            size_t mirrorLen = LMBUF_RING_MIRROR_SIZE - pos;
+            if (mirrorLen > len)
+                mirrorLen = len;
+
+            memcpy(&lm->buf[lm->bufSize + pos], &lm->buf[pos], mirrorLen);
+        }
+
+        lm->ringHead += len;
+        lm->bufHead = LMBUF_RING_READ_END(lm);
+    }
+    else
+    {
+        lm->bufHead += len;
+    }
+}
+
+
+/*
+ * NAME:        LmBufGetUnreadLen
+ * ACTION:      Gets the amount of data in the buffer which hasn't been
+ *              read out as packets yet, including any incomplete packet.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ * RETURNS:     size_t - the number of unread bytes.
+ */
+
+size_t LmBufGetUnreadLen(LmBuf *lm)
+{
+    if (lm->ring)
+        return lm->ringHead - lm->bufTail;
+
+    return lm->bufHead - lm->bufTail;
+}
+
+
 /*
  * NAME:        LmBufAddData
  * ACTION:      Adds some binary data to the head of the buffer. Use
  *              this to add data read from a file or stream, then use
  *              LmBufGetNextPacket() to get packets out of the buffer.
  * PARAMETERS:  LmBuf *lm - the list mode buffer.
- * RETURNS:     bool - true on success, false if out of memory.
+ * RETURNS:     bool - true on success, false if out of memory or the
+ *                  ring is full.
  */
 
 bool LmBufAddData(LmBuf *lm, uint8_t *data, size_t len)
 {
-    /* Don't waste space at the start of the buffer. */
-    LmBufCompact(lm);
-
-    /* Make sure the buffer's big enough to hold our new data. */
-    if (!LmBufExpand(lm, lm->bufHead + len))
+    if (lm->ring && len > lm->bufSize - (lm->ringHead - lm->bufTail))
         return false;
 
-    /* Copy the new data in. */
-    memcpy(&lm->buf[lm->bufHead], data, len);
-    lm->bufHead += len;
+    /* A ring may take two goes if the data wraps around the end. */
+    while (len > 0)
+    {
+        size_t space;
+        uint8_t *dest = LmBufGetWriteSpace(lm, len, &space);
+        if (dest == NULL)
+            return false;
+
+        if (space > len)
+            space = len;
+
+        /* Copy the new data in. */
+        memcpy(dest, data, space);
+        LmBufCommitWrite(lm, space);
+        data += space;
+        len -= space;
+    }
 
     return true;
 }
@@ -629,23 +795,24 @@ static bool LmBufGetNumberedPacket(LmBuf *lm, LmPacket *packet, LmEventType even
 
 static bool LmBufScanStreamAlign(LmBuf *lm)
 {
-    size_t i;
+    uint8_t *pos = &lm->buf[lm->bufTail];
+    uint8_t *end = &lm->buf[lm->bufHead - 3];
 
-    /* Scan for the first byte. */
-    for (i = lm->bufTail; i < lm->bufHead - 3; i++)
+    /* Scan for the first byte. memchr() is vectorised by the C library. */
+    while (pos < end && (pos = memchr(pos, LMBUF_STREAM_ALIGN_WORD & 0xff, (size_t)(end - pos))) != NULL)
     {
-        if (lm->buf[i] == (LMBUF_STREAM_ALIGN_WORD & 0xff))
+        /* The first byte matches. Check the rest. */
+        uint32_t word;
+        memcpy(&word, pos, sizeof(word));  /* Fixes memory alignment. */
+        if (word == LMBUF_STREAM_ALIGN_WORD)
         {
-            /* The first byte matches. Check the rest. */
-            uint32_t word;
-            memcpy(&word, &lm->buf[i], sizeof(word));  /* Fixes memory alignment. */
-            if (word == LMBUF_STREAM_ALIGN_WORD)
-            {
-                lm->srcTailPos += i - lm->bufTail;
-                lm->bufTail = i;
-                return true;
-            }
+            size_t i = (size_t)(pos - lm->buf);
+            lm->srcTailPos += i - lm->bufTail;
+            lm->bufTail = i;
+            return true;
         }
+
+        pos++;
     }
 
     /* Wasn't found. Delete the scanned data. */
@@ -675,6 +842,9 @@ bool LmBufGetNextPacket(LmBuf *lm, LmPacket *packet)
     char         errorMessage[LMBUF_ERROR_MESSAGE_BUFFER_LEN] = "error";
     unsigned int packetBytes = 0;
 
+    if (lm->ring)
+        LmBufRingSync(lm);
+
     /* Check if we've got a word to read. */
     if (!LMBUF_CHECK_WORD_AVAILABLE(lm, 0))
     {
@@ -786,6 +956,159 @@ bool LmBufGetNextPacket(LmBuf *lm, LmPacket *packet)
     return true;
 }
 
+/*
+ * NAME:        LmBatchInit
+ * ACTION:      Initialises a batch of decoded list mode data.
+ * PARAMETERS:  LmBatch *batch - the batch.
+ *              size_t pulseCapacity - the most pulses a batch can hold.
+ *              size_t sideCapacity - the most other packets a batch can hold.
+ * RETURNS:     bool - true on success, false if out of memory.
+ */
+
+bool LmBatchInit(LmBatch *batch, size_t pulseCapacity, size_t sideCapacity)
+{
+    memset(batch, 0, sizeof(*batch));
+
+    batch->amplitude = malloc(pulseCapacity * sizeof(int32_t));
+    batch->timeOfArrival = malloc(pulseCapacity * sizeof(uint16_t));
+    batch->subSampleTimeOfArrival = malloc(pulseCapacity * sizeof(uint8_t));
+    batch->flags = malloc(pulseCapacity * sizeof(uint8_t));
+    batch->side = malloc(sideCapacity * sizeof(LmPacket));
+    batch->sidePulseIndex = malloc(sideCapacity * sizeof(size_t));
+
+    if (batch->amplitude == NULL || batch->timeOfArrival == NULL ||
+        batch->subSampleTimeOfArrival == NULL || batch->flags == NULL ||
+        batch->side == NULL || batch->sidePulseIndex == NULL)
+    {
+        LmBatchClose(batch);
+        return false;
+    }
+
+    batch->pulseCapacity = pulseCapacity;
+    batch->sideCapacity = sideCapacity;
+
+    return true;
+}
+
+
+/*
+ * NAME:        LmBatchClose
+ * ACTION:      Closes an LmBatch, freeing memory.
+ * PARAMETERS:  LmBatch *batch - the batch.
+ */
+
+void LmBatchClose(LmBatch *batch)
+{
+    free(batch->amplitude);
+    free(batch->timeOfArrival);
+    free(batch->subSampleTimeOfArrival);
+    free(batch->flags);
+    free(batch->side);
+    free(batch->sidePulseIndex);
+    memset(batch, 0, sizeof(*batch));
+}
+
+
+/*
+ * NAME:        LmBatchClear
+ * ACTION:      Empties a batch ready for the next LmBufDecodeBatch().
+ * PARAMETERS:  LmBatch *batch - the batch.
+ */
+
+void LmBatchClear(LmBatch *batch)
+{
+    batch->numPulses = 0;
+    batch->numSide = 0;
+}
+
+
+/*
+ * NAME:        LmBufDecodeBatch
+ * ACTION:      Decodes as many packets as are available from the buffer
+ *              into a batch, appending to what's already in the batch.
+ *              Stops when the buffer has no complete packet left or
+ *              the batch is full. Produces the same packets as repeated
+ *              calls to LmBufGetNextPacket().
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              LmBatch *batch - the decoded packets are added to this.
+ * RETURNS:     size_t - the number of packets decoded.
+ */
+
+size_t LmBufDecodeBatch(LmBuf *lm, LmBatch *batch)
+{
+    uint32_t val_u32;
+    size_t   decoded = 0;
+
+    if (lm->ring)
+        LmBufRingSync(lm);
+
+    /* In ring mode keep going after reaching the end of the contiguous data. */
+    do
+    {
+        while (LMBUF_CHECK_WORD_AVAILABLE(lm, 0))
+        {
+            uint32_t word0 = LMBUF_LM_GET_WORD(lm, 0);
+
+            if (!lm->scanStreamAlign && (word0 >> 28) == LmEventTypePulse)
+            {
+                /*
+                 * The pulse fast path. Pulses are nearly all of the data so
+                 * decode them straight into the columns.
+                 */
+                size_t n = batch->numPulses;
+                if (n >= batch->pulseCapacity || !LMBUF_CHECK_WORD_AVAILABLE(lm, 1))
+                    break;
+
+                uint32_t word1 = LMBUF_LM_GET_WORD(lm, 1);
+                uint8_t  flags = (word0 & 0x08000000) ? LM_PULSE_FLAG_INVALID : 0;
+                size_t   packetBytes;
+
+                batch->amplitude[n] = (int32_t)LMBUF_SIGN_EXTEND_24_TO_32(word0);
+
+                if ((word1 >> 28) == LmEventTypePulseToa)
+                {
+                    flags |= LM_PULSE_FLAG_HAS_TOA;
+                    if ((word1 >> 20) & 0x1)
+                        flags |= LM_PULSE_FLAG_IN_MARKED_RANGE;
+
+                    batch->timeOfArrival[n] = (uint16_t)((word1 >> 8) & 0xfff);
+                    batch->subSampleTimeOfArrival[n] = (uint8_t)(word1 & 0xff);
+                    packetBytes = sizeof(uint32_t) * 2;
+                }
+                else
+                {
+                    batch->timeOfArrival[n] = 0;
+                    batch->subSampleTimeOfArrival[n] = 0;
+                    packetBytes = sizeof(uint32_t);
+                }
+
+                batch->flags[n] = flags;
+                batch->numPulses = n + 1;
+
+                lm->bufTail += packetBytes;
+                lm->srcTailPos += packetBytes;
+            }
+            else
+            {
+                /* Everything else is rare so use the general decoder. */
+                if (batch->numSide >= batch->sideCapacity)
+                    break;
+
+                if (!LmBufGetNextPacket(lm, &batch->side[batch->numSide]))
+                    break;
+
+                batch->sidePulseIndex[batch->numSide] = batch->numPulses;
+                batch->numSide++;
+            }
+
+            decoded++;
+        }
+    } while (lm->ring && LmBufRingSync(lm));
+
+    return decoded;
+}
+
+
 #else /* !LMBUF_NEW_DECODER */
 
 /*
@@ -858,6 +1181,9 @@ bool LmBufGetNextPacket(LmBuf *lm, LmPacket *packet)
     uint32_t     vetoValue = 0;
     unsigned int timestampOffset = 0;
 
+    if (lm->ring)
+        LmBufRingSync(lm);
+
     /* Get a valid packet type. */
     do
     {
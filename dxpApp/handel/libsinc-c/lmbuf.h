@@ -43,6 +43,8 @@ typedef struct
     size_t   bufTail;      /* The lowest used value in the buffer. */
     size_t   srcTailPos;   /* Where we're up reading in the entire source data, not just the buffer. */
     bool     scanStreamAlign;   /* Currently scanning for a "resync" flag of 0x70717273. */
+    bool     ring;         /* Using a fixed size circular buffer. See LmBufInitRing(). */
+    size_t   ringHead;     /* In ring mode, the end of all the data. bufHead is clipped to what can be read contiguously. */
 } LmBuf;
 
 
@@ -158,6 +160,34 @@ typedef struct
 } LmPacket;
 
 
+/* Flags for each pulse in an LmBatch. */
+#define LM_PULSE_FLAG_INVALID           0x01
+#define LM_PULSE_FLAG_HAS_TOA           0x02
+#define LM_PULSE_FLAG_IN_MARKED_RANGE   0x04
+
+
+/*
+ * A batch of decoded list mode data. Pulses are stored as columns so
+ * they can be processed a block at a time. All other packets go to a
+ * side list in stream order. Each side packet records how many pulses
+ * came before it in the batch so it can be placed in the pulse stream.
+ */
+typedef struct
+{
+    size_t    pulseCapacity;          /* The number of entries in each pulse column. */
+    size_t    numPulses;              /* The number of pulses in the columns. */
+    int32_t  *amplitude;
+    uint16_t *timeOfArrival;          /* Zero if the pulse has no time of arrival. */
+    uint8_t  *subSampleTimeOfArrival;
+    uint8_t  *flags;                  /* LM_PULSE_FLAG_*. */
+
+    size_t    sideCapacity;           /* The number of entries in the side list. */
+    size_t    numSide;                /* The number of packets in the side list. */
+    LmPacket *side;                   /* Stats, gate, sync, spatial, align and error packets. */
+    size_t   *sidePulseIndex;         /* The number of pulses before each side packet. */
+} LmBatch;
+
+
 /* Prototypes. */
 
 /*
@@ -170,6 +200,23 @@ typedef struct
 bool LmBufInit(LmBuf *lm);
 
 
+/*
+ * NAME:        LmBufInitRing
+ * ACTION:      Initialises a list mode buffer as a fixed size circular
+ *              buffer. Memory use stays constant and data is never moved
+ *              once it's been added. The first bytes of the ring are
+ *              mirrored past its end so packets which wrap around can
+ *              still be decoded in place. LmBufAddData() fails when the
+ *              ring is full, so packets must be read out as data arrives.
+ *              A JSON header must fit in the ring.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t size - the ring size. Rounded up to a power of two.
+ * RETURNS:     bool - true on success, false if out of memory.
+ */
+
+bool LmBufInitRing(LmBuf *lm, size_t size);
+
+
 /*
  * NAME:        LmBufClose
  * ACTION:      Closes an LmBuf, freeing memory.
@@ -200,6 +247,47 @@ void LmBufClear(LmBuf *lm);
 bool LmBufAddData(LmBuf *lm, uint8_t *data, size_t len);
 
 
+/*
+ * NAME:        LmBufGetWriteSpace
+ * ACTION:      Gets free space at the head of the buffer so data can be
+ *              read from a file or socket directly into the buffer rather
+ *              than being copied in with LmBufAddData(). Call
+ *              LmBufCommitWrite() afterwards with the number of bytes
+ *              actually written.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t minLen - the space wanted. A linear buffer grows to
+ *                  provide at least this much. A ring may provide less.
+ *              size_t *space - set to the number of bytes available.
+ * RETURNS:     uint8_t * - where to write the data, or NULL if out of
+ *                  memory or the ring is full.
+ */
+
+uint8_t *LmBufGetWriteSpace(LmBuf *lm, size_t minLen, size_t *space);
+
+
+/*
+ * NAME:        LmBufCommitWrite
+ * ACTION:      Adds data written to the space from LmBufGetWriteSpace()
+ *              to the buffer.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              size_t len - the number of bytes written. Must be no more
+ *                  than the space available.
+ */
+
+void LmBufCommitWrite(LmBuf *lm, size_t len);
+
+
+/*
+ * NAME:        LmBufGetUnreadLen
+ * ACTION:      Gets the amount of data in the buffer which hasn't been
+ *              read out as packets yet, including any incomplete packet.
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ * RETURNS:     size_t - the number of unread bytes.
+ */
+
+size_t LmBufGetUnreadLen(LmBuf *lm);
+
+
 /*
  * NAME:        LmBufGetJsonHeader
  * ACTION:      Gets a JSON header from the buffer. This is usually
@@ -229,6 +317,51 @@ bool LmBufGetJsonHeader(LmBuf *lm, char **data, size_t *len, bool *invalidHeader
 bool LmBufGetNextPacket(LmBuf *lm, LmPacket *packet);
 
 
+/*
+ * NAME:        LmBatchInit
+ * ACTION:      Initialises a batch of decoded list mode data.
+ * PARAMETERS:  LmBatch *batch - the batch.
+ *              size_t pulseCapacity - the most pulses a batch can hold.
+ *              size_t sideCapacity - the most other packets a batch can hold.
+ * RETURNS:     bool - true on success, false if out of memory.
+ */
+
+bool LmBatchInit(LmBatch *batch, size_t pulseCapacity, size_t sideCapacity);
+
+
+/*
+ * NAME:        LmBatchClose
+ * ACTION:      Closes an LmBatch, freeing memory.
+ * PARAMETERS:  LmBatch *batch - the batch.
+ */
+
+void LmBatchClose(LmBatch *batch);
+
+
+/*
+ * NAME:        LmBatchClear
+ * ACTION:      Empties a batch ready for the next LmBufDecodeBatch().
+ * PARAMETERS:  LmBatch *batch - the batch.
+ */
+
+void LmBatchClear(LmBatch *batch);
+
+
+/*
+ * NAME:        LmBufDecodeBatch
+ * ACTION:      Decodes as many packets as are available from the buffer
+ *              into a batch, appending to what's already in the batch.
+ *              Stops when the buffer has no complete packet left or
+ *              the batch is full. Produces the same packets as repeated
+ *              calls to LmBufGetNextPacket().
+ * PARAMETERS:  LmBuf *lm - the list mode buffer.
+ *              LmBatch *batch - the decoded packets are added to this.
+ * RETURNS:     size_t - the number of packets decoded.
+ */
+
+size_t LmBufDecodeBatch(LmBuf *lm, LmBatch *batch);
+
+
 /*
  * NAME:        LmBufTranslatePacketSimple
  * ACTION:      Translates a LmPacket into textual form.
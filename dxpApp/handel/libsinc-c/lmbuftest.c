@@ -0,0 +1,386 @@
+/********************************************************************
+ ***                                                              ***
+ ***              libsinc list mode batch decode test             ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * Checks LmBufDecodeBatch() against LmBufGetNextPacket() on a
+ * synthetic list mode stream and compares their throughput. Also
+ * checks a ring buffer gives the same packets and that software
+ * histograms of the batches are right. Doesn't need any hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lmbuf.h"
+#include "lmhist.h"
+
+#define NUM_PULSES      4000000
+#define CHUNK_SIZE      65536
+#define BATCH_PULSES    16384
+#define BATCH_SIDE      256
+#define HIST_BINS       4096
+#define HIST_MIN        -1000
+#define HIST_WIDTH      3000
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// Builds a stream of mostly pulses with the occasional other packet and
+// a little corruption.
+static uint32_t *makeStream(size_t *numWords)
+{
+    size_t    maxWords = NUM_PULSES * 2 + NUM_PULSES / 100 * 8 + 64;
+    uint32_t *words = malloc(maxWords * sizeof(uint32_t));
+    size_t    n = 0;
+    int       i;
+
+    if (words == NULL)
+        return NULL;
+
+    words[n++] = 0x70717273;
+
+    for (i = 0; i < NUM_PULSES; i++)
+    {
+        uint32_t amplitude = (uint32_t)(rand() & 0xffffff);
+        words[n++] = (amplitude & 0xffffff) | ((rand() & 0x1f) == 0 ? 0x08000000 : 0);
+        if (rand() & 3)
+            words[n++] = 0x10000000 | ((uint32_t)(rand() & 0x1) << 20) | ((uint32_t)(rand() & 0xfff) << 8) | (uint32_t)(rand() & 0xff);
+
+        if (i % 1000 == 999)
+            words[n++] = 0xd0000000 | ((uint32_t)((i / 1000) & 1) << 24) | (uint32_t)(i & 0xffffff);
+
+        if (i % 10000 == 9999)
+        {
+            // Periodic stats.
+            words[n++] = 0xe0000000 | 0x00000000 | 1000;
+            words[n++] = 0xe0000000 | 0x02000000 | 2;
+            words[n++] = 0xe0000000 | 0x05000000 | 55;
+            words[n++] = 0xe0000000 | 0x0f000000 | (uint32_t)i;
+        }
+
+        if (i % 250000 == 249999)
+        {
+            // Corruption followed by a realignment.
+            words[n++] = 0x61234567;
+            words[n++] = 0x70717273;
+        }
+    }
+
+    words[n++] = 0x70717273;
+    *numWords = n;
+
+    return words;
+}
+
+
+// The parts of a packet the comparison looks at.
+typedef struct
+{
+    LmPacketType typ;
+    size_t       len;
+    int32_t      amplitude;
+    uint32_t     timeOfArrival;
+    uint32_t     subSampleTimeOfArrival;
+    uint8_t      flags;
+    bool         gate;
+} Expected;
+
+
+int main()
+{
+    size_t    numWords;
+    uint32_t *words;
+    uint8_t  *data;
+    size_t    dataLen;
+    size_t    pos;
+    LmBuf     lm;
+    LmBatch   batch;
+    LmPacket  packet;
+    int       failures = 0;
+
+    printf("list mode batch decode test.\n");
+    srand(1234);
+
+    words = makeStream(&numWords);
+    if (words == NULL || !LmBufInit(&lm) || !LmBatchInit(&batch, BATCH_PULSES, BATCH_SIDE))
+    {
+        printf("out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    data = (uint8_t *)words;
+    dataLen = numWords * sizeof(uint32_t);
+
+    // Time decoding a packet at a time.
+    int64_t checksum = 0;
+    double start = now();
+    for (pos = 0; pos < dataLen; pos += CHUNK_SIZE)
+    {
+        size_t len = dataLen - pos < CHUNK_SIZE ? dataLen - pos : CHUNK_SIZE;
+        LmBufAddData(&lm, &data[pos], len);
+        while (LmBufGetNextPacket(&lm, &packet))
+        {
+            if (packet.typ == LmPacketTypePulse)
+                checksum += packet.p.pulse.amplitude;
+        }
+    }
+    double packetTime = now() - start;
+
+    // Decode a packet at a time again, keeping the results to compare against.
+    Expected *expected = malloc(sizeof(Expected) * (NUM_PULSES + NUM_PULSES / 100 + 64));
+    size_t numExpected = 0;
+    LmBufClose(&lm);
+    LmBufInit(&lm);
+    for (pos = 0; pos < dataLen; pos += CHUNK_SIZE)
+    {
+        size_t len = dataLen - pos < CHUNK_SIZE ? dataLen - pos : CHUNK_SIZE;
+        LmBufAddData(&lm, &data[pos], len);
+        while (LmBufGetNextPacket(&lm, &packet))
+        {
+            Expected *x = &expected[numExpected++];
+            memset(x, 0, sizeof(*x));
+            x->typ = packet.typ;
+            x->len = packet.len;
+            if (packet.typ == LmPacketTypePulse)
+            {
+                x->amplitude = packet.p.pulse.amplitude;
+                x->timeOfArrival = packet.p.pulse.timeOfArrival;
+                x->subSampleTimeOfArrival = packet.p.pulse.subSampleTimeOfArrival;
+                x->flags = (packet.p.pulse.invalid ? LM_PULSE_FLAG_INVALID : 0) |
+                           (packet.p.pulse.hasTimeOfArrival ? LM_PULSE_FLAG_HAS_TOA : 0) |
+                           (packet.p.pulse.inMarkedRange ? LM_PULSE_FLAG_IN_MARKED_RANGE : 0);
+            }
+            else if (packet.typ == LmPacketTypeGateState)
+            {
+                x->gate = packet.p.gateState.gate;
+            }
+        }
+    }
+
+    // Decode in batches and compare.
+    LmBufClose(&lm);
+    LmBufInit(&lm);
+    size_t e = 0;
+    size_t decoded = 0;
+    double batchTime = 0;
+
+    // Also histogram the batches, alternating between two histograms
+    // as separate threads would.
+    LmHistogram hist[2];
+    if (!LmHistogramInit(&hist[0], HIST_BINS, HIST_MIN, HIST_WIDTH, true) ||
+        !LmHistogramInit(&hist[1], HIST_BINS, HIST_MIN, HIST_WIDTH, true))
+    {
+        printf("out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int    histIndex = 0;
+    for (pos = 0; pos < dataLen; pos += CHUNK_SIZE)
+    {
+        size_t len = dataLen - pos < CHUNK_SIZE ? dataLen - pos : CHUNK_SIZE;
+        LmBufAddData(&lm, &data[pos], len);
+
+        for (;;)
+        {
+            LmBatchClear(&batch);
+            start = now();
+            size_t n = LmBufDecodeBatch(&lm, &batch);
+            batchTime += now() - start;
+            if (n == 0)
+                break;
+
+            decoded += n;
+            for (size_t i = 0; i < batch.numPulses; i++)
+            {
+                checksum -= batch.amplitude[i];
+            }
+
+            // The gate state carries on from the previous batch.
+            hist[histIndex].gate = hist[1 - histIndex].gate;
+            LmHistogramAddBatch(&hist[histIndex], &batch);
+            histIndex = 1 - histIndex;
+
+            // Merge the pulses and side packets back into stream order.
+            size_t p = 0;
+            size_t s = 0;
+            while (p < batch.numPulses || s < batch.numSide)
+            {
+                if (e >= numExpected)
+                {
+                    failures++;
+                    break;
+                }
+
+                if (s < batch.numSide && batch.sidePulseIndex[s] == p)
+                {
+                    if (expected[e].typ != batch.side[s].typ || expected[e].len != batch.side[s].len)
+                        failures++;
+                    s++;
+                }
+                else
+                {
+                    Expected *x = &expected[e];
+                    if (x->typ != LmPacketTypePulse ||
+                        x->amplitude != batch.amplitude[p] ||
+                        x->timeOfArrival != batch.timeOfArrival[p] ||
+                        x->subSampleTimeOfArrival != batch.subSampleTimeOfArrival[p] ||
+                        x->flags != batch.flags[p])
+                    {
+                        failures++;
+                    }
+                    p++;
+                }
+
+                e++;
+            }
+        }
+    }
+
+    if (decoded != numExpected || e != numExpected || checksum != 0)
+    {
+        printf("packet count mismatch: %zu per packet, %zu batched\n", numExpected, decoded);
+        failures++;
+    }
+
+    // Check the merged histograms against binning the expected pulses.
+    uint32_t *histCheck[2];
+    uint64_t  outOfRange = 0;
+    uint64_t  invalid = 0;
+    bool      gate = false;
+    histCheck[0] = calloc(HIST_BINS, sizeof(uint32_t));
+    histCheck[1] = calloc(HIST_BINS, sizeof(uint32_t));
+    for (e = 0; e < numExpected; e++)
+    {
+        if (expected[e].typ == LmPacketTypeGateState)
+        {
+            gate = expected[e].gate;
+        }
+        else if (expected[e].typ == LmPacketTypePulse)
+        {
+            int64_t bin = ((int64_t)expected[e].amplitude - HIST_MIN) / HIST_WIDTH;
+            if (expected[e].flags & LM_PULSE_FLAG_INVALID)
+                invalid++;
+            else if (expected[e].amplitude < HIST_MIN || bin >= HIST_BINS)
+                outOfRange++;
+            else
+                histCheck[gate][bin]++;
+        }
+    }
+
+    if (!LmHistogramMerge(&hist[0], &hist[1]) ||
+        memcmp(hist[0].bins[0], histCheck[0], HIST_BINS * sizeof(uint32_t)) != 0 ||
+        memcmp(hist[0].bins[1], histCheck[1], HIST_BINS * sizeof(uint32_t)) != 0 ||
+        hist[0].underflow + hist[0].overflow != outOfRange || hist[0].invalid != invalid)
+    {
+        printf("histogram mismatch\n");
+        failures++;
+    }
+
+    free(histCheck[0]);
+    free(histCheck[1]);
+    LmHistogramClose(&hist[0]);
+    LmHistogramClose(&hist[1]);
+
+    printf("%zu packets: per packet %.1f Mpackets/s, batched %.1f Mpackets/s\n",
+           numExpected, numExpected / packetTime / 1e6, numExpected / batchTime / 1e6);
+
+    // Read straight into a small ring in odd sized pieces so packets
+    // wrap around the end, decoding a packet at a time and then in
+    // batches.
+    for (int useBatch = 0; useBatch < 2; useBatch++)
+    {
+        LmBufClose(&lm);
+        if (!LmBufInitRing(&lm, 65536))
+        {
+            printf("out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        e = 0;
+        pos = 0;
+        start = now();
+        while (pos < dataLen || LmBufGetUnreadLen(&lm) > 0)
+        {
+            size_t space;
+            uint8_t *dest = LmBufGetWriteSpace(&lm, 0, &space);
+            size_t len = (size_t)(rand() % 5000) + 1;
+            if (len > space)
+                len = space;
+
+            if (len > dataLen - pos)
+                len = dataLen - pos;
+
+            if (len > 0)
+            {
+                memcpy(dest, &data[pos], len);
+                LmBufCommitWrite(&lm, len);
+                pos += len;
+            }
+
+            size_t before = e;
+            if (useBatch)
+            {
+                LmBatchClear(&batch);
+                LmBufDecodeBatch(&lm, &batch);
+                for (size_t i = 0; i < batch.numPulses + batch.numSide; i++, e++)
+                {
+                    if (e >= numExpected)
+                    {
+                        failures++;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                while (LmBufGetNextPacket(&lm, &packet))
+                {
+                    if (e >= numExpected || expected[e].typ != packet.typ || expected[e].len != packet.len ||
+                        (packet.typ == LmPacketTypePulse && expected[e].amplitude != packet.p.pulse.amplitude))
+                    {
+                        failures++;
+                    }
+
+                    e++;
+                }
+            }
+
+            if (pos == dataLen && len == 0 && e == before)
+                break;
+        }
+
+        if (e != numExpected)
+        {
+            printf("ring %s: %zu packets, expected %zu\n", useBatch ? "batched" : "per packet", e, numExpected);
+            failures++;
+        }
+
+        printf("ring %s: %.1f Mpackets/s\n", useBatch ? "batched" : "per packet", e / (now() - start) / 1e6);
+    }
+
+    free(expected);
+    free(words);
+    LmBatchClose(&batch);
+    LmBufClose(&lm);
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("passed\n");
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+/********************************************************************
+ ***                                                              ***
+ ***                libsinc list mode software histogram          ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * Builds energy spectra on the host from decoded list mode pulses, so
+ * a list mode run gives spectra as well as the event data. Optionally
+ * keeps separate spectra for gate high and gate low, following the
+ * gate state packets in the stream.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lmhist.h"
+
+
+/*
+ * NAME:        LmHistogramInit
+ * ACTION:      Initialises a software histogram.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ *              uint32_t numBins - the number of bins in each spectrum.
+ *              int32_t minAmplitude - the amplitude at the bottom of the first bin.
+ *              uint32_t binWidth - the amplitude range of each bin.
+ *              bool gated - keep separate spectra for gate high and low.
+ * RETURNS:     bool - true on success, false if out of memory or the
+ *                  binning is invalid.
+ */
+
+bool LmHistogramInit(LmHistogram *h, uint32_t numBins, int32_t minAmplitude, uint32_t binWidth, bool gated)
+{
+    memset(h, 0, sizeof(*h));
+
+    if (numBins == 0 || binWidth == 0)
+        return false;
+
+    h->numBins = numBins;
+    h->minAmplitude = minAmplitude;
+    h->binWidth = binWidth;
+    h->gated = gated;
+
+    /* Binning by a shift is much cheaper than a divide. */
+    h->binShift = -1;
+    if ((binWidth & (binWidth - 1)) == 0)
+    {
+        h->binShift = 0;
+        while ((1u << h->binShift) < binWidth)
+            h->binShift++;
+    }
+
+    h->bins[0] = calloc(numBins, sizeof(uint32_t));
+    if (gated)
+        h->bins[1] = calloc(numBins, sizeof(uint32_t));
+
+    if (h->bins[0] == NULL || (gated && h->bins[1] == NULL))
+    {
+        LmHistogramClose(h);
+        return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * NAME:        LmHistogramClose
+ * ACTION:      Closes a histogram, freeing memory.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ */
+
+void LmHistogramClose(LmHistogram *h)
+{
+    free(h->bins[0]);
+    free(h->bins[1]);
+    h->bins[0] = NULL;
+    h->bins[1] = NULL;
+}
+
+
+/*
+ * NAME:        LmHistogramClear
+ * ACTION:      Zeroes the spectra and counts. The gate state is kept.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ */
+
+void LmHistogramClear(LmHistogram *h)
+{
+    memset(h->bins[0], 0, h->numBins * sizeof(uint32_t));
+    if (h->gated)
+        memset(h->bins[1], 0, h->numBins * sizeof(uint32_t));
+
+    h->underflow = 0;
+    h->overflow = 0;
+    h->invalid = 0;
+}
+
+
+/*
+ * NAME:        LmHistogramAddPulses
+ * ACTION:      Bins a run of pulses into a given spectrum.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ *              uint32_t *bins - the spectrum to add to.
+ *              const LmBatch *batch - the batch.
+ *              size_t start, size_t end - the range of pulses to add.
+ */
+
+void LmHistogramAddPulses(LmHistogram *h, uint32_t *bins, const LmBatch *batch, size_t start, size_t end)
+{
+    const int32_t *amplitude = batch->amplitude;
+    const uint8_t *flags = batch->flags;
+    int64_t        minAmplitude = h->minAmplitude;
+    uint64_t       numBins = h->numBins;
+    size_t         i;
+
+    for (i = start; i < end; i++)
+    {
+        /* Work in 64 bits so the offset can't overflow. */
+        int64_t  offset = (int64_t)amplitude[i] - minAmplitude;
+        uint64_t bin;
+
+        if (flags[i] & LM_PULSE_FLAG_INVALID)
+        {
+            h->invalid++;
+            continue;
+        }
+
+        if (offset < 0)
+        {
+            h->underflow++;
+            continue;
+        }
+
+        if (h->binShift >= 0)
+            bin = (uint64_t)offset >> h->binShift;
+        else
+            bin = (uint64_t)offset / h->binWidth;
+
+        if (bin >= numBins)
+            h->overflow++;
+        else
+            bins[bin]++;
+    }
+}
+
+
+/*
+ * NAME:        LmHistogramAddBatch
+ * ACTION:      Adds the pulses in a batch to the spectra.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ *              const LmBatch *batch - the batch from LmBufDecodeBatch().
+ */
+
+void LmHistogramAddBatch(LmHistogram *h, const LmBatch *batch)
+{
+    size_t start = 0;
+    size_t s;
+
+    if (!h->gated)
+    {
+        /* Gate state doesn't matter so do the whole batch in one go. */
+        LmHistogramAddPulses(h, h->bins[0], batch, 0, batch->numPulses);
+        return;
+    }
+
+    /* Bin the runs of pulses between gate changes into the current gate's spectrum. */
+    for (s = 0; s < batch->numSide; s++)
+    {
+        if (batch->side[s].typ != LmPacketTypeGateState)
+            continue;
+
+        LmHistogramAddPulses(h, h->bins[h->gate], batch, start, batch->sidePulseIndex[s]);
+        start = batch->sidePulseIndex[s];
+        h->gate = batch->side[s].p.gateState.gate;
+    }
+
+    LmHistogramAddPulses(h, h->bins[h->gate], batch, start, batch->numPulses);
+}
+
+
+/*
+ * NAME:        LmHistogramMerge
+ * ACTION:      Adds one histogram into another.
+ * PARAMETERS:  LmHistogram *dest - the histogram to add to.
+ *              const LmHistogram *src - the histogram to add.
+ * RETURNS:     bool - true on success, false if the binning doesn't match.
+ */
+
+bool LmHistogramMerge(LmHistogram *dest, const LmHistogram *src)
+{
+    uint32_t i;
+    int      g;
+
+    if (dest->numBins != src->numBins || dest->minAmplitude != src->minAmplitude ||
+        dest->binWidth != src->binWidth || dest->gated != src->gated)
+    {
+        return false;
+    }
+
+    for (g = 0; g < (dest->gated ? 2 : 1); g++)
+    {
+        for (i = 0; i < dest->numBins; i++)
+        {
+            dest->bins[g][i] += src->bins[g][i];
+        }
+    }
+
+    dest->underflow += src->underflow;
+    dest->overflow += src->overflow;
+    dest->invalid += src->invalid;
+
+    return true;
+}
@@ -0,0 +1,122 @@
+/********************************************************************
+ ***                                                              ***
+ ***                libsinc list mode software histogram          ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * Builds energy spectra on the host from decoded list mode pulses, so
+ * a list mode run gives spectra as well as the event data. Optionally
+ * keeps separate spectra for gate high and gate low, following the
+ * gate state packets in the stream.
+ */
+
+#ifndef SINC_LMHIST_H
+#define SINC_LMHIST_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lmbuf.h"
+
+
+typedef struct
+{
+    uint32_t  numBins;          /* The number of bins in each spectrum. */
+    int32_t   minAmplitude;     /* The amplitude at the bottom of the first bin. */
+    uint32_t  binWidth;         /* The amplitude range of each bin. */
+    int       binShift;         /* log2(binWidth) if it's a power of two, otherwise -1. */
+    bool      gated;            /* Keep separate spectra for each gate state. */
+    bool      gate;             /* The current gate state. */
+    uint32_t *bins[2];          /* The spectra, indexed by gate state. Only [0] is used if not gated. */
+    uint64_t  underflow;        /* Pulses below the first bin. */
+    uint64_t  overflow;         /* Pulses beyond the last bin. */
+    uint64_t  invalid;          /* Pulses flagged invalid, which aren't binned. */
+} LmHistogram;
+
+
+/* Prototypes. */
+
+/*
+ * NAME:        LmHistogramInit
+ * ACTION:      Initialises a software histogram.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ *              uint32_t numBins - the number of bins in each spectrum.
+ *              int32_t minAmplitude - the amplitude at the bottom of the first bin.
+ *              uint32_t binWidth - the amplitude range of each bin. A
+ *                  power of two is fastest.
+ *              bool gated - keep separate spectra for gate high and low.
+ * RETURNS:     bool - true on success, false if out of memory or the
+ *                  binning is invalid.
+ */
+
+bool LmHistogramInit(LmHistogram *h, uint32_t numBins, int32_t minAmplitude, uint32_t binWidth, bool gated);
+
+
+/*
+ * NAME:        LmHistogramClose
+ * ACTION:      Closes a histogram, freeing memory.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ */
+
+void LmHistogramClose(LmHistogram *h);
+
+
+/*
+ * NAME:        LmHistogramClear
+ * ACTION:      Zeroes the spectra and counts. The gate state is kept.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ */
+
+void LmHistogramClear(LmHistogram *h);
+
+
+/*
+ * NAME:        LmHistogramAddBatch
+ * ACTION:      Adds the pulses in a batch to the spectra. Gate state
+ *              packets in the batch's side list switch spectra at the
+ *              point they occurred in the stream.
+ * PARAMETERS:  LmHistogram *h - the histogram.
+ *              const LmBatch *batch - the batch from LmBufDecodeBatch().
+ */
+
+void LmHistogramAddBatch(LmHistogram *h, const LmBatch *batch);
+
+
+/*
+ * NAME:        LmHistogramAddPulses
+ * ACTION:      Bins a run of pulses from a batch into a given spectrum
+ *              using this histogram's binning. Underflow, overflow and
+ *              invalid pulses are counted in the histogram. Lets other
+ *              code keep many spectra with the same binning.
+ * PARAMETERS:  LmHistogram *h - the histogram with the binning to use.
+ *              uint32_t *bins - the spectrum to add to. It has h->numBins bins.
+ *              const LmBatch *batch - the batch.
+ *              size_t start, size_t end - the range of pulses to add.
+ */
+
+void LmHistogramAddPulses(LmHistogram *h, uint32_t *bins, const LmBatch *batch, size_t start, size_t end);
+
+
+/*
+ * NAME:        LmHistogramMerge
+ * ACTION:      Adds one histogram into another. Use this to combine
+ *              histograms which were filled separately, such as one per
+ *              thread.
+ * PARAMETERS:  LmHistogram *dest - the histogram to add to.
+ *              const LmHistogram *src - the histogram to add.
+ * RETURNS:     bool - true on success, false if the binning doesn't match.
+ */
+
+bool LmHistogramMerge(LmHistogram *dest, const LmHistogram *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SINC_LMHIST_H */
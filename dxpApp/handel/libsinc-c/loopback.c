@@ -0,0 +1,113 @@
+/********************************************************************
+ ***                                                              ***
+ ***                  libsinc loopback transport                  ***
+ ***                                                              ***
+ ********************************************************************/
+
+/*
+ * This module connects a channel to a device emulated in the same
+ * process. Each connection is a local socket pair. The channel keeps
+ * one end and the other is handed to the emulator which serves the
+ * protocol on it, so reads, writes and waits behave exactly as they
+ * do on a network socket and a pair's descriptor can be polled.
+ */
+
+#include <errno.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "sinc.h"
+#include "sinc_internal.h"
+
+
+// The peer used by channels without a transport context of their own.
+static SincLoopbackPeer loopbackPeer;
+
+
+/*
+ * NAME:        SincLoopbackSetPeer
+ * ACTION:      Sets the emulated device SincLoopbackTransport connects to when
+ *                  the channel has no transport context of its own.
+ * PARAMETERS:  SincLoopbackAccept accept - called with the device's end of each
+ *                                          new connection. NULL to refuse connections.
+ *              void *context             - passed to accept.
+ */
+
+void SincLoopbackSetPeer(SincLoopbackAccept accept, void *context)
+{
+    loopbackPeer.accept = accept;
+    loopbackPeer.context = context;
+}
+
+
+/*
+ * NAME:        SincLoopbackConnect
+ * ACTION:      Creates a socket pair and hands one end to the emulated device.
+ * PARAMETERS:  void *context   - a SincLoopbackPeer or NULL for the default peer.
+ *              int *fd         - the channel's end of the pair is placed here.
+ *              const char *host - ignored.
+ *              int port        - passed to the peer so it can tell connections apart.
+ *              int timeout     - ignored. The connection is made immediately.
+ *              int rcvBufSize  - the receive buffer size or 0 for the default.
+ * RETURNS:     0 on success, a SiToro__Sinc__ErrorCode otherwise.
+ */
+
+static int SincLoopbackConnect(void *context, int *fd, const char *host, int port, int timeout, int rcvBufSize)
+{
+#ifdef _WIN32
+    (void)context;
+    (void)fd;
+    (void)host;
+    (void)port;
+    (void)timeout;
+    (void)rcvBufSize;
+    return SI_TORO__SINC__ERROR_CODE__UNIMPLEMENTED;
+#else
+    const SincLoopbackPeer *peer = context != NULL ? (const SincLoopbackPeer *)context : &loopbackPeer;
+    int fds[2];
+    int errCode;
+
+    (void)host;
+    (void)timeout;
+
+    if (peer->accept == NULL)
+        return SI_TORO__SINC__ERROR_CODE__CONNECTION_FAILED;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return SI_TORO__SINC__ERROR_CODE__OUT_OF_RESOURCES;
+
+    // The channel's end is used the same way as a network socket.
+    errCode = SincSocketSetNonBlocking(fds[0]);
+    if (errCode == SI_TORO__SINC__ERROR_CODE__NO_ERROR && rcvBufSize > 0)
+    {
+        if (setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &rcvBufSize, sizeof(rcvBufSize)) < 0)
+            errCode = SI_TORO__SINC__ERROR_CODE__OUT_OF_RESOURCES;
+    }
+
+    if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return errCode;
+    }
+
+    *fd = fds[0];
+    peer->accept(peer->context, fds[1], port);
+
+    return SI_TORO__SINC__ERROR_CODE__NO_ERROR;
+#endif
+}
+
+
+const SincTransport SincLoopbackTransport =
+{
+    "loopback",
+    SincLoopbackConnect,
+    SincSocketTransportDisconnect,
+    SincSocketTransportReadNonBlocking,
+    SincSocketTransportWrite,
+    SincSocketTransportWaitMulti
+};
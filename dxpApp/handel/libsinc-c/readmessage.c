@@ -448,8 +448,8 @@ bool SincPacketPeekMulti(Sinc **channelSet, int numChannels, int timeout, SiToro
             channelSet[i]->inSocketWait = true;
         }
 
-        // Wait for network activity.
-        int err = SincSocketWaitMulti(fdSet, numFds, timeout, readOk);
+        // Wait for network activity. The channels in a set share a transport.
+        int err = channelSet[0]->transport->waitMulti(channelSet[0]->transportContext, fdSet, numFds, timeout, readOk);
 
         for (i = 0; i < numChannels; i++)
         {
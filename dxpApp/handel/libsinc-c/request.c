@@ -35,7 +35,7 @@ bool SincSend(Sinc *sc, SincBuffer *sendBuf)
     }
 
     // Send it.
-    int errCode = SincSocketWrite(sc->fd, sendBuf->cbuf.data, (int)sendBuf->cbuf.len);
+    int errCode = sc->transport->write(sc->transportContext, sc->fd, sendBuf->cbuf.data, (int)sendBuf->cbuf.len);
     SINC_BUFFER_CLEAR(sendBuf);
     if (errCode != 0)
     {
@@ -66,7 +66,7 @@ bool SincSendNoFree(Sinc *sc, SincBuffer *sendBuf)
     }
 
     // Send it.
-    int errCode = SincSocketWrite(sc->fd, sendBuf->cbuf.data, (int)sendBuf->cbuf.len);
+    int errCode = sc->transport->write(sc->transportContext, sc->fd, sendBuf->cbuf.data, (int)sendBuf->cbuf.len);
     if (errCode != 0)
     {
         SincWriteErrorSetCode(sc, (SiToro__Sinc__ErrorCode)errCode);
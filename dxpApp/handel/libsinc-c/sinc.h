@@ -58,6 +58,7 @@ typedef struct
     ProtobufCBufferSimple cbuf;             // The packet buffer.
     int                   deviceId;         // Which array device this came from. Used only in SINC arrays.
     int                   channelIdOffset;  // What channel id offset to apply to the decoded data. Used only in SINC arrays.
+    ProtobufCAllocator   *allocator;        // Allocator for messages decoded from this packet. NULL to use malloc() and free().
 } SincBuffer;
 
 
@@ -71,11 +72,70 @@ typedef struct
  *   int success = SincSend(sinc, &buf);
  */
 
-#define SINC_BUFFER_INIT(x)  { PROTOBUF_C_BUFFER_SIMPLE_INIT(x), 0, 0 }
+#define SINC_BUFFER_INIT(x)  { PROTOBUF_C_BUFFER_SIMPLE_INIT(x), 0, 0, NULL }
 #define SINC_BUFFER_CLEAR(x) PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&(x)->cbuf)
 
 
 
+// A bump allocator for decoding messages. Set a SincBuffer's allocator to
+// &arena.allocator before decoding it and call SincArenaReset() once the
+// decoded message is no longer needed.
+#define SINC_ARENA_DEFAULT_BLOCK_SIZE 16384
+
+typedef struct SincArenaBlock SincArenaBlock;
+
+typedef struct
+{
+    ProtobufCAllocator allocator;        // Hand this to the decoder. Frees are ignored.
+    SincArenaBlock    *blocks;           // The blocks, most recent first.
+    size_t             blockSize;        // The size of new blocks.
+    size_t             used;             // Bytes used in the most recent block.
+    size_t             total;            // Bytes allocated since the last reset.
+    uint64_t           blockAllocs;      // Number of blocks allocated from the heap.
+} SincArena;
+
+
+// Receive counters for a channel.
+typedef struct
+{
+    uint64_t   bytes;            // Stream bytes read from the socket.
+    uint64_t   reads;            // Socket reads which returned data.
+    uint64_t   wakeups;          // Times the reader had to wait for data to arrive.
+} SincReadStats;
+
+
+// How a channel's stream is carried to and from the device. The default is
+// a TCP socket. Each function returns 0 on success or a SiToro__Sinc__ErrorCode
+// and is passed the context given to SincSetTransport(). Transports hand out
+// file descriptors which can be polled so callers can still wait on them.
+typedef struct
+{
+    const char *name;
+    int (*connect)(void *context, int *fd, const char *host, int port, int timeout, int rcvBufSize);
+    int (*disconnect)(void *context, int fd);
+    int (*readNonBlocking)(void *context, int fd, uint8_t *buf, int bufLen, int *bytesRead);
+    int (*write)(void *context, int fd, const uint8_t *buf, int bufLen);
+    int (*waitMulti)(void *context, const int *fd, int numFds, int timeout, bool *readOk);
+} SincTransport;
+
+// Connects over TCP. This is the default.
+extern const SincTransport SincSocketTransport;
+
+// Connects to a device emulated in the same process. Each connect creates a
+// socket pair and hands the device's end to an accept function which serves
+// the SINC protocol on it, usually from another thread. The transport context
+// is a SincLoopbackPeer, or NULL for the peer set with SincLoopbackSetPeer().
+extern const SincTransport SincLoopbackTransport;
+
+typedef void (*SincLoopbackAccept)(void *context, int fd, int port);
+
+typedef struct
+{
+    SincLoopbackAccept accept;   // Takes ownership of the device's end of the connection.
+    void              *context;  // Passed to accept.
+} SincLoopbackPeer;
+
+
 // A channel of communication to a device.
 typedef struct
 {
@@ -91,6 +151,10 @@ typedef struct
     SincError *err;              // The most recent error.
     SincError  readErr;          // The most recent read error.
     SincError  writeErr;         // The most recent write error.
+    int        rcvBufSize;       // Socket receive buffer size in bytes. 0 for the system default. User settable before connecting.
+    SincReadStats readStats;     // Receive counters.
+    const SincTransport *transport; // Carries the stream. User settable before connecting.
+    void      *transportContext; // Passed to the transport.
 } Sinc;
 
 
@@ -194,6 +258,77 @@ void SincCleanup(Sinc *sc);
 void SincSetTimeout(Sinc *sc, int timeout);
 
 
+/*
+ * NAME:        SincSetReceiveBufferSize
+ * ACTION:      Sets the socket receive buffer size. Takes effect on the next connect.
+ * PARAMETERS:  int size - the size in bytes. 0 for the system default.
+ */
+
+void SincSetReceiveBufferSize(Sinc *sc, int size);
+
+
+/*
+ * NAME:        SincSetTransport
+ * ACTION:      Sets how the channel talks to the device. Takes effect on the next connect.
+ * PARAMETERS:  const SincTransport *transport - the transport. NULL for the TCP socket default.
+ *              void *context                  - passed to the transport's functions.
+ */
+
+void SincSetTransport(Sinc *sc, const SincTransport *transport, void *context);
+
+
+/*
+ * NAME:        SincLoopbackSetPeer
+ * ACTION:      Sets the emulated device SincLoopbackTransport connects to when
+ *                  the channel has no transport context of its own.
+ * PARAMETERS:  SincLoopbackAccept accept - called with the device's end of each
+ *                                          new connection. NULL to refuse connections.
+ *              void *context             - passed to accept.
+ */
+
+void SincLoopbackSetPeer(SincLoopbackAccept accept, void *context);
+
+
+/*
+ * NAME:        SincArenaInit
+ * ACTION:      Initialises a decode arena and allocates its first block.
+ * PARAMETERS:  SincArena *arena - the arena to initialise.
+ *              size_t blockSize - the size of the arena's blocks. 0 for a default size.
+ * RETURNS:     true on success, false if out of memory.
+ */
+
+bool SincArenaInit(SincArena *arena, size_t blockSize);
+
+
+/*
+ * NAME:        SincArenaReset
+ * ACTION:      Releases everything decoded into the arena.
+ * PARAMETERS:  SincArena *arena - the arena.
+ */
+
+void SincArenaReset(SincArena *arena);
+
+
+/*
+ * NAME:        SincArenaFree
+ * ACTION:      Frees all the memory held by an arena.
+ * PARAMETERS:  SincArena *arena - the arena.
+ */
+
+void SincArenaFree(SincArena *arena);
+
+
+/*
+ * NAME:        SincGetReadStats
+ * ACTION:      Gets the receive counters for the channel.
+ * PARAMETERS:  Sinc *sc             - the sinc connection.
+ *              SincReadStats *stats - where to put the counters.
+ *              bool reset           - clear the counters after reading them.
+ */
+
+void SincGetReadStats(Sinc *sc, SincReadStats *stats, bool reset);
+
+
 /*
  * NAME:        SincConnect
  * ACTION:      Connects a Sinc channel to a device on a given host and port.
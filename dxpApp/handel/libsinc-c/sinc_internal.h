@@ -36,7 +36,8 @@ extern "C"
 #define SINC_SPECTRUMSELECT_REJECTED            0x02
 
 // The read buffer starts at this size but can expand.
-#define SINC_READBUF_DEFAULT_SIZE 65536
+#define SINC_READBUF_DEFAULT_SIZE 262144
+#define SINC_READBUF_MIN_SPACE 65536
 #define SINC_MAX_DATAGRAM_BYTES 65536
 
 // Handy network write macros. These assume a little endian architecture for speed but we can substitute big endian if necessary.
@@ -74,16 +75,21 @@ uint64_t SincProtocolReadUint64(const uint8_t *buf);
 double SincProtocolReadDouble(const uint8_t *buf);
 
 // Prototypes from socket.c.
-int SincSocketConnect(int *fd, const char *host, int port, int timeout);
+int SincSocketConnect(int *fd, const char *host, int port, int timeout, int rcvBufSize);
 int SincSocketDisconnect(int fd);
 int SincSocketWait(int fd, int timeout, bool *readOk);
 int SincSocketWaitMulti(const int *fd, int numFds, int timeout, bool *readOk);
 int SincSocketRead(int fd, uint8_t *buf, int bufLen, int *bytesRead);
+int SincSocketReadNonBlocking(int fd, uint8_t *buf, int bufLen, int *bytesRead);
 int SincSocketWriteNonBlocking(int fd, const uint8_t *buf, int bufLen, int *bytesWritten);
 int SincSocketWrite(int fd, const uint8_t *buf, int bufLen);
 int SincSocketSetNonBlocking(int fd);
 int SincSocketBindDatagram(int *datagramFd, int *port);
 int SincSocketReadDatagram(int fd, uint8_t *buf, size_t *buflen, bool nonBlocking);
+int SincSocketTransportDisconnect(void *context, int fd);
+int SincSocketTransportReadNonBlocking(void *context, int fd, uint8_t *buf, int bufLen, int *bytesRead);
+int SincSocketTransportWrite(void *context, int fd, const uint8_t *buf, int bufLen);
+int SincSocketTransportWaitMulti(void *context, const int *fd, int numFds, int timeout, bool *readOk);
 
 // Prototypes from readmessage.c.
 bool SincReadMessage(Sinc *sc, int timeout, SincBuffer *buf, SiToro__Sinc__MessageType *msgType);
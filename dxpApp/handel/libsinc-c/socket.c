@@ -100,10 +100,11 @@ int SincSocketSetNonBlocking(int fd)
  *              const char *host - the host to connect to.
  *              int port - the port to connect to.
  *              int timeout - in milliseconds. 0 to poll. -1 to wait forever.
+ *              int rcvBufSize - the socket receive buffer size in bytes. 0 for the system default.
  * RETURNS:     0 on success, a SiToro__Sinc__ErrorCode otherwise.
  */
 
-int SincSocketConnect(int *clientFd, const char *host, int port, int timeout)
+int SincSocketConnect(int *clientFd, const char *host, int port, int timeout, int rcvBufSize)
 {
     // Make sure winsock is initialised.
     int errCode = SincSocketInit();
@@ -127,6 +128,13 @@ int SincSocketConnect(int *clientFd, const char *host, int port, int timeout)
     if (errCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR)
         return errCode;
 
+    // Size the receive buffer before connecting so the TCP window scale is negotiated to suit.
+    if (rcvBufSize > 0)
+    {
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char *)&rcvBufSize, sizeof(rcvBufSize)) < 0)
+            return SI_TORO__SINC__ERROR_CODE__OUT_OF_RESOURCES;
+    }
+
     // Connect to the remote host.
     struct sockaddr_in inetAddr;
     memset(&inetAddr, 0, sizeof(inetAddr));
@@ -263,6 +271,56 @@ int SincSocketRead(int fd, uint8_t *buf, int bufLen, int *bytesRead)
 }
 
 
+/*
+ * NAME:        SincSocketReadNonBlocking
+ * ACTION:      Read whatever data the device has already sent. Will not block.
+ * PARAMETERS:  int fd - the connection to read from.
+ *              uint8_t *buf - the buffer to read to.
+ *              int bufLen - the number of bytes available in the buffer.
+ *              int *bytesRead - filled with the number of bytes read. 0 if no data is waiting.
+ * RETURNS:     0 on success, a SiToro__Sinc__ErrorCode otherwise.
+ *              SI_TORO__SINC__ERROR_CODE__SOCKET_CLOSED_UNEXPECTEDLY if the device closed the connection.
+ */
+
+int SincSocketReadNonBlocking(int fd, uint8_t *buf, int bufLen, int *bytesRead)
+{
+    int result;
+
+    *bytesRead = 0;
+
+#if defined (_WIN32)
+    result = recv(fd, (char *)buf, bufLen, 0);
+    if (result == SOCKET_ERROR)
+    {
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+            return SI_TORO__SINC__ERROR_CODE__NO_ERROR;
+
+        return SI_TORO__SINC__ERROR_CODE__READ_FAILED;
+    }
+#else
+    do
+    {
+        result = (int)recv(fd, buf, (size_t)bufLen, MSG_DONTWAIT);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return SI_TORO__SINC__ERROR_CODE__NO_ERROR;
+
+        return SI_TORO__SINC__ERROR_CODE__READ_FAILED;
+    }
+#endif
+
+    if (result == 0)
+        return SI_TORO__SINC__ERROR_CODE__SOCKET_CLOSED_UNEXPECTEDLY;
+
+    *bytesRead = result;
+
+    return SI_TORO__SINC__ERROR_CODE__NO_ERROR;
+}
+
+
 /*
  * NAME:        SincSocketWriteNonBlocking
  * ACTION:      Write to the device. Will not block but may not write the entire buffer.
@@ -550,3 +608,49 @@ int SincSocketReadDatagram(int fd, uint8_t *buf, size_t *bufLen, bool nonBlockin
     *bufLen = (size_t)packetSize;
     return SI_TORO__SINC__ERROR_CODE__NO_ERROR;
 }
+
+
+/*
+ * The stream functions as a SincTransport. The loopback transport shares
+ * all but connect since its socket pairs behave like connected sockets.
+ */
+
+static int SincSocketTransportConnect(void *context, int *fd, const char *host, int port, int timeout, int rcvBufSize)
+{
+    (void)context;
+    return SincSocketConnect(fd, host, port, timeout, rcvBufSize);
+}
+
+int SincSocketTransportDisconnect(void *context, int fd)
+{
+    (void)context;
+    return SincSocketDisconnect(fd);
+}
+
+int SincSocketTransportReadNonBlocking(void *context, int fd, uint8_t *buf, int bufLen, int *bytesRead)
+{
+    (void)context;
+    return SincSocketReadNonBlocking(fd, buf, bufLen, bytesRead);
+}
+
+int SincSocketTransportWrite(void *context, int fd, const uint8_t *buf, int bufLen)
+{
+    (void)context;
+    return SincSocketWrite(fd, buf, bufLen);
+}
+
+int SincSocketTransportWaitMulti(void *context, const int *fd, int numFds, int timeout, bool *readOk)
+{
+    (void)context;
+    return SincSocketWaitMulti(fd, numFds, timeout, readOk);
+}
+
+const SincTransport SincSocketTransport =
+{
+    "socket",
+    SincSocketTransportConnect,
+    SincSocketTransportDisconnect,
+    SincSocketTransportReadNonBlocking,
+    SincSocketTransportWrite,
+    SincSocketTransportWaitMulti
+};
@@ -987,6 +987,53 @@ int psl__XMAP_UpdateBufferHeader_MM1(MMC1_Data* mm1)
     return status;
 }
 
+int psl__XMAP_DropPixels_MM1(MMC1_Data* mm1, uint32_t drops)
+{
+    int status = XIA_SUCCESS;
+
+    MM_Buffers* mmb = &mm1->buffers;
+
+    /*
+     * The box can keep dropping after the run's last pixel. Only count
+     * the pixels the run asked for.
+     */
+    if (mmb->numPixels > 0) {
+        if (mmb->pixel >= mmb->numPixels)
+            return status;
+        if (drops > (mmb->numPixels - mmb->pixel))
+            drops = mmb->numPixels - mmb->pixel;
+    }
+
+    /*
+     * Drops that end the run have no pixel after them to write a buffer
+     * header so start the buffer here. The header's starting pixel is the
+     * first one dropped.
+     */
+    if ((psl__MappingModeBuffers_Next_Level(mmb) == 0) &&
+        (mmb->numPixels > 0) &&
+        ((mmb->pixel + drops) == mmb->numPixels)) {
+        status = psl__XMAP_WriteBufferHeader_MM1(mm1);
+        if (status != XIA_SUCCESS)
+            return status;
+    }
+
+    psl__MappingModeBuffers_Drop(mmb, drops);
+
+    /*
+     * Count the drops in a started buffer's header and let the buffer
+     * swap if the drops filled the run.
+     */
+    if (psl__MappingModeBuffers_Next_Level(mmb) > 0) {
+        status = psl__XMAP_UpdateBufferHeader_MM1(mm1);
+        if (status != XIA_SUCCESS)
+            return status;
+
+        psl__MappingModeBuffers_Update(mmb);
+    }
+
+    return status;
+}
+
 int psl__XMAP_WritePixelHeader_MM1(MMC1_Data* mm1, MM_Pixel_Stats* stats)
 {
     int status = XIA_SUCCESS;
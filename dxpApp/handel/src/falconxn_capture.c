@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * FalconXN SINC wire stream capture and replay files.
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <inttypes.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "handel_log.h"
+
+#include "psldef.h"
+#include "psl_common.h"
+
+#include "xia_handel.h"
+#include "xia_common.h"
+#include "xia_assert.h"
+
+#include "handel_errors.h"
+
+#include "falconxn_capture.h"
+
+static const char CAPTURE_MAGIC[8] = { 'S', 'I', 'N', 'C', 'C', 'A', 'P', '\0' };
+
+#define CAPTURE_HEADER_SIZE (16)
+#define CAPTURE_RECORD_SIZE (16)
+
+static void psl__CapturePut32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+static uint32_t psl__CaptureGet32(const uint8_t* p)
+{
+    return ((uint32_t) p[0]) | (((uint32_t) p[1]) << 8) |
+        (((uint32_t) p[2]) << 16) | (((uint32_t) p[3]) << 24);
+}
+
+/*
+ * Monotonic time in nanoseconds. Only differences are meaningful.
+ */
+uint64_t psl__CaptureNow(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) ((double) counter.QuadPart * 1.0e9 / (double) frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+boolean_t psl__CaptureIsOpen(FalconXNCapture* capture)
+{
+    return capture->fp != NULL;
+}
+
+int psl__CaptureOpen(FalconXNCapture* capture, const char* path)
+{
+    uint8_t header[CAPTURE_HEADER_SIZE];
+
+    ASSERT(capture->fp == NULL);
+
+    memset(capture, 0, sizeof(*capture));
+
+    capture->fp = fopen(path, "wb");
+    if (capture->fp == NULL) {
+        pslLog(PSL_LOG_ERROR, XIA_OPEN_FILE,
+               "Unable to open capture file: %s: %s", path, strerror(errno));
+        return XIA_OPEN_FILE;
+    }
+
+    capture->buffer = handel_md_alloc(FALCONXN_CAPTURE_WRITE_BUFFER);
+    if (capture->buffer != NULL) {
+        capture->size = FALCONXN_CAPTURE_WRITE_BUFFER;
+        setvbuf(capture->fp, capture->buffer, _IOFBF, capture->size);
+    }
+
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    psl__CapturePut32(&header[8], FALCONXN_CAPTURE_VERSION);
+    psl__CapturePut32(&header[12], 0);
+
+    if (fwrite(header, sizeof(header), 1, capture->fp) != 1) {
+        pslLog(PSL_LOG_ERROR, XIA_BAD_FILE_WRITE,
+               "Unable to write capture file header: %s", path);
+        psl__CaptureClose(capture);
+        return XIA_BAD_FILE_WRITE;
+    }
+
+    capture->start = psl__CaptureNow();
+
+    pslLog(PSL_LOG_INFO, "Capturing the SINC stream to %s", path);
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Write a received packet. The packet is the payload returned by the
+ * SINC read with the message type.
+ */
+int psl__CaptureWrite(FalconXNCapture* capture,
+                      SiToro__Sinc__MessageType msgType,
+                      SincBuffer* packet)
+{
+    uint8_t  record[CAPTURE_RECORD_SIZE];
+    uint64_t time;
+
+    ASSERT(capture->fp != NULL);
+
+    time = psl__CaptureNow() - capture->start;
+
+    psl__CapturePut32(&record[0], (uint32_t) time);
+    psl__CapturePut32(&record[4], (uint32_t) (time >> 32));
+    psl__CapturePut32(&record[8], (uint32_t) msgType);
+    psl__CapturePut32(&record[12], (uint32_t) packet->cbuf.len);
+
+    if ((fwrite(record, sizeof(record), 1, capture->fp) != 1) ||
+        ((packet->cbuf.len > 0) &&
+         (fwrite(packet->cbuf.data, packet->cbuf.len, 1, capture->fp) != 1))) {
+        pslLog(PSL_LOG_ERROR, XIA_BAD_FILE_WRITE,
+               "Capture file write failed after %" PRIu64 " packets",
+               capture->packets);
+        return XIA_BAD_FILE_WRITE;
+    }
+
+    ++capture->packets;
+    capture->bytes += packet->cbuf.len;
+
+    return XIA_SUCCESS;
+}
+
+int psl__CaptureOpenReplay(FalconXNCapture* capture, const char* path)
+{
+    uint8_t header[CAPTURE_HEADER_SIZE];
+
+    memset(capture, 0, sizeof(*capture));
+
+    capture->fp = fopen(path, "rb");
+    if (capture->fp == NULL) {
+        pslLog(PSL_LOG_ERROR, XIA_OPEN_FILE,
+               "Unable to open capture file: %s: %s", path, strerror(errno));
+        return XIA_OPEN_FILE;
+    }
+
+    if (fread(header, sizeof(header), 1, capture->fp) != 1 ||
+        memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        pslLog(PSL_LOG_ERROR, XIA_FILE_TYPE,
+               "Not a SINC capture file: %s", path);
+        psl__CaptureClose(capture);
+        return XIA_FILE_TYPE;
+    }
+
+    if (psl__CaptureGet32(&header[8]) != FALCONXN_CAPTURE_VERSION) {
+        pslLog(PSL_LOG_ERROR, XIA_FILE_TYPE,
+               "Unsupported SINC capture file version %u: %s",
+               psl__CaptureGet32(&header[8]), path);
+        psl__CaptureClose(capture);
+        return XIA_FILE_TYPE;
+    }
+
+    capture->start = psl__CaptureNow();
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Read the next packet. The packet's buffer refers to the capture's
+ * data and is valid until the next read. Returns XIA_EOF at the end of
+ * the capture. A truncated last record, as left if the process capturing
+ * was killed, is also the end.
+ */
+int psl__CaptureRead(FalconXNCapture* capture,
+                     uint64_t* time,
+                     SiToro__Sinc__MessageType* msgType,
+                     SincBuffer* packet)
+{
+    uint8_t  record[CAPTURE_RECORD_SIZE];
+    uint32_t length;
+
+    ASSERT(capture->fp != NULL);
+
+    if (fread(record, sizeof(record), 1, capture->fp) != 1)
+        return XIA_EOF;
+
+    *time = ((uint64_t) psl__CaptureGet32(&record[4]) << 32) |
+        psl__CaptureGet32(&record[0]);
+    *msgType = (SiToro__Sinc__MessageType) psl__CaptureGet32(&record[8]);
+    length = psl__CaptureGet32(&record[12]);
+
+    if (length > FALCONXN_CAPTURE_MAX_PACKET) {
+        pslLog(PSL_LOG_ERROR, XIA_BAD_FILE_READ,
+               "Capture packet %" PRIu64 " length invalid: %u",
+               capture->packets, length);
+        return XIA_BAD_FILE_READ;
+    }
+
+    if (length > capture->size) {
+        size_t size = capture->size ? capture->size : 4096;
+
+        while (size < length)
+            size *= 2;
+
+        handel_md_free(capture->buffer);
+        capture->size = 0;
+
+        capture->buffer = handel_md_alloc(size);
+        if (capture->buffer == NULL) {
+            pslLog(PSL_LOG_ERROR, XIA_NOMEM,
+                   "No memory for a capture packet: %u", length);
+            return XIA_NOMEM;
+        }
+
+        capture->size = size;
+    }
+
+    if ((length > 0) && (fread(capture->buffer, length, 1, capture->fp) != 1)) {
+        pslLog(PSL_LOG_WARNING,
+               "Capture truncated in packet %" PRIu64, capture->packets);
+        return XIA_EOF;
+    }
+
+    /*
+     * Wrap the data the way PROTOBUF_C_BUFFER_SIMPLE_INIT wraps a fixed
+     * array. Clearing the packet leaves the data alone.
+     */
+    packet->cbuf.data = (uint8_t*) capture->buffer;
+    packet->cbuf.len = length;
+    packet->cbuf.alloced = capture->size;
+    packet->cbuf.must_free_data = 0;
+
+    ++capture->packets;
+    capture->bytes += length;
+
+    return XIA_SUCCESS;
+}
+
+void psl__CaptureClose(FalconXNCapture* capture)
+{
+    if (capture->fp != NULL) {
+        fclose(capture->fp);
+        capture->fp = NULL;
+    }
+
+    if (capture->buffer != NULL) {
+        handel_md_free(capture->buffer);
+        capture->buffer = NULL;
+    }
+
+    capture->size = 0;
+}
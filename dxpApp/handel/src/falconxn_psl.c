@@ -44,6 +44,14 @@
 
 #include <inttypes.h>
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#define PSL_RECEIVE_ENGINE 1
+#else
+#define PSL_RECEIVE_ENGINE 0
+#endif
+
 #include "handel_log.h"
 
 #include "psldef.h"
@@ -113,6 +121,29 @@ typedef union {
 
 #define DC_OFFSET_REQUESTED -99999.9
 
+#define PSL_CALIBRATION_HASH_LEN 17
+
+/*
+ * Binary detector characterization channel data. The values are in the
+ * host's byte order, which the order mark checks when loading:
+ *
+ *   magic          PSL_DETC_MAGIC_LEN bytes
+ *   order mark     uint32_t, PSL_DETC_ORDER
+ *   data length    uint32_t
+ *   pulse lengths  3 x uint32_t, example, model and final
+ *   hash           16 hex digits, hash of everything that follows
+ *   data           data length bytes
+ *   pulses         pulse length y-values as doubles for each pulse
+ *
+ * The pulse x-values are the sample index so they are not stored. The
+ * older text format is still loaded.
+ */
+#define PSL_DETC_MAGIC      "FXNDETC\001"
+#define PSL_DETC_MAGIC_LEN  8
+#define PSL_DETC_ORDER      0x01020304
+#define PSL_DETC_HEADER_LEN (PSL_DETC_MAGIC_LEN + 5 * sizeof(uint32_t) + \
+                             PSL_CALIBRATION_HASH_LEN - 1)
+
 #define PSL_SINC_BUFFER_CLEAR(x) PRAGMA_PUSH    \
     PRAGMA_IGNORE_COND_CONST                    \
     SINC_BUFFER_CLEAR(x)                        \
@@ -173,11 +204,21 @@ PSL_STATIC int psl__ModuleTransactionEnd(Module* module);
 PSL_STATIC boolean_t psl__CanRemoveName(const char *name);
 
 PSL_STATIC int psl__DetCharacterizeStart(int detChan, FalconXNDetector* fDetector, Module* module);
-PSL_STATIC int psl__UnloadDetCharacterization(Module* module, FalconXNDetector* fDetector,
-                                              xia_sio *buf);
+PSL_STATIC int psl__DetcJobJoin(Module* module, FalconXNDetector* fDetector);
+PSL_STATIC void psl__DetcJobStatus(int* channels, int* running, int* successful,
+                                   double* percentage);
+PSL_STATIC void psl__DetcCollector(void* arg);
+PSL_STATIC void psl__DetcCollectorStop(Module* module);
+PSL_STATIC int psl__UnloadDetCharacterizationS(Module* module, FalconXNDetector* fDetector,
+                                               xia_sio *buf);
+PSL_STATIC int psl__UnloadDetCharacterizationB(Module* module, FalconXNDetector* fDetector,
+                                               GenBuffer *buf);
 PSL_STATIC int psl__LoadDetCharacterization(FalconXNDetector *fDetector, Module *module);
 PSL_STATIC int psl__LoadDetCharacterizationF(FalconXNDetector *fDetector, Module *module, const char *filename);
 PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module *module, const char *calString);
+PSL_STATIC int psl__ReadDetCharacterization(FalconXNDetector *fDetector, xia_sio *dcStream, int *lc);
+PSL_STATIC int psl__LoadDetCharacterizationB(FalconXNDetector *fDetector, Module *module,
+                                             const byte_t *data, size_t len);
 
 PSL_STATIC int psl__RefreshChannelState(Module* module, FalconXNDetector* fDetector);
 PSL_STATIC int psl__UpdateChannelState(SiToro__Sinc__KeyValue* kv, FalconXNDetector* fDetector);
@@ -202,6 +243,12 @@ PSL_STATIC int psl__BoardOp_GetFirmwareVersion(int detChan, Detector* detector,
                                                const char *name, void *value);
 PSL_STATIC int psl__BoardOp_GetBoardFeatures(int detChan, Detector* detector, Module* module,
                                              const char *name, void *value);
+PSL_STATIC int psl__BoardOp_GetReceiveStats(int detChan, Detector* detector, Module* module,
+                                            const char *name, void *value);
+PSL_STATIC int psl__BoardOp_ReplayCapture(int detChan, Detector* detector, Module* module,
+                                          const char *name, void *value);
+PSL_STATIC int psl__BoardOp_GetConnectionStatus(int detChan, Detector* detector, Module* module,
+                                                const char *name, void *value);
 
 /* Helpers */
 PSL_STATIC PSL_INLINE int psl__SetAcqValue(acqValue*    acqVal,
@@ -210,6 +257,12 @@ PSL_STATIC bool psl__AcqRemoved(const char *name);
 PSL_STATIC FalconXNDetector* psl__FindDetector(Module* module, int channel);
 PSL_STATIC int psl__GetParam(Module* module, int channel, const char* name,
                              SiToro__Sinc__GetParamResponse** resp);
+PSL_STATIC int psl__GetParamNoCache(Module* module, int channel, const char* name,
+                                    SiToro__Sinc__GetParamResponse** resp);
+PSL_STATIC int psl__ParamCacheStore(FalconXNDetector* fDetector,
+                                    const SiToro__Sinc__KeyValue* kv);
+PSL_STATIC void psl__ParamCacheClear(FalconXNDetector* fDetector);
+PSL_STATIC void psl__ParamMapFree(xia_map_t* params);
 PSL_STATIC int psl__SetParam(Module* module, int modChan,
                              SiToro__Sinc__KeyValue* param);
 PSL_STATIC int psl__GetParamValue(Module* module, int channel, const char* name,
@@ -239,6 +292,9 @@ PSL_STATIC int64_t psl__SamplesToNS(FalconXNDetector *fDetector, int64_t samples
 PSL_STATIC int64_t psl__NSToSamples(FalconXNDetector *fDetector, int64_t ns);
 PSL_STATIC int psl__GetDCOffset(Module *module, FalconXNDetector *fDetector,
                                 void *value);
+PSL_STATIC boolean_t psl__LinkLost(Module* module);
+PSL_STATIC void psl__ModuleReconnector(void* arg);
+PSL_STATIC void psl__ReconnectStop(Module* module);
 
 /*
  * Override xia_system PSL validation to ignore detector->pslData since falconxn
@@ -423,7 +479,11 @@ static  BoardOperation boardOps[] =
         { "get_connected",        psl__BoardOp_GetConnected },
         { "get_channel_count",    psl__BoardOp_GetChannelCount },
         { "get_serial_number",    psl__BoardOp_GetSerialNumber },
-        { "get_firmware_version", psl__BoardOp_GetFirmwareVersion }
+        { "get_firmware_version", psl__BoardOp_GetFirmwareVersion },
+        { "get_receive_stats",    psl__BoardOp_GetReceiveStats },
+        { "replay_capture",       psl__BoardOp_ReplayCapture },
+        { "replay_capture_fast",  psl__BoardOp_ReplayCapture },
+        { "get_connection_status", psl__BoardOp_GetConnectionStatus }
     };
 
 /* The PSL Handlers table. This is exported to Handel. */
@@ -453,6 +513,12 @@ PSL_SHARED int falconxn_PSLInit(const PSLHandlers** psl)
     handlers.canRemoveName = psl__CanRemoveName;
     handlers.freeSCAs = pslDestroySCAs;
 
+    /*
+     * Each module has its own connection, receiver and locks so Handel can
+     * broadcast to the modules in parallel.
+     */
+    handlers.concurrentModules = TRUE_;
+
     *psl = &handlers;
     return XIA_SUCCESS;
 }
@@ -497,6 +563,31 @@ PSL_STATIC void falconXNClearDetectorCalibrationData(FalconXNDetector* fDetector
     falconXNClearCalibrationData(&fDetector->calibFinal);
 }
 
+/*
+ * Free an oscilloscope trace.
+ */
+PSL_STATIC void falconXNClearOscPlot(SincOscPlot* plot)
+{
+    free(plot->data);
+    plot->data = NULL;
+    free(plot->intData);
+    plot->intData = NULL;
+    plot->len = 0;
+}
+
+/*
+ * Clean out the traces held by a continuously running oscilloscope.
+ */
+PSL_STATIC void falconXNClearDetectorScopeRing(FalconXNDetector* fDetector)
+{
+    while (fDetector->scopeCount > 0) {
+        falconXNClearOscPlot(&fDetector->scopeRing[fDetector->scopeHead]);
+        fDetector->scopeHead = (fDetector->scopeHead + 1) % FALCONXN_SCOPE_RING_SIZE;
+        --fDetector->scopeCount;
+    }
+    fDetector->scopeHead = 0;
+}
+
 /*
  * Clean out the stats.
  */
@@ -998,8 +1089,8 @@ PSL_STATIC int psl__RefreshChannelState(Module* module, FalconXNDetector* fDetec
     SiToro__Sinc__GetParamResponse* resp = NULL;
     SiToro__Sinc__KeyValue*         kv;
 
-    status = psl__GetParam(module, fDetector->modDetChan,
-                           "channel.state", &resp);
+    status = psl__GetParamNoCache(module, fDetector->modDetChan,
+                                  "channel.state", &resp);
     if (status != XIA_SUCCESS) {
         pslLog(PSL_LOG_ERROR, status,
                "Unable to get the channel state");
@@ -1032,7 +1123,9 @@ PSL_STATIC int psl__RefreshChannelState(Module* module, FalconXNDetector* fDetec
 
 /*
  * Queries the board for features we support conditionally based on firmware.
- * Updates the detector features state.
+ * Updates the detector features state. The parameter values in the details
+ * fill the detector's parameter mirror so the channel must be monitored
+ * first to keep it current.
  */
 PSL_STATIC int psl__LoadChannelFeatures(Module* module, int modChan)
 {
@@ -1040,6 +1133,7 @@ PSL_STATIC int psl__LoadChannelFeatures(Module* module, int modChan)
     SiToro__Sinc__ListParamDetailsResponse* resp = NULL;
 
     FalconXNDetector* fDetector = psl__FindDetector(module, modChan);
+    FalconXNParam*    param;
 
     size_t i, j;
 
@@ -1072,9 +1166,27 @@ PSL_STATIC int psl__LoadChannelFeatures(Module* module, int modChan)
         return status;
     }
 
+    psl__ParamCacheClear(fDetector);
+
     for (i = 0; i < resp->n_paramdetails; i++) {
         SiToro__Sinc__ParamDetails *paramdetails = resp->paramdetails[i];
 
+        if (paramdetails->kv == NULL)
+            continue;
+
+        status = psl__ParamCacheStore(fDetector, paramdetails->kv);
+        if (status != XIA_SUCCESS) {
+            psl__ParamCacheClear(fDetector);
+            psl__DetectorUnlock(fDetector);
+            si_toro__sinc__list_param_details_response__free_unpacked(resp, NULL);
+            pslLog(PSL_LOG_ERROR, status, "Unable to mirror the parameters");
+            return status;
+        }
+
+        param = xia_map_get(&fDetector->params, paramdetails->kv->key);
+        if ((param != NULL) && paramdetails->has_settable)
+            param->settable = paramdetails->settable ? TRUE_ : FALSE_;
+
         if (strcmp("gate.veto", paramdetails->kv->key) == 0) {
             fDetector->features.mcaGateVeto = TRUE_;
         }
@@ -1107,6 +1219,11 @@ PSL_STATIC int psl__LoadChannelFeatures(Module* module, int modChan)
         }
     }
 
+    fDetector->paramsValid = TRUE_;
+
+    pslLog(PSL_LOG_DEBUG, "Mirrored %d parameters for %s:%d",
+           (int) fDetector->params.count, module->alias, modChan);
+
     psl__DetectorUnlock(fDetector);
 
     si_toro__sinc__list_param_details_response__free_unpacked(resp, NULL);
@@ -1164,6 +1281,212 @@ PSL_STATIC void psl__SPrintKV(char *s, size_t max, SiToro__Sinc__KeyValue* kv)
         snprintf(s, max, "???");
 }
 
+/*
+ * Stores a parameter in the detector's mirror of the box's parameters.
+ * A parameter without a value is removed so it is read from the box.
+ * The caller holds the detector lock.
+ */
+PSL_STATIC int psl__ParamCacheStore(FalconXNDetector*             fDetector,
+                                    const SiToro__Sinc__KeyValue* kv)
+{
+    FalconXNParam* param;
+    const char*    str = NULL;
+    boolean_t      hasValue;
+
+    SiToro__Sinc__KeyValue__ParamType type;
+
+    if ((kv == NULL) || (kv->key == NULL))
+        return XIA_SUCCESS;
+
+    if (kv->has_paramtype)
+        type = kv->paramtype;
+    else if (kv->has_intval)
+        type = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE;
+    else if (kv->has_floatval)
+        type = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE;
+    else if (kv->has_boolval)
+        type = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE;
+    else if (kv->optionval != NULL)
+        type = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE;
+    else
+        type = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE;
+
+    switch (type) {
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE:
+        hasValue = kv->has_intval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE:
+        hasValue = kv->has_floatval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE:
+        hasValue = kv->has_boolval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE:
+        str = kv->strval;
+        hasValue = str != NULL;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE:
+        str = kv->optionval;
+        hasValue = str != NULL;
+        break;
+    default:
+        hasValue = FALSE_;
+        break;
+    }
+
+    param = xia_map_get(&fDetector->params, kv->key);
+
+    if (!hasValue) {
+        if (param != NULL) {
+            xia_map_remove(&fDetector->params, kv->key);
+            if (param->str != NULL)
+                handel_md_free(param->str);
+            handel_md_free(param);
+        }
+        return XIA_SUCCESS;
+    }
+
+    if (param == NULL) {
+        param = handel_md_alloc(sizeof(FalconXNParam) + strlen(kv->key) + 1);
+        if (param == NULL)
+            return XIA_NOMEM;
+        memset(param, 0, sizeof(*param));
+        param->settable = TRUE_;
+        strcpy(param->key, kv->key);
+        if (xia_map_put(&fDetector->params, param->key, param) != 0) {
+            handel_md_free(param);
+            return XIA_NOMEM;
+        }
+    }
+
+    if (param->str != NULL) {
+        handel_md_free(param->str);
+        param->str = NULL;
+    }
+
+    if (str != NULL) {
+        param->str = handel_md_alloc(strlen(str) + 1);
+        if (param->str == NULL) {
+            xia_map_remove(&fDetector->params, param->key);
+            handel_md_free(param);
+            return XIA_NOMEM;
+        }
+        strcpy(param->str, str);
+    }
+
+    param->type = type;
+    param->intval = kv->intval;
+    param->floatval = kv->floatval;
+    param->boolval = kv->boolval ? TRUE_ : FALSE_;
+
+    return XIA_SUCCESS;
+}
+
+PSL_STATIC void psl__ParamMapFree(xia_map_t* params)
+{
+    size_t e;
+
+    for (e = 0; e < params->size; ++e) {
+        FalconXNParam* param = params->entries[e].value;
+        if (param != NULL) {
+            if (param->str != NULL)
+                handel_md_free(param->str);
+            handel_md_free(param);
+        }
+    }
+
+    xia_map_clear(params);
+}
+
+PSL_STATIC void psl__ParamCacheClear(FalconXNDetector* fDetector)
+{
+    psl__ParamMapFree(&fDetector->params);
+    fDetector->paramsValid = FALSE_;
+}
+
+/*
+ * Makes a GetParam response from a mirrored parameter. It is allocated
+ * the way the decoder allocates so callers free it with
+ * si_toro__sinc__get_param_response__free_unpacked as usual.
+ */
+PSL_STATIC int psl__ParamCacheResponse(const FalconXNParam*             param,
+                                       int                              channel,
+                                       SiToro__Sinc__GetParamResponse** resp)
+{
+    SiToro__Sinc__GetParamResponse* r;
+    SiToro__Sinc__KeyValue*         kv;
+
+    r = malloc(sizeof(*r));
+    if (r == NULL)
+        return XIA_NOMEM;
+
+    si_toro__sinc__get_param_response__init(r);
+
+    r->results = malloc(sizeof(*r->results));
+    kv = malloc(sizeof(*kv));
+    if (r->results != NULL)
+        r->results[0] = kv;
+    if (kv != NULL) {
+        si_toro__sinc__key_value__init(kv);
+        r->n_results = 1;
+        kv->key = malloc(strlen(param->key) + 1);
+        if ((kv->key != NULL) && (param->str != NULL))
+            kv->strval = malloc(strlen(param->str) + 1);
+    }
+
+    if ((r->results == NULL) || (kv == NULL) || (kv->key == NULL) ||
+        ((param->str != NULL) && (kv->strval == NULL))) {
+        if (r->results == NULL)
+            free(kv);
+        si_toro__sinc__get_param_response__free_unpacked(r, NULL);
+        return XIA_NOMEM;
+    }
+
+    strcpy(kv->key, param->key);
+
+    r->has_channelid = TRUE_;
+    r->channelid = channel;
+
+    kv->has_channelid = TRUE_;
+    kv->channelid = channel;
+    kv->has_paramtype = TRUE_;
+    kv->paramtype = param->type;
+
+    switch (param->type) {
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE:
+        kv->has_intval = TRUE_;
+        kv->intval = param->intval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE:
+        kv->has_floatval = TRUE_;
+        kv->floatval = param->floatval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE:
+        kv->has_boolval = TRUE_;
+        kv->boolval = param->boolval;
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE:
+        strcpy(kv->strval, param->str);
+        break;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE:
+        strcpy(kv->strval, param->str);
+        kv->optionval = kv->strval;
+        kv->strval = NULL;
+        break;
+    default:
+        break;
+    }
+
+    *resp = r;
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Gets a parameter from the detector's mirror of the box's parameters
+ * or from the box if the mirror does not hold it. Parameters read from
+ * the box are added to the mirror.
+ */
 PSL_STATIC int psl__GetParam(Module*                          module,
                              int                              channel,
                              const char*                      name,
@@ -1171,6 +1494,53 @@ PSL_STATIC int psl__GetParam(Module*                          module,
 {
     int status = XIA_SUCCESS;
 
+    FalconXNDetector* fDetector = psl__FindDetector(module, channel);
+
+    *resp = NULL;
+
+    if (fDetector != NULL) {
+        status = psl__DetectorLock(fDetector);
+        if (status != XIA_SUCCESS)
+            return status;
+
+        if (fDetector->paramsValid) {
+            FalconXNParam* param = xia_map_get(&fDetector->params, name);
+            if (param != NULL)
+                status = psl__ParamCacheResponse(param, channel, resp);
+        }
+
+        psl__DetectorUnlock(fDetector);
+
+        if (*resp != NULL)
+            pslLog(PSL_LOG_DEBUG, "Param read: %s (cached)", name);
+
+        if ((status != XIA_SUCCESS) || (*resp != NULL))
+            return status;
+    }
+
+    status = psl__GetParamNoCache(module, channel, name, resp);
+
+    if ((status == XIA_SUCCESS) && (fDetector != NULL) && ((*resp)->n_results > 0)) {
+        if (psl__DetectorLock(fDetector) == XIA_SUCCESS) {
+            if (fDetector->paramsValid)
+                psl__ParamCacheStore(fDetector, (*resp)->results[0]);
+            psl__DetectorUnlock(fDetector);
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Gets a parameter from the box.
+ */
+PSL_STATIC int psl__GetParamNoCache(Module*                          module,
+                                    int                              channel,
+                                    const char*                      name,
+                                    SiToro__Sinc__GetParamResponse** resp)
+{
+    int status = XIA_SUCCESS;
+
     uint8_t    pad[256];
     SincBuffer packet = PSL_SINC_BUFFER_INIT(pad);
     Sinc_Response response;
@@ -1238,6 +1608,18 @@ PSL_STATIC int psl__SetParam(Module*                 module,
 
     psl__ModuleTransactionEnd(module);
 
+    /*
+     * Keep the mirror current until the box's update arrives. The box
+     * may adjust the value and the update corrects it.
+     */
+    if (status == XIA_SUCCESS) {
+        FalconXNDetector* fDetector = psl__FindDetector(module, modChan);
+        if ((fDetector != NULL) && (psl__DetectorLock(fDetector) == XIA_SUCCESS)) {
+            psl__ParamCacheStore(fDetector, param);
+            psl__DetectorUnlock(fDetector);
+        }
+    }
+
     return status;
 }
 
@@ -1404,6 +1786,29 @@ PSL_STATIC int psl__SetADCTraceLength(Module* module, int modChan,
     return XIA_SUCCESS;
 }
 
+/*
+ * Copy a trace to the caller's buffer converting the signed samples
+ * into our unsigned range and free it.
+ */
+PSL_STATIC void psl__CopyADCTrace(SincOscPlot* trace, void* buffer)
+{
+    int32_t* in;
+    unsigned int* out;
+    int s;
+
+    in = trace->intData;
+    out = ((unsigned int*) buffer);
+    for (s = 0; s < trace->len; ++s) {
+        /* Convert signed values into our unsigned range. adcTrace
+         * minRange/maxRange are typically -0x10000/2 - 1 to 0x10000
+         */
+        *out++ =
+            (unsigned int) (*in++) - (unsigned int) trace->minRange;
+    }
+
+    falconXNClearOscPlot(trace);
+}
+
 PSL_STATIC int psl__GetADCTrace(Module* module, FalconXNDetector* fDetector, void* buffer)
 {
     int status;
@@ -1411,15 +1816,28 @@ PSL_STATIC int psl__GetADCTrace(Module* module, FalconXNDetector* fDetector, voi
     uint8_t    pad[256];
     SincBuffer packet = PSL_SINC_BUFFER_INIT(pad);
 
-    int32_t* in;
-    unsigned int* out;
-    int s;
+    boolean_t continuous;
 
     SiToro__Sinc__KeyValue kv;
 
     pslLog(PSL_LOG_INFO,
            "ADC trace channel %d", fDetector->detChan);
 
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    continuous = fDetector->scopeContinuous;
+
+    psl__DetectorUnlock(fDetector);
+
+    if (continuous) {
+        pslLog(PSL_LOG_ERROR, XIA_NOT_IDLE,
+               "The oscilloscope is running continuously on channel %d",
+               fDetector->detChan);
+        return XIA_NOT_IDLE;
+    }
+
     si_toro__sinc__key_value__init(&kv);
     kv.key = (char*) "oscilloscope.runContinuously";
     kv.has_boolval = TRUE_;
@@ -1475,95 +1893,211 @@ PSL_STATIC int psl__GetADCTrace(Module* module, FalconXNDetector* fDetector, voi
     if (status != XIA_SUCCESS)
         return status;
 
-    in = fDetector->adcTrace.intData;
-    out = ((unsigned int*) buffer);
-    for (s = 0; s < fDetector->adcTrace.len; ++s) {
-        /* Convert signed values into our unsigned range. adcTrace
-         * minRange/maxRange are typically -0x10000/2 - 1 to 0x10000
-         */
-        *out++ =
-            (unsigned int) (*in++) - (unsigned int) fDetector->adcTrace.minRange;
-    }
-
-    free(fDetector->adcTrace.data);
-    fDetector->adcTrace.data = NULL;
-
-    free(fDetector->adcTrace.intData);
-    fDetector->adcTrace.intData = NULL;
-
-    fDetector->adcTrace.len = 0;
+    psl__CopyADCTrace(&fDetector->adcTrace, buffer);
 
     status = psl__DetectorUnlock(fDetector);
 
     return status;
 }
 
-PSL_STATIC int psl__UpdateCalibration(Module* module, FalconXNDetector* fDetector)
+/*
+ * Start the oscilloscope running continuously. The box keeps sending
+ * traces until it is stopped and the receiver holds the latest in the
+ * detector's scope ring.
+ */
+PSL_STATIC int psl__ADCTraceStreamStart(Module* module, FalconXNDetector* fDetector)
 {
-    int status = XIA_SUCCESS;
+    int status;
 
     uint8_t    pad[256];
     SincBuffer packet = PSL_SINC_BUFFER_INIT(pad);
 
-    Sinc_Response response;
+    SiToro__Sinc__KeyValue kv;
 
-    SiToro__Sinc__GetParamResponse* resp = NULL;
-    SiToro__Sinc__KeyValue*  kv;
+    pslLog(PSL_LOG_INFO,
+           "ADC trace stream start channel %d", fDetector->detChan);
 
-    pslLog(PSL_LOG_DEBUG, "Updating calibration result for %s channel %d",
-           module->alias, fDetector->modDetChan);
+    si_toro__sinc__key_value__init(&kv);
+    kv.key = (char*) "oscilloscope.runContinuously";
+    kv.has_boolval = TRUE_;
+    kv.boolval = TRUE_;
+
+    status = psl__SetParam(module, fDetector->modDetChan, &kv);
+    if (status != XIA_SUCCESS) {
+        pslLog(PSL_LOG_ERROR, status,
+               "Unable to set the oscilloscope run mode");
+        return status;
+    }
 
     status = psl__DetectorLock(fDetector);
     if (status != XIA_SUCCESS)
         return status;
 
-    fDetector->calibrationState = CalibrationNone;
+    falconXNClearDetectorScopeRing(fDetector);
+    fDetector->scopeTraces = 0;
+    fDetector->scopeDropped = 0;
+    fDetector->scopeContinuous = TRUE_;
 
-    status = psl__GetParam(module, fDetector->modDetChan, "pulse.calibrated", &resp);
+    psl__DetectorUnlock(fDetector);
+
+    SincEncodeStartOscilloscope(&packet, psl__DetectorChannel(fDetector));
+
+    status = psl__ModuleTransactionSend(module, &packet);
+    if (status == XIA_SUCCESS) {
+        status = psl__CheckSuccessResponse(module);
+        psl__ModuleTransactionEnd(module);
+    }
 
     if (status != XIA_SUCCESS) {
+        psl__DetectorLock(fDetector);
+        fDetector->scopeContinuous = FALSE_;
         psl__DetectorUnlock(fDetector);
-        pslLog(PSL_LOG_ERROR, status, "Unable to get pulse.calibrated");
+        pslLog(PSL_LOG_ERROR, status,
+               "Starting continuous oscilloscope failed");
         return status;
     }
 
-    kv = resp->results[0];
-
-    if (kv->has_paramtype &&
-        (kv->paramtype == SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE)) {
-        fDetector->calibrationState = kv->boolval ? CalibrationReady :
-            CalibrationNone;
-    }
+    return XIA_SUCCESS;
+}
 
-    si_toro__sinc__get_param_response__free_unpacked(resp, NULL);
+/*
+ * Stop a continuously running oscilloscope and drop any traces not
+ * collected.
+ */
+PSL_STATIC int psl__ADCTraceStreamStop(Module* module, FalconXNDetector* fDetector)
+{
+    int status;
 
-    pslLog(PSL_LOG_DEBUG, "Calibration success= %s", kv->boolval ? "yes" : "no");
+    pslLog(PSL_LOG_INFO,
+           "ADC trace stream stop channel %d", fDetector->detChan);
 
-    psl__DetectorUnlock(fDetector);
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS)
+        return status;
 
-    if (fDetector->calibrationState == CalibrationNone)
-        return XIA_SUCCESS;
+    fDetector->scopeContinuous = FALSE_;
 
-    pslLog(PSL_LOG_DEBUG, "Get calibration data");
-    SincEncodeGetCalibration(&packet, psl__DetectorChannel(fDetector));
+    psl__DetectorUnlock(fDetector);
 
-    status = psl__ModuleTransactionSend(module, &packet);
+    status = psl__StopDataAcquisition(module, fDetector->modDetChan, false);
     if (status != XIA_SUCCESS) {
         pslLog(PSL_LOG_ERROR, status,
-               "Error requesting detector characterisation data");
-        return status;
+               "Unable to stop the oscilloscope");
     }
 
-    /*
-     * The 'resp'onse is NULL. The decoder loaded the data into the detector.
-     */
-    response.channel = psl__DetectorChannel(fDetector);
-    response.type = SI_TORO__SINC__MESSAGE_TYPE__GET_CALIBRATION_RESPONSE;
+    psl__DetectorLock(fDetector);
 
-    status = psl__ModuleTransactionReceive(module, &response);
+    pslLog(PSL_LOG_INFO,
+           "ADC trace stream channel %d: %" PRIu64 " traces, %" PRIu64 " dropped",
+           fDetector->detChan, fDetector->scopeTraces, fDetector->scopeDropped);
 
-    if (status != XIA_SUCCESS) {
-        pslLog(PSL_LOG_ERROR, status, "Receiving the response");
+    falconXNClearDetectorScopeRing(fDetector);
+
+    psl__DetectorUnlock(fDetector);
+
+    return status;
+}
+
+/*
+ * Take the oldest trace from the scope ring.
+ */
+PSL_STATIC int psl__ADCTraceNext(FalconXNDetector* fDetector, void* buffer)
+{
+    int status;
+
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    if (fDetector->scopeCount == 0) {
+        psl__DetectorUnlock(fDetector);
+        pslLog(PSL_LOG_ERROR, XIA_NOT_ACTIVE,
+               "No ADC trace available for channel %d", fDetector->detChan);
+        return XIA_NOT_ACTIVE;
+    }
+
+    psl__CopyADCTrace(&fDetector->scopeRing[fDetector->scopeHead], buffer);
+
+    fDetector->scopeHead = (fDetector->scopeHead + 1) % FALCONXN_SCOPE_RING_SIZE;
+    --fDetector->scopeCount;
+
+    status = psl__DetectorUnlock(fDetector);
+
+    return status;
+}
+
+PSL_STATIC int psl__UpdateCalibration(Module* module, FalconXNDetector* fDetector)
+{
+    int status = XIA_SUCCESS;
+
+    uint8_t    pad[256];
+    SincBuffer packet = PSL_SINC_BUFFER_INIT(pad);
+
+    Sinc_Response response;
+
+    SiToro__Sinc__GetParamResponse* resp = NULL;
+    SiToro__Sinc__KeyValue*  kv;
+
+    pslLog(PSL_LOG_DEBUG, "Updating calibration result for %s channel %d",
+           module->alias, fDetector->modDetChan);
+
+    /*
+     * Do not hold the detector lock while waiting on the box. The receive
+     * thread needs it to handle parameter updates.
+     */
+    status = psl__GetParamNoCache(module, fDetector->modDetChan, "pulse.calibrated", &resp);
+
+    if (status != XIA_SUCCESS) {
+        fDetector->calibrationState = CalibrationNone;
+        pslLog(PSL_LOG_ERROR, status, "Unable to get pulse.calibrated");
+        return status;
+    }
+
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS) {
+        si_toro__sinc__get_param_response__free_unpacked(resp, NULL);
+        return status;
+    }
+
+    fDetector->calibrationState = CalibrationNone;
+
+    kv = resp->results[0];
+
+    if (kv->has_paramtype &&
+        (kv->paramtype == SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE)) {
+        fDetector->calibrationState = kv->boolval ? CalibrationReady :
+            CalibrationNone;
+    }
+
+    pslLog(PSL_LOG_DEBUG, "Calibration success= %s", kv->boolval ? "yes" : "no");
+
+    si_toro__sinc__get_param_response__free_unpacked(resp, NULL);
+
+    psl__DetectorUnlock(fDetector);
+
+    if (fDetector->calibrationState == CalibrationNone)
+        return XIA_SUCCESS;
+
+    pslLog(PSL_LOG_DEBUG, "Get calibration data");
+    SincEncodeGetCalibration(&packet, psl__DetectorChannel(fDetector));
+
+    status = psl__ModuleTransactionSend(module, &packet);
+    if (status != XIA_SUCCESS) {
+        pslLog(PSL_LOG_ERROR, status,
+               "Error requesting detector characterisation data");
+        return status;
+    }
+
+    /*
+     * The 'resp'onse is NULL. The decoder loaded the data into the detector.
+     */
+    response.channel = psl__DetectorChannel(fDetector);
+    response.type = SI_TORO__SINC__MESSAGE_TYPE__GET_CALIBRATION_RESPONSE;
+
+    status = psl__ModuleTransactionReceive(module, &response);
+
+    if (status != XIA_SUCCESS) {
+        pslLog(PSL_LOG_ERROR, status, "Receiving the response");
     }
 
     psl__ModuleTransactionEnd(module);
@@ -1571,13 +2105,189 @@ PSL_STATIC int psl__UpdateCalibration(Module* module, FalconXNDetector* fDetecto
     return status;
 }
 
-PSL_STATIC int psl__SetCalibration(Module* module, FalconXNDetector* fDetector)
+PSL_STATIC uint64_t psl__CalibrationHashAdd(uint64_t h, const void* data, size_t len)
+{
+    const uint8_t* d = data;
+
+    while (len-- > 0) {
+        h ^= *d++;
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/*
+ * FNV-1a hash of the detector characterization as it is uploaded, the
+ * data and the y values of the pulses. The x values are the sample
+ * index. The hash is the same whichever format the characterization was
+ * saved in so a box holding it still matches after a change of format.
+ */
+PSL_STATIC void psl__CalibrationHash(const FalconXNDetector* fDetector, char* hash)
+{
+    const SincCalibrationPlot* plots[3];
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+
+    plots[0] = &fDetector->calibExample;
+    plots[1] = &fDetector->calibModel;
+    plots[2] = &fDetector->calibFinal;
+
+    h = psl__CalibrationHashAdd(h, fDetector->calibData.data,
+                                (size_t) fDetector->calibData.len);
+
+    for (i = 0; i < 3; i++) {
+        h = psl__CalibrationHashAdd(h, plots[i]->y,
+                                    sizeof(double) * (size_t) plots[i]->len);
+    }
+
+    sprintf(hash, "%016" PRIx64, h);
+}
+
+/*
+ * Flag a module as not supporting the calibration hash param so it is
+ * not asked again. This is logged once per module.
+ */
+PSL_STATIC void psl__CalibrationHashUnsupported(Module* module, int status)
+{
+    FalconXNModule* fModule = module->pslData;
+
+    if (!fModule->calibHashUnsupported) {
+        fModule->calibHashUnsupported = TRUE_;
+        pslLog(PSL_LOG_INFO,
+               "%s does not support %s (%d), characterization is always uploaded",
+               module->alias, FALCONXN_CALIBRATION_HASH_PARAM, status);
+    }
+}
+
+/*
+ * Flag a module that rejects the calibration hash param for any reason,
+ * such as not knowing it or refusing its type or a write. Errors reaching
+ * the box, such as a timeout or a lost connection, leave the module to be
+ * asked the next time.
+ */
+PSL_STATIC void psl__CalibrationHashError(Module* module, int status)
+{
+    int code = status - XIA_FN_BASE_CODE;
+
+    if (code < SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY)
+        return;
+
+    switch (code) {
+        case SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY:
+        case SI_TORO__SINC__ERROR_CODE__HOST_NOT_FOUND:
+        case SI_TORO__SINC__ERROR_CODE__OUT_OF_RESOURCES:
+        case SI_TORO__SINC__ERROR_CODE__CONNECTION_FAILED:
+        case SI_TORO__SINC__ERROR_CODE__READ_FAILED:
+        case SI_TORO__SINC__ERROR_CODE__WRITE_FAILED:
+        case SI_TORO__SINC__ERROR_CODE__SOCKET_CLOSED_UNEXPECTEDLY:
+        case SI_TORO__SINC__ERROR_CODE__TIMEOUT:
+        case SI_TORO__SINC__ERROR_CODE__HOST_UNREACHABLE:
+        case SI_TORO__SINC__ERROR_CODE__DEVICE_ERROR:
+        case SI_TORO__SINC__ERROR_CODE__NOT_CONNECTED:
+        case SI_TORO__SINC__ERROR_CODE__MULTIPLE_THREAD_WAIT:
+            break;
+        default:
+            psl__CalibrationHashUnsupported(module, status);
+            break;
+    }
+}
+
+/*
+ * Set the calibration hash param of a channel.
+ */
+PSL_STATIC int psl__SetCalibrationHash(Module* module, FalconXNDetector* fDetector,
+                                       char* hash)
+{
+    int status;
+
+    FalconXNModule* fModule = module->pslData;
+
+    SiToro__Sinc__KeyValue kv;
+
+    if (fModule->calibHashUnsupported)
+        return XIA_SUCCESS;
+
+    si_toro__sinc__key_value__init(&kv);
+    kv.key = (char*) FALCONXN_CALIBRATION_HASH_PARAM;
+    kv.has_paramtype = TRUE_;
+    kv.paramtype = SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE;
+    kv.strval = hash;
+
+    status = psl__SetParam(module, fDetector->modDetChan, &kv);
+    if (status != XIA_SUCCESS)
+        psl__CalibrationHashError(module, status);
+
+    return status;
+}
+
+/*
+ * Check if the channel already holds the characterization with the
+ * hash. This is a single param get so an unchanged characterization
+ * is not transferred again on every start up.
+ */
+PSL_STATIC boolean_t psl__CalibrationHashMatches(Module* module,
+                                                 FalconXNDetector* fDetector,
+                                                 const char* hash)
+{
+    int status;
+
+    FalconXNModule* fModule = module->pslData;
+
+    SiToro__Sinc__GetParamResponse* resp = NULL;
+    SiToro__Sinc__KeyValue*         kv;
+
+    boolean_t match = FALSE_;
+
+    if (fModule->calibHashUnsupported)
+        return FALSE_;
+
+    status = psl__GetParamNoCache(module, fDetector->modDetChan,
+                                  FALCONXN_CALIBRATION_HASH_PARAM, &resp);
+    if (status != XIA_SUCCESS) {
+        psl__CalibrationHashError(module, status);
+        return FALSE_;
+    }
+
+    kv = resp->results[0];
+
+    /*
+     * A param that is not a string cannot hold the hash.
+     */
+    if ((kv->has_paramtype &&
+         (kv->paramtype != SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE)) ||
+        (kv->strval == NULL)) {
+        psl__CalibrationHashUnsupported(module, XIA_BAD_VALUE);
+    }
+    else if (STREQ(kv->strval, hash)) {
+        match = TRUE_;
+    }
+
+    si_toro__sinc__get_param_response__free_unpacked(resp, NULL);
+
+    return match;
+}
+
+/*
+ * Upload the detector characterization unless the channel already holds
+ * it. A NULL hash is not known so the data is always uploaded.
+ */
+PSL_STATIC int psl__SetCalibration(Module* module, FalconXNDetector* fDetector,
+                                   char* hash)
 {
     int status = XIA_SUCCESS;
 
     uint8_t    pad[256];
     SincBuffer packet = PSL_SINC_BUFFER_INIT(pad);
 
+    if ((hash != NULL) && psl__CalibrationHashMatches(module, fDetector, hash)) {
+        pslLog(PSL_LOG_INFO,
+               "Detector characterization unchanged for %s channel %d (%s), "
+               "skipping the upload", module->alias, fDetector->modDetChan, hash);
+        fDetector->calibrationState = CalibrationReady;
+        return XIA_SUCCESS;
+    }
+
     SincEncodeSetCalibration(&packet,
                              fDetector->modDetChan,
                              &fDetector->calibData,
@@ -1597,6 +2307,9 @@ PSL_STATIC int psl__SetCalibration(Module* module, FalconXNDetector* fDetector)
     psl__ModuleTransactionEnd(module);
     fDetector->calibrationState = CalibrationReady;
 
+    if ((status == XIA_SUCCESS) && (hash != NULL))
+        psl__SetCalibrationHash(module, fDetector, hash);
+
     return XIA_SUCCESS;
 }
 
@@ -5013,6 +5726,32 @@ PSL_STATIC int psl__mm0_sca(int detChan,
 
 }
 
+/*
+ * The state of the module's connection to the box as a LinkState,
+ * 0 connected, 1 disconnected and reconnecting, 2 restoring the box's
+ * state. Valid in all mapping modes.
+ */
+PSL_STATIC int psl__mm0_connection_state(int detChan,
+                                         int modChan, Module* module,
+                                         const char *name, void *value)
+{
+    int status;
+
+    FalconXNModule* fModule = module->pslData;
+
+    UNUSED(detChan);
+    UNUSED(modChan);
+    UNUSED(name);
+
+    status = psl__ModuleLock(module);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    *((unsigned long*) value) = (unsigned long) fModule->linkState;
+
+    return psl__ModuleUnlock(module);
+}
+
 /*
  * MCA mapping mca_length. The run data member is documented on the mm0 routine.
  */
@@ -5459,10 +6198,13 @@ PSL_STATIC int psl__mm1_buffer_overrun(int detChan,
         if (overruns) {
             pslLog(PSL_LOG_INFO,
                    "Overrun count %d: %s:%d", (int) overruns, module->alias, modChan);
-            *((int*) value) = 1;
-        } else {
-            *((int*) value) = 0;
         }
+
+        /*
+         * The number of overruns since the last call so callers can
+         * count them. Non-zero is true for those only checking.
+         */
+        *((int*) value) = (int) overruns;
     } else {
         status = XIA_NOT_ACTIVE;
         pslLog(PSL_LOG_ERROR, status,
@@ -5567,7 +6309,8 @@ PSL_STATIC const char* getRunDataLabels[] =
         "total_output_events",
         "list_buffer_len_a",
         "list_buffer_len_b",
-        "mapping_pixel_next"
+        "mapping_pixel_next",
+        "connection_state"
     };
 
 #define GET_RUN_DATA_HANDLER_COUNT (sizeof(getRunDataLabels) / sizeof(const char*))
@@ -5603,6 +6346,7 @@ PSL_STATIC DoRunData_FP getRunDataHandlers[MAPPING_MODE_COUNT][GET_RUN_DATA_HAND
             NULL,   /* psl__mm0_list_buffer_len_a */
             NULL,   /* psl__mm0_list_buffer_len_b */
             NULL,   /* psl__mm0_mapping_pixel_next */
+            psl__mm0_connection_state,
         },
         {
             psl__mm1_mca_length,
@@ -5633,6 +6377,7 @@ PSL_STATIC DoRunData_FP getRunDataHandlers[MAPPING_MODE_COUNT][GET_RUN_DATA_HAND
             NULL,   /* psl__mm1_list_buffer_len_a */
             NULL,   /* psl__mm1_list_buffer_len_b */
             psl__mm1_mapping_pixel_next,
+            psl__mm0_connection_state, /* Defer to mm0 routine--this is generic. */
         },
         {
             NULL,   /* psl__mm2_mca_length */
@@ -5663,6 +6408,7 @@ PSL_STATIC DoRunData_FP getRunDataHandlers[MAPPING_MODE_COUNT][GET_RUN_DATA_HAND
             NULL,   /* psl__mm2_list_buffer_len_a */
             NULL,   /* psl__mm2_list_buffer_len_b */
             NULL,   /* psl__mm2_mapping_pixel_next */
+            psl__mm0_connection_state, /* Defer to mm0 routine--this is generic. */
         },
     };
 
@@ -5878,6 +6624,20 @@ PSL_STATIC int psl__SpecialRun(int detChan, const char *name, void *info,
         }
         status = psl__SetADCTraceLength(module, fDetector->modDetChan, (int64_t)*value);
     }
+    else if (STREQ(name, "adc_trace_stream_start")) {
+        double* value = info;
+        if (*value <= 0) {
+            pslLog(PSL_LOG_WARNING, "%f is out of range for adc_trace_length. Coercing to %d.",
+                   *value, 0x2000);
+            *value = 0x2000;
+        }
+        status = psl__SetADCTraceLength(module, fDetector->modDetChan, (int64_t)*value);
+        if (status == XIA_SUCCESS)
+            status = psl__ADCTraceStreamStart(module, fDetector);
+    }
+    else if (STREQ(name, "adc_trace_stream_stop")) {
+        status = psl__ADCTraceStreamStop(module, fDetector);
+    }
     else if (STREQ(name, "calc_dc_offset")) {
         return psl__CalculateDCOffset(module, fDetector);
     }
@@ -5910,7 +6670,10 @@ PSL_STATIC int psl__SpecialRun(int detChan, const char *name, void *info,
         if (status != XIA_SUCCESS) {
             pslLog(PSL_LOG_ERROR, status,
                    "Unable to unlock the detector: %s", detector->alias);
+            return status;
         }
+
+        status = psl__DetcJobJoin(module, fDetector);
     }
     else if (STREQ(name, "detc-stop")) {
         /*
@@ -5970,26 +6733,49 @@ PSL_STATIC int psl__GetSpecialRunData(int detChan, const char *name, void *value
         }
         *((unsigned long *)value) = (unsigned long)length;
         return status;
+    } else if (STREQ(name, "adc_trace_next")) {
+        return psl__ADCTraceNext(fDetector, value);
+    } else if (STREQ(name, "adc_trace_available")) {
+        status = psl__DetectorLock(fDetector);
+        if (status != XIA_SUCCESS)
+            return status;
+        *((int*) value) = fDetector->scopeCount;
+        return psl__DetectorUnlock(fDetector);
+    } else if (STREQ(name, "adc_trace_dropped")) {
+        status = psl__DetectorLock(fDetector);
+        if (status != XIA_SUCCESS)
+            return status;
+        *((unsigned long*) value) = (unsigned long) fDetector->scopeDropped;
+        return psl__DetectorUnlock(fDetector);
     } else if (STREQ(name, "dc_offset")) {
         return psl__GetDCOffset(module, fDetector, value);
-    }
+    } else if (STRNEQ(name, "detc-all-")) {
+        /*
+         * The job covers all the channels so every detChan, including
+         * DXP_ALL, gives the same answer.
+         */
+        int    channels;
+        int    running;
+        int    successful;
+        double percentage;
+
+        psl__DetcJobStatus(&channels, &running, &successful, &percentage);
+
+        if (STREQ(name, "detc-all-channels"))
+            *((int*) value) = channels;
+        else if (STREQ(name, "detc-all-running"))
+            *((int*) value) = running;
+        else if (STREQ(name, "detc-all-successful"))
+            *((int*) value) = successful;
+        else if (STREQ(name, "detc-all-percentage"))
+            *((int*) value) = (int) percentage;
+        else {
+            status = XIA_BAD_NAME;
+            pslLog(PSL_LOG_ERROR, status, "Invalid name: %s", name);
+        }
 
-    status = psl__DetectorLock(fDetector);
-    if (status != XIA_SUCCESS)
         return status;
-
-
-    if (STREQ(name, "detc-progress-text-size")) {
-        pslLog(PSL_LOG_INFO,
-               "Progress text size: %zu", sizeof(fDetector->calibStage));
-        *((int*) value) = sizeof(fDetector->calibStage);
-    }
-    else if (STREQ(name, "detc-running")) {
-        int *running = (int*) value;
-        *running = fDetector->channelState == ChannelCharacterizing ? 1 : 0;
-        pslLog(PSL_LOG_INFO, "Running: %s", *running ? "yes" : "no");
-    }
-    else if (STREQ(name, "detc-successful")) {
+    } else if (STREQ(name, "detc-successful")) {
         /* While calibration data is implicitly refreshed here when checking
          * success, successful characterization also results in Sinc pushing
          * optimized values for DC offset, detection threshold, and rise time
@@ -5999,15 +6785,35 @@ PSL_STATIC int psl__GetSpecialRunData(int detChan, const char *name, void *value
          * scheme would be more robust for saving in autonomous applications,
          * though interactive applications still must know to refresh for
          * display.
+         *
+         * The refresh waits on the receive thread which locks the detector
+         * to store the data so the detector cannot be held here.
          */
         int *success = (int*) value;
         *success = psl__GetCalibrated(module, fDetector) ? 1 : 0;
         pslLog(PSL_LOG_INFO, "Successful: %s", *success ? "yes" : "no");
+        return XIA_SUCCESS;
     }
-    else if (STREQ(name, "detc-percentage")) {
+
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS)
+        return status;
+
+
+    if (STREQ(name, "detc-progress-text-size")) {
         pslLog(PSL_LOG_INFO,
-               "Percentage: %3.0f", fDetector->calibPercentage);
-        ASSERT(fDetector->calibPercentage < INT_MAX);
+               "Progress text size: %zu", sizeof(fDetector->calibStage));
+        *((int*) value) = sizeof(fDetector->calibStage);
+    }
+    else if (STREQ(name, "detc-running")) {
+        int *running = (int*) value;
+        *running = fDetector->channelState == ChannelCharacterizing ? 1 : 0;
+        pslLog(PSL_LOG_INFO, "Running: %s", *running ? "yes" : "no");
+    }
+    else if (STREQ(name, "detc-percentage")) {
+        pslLog(PSL_LOG_INFO,
+               "Percentage: %3.0f", fDetector->calibPercentage);
+        ASSERT(fDetector->calibPercentage < INT_MAX);
         *((int*) value) = (int) fDetector->calibPercentage;
     }
     else if (STREQ(name, "detc-progress-text")) {
@@ -6094,10 +6900,16 @@ PSL_STATIC int psl__LoadChanData(const int modChan, Module *module)
         return XIA_NOT_FOUND;
     }
 
+    if (buf.length >= PSL_DETC_HEADER_LEN &&
+        memcmp(buf.data, PSL_DETC_MAGIC, PSL_DETC_MAGIC_LEN) == 0)
+        return psl__LoadDetCharacterizationB(fDetector, module, buf.data,
+                                             buf.length);
+
     return psl__LoadDetCharacterizationS(fDetector, module, (char*)buf.data);
 }
 
-PSL_STATIC int psl__SaveChanData(const int modChan, Module *module)
+PSL_STATIC int psl__SaveChanData(const int modChan, Module *module,
+                                 boolean_t binary)
 {
     FalconXNDetector* fDetector;
 
@@ -6111,46 +6923,59 @@ PSL_STATIC int psl__SaveChanData(const int modChan, Module *module)
         return status;
     }
 
-    /* Unload the characterization to a string buffer. The binary data
-     * and three pulses worth of y-values typically take a little over
-     * 70K, so initialize a little over that.
-     */
-    xia_sio detChar;
-    status = xia_sio_open(&detChar, 80000);
-    if (status != XIA_SUCCESS) {
-        pslLog(PSL_LOG_ERROR, status,
-               "Opening buffer for detector characterization.");
-        return status;
-    }
+    GenBuffer detChar;
 
-    status = psl__UnloadDetCharacterization(module, fDetector, &detChar);
-    if (status != XIA_SUCCESS) {
-        xia_sio_close(&detChar);
-        pslLog(PSL_LOG_ERROR, status,
-               "Unloading detector chararacterization to temp buffer.");
-        return status;
-    }
+    if (binary) {
+        /* Unload the characterization in the binary format. The data
+         * and three pulses worth of y-values are copied as is.
+         */
+        status = psl__UnloadDetCharacterizationB(module, fDetector, &detChar);
+        if (status != XIA_SUCCESS) {
+            pslLog(PSL_LOG_ERROR, status,
+                   "Unloading detector chararacterization to temp buffer.");
+            return status;
+        }
+    } else {
+        /* Unload the characterization to a string buffer. The binary data
+         * and three pulses worth of y-values typically take a little over
+         * 70K, so initialize a little over that.
+         */
+        xia_sio detCharS;
+        status = xia_sio_open(&detCharS, 80000);
+        if (status != XIA_SUCCESS) {
+            pslLog(PSL_LOG_ERROR, status,
+                   "Opening buffer for detector characterization.");
+            return status;
+        }
 
-    size_t size = xia_sio_level(&detChar);
-    char *detCharacterizationStr = handel_md_alloc(size * sizeof(char));
-    if (detCharacterizationStr == NULL) {
-        xia_sio_close(&detChar);
-        pslLog(PSL_LOG_ERROR, XIA_NOMEM,
-               "No memory when loading detector characterization string: %d",
-               (int) detChar.size);
-        return XIA_NOMEM;
-    }
+        status = psl__UnloadDetCharacterizationS(module, fDetector, &detCharS);
+        if (status != XIA_SUCCESS) {
+            xia_sio_close(&detCharS);
+            pslLog(PSL_LOG_ERROR, status,
+                   "Unloading detector chararacterization to temp buffer.");
+            return status;
+        }
+
+        detChar.length = xia_sio_level(&detCharS);
+        detChar.data = handel_md_alloc(detChar.length * sizeof(char));
+        if (detChar.data == NULL) {
+            xia_sio_close(&detCharS);
+            pslLog(PSL_LOG_ERROR, XIA_NOMEM,
+                   "No memory when loading detector characterization string: %d",
+                   (int) detCharS.size);
+            return XIA_NOMEM;
+        }
+
+        xia_sio_copy_out(&detCharS, (char*) detChar.data, detChar.length);
 
-    xia_sio_copy_out(&detChar, detCharacterizationStr, size);
+        xia_sio_close(&detCharS);
+    }
 
     if (module->ch[modChan].data.data) {
         handel_md_free(module->ch[modChan].data.data);
     }
 
-    module->ch[modChan].data.data = detCharacterizationStr;
-    module->ch[modChan].data.length = detChar.level;
-
-    xia_sio_close(&detChar);
+    module->ch[modChan].data = detChar;
 
     return XIA_SUCCESS;
 }
@@ -6160,18 +6985,21 @@ PSL_STATIC int psl__IniWrite(FILE* fp, const char* section, const char* path,
 {
     UNUSED(fp);
     UNUSED(path);
-    UNUSED(value);
 
     pslLog(PSL_LOG_DEBUG, "Writing section %s[%d]", section, index);
 
     if (STREQ(section, "module")) {
+        /* The binary characterization is only saved to sidecar files.
+         * The text format is kept inline so older releases can load it.
+         */
+        boolean_t binary = (value != NULL) && *((boolean_t*) value);
         int modChan;
 
         for (modChan = 0; modChan < (int) module->number_of_channels; modChan++) {
             if (module->channels[modChan] == DISABLED_CHANNEL) continue;
             int status;
 
-            status = psl__SaveChanData(modChan, module);
+            status = psl__SaveChanData(modChan, module, binary);
             if (status != XIA_SUCCESS) {
                 pslLog(PSL_LOG_ERROR, status,
                        "Error saving channel data for channel %s:%d",
@@ -6186,7 +7014,8 @@ PSL_STATIC int psl__IniWrite(FILE* fp, const char* section, const char* path,
 
 PSL_STATIC int psl__ModuleTransactionSend(Module* module, SincBuffer* packet)
 {
-    int status;
+    int       status;
+    boolean_t down;
 
     FalconXNModule* fModule = module->pslData;
 
@@ -6201,6 +7030,24 @@ PSL_STATIC int psl__ModuleTransactionSend(Module* module, SincBuffer* packet)
         return status;
     }
 
+    /*
+     * Fail at once while the connection is down rather than wait for
+     * a response that cannot come.
+     */
+    handel_md_mutex_lock(&fModule->lock);
+    down = fModule->linkState == LinkDisconnected;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    if (down) {
+        PSL_SINC_BUFFER_CLEAR(packet);
+        handel_md_mutex_unlock(&fModule->sendLock);
+        status = XIA_FN_BASE_CODE + SI_TORO__SINC__ERROR_CODE__NOT_CONNECTED;
+        pslLog(PSL_LOG_ERROR, status,
+               "FalconXN connection is down: %s:%d",
+               fModule->hostAddress, fModule->portBase);
+        return status;
+    }
+
     /*
      * Send will clear the packet buffer. No need to clear.
      */
@@ -6851,7 +7698,21 @@ PSL_STATIC int psl__ReceiveOscilloscopeData(Module* module, SincBuffer* packet)
 
     status = psl__DetectorLock(fDetector);
 
-    fDetector->adcTrace = raw;
+    if (fDetector->scopeContinuous) {
+        if (fDetector->scopeCount == FALCONXN_SCOPE_RING_SIZE) {
+            falconXNClearOscPlot(&fDetector->scopeRing[fDetector->scopeHead]);
+            fDetector->scopeHead = (fDetector->scopeHead + 1) % FALCONXN_SCOPE_RING_SIZE;
+            --fDetector->scopeCount;
+            ++fDetector->scopeDropped;
+        }
+        fDetector->scopeRing[(fDetector->scopeHead + fDetector->scopeCount) %
+                             FALCONXN_SCOPE_RING_SIZE] = raw;
+        ++fDetector->scopeCount;
+        ++fDetector->scopeTraces;
+    } else {
+        falconXNClearOscPlot(&fDetector->adcTrace);
+        fDetector->adcTrace = raw;
+    }
 
     fDetector->asyncStatus = XIA_SUCCESS;
 
@@ -6881,7 +7742,7 @@ PSL_STATIC int psl__ReceiveCalibrationProgress(Module* module, SincBuffer* packe
                                                    &channel);
     if (status != true) {
         if (resp != NULL)
-            si_toro__sinc__calibration_progress_response__free_unpacked(resp, NULL);
+            si_toro__sinc__calibration_progress_response__free_unpacked(resp, packet->allocator);
         status = falconXNSincErrorToHandel(&se);
         pslLog(PSL_LOG_ERROR, status,
                "Decode calibration progress response failed %s:%d",
@@ -6891,7 +7752,7 @@ PSL_STATIC int psl__ReceiveCalibrationProgress(Module* module, SincBuffer* packe
 
     fDetector = psl__FindDetector(module, channel);
     if (fDetector == NULL) {
-        si_toro__sinc__calibration_progress_response__free_unpacked(resp, NULL);
+        si_toro__sinc__calibration_progress_response__free_unpacked(resp, packet->allocator);
         status = XIA_INVALID_DETCHAN;
         pslLog(PSL_LOG_ERROR, status,
                "Cannot find channel detector: %d", channel);
@@ -6900,7 +7761,7 @@ PSL_STATIC int psl__ReceiveCalibrationProgress(Module* module, SincBuffer* packe
 
     status = psl__DetectorLock(fDetector);
     if (status != 0) {
-        si_toro__sinc__calibration_progress_response__free_unpacked(resp, NULL);
+        si_toro__sinc__calibration_progress_response__free_unpacked(resp, packet->allocator);
         return status;
     }
 
@@ -6916,7 +7777,7 @@ PSL_STATIC int psl__ReceiveCalibrationProgress(Module* module, SincBuffer* packe
         pslLog(PSL_LOG_INFO, "Characterization completed [%d]", channel);
     }
 
-    si_toro__sinc__calibration_progress_response__free_unpacked(resp, NULL);
+    si_toro__sinc__calibration_progress_response__free_unpacked(resp, packet->allocator);
 
     status = psl__DetectorUnlock(fDetector);
 
@@ -6959,7 +7820,6 @@ PSL_STATIC int psl__ReceiveAsynchronousError(Module* module, SincBuffer* packet)
         FalconXNDetector* fDetector;
         MM_Control*       mmc;
         MMC1_Data*        mm1;
-        MM_Buffers*       mmb;
 
         fDetector = psl__FindDetector(module, channel);
         if (fDetector == NULL) {
@@ -6985,9 +7845,13 @@ PSL_STATIC int psl__ReceiveAsynchronousError(Module* module, SincBuffer* packet)
                    drops, module->alias, channel);
 
             mm1 = psl__MappingModeControl_MM1Data(mmc);
-            mmb = &mm1->buffers;
 
-            psl__MappingModeBuffers_Drop(mmb, drops);
+            status = psl__XMAP_DropPixels_MM1(mm1, drops);
+            if (status != XIA_SUCCESS) {
+                pslLog(PSL_LOG_ERROR, status,
+                       "Error counting dropped pixels: %s:%d",
+                       module->alias, channel);
+            }
             break;
 
         case MAPPING_MODE_MCA:
@@ -7267,7 +8131,7 @@ PSL_STATIC int psl__ReceiveParamUpdated(Module* module, SincBuffer* packet)
 
     fDetector = psl__FindDetector(module, channel);
     if (fDetector == NULL) {
-        si_toro__sinc__param_updated_response__free_unpacked(resp, NULL);
+        si_toro__sinc__param_updated_response__free_unpacked(resp, packet->allocator);
         status = XIA_INVALID_DETCHAN;
         psl__ModuleStatusResponse(module, status);
         pslLog(PSL_LOG_ERROR, status,
@@ -7277,7 +8141,7 @@ PSL_STATIC int psl__ReceiveParamUpdated(Module* module, SincBuffer* packet)
 
     status = psl__DetectorLock(fDetector);
     if (status != XIA_SUCCESS) {
-        si_toro__sinc__param_updated_response__free_unpacked(resp, NULL);
+        si_toro__sinc__param_updated_response__free_unpacked(resp, packet->allocator);
         psl__ModuleStatusResponse(module, status);
         return status;
     }
@@ -7302,6 +8166,10 @@ PSL_STATIC int psl__ReceiveParamUpdated(Module* module, SincBuffer* packet)
                kv->optionval != NULL ? 'o' : '-',
                logValue);
 
+        if (psl__ParamCacheStore(fDetector, kv) != XIA_SUCCESS) {
+            pslLog(PSL_LOG_ERROR, XIA_NOMEM, "Mirroring %s", kv->key);
+        }
+
         /*
          * We ignore some lock/unlock results to keep processing all params.
          */
@@ -7315,7 +8183,7 @@ PSL_STATIC int psl__ReceiveParamUpdated(Module* module, SincBuffer* packet)
 
     status = psl__DetectorUnlock(fDetector);
 
-    si_toro__sinc__param_updated_response__free_unpacked(resp, NULL);
+    si_toro__sinc__param_updated_response__free_unpacked(resp, packet->allocator);
 
     return status;
 }
@@ -7434,6 +8302,27 @@ PSL_STATIC int psl__ReceiveCheckParamConsistency(Module* module, SincBuffer* pac
                                resp);
 }
 
+/*
+ * Asynchronous messages are sent by the box unprompted. Everything else
+ * is a response to a command.
+ */
+PSL_STATIC boolean_t psl__AsyncMessage(SiToro__Sinc__MessageType msgType)
+{
+    switch (msgType) {
+    case SI_TORO__SINC__MESSAGE_TYPE__HISTOGRAM_DATA_RESPONSE:
+    case SI_TORO__SINC__MESSAGE_TYPE__LIST_MODE_DATA_RESPONSE:
+    case SI_TORO__SINC__MESSAGE_TYPE__OSCILLOSCOPE_DATA_RESPONSE:
+    case SI_TORO__SINC__MESSAGE_TYPE__CALIBRATION_PROGRESS_RESPONSE:
+    case SI_TORO__SINC__MESSAGE_TYPE__ASYNCHRONOUS_ERROR_RESPONSE:
+    case SI_TORO__SINC__MESSAGE_TYPE__PARAM_UPDATED_RESPONSE:
+        return TRUE_;
+    default:
+        break;
+    }
+
+    return FALSE_;
+}
+
 PSL_STATIC int psl__ModuleReceiveProcessor(Module*                   module,
                                            SiToro__Sinc__MessageType msgType,
                                            SincBuffer*               packet)
@@ -7444,6 +8333,14 @@ PSL_STATIC int psl__ModuleReceiveProcessor(Module*                   module,
     pslLog(PSL_LOG_DEBUG,
            "SINC Receive: %d", msgType);
 
+    /*
+     * Asynchronous data is decoded and finished with here so it can use
+     * the module's decode arena. Command responses are handed to the
+     * waiting caller and are decoded on to the heap.
+     */
+    if (psl__AsyncMessage(msgType))
+        packet->allocator = &fModule->arena.allocator;
+
     switch (msgType) {
         /*
          * Async responses.
@@ -7544,9 +8441,91 @@ PSL_STATIC int psl__ModuleReceiveProcessor(Module*                   module,
         break;
     }
 
+    if (packet->allocator != NULL) {
+        packet->allocator = NULL;
+        SincArenaReset(&fModule->arena);
+    }
+
     return status;
 }
 
+/*
+ * Handle a packet read from the module's connection. The module lock is
+ * held.
+ */
+PSL_STATIC int psl__ModuleReceived(Module*                   module,
+                                   SiToro__Sinc__MessageType msgType,
+                                   SincBuffer*               packet)
+{
+    FalconXNModule* fModule = module->pslData;
+
+    if (psl__CaptureIsOpen(&fModule->capture)) {
+        int status = psl__CaptureWrite(&fModule->capture, msgType, packet);
+        if (status != XIA_SUCCESS) {
+            pslLog(PSL_LOG_ERROR, status,
+                   "Capture stopped for %s", module->alias);
+            psl__CaptureClose(&fModule->capture);
+        }
+    }
+
+    if (fModule->replaying && psl__AsyncMessage(msgType))
+        return XIA_SUCCESS;
+
+    return psl__ModuleReceiveProcessor(module, msgType, packet);
+}
+
+/*
+ * The receiver has lost the connection to the box. Reading stops and the
+ * reconnect thread is started to connect again. Returns FALSE_ if the
+ * module is not reconnecting and the receiver should stop. The module
+ * lock is held.
+ */
+PSL_STATIC boolean_t psl__LinkLost(Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+    int             status;
+
+    if (!fModule->reconnectActive)
+        return FALSE_;
+
+    if (fModule->linkState == LinkConnected) {
+        ++fModule->outages;
+        fModule->reconnectAttempts = 0;
+        fModule->paramsRestored = 0;
+        fModule->outageStart = psl__CaptureNow();
+    }
+
+    fModule->linkState = LinkDisconnected;
+
+    pslLog(PSL_LOG_WARNING,
+           "Connection lost, reconnecting: %s (%s:%d)",
+           module->alias, fModule->hostAddress, fModule->portBase);
+
+    if (fModule->reconnectRunning)
+        return TRUE_;
+
+    fModule->reconnector.name = "Module.reconnect";
+    fModule->reconnector.priority = 10;
+    fModule->reconnector.stackSize = 128 * 1024;
+    fModule->reconnector.attributes = 0;
+    fModule->reconnector.realtime = FALSE_;
+    fModule->reconnector.entryPoint = psl__ModuleReconnector;
+    fModule->reconnector.argument = module;
+
+    fModule->reconnectRunning = TRUE_;
+
+    status = handel_md_thread_create(&fModule->reconnector);
+    if (status != 0) {
+        fModule->reconnectRunning = FALSE_;
+        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+               "Reconnect thread create failed for %s: %d",
+               module->alias, status);
+        return FALSE_;
+    }
+
+    return TRUE_;
+}
+
 PSL_STATIC void psl__ModuleReceiver(void* arg)
 {
     Module*         module = (Module*) arg;
@@ -7571,6 +8550,24 @@ PSL_STATIC void psl__ModuleReceiver(void* arg)
         uint8_t                   receiveBufferData[4096];
         SincBuffer                sb = PSL_SINC_BUFFER_INIT(receiveBufferData);
 
+        /*
+         * Nothing is read while the connection is down. The reconnect
+         * thread signals once there is a new connection.
+         */
+        if (fModule->linkState == LinkDisconnected) {
+            r = handel_md_mutex_unlock(&fModule->lock);
+            if (r != 0)
+                break;
+
+            handel_md_event_wait(&fModule->receiverEvent, 100);
+
+            r = handel_md_mutex_lock(&fModule->lock);
+            if (r != 0)
+                break;
+
+            continue;
+        }
+
         /*
          * The receive message in the Sinc API is thread safe in respect to
          * the send path so we can unlock the module mutex. We hold the
@@ -7599,12 +8596,16 @@ PSL_STATIC void psl__ModuleReceiver(void* arg)
             pslLog(PSL_LOG_ERROR, status,
                    "Read message failed for FalconXN connection: %s:%d",
                    fModule->hostAddress, fModule->portBase);
+
+            if (psl__LinkLost(module))
+                continue;
+
             break;
         }
 
-        status = psl__ModuleReceiveProcessor(module,
-                                             msgType,
-                                             &sb);
+        status = psl__ModuleReceived(module,
+                                     msgType,
+                                     &sb);
 
         /* We have to clear SINC buffers after reading. They clear automatically for sends.
          */
@@ -7622,80 +8623,999 @@ PSL_STATIC void psl__ModuleReceiver(void* arg)
     handel_md_mutex_unlock(&fModule->lock);
 }
 
-PSL_STATIC int psl__ModuleReceiverStop(const char* alias, FalconXNModule* fModule)
-{
-    int status;
+#if PSL_RECEIVE_ENGINE
+/*
+ * Shared receive engine. Modules with the inet_receive_threads item set are
+ * serviced by a small pool of epoll threads rather than a thread per
+ * module. Each worker has its own epoll set and modules are spread across
+ * the workers as they are set up. Module set up and tear down is serialised
+ * by Handel so the engine tables are only changed from that path.
+ */
+#define PSL_RECEIVE_ENGINE_MAX_WORKERS  8
+#define PSL_RECEIVE_ENGINE_MAX_EVENTS   16
 
-    int period;
+/*
+ * Messages read from a module each time it is serviced. A busy module is
+ * put on its worker's backlog when it reaches the limit so the other
+ * modules on the worker are not held off.
+ */
+#define PSL_RECEIVE_ENGINE_MAX_MESSAGES 16
 
-    handel_md_mutex_lock(&fModule->lock);
-    fModule->receiverActive = FALSE_;
-    handel_md_mutex_unlock(&fModule->lock);
+typedef struct {
+    int              epollFd;
+    handel_md_Thread thread;
+    handel_md_Mutex  lock;
+    boolean_t        active;
+    boolean_t        running;
+    unsigned int     loops;
+    int              modules;
+    /* Modules with messages left to read. Sinc buffers the data it reads
+     * from the socket so epoll may not report these modules again.
+     */
+    Module*          backlog;
+} psl__ReceiveWorker;
 
-    status = handel_md_event_signal(&fModule->receiverEvent);
-    if (status != 0) {
-        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
-               "Receiver thread signal failed for %s: %d",
-               alias, status);
+typedef struct {
+    int                users;
+    int                workers;
+    int                next;
+    psl__ReceiveWorker worker[PSL_RECEIVE_ENGINE_MAX_WORKERS];
+} psl__ReceiveEngine;
+
+static psl__ReceiveEngine receiveEngine;
+
+/*
+ * Read and process the messages available on a module's connection. Called
+ * from a worker when the socket is readable or the module is on the
+ * worker's backlog. The module lock is released around the Sinc read as
+ * the module receiver thread does. Returns TRUE_ if the message limit is
+ * reached and there may be more to read.
+ */
+PSL_STATIC boolean_t psl__ModuleReceiveReady(Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+    boolean_t       more = FALSE_;
+    int             messages;
+    int             r;
+
+    r = handel_md_mutex_lock(&fModule->lock);
+    if (r != 0) {
+        pslLog(PSL_LOG_DEBUG,
+               "Receive engine failed locking module: %s: %d", module->alias, r);
+        return FALSE_;
     }
 
-    period = 2000;
+    for (messages = 0; fModule->receiverActive; ++messages) {
+        SiToro__Sinc__MessageType msgType;
+        int                       status;
+        uint8_t                   receiveBufferData[4096];
+        SincBuffer                sb = PSL_SINC_BUFFER_INIT(receiveBufferData);
 
-    handel_md_mutex_lock(&fModule->lock);
+        if (messages >= PSL_RECEIVE_ENGINE_MAX_MESSAGES) {
+            more = TRUE_;
+            break;
+        }
 
-    while (period > 0) {
-        if (!fModule->receiverRunning)
+        /*
+         * Nothing is read while the connection is down. The new connection
+         * is added to the epoll set once the module has reconnected.
+         */
+        if (fModule->linkState == LinkDisconnected)
             break;
-        handel_md_mutex_unlock(&fModule->lock);
-        handel_md_thread_sleep(50);
-        period -= 50;
-        handel_md_mutex_lock(&fModule->lock);
+
+        r = handel_md_mutex_unlock(&fModule->lock);
+        if (r != 0)
+            return FALSE_;
+
+        status = SincReadMessage(&fModule->sinc,
+                                 0,
+                                 &sb,
+                                 &msgType);
+
+        r = handel_md_mutex_lock(&fModule->lock);
+        if (r != 0)
+            return FALSE_;
+
+        if (status != true) {
+            int sincErrCode = SincReadErrorCode(&fModule->sinc);
+            if (sincErrCode == SI_TORO__SINC__ERROR_CODE__TIMEOUT)
+                break;
+
+            status = falconXNSincResultToHandel(sincErrCode,
+                                                SincReadErrorMessage(&fModule->sinc));
+            pslLog(PSL_LOG_ERROR, status,
+                   "Read message failed for FalconXN connection: %s:%d",
+                   fModule->hostAddress, fModule->portBase);
+
+            /*
+             * The socket is removed from the epoll set so a closed
+             * connection does not spin the worker. The new connection is
+             * added once the module has reconnected. Without a reconnect
+             * receiving stops as it does for the module receiver thread.
+             */
+            epoll_ctl(receiveEngine.worker[fModule->receiveWorker].epollFd,
+                      EPOLL_CTL_DEL, fModule->sinc.fd, NULL);
+            if (!psl__LinkLost(module))
+                fModule->receiverRunning = FALSE_;
+            break;
+        }
+
+        status = psl__ModuleReceived(module,
+                                     msgType,
+                                     &sb);
+
+        PSL_SINC_BUFFER_CLEAR(&sb);
     }
 
     handel_md_mutex_unlock(&fModule->lock);
 
-    if (period <= 0) {
-        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
-               "Receiver thread stop failed for %s", alias);
+    return more;
+}
+
+/*
+ * Put a module on the end of the worker's backlog if it is not already
+ * there.
+ */
+PSL_STATIC void psl__ReceiveEngineBacklog(psl__ReceiveWorker* worker, Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+
+    handel_md_mutex_lock(&worker->lock);
+
+    if (!fModule->receivePending) {
+        Module** next = &worker->backlog;
+        while (*next != NULL)
+            next = &((FalconXNModule*) (*next)->pslData)->receiveNext;
+        *next = module;
+        fModule->receiveNext = NULL;
+        fModule->receivePending = TRUE_;
     }
 
-    return XIA_SUCCESS;
+    handel_md_mutex_unlock(&worker->lock);
 }
 
-PSL_STATIC int psl__SetupModule(Module *module)
+/*
+ * Take the worker's backlog dropping any module being removed. The worker
+ * lock is held. A module being removed waits for the worker to go around
+ * its loop so the modules taken remain valid until the next call.
+ */
+PSL_STATIC Module* psl__ReceiveEngineTakeBacklog(psl__ReceiveWorker* worker)
 {
-    int status;
+    Module*  backlog = NULL;
+    Module** tail = &backlog;
 
-    FalconXNModule* fModule = NULL;
-    char            item[MAXITEM_LEN];
-    int             value;
-    int             period;
+    while (worker->backlog != NULL) {
+        Module*         module = worker->backlog;
+        FalconXNModule* fModule = module->pslData;
+        boolean_t       active;
 
-    pslLog(PSL_LOG_DEBUG, "Module %s", module->alias);
+        worker->backlog = fModule->receiveNext;
+        fModule->receiveNext = NULL;
+        fModule->receivePending = FALSE_;
 
-    ASSERT(module->pslData == NULL);
+        handel_md_mutex_lock(&fModule->lock);
+        active = fModule->receiverActive;
+        handel_md_mutex_unlock(&fModule->lock);
 
-    fModule = handel_md_alloc(sizeof(FalconXNModule));
-    if (fModule == NULL) {
-        pslLog(PSL_LOG_ERROR, XIA_NOMEM,
-               "No memory for SiToro module PSL data");
-        return XIA_NOMEM;
+        if (active) {
+            *tail = module;
+            tail = &fModule->receiveNext;
+        }
     }
 
-    memset(fModule, 0, sizeof(*fModule));
+    return backlog;
+}
 
-    /*
-     * The module level set up need to change once we move to a single
-     * connection for the module the detectors share. This will allow us to
-     * determine the number of detectors.
-     */
-    status = xiaGetModuleItem(module->alias, "inet_address", item);
-    if (status != XIA_SUCCESS) {
-        handel_md_free(fModule);
-        pslLog(PSL_LOG_ERROR, status,
-               "Error getting the INET address from the module:");
-        return status;
-    }
+PSL_STATIC void psl__ReceiveEngineWorker(void* arg)
+{
+    psl__ReceiveWorker* worker = (psl__ReceiveWorker*) arg;
+    struct epoll_event  events[PSL_RECEIVE_ENGINE_MAX_EVENTS];
+
+    pslLog(PSL_LOG_DEBUG, "Receive engine worker starting");
+
+    handel_md_mutex_lock(&worker->lock);
+
+    worker->running = TRUE_;
+
+    while (worker->active) {
+        Module* backlog;
+        int     n;
+        int     e;
+
+        backlog = psl__ReceiveEngineTakeBacklog(worker);
+
+        ++worker->loops;
+
+        handel_md_mutex_unlock(&worker->lock);
+
+        /*
+         * Do not wait if there is a backlog to work through.
+         */
+        n = epoll_wait(worker->epollFd, events,
+                       PSL_RECEIVE_ENGINE_MAX_EVENTS,
+                       backlog != NULL ? 0 : 100);
+
+        if ((n < 0) && (errno != EINTR)) {
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine wait failed: %d", errno);
+            handel_md_mutex_lock(&worker->lock);
+            break;
+        }
+
+        /*
+         * A module can go back on the backlog while the list is walked so
+         * step to the next module before servicing this one.
+         */
+        while (backlog != NULL) {
+            Module* module = backlog;
+            backlog = ((FalconXNModule*) module->pslData)->receiveNext;
+            if (psl__ModuleReceiveReady(module))
+                psl__ReceiveEngineBacklog(worker, module);
+        }
+
+        for (e = 0; e < n; ++e) {
+            Module* module = (Module*) events[e].data.ptr;
+            if (psl__ModuleReceiveReady(module))
+                psl__ReceiveEngineBacklog(worker, module);
+        }
+
+        handel_md_mutex_lock(&worker->lock);
+    }
+
+    worker->running = FALSE_;
+
+    pslLog(PSL_LOG_DEBUG, "Receive engine worker stopping");
+
+    handel_md_mutex_unlock(&worker->lock);
+}
+
+PSL_STATIC void psl__ReceiveEngineStop(void)
+{
+    int w;
+
+    for (w = 0; w < receiveEngine.workers; ++w) {
+        psl__ReceiveWorker* worker = &receiveEngine.worker[w];
+        int                 period = 2000;
+
+        handel_md_mutex_lock(&worker->lock);
+        worker->active = FALSE_;
+        while ((period > 0) && worker->running) {
+            handel_md_mutex_unlock(&worker->lock);
+            handel_md_thread_sleep(50);
+            period -= 50;
+            handel_md_mutex_lock(&worker->lock);
+        }
+        handel_md_mutex_unlock(&worker->lock);
+
+        if (period <= 0) {
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine worker %d stop failed", w);
+        }
+
+        handel_md_thread_destroy(&worker->thread);
+        handel_md_mutex_destroy(&worker->lock);
+        close(worker->epollFd);
+    }
+
+    memset(&receiveEngine, 0, sizeof(receiveEngine));
+}
+
+PSL_STATIC int psl__ReceiveEngineStart(int workers)
+{
+    int w;
+
+    if (workers > PSL_RECEIVE_ENGINE_MAX_WORKERS)
+        workers = PSL_RECEIVE_ENGINE_MAX_WORKERS;
+
+    memset(&receiveEngine, 0, sizeof(receiveEngine));
+
+    for (w = 0; w < workers; ++w) {
+        psl__ReceiveWorker* worker = &receiveEngine.worker[w];
+        int                 period = 2000;
+        int                 status;
+
+        worker->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->epollFd < 0) {
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine epoll create failed: %d", errno);
+            psl__ReceiveEngineStop();
+            return XIA_THREAD_ERROR;
+        }
+
+        status = handel_md_mutex_create(&worker->lock);
+        if (status != 0) {
+            close(worker->epollFd);
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine mutex create failed: %d", status);
+            psl__ReceiveEngineStop();
+            return XIA_THREAD_ERROR;
+        }
+
+        worker->thread.name = "Module.receive.engine";
+        worker->thread.priority = 10;
+        worker->thread.stackSize = 128 * 1024;
+        worker->thread.attributes = 0;
+        worker->thread.realtime = FALSE_;
+        worker->thread.entryPoint = psl__ReceiveEngineWorker;
+        worker->thread.argument = worker;
+
+        worker->active = TRUE_;
+
+        /*
+         * Count the worker now so a failure below cleans it up.
+         */
+        receiveEngine.workers = w + 1;
+
+        status = handel_md_thread_create(&worker->thread);
+        if (status != 0) {
+            worker->active = FALSE_;
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine thread create failed: %d", status);
+            psl__ReceiveEngineStop();
+            return XIA_THREAD_ERROR;
+        }
+
+        handel_md_mutex_lock(&worker->lock);
+        while ((period > 0) && !worker->running) {
+            handel_md_mutex_unlock(&worker->lock);
+            handel_md_thread_sleep(50);
+            period -= 50;
+            handel_md_mutex_lock(&worker->lock);
+        }
+        handel_md_mutex_unlock(&worker->lock);
+
+        if (period <= 0) {
+            pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+                   "Receive engine thread start failed");
+            psl__ReceiveEngineStop();
+            return XIA_THREAD_ERROR;
+        }
+    }
+
+    pslLog(PSL_LOG_INFO, "Receive engine started: workers:%d", workers);
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * The number of workers is the largest inet_receive_threads of the
+ * modules in the system so it does not depend on the order the modules
+ * are set up in.
+ */
+PSL_STATIC int psl__ReceiveEngineWorkers(void)
+{
+    Module* module;
+    int     workers = 0;
+
+    for (module = xiaGetModuleHead(); module != NULL; module = module->next) {
+        if ((module->interface_ != NULL) &&
+            (module->interface_->type == INET) &&
+            ((int) module->interface_->info.inet->receive_threads > workers))
+            workers = (int) module->interface_->info.inet->receive_threads;
+    }
+
+    return workers;
+}
+
+/*
+ * Add a module to the receive engine starting the engine if this is the
+ * first user.
+ */
+PSL_STATIC int psl__ReceiveEngineAdd(Module* module)
+{
+    FalconXNModule*     fModule = module->pslData;
+    psl__ReceiveWorker* worker;
+    struct epoll_event  event;
+    int                 status;
+
+    if (receiveEngine.users == 0) {
+        status = psl__ReceiveEngineStart(psl__ReceiveEngineWorkers());
+        if (status != XIA_SUCCESS)
+            return status;
+    }
+
+    fModule->receiveWorker = receiveEngine.next;
+    receiveEngine.next = (receiveEngine.next + 1) % receiveEngine.workers;
+
+    worker = &receiveEngine.worker[fModule->receiveWorker];
+
+    fModule->receiverActive = TRUE_;
+    fModule->receiverRunning = TRUE_;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = module;
+
+    if (epoll_ctl(worker->epollFd, EPOLL_CTL_ADD, fModule->sinc.fd, &event) != 0) {
+        status = XIA_THREAD_ERROR;
+        fModule->receiverActive = FALSE_;
+        fModule->receiverRunning = FALSE_;
+        fModule->receiveWorker = -1;
+        pslLog(PSL_LOG_ERROR, status,
+               "Receive engine add failed for %s: %d", module->alias, errno);
+        if (receiveEngine.users == 0)
+            psl__ReceiveEngineStop();
+        return status;
+    }
+
+    ++worker->modules;
+    ++receiveEngine.users;
+
+    pslLog(PSL_LOG_DEBUG,
+           "Receive engine: %s on worker %d",
+           module->alias, fModule->receiveWorker);
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Remove a module from the receive engine. Once the socket is out of the
+ * epoll set we wait for the worker to go around its loop so any events it
+ * holds for the module have been processed before the module is released.
+ */
+PSL_STATIC void psl__ReceiveEngineRemove(FalconXNModule* fModule)
+{
+    psl__ReceiveWorker* worker;
+    unsigned int        loops;
+    int                 period = 2000;
+
+    if (fModule->receiveWorker < 0)
+        return;
+
+    worker = &receiveEngine.worker[fModule->receiveWorker];
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->receiverActive = FALSE_;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    epoll_ctl(worker->epollFd, EPOLL_CTL_DEL, fModule->sinc.fd, NULL);
+
+    handel_md_mutex_lock(&worker->lock);
+    if (fModule->receivePending) {
+        Module** next = &worker->backlog;
+        while (((FalconXNModule*) (*next)->pslData) != fModule)
+            next = &((FalconXNModule*) (*next)->pslData)->receiveNext;
+        *next = fModule->receiveNext;
+        fModule->receiveNext = NULL;
+        fModule->receivePending = FALSE_;
+    }
+    loops = worker->loops;
+    while ((period > 0) && worker->running && (worker->loops == loops)) {
+        handel_md_mutex_unlock(&worker->lock);
+        handel_md_thread_sleep(10);
+        period -= 10;
+        handel_md_mutex_lock(&worker->lock);
+    }
+    handel_md_mutex_unlock(&worker->lock);
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->receiverRunning = FALSE_;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    --worker->modules;
+    fModule->receiveWorker = -1;
+
+    if (--receiveEngine.users == 0)
+        psl__ReceiveEngineStop();
+}
+
+/*
+ * Add a module's new connection to its worker's epoll set after a
+ * reconnect. The module lock is held.
+ */
+PSL_STATIC void psl__ReceiveEngineRearm(Module* module)
+{
+    FalconXNModule*    fModule = module->pslData;
+    struct epoll_event event;
+
+    if (fModule->receiveWorker < 0)
+        return;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = module;
+
+    if (epoll_ctl(receiveEngine.worker[fModule->receiveWorker].epollFd,
+                  EPOLL_CTL_ADD, fModule->sinc.fd, &event) != 0) {
+        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+               "Receive engine rearm failed for %s: %d", module->alias, errno);
+    }
+}
+#endif /* PSL_RECEIVE_ENGINE */
+
+PSL_STATIC int psl__ModuleReceiverStop(const char* alias, FalconXNModule* fModule)
+{
+    int status;
+
+    int period;
+
+#if PSL_RECEIVE_ENGINE
+    if (fModule->receiveWorker >= 0) {
+        psl__ReceiveEngineRemove(fModule);
+        return XIA_SUCCESS;
+    }
+#endif
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->receiverActive = FALSE_;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    status = handel_md_event_signal(&fModule->receiverEvent);
+    if (status != 0) {
+        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+               "Receiver thread signal failed for %s: %d",
+               alias, status);
+    }
+
+    period = 2000;
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    while (period > 0) {
+        if (!fModule->receiverRunning)
+            break;
+        handel_md_mutex_unlock(&fModule->lock);
+        handel_md_thread_sleep(50);
+        period -= 50;
+        handel_md_mutex_lock(&fModule->lock);
+    }
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    if (period <= 0) {
+        pslLog(PSL_LOG_ERROR, XIA_THREAD_ERROR,
+               "Receiver thread stop failed for %s", alias);
+    }
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Parameters the box owns. They are never restored from the mirror. The
+ * calibration hash is set when the characterization is restored.
+ */
+static const char* RESTORE_SKIP_PARAMS[] = {
+    "channel.state",
+    "pulse.calibrated",
+    FALCONXN_CALIBRATION_HASH_PARAM
+};
+
+/*
+ * True while a reconnect should carry on restoring. Teardown or a second
+ * loss of the connection stops it.
+ */
+PSL_STATIC boolean_t psl__Restoring(FalconXNModule* fModule)
+{
+    boolean_t restoring;
+
+    handel_md_mutex_lock(&fModule->lock);
+    restoring = fModule->reconnectActive && (fModule->linkState == LinkRestoring);
+    handel_md_mutex_unlock(&fModule->lock);
+
+    return restoring;
+}
+
+PSL_STATIC boolean_t psl__ParamEqual(const FalconXNParam* a, const FalconXNParam* b)
+{
+    if (a->type != b->type)
+        return FALSE_;
+
+    switch (a->type) {
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE:
+        return a->intval == b->intval;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE:
+        return a->floatval == b->floatval;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE:
+        return a->boolval == b->boolval;
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE:
+    case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE:
+        if ((a->str == NULL) || (b->str == NULL))
+            return a->str == b->str;
+        return STREQ(a->str, b->str);
+    default:
+        break;
+    }
+
+    return TRUE_;
+}
+
+/*
+ * Restore a channel after a reconnect. The parameter mirror held before
+ * the connection was lost is what the host last set so the box is
+ * brought back to it. The mirror is loaded again from the box and only
+ * the settable parameters that differ are set. The characterization is
+ * uploaded if the box's calibration hash shows it does not hold it. A
+ * box that only dropped the connection has nothing to restore.
+ */
+PSL_STATIC int psl__RestoreDetector(Module* module, FalconXNDetector* fDetector,
+                                    uint32_t* restored)
+{
+    int status;
+    int result = XIA_SUCCESS;
+
+    xia_map_t         mirror;
+    CalibrationState  calibrationState;
+    FalconXNParam*    param;
+    size_t            e;
+
+    status = psl__DetectorLock(fDetector);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    mirror = fDetector->params;
+    memset(&fDetector->params, 0, sizeof(fDetector->params));
+    fDetector->paramsValid = FALSE_;
+    calibrationState = fDetector->calibrationState;
+
+    psl__DetectorUnlock(fDetector);
+
+    status = psl__RefreshChannelState(module, fDetector);
+    if (status == XIA_SUCCESS)
+        status = psl__LoadChannelFeatures(module, fDetector->modDetChan);
+
+    if (status != XIA_SUCCESS) {
+        /*
+         * Keep the old mirror for the next attempt.
+         */
+        psl__DetectorLock(fDetector);
+        psl__ParamCacheClear(fDetector);
+        fDetector->params = mirror;
+        fDetector->paramsValid = TRUE_;
+        psl__DetectorUnlock(fDetector);
+        pslLog(PSL_LOG_ERROR, status,
+               "Unable to reload the parameters for %s:%d",
+               module->alias, fDetector->modDetChan);
+        return status;
+    }
+
+    if (calibrationState == CalibrationReady) {
+        param = xia_map_get(&mirror, FALCONXN_CALIBRATION_HASH_PARAM);
+        status = psl__SetCalibration(module, fDetector,
+                                     ((param != NULL) && (param->str != NULL) &&
+                                      (param->str[0] != '\0')) ? param->str : NULL);
+        if (status != XIA_SUCCESS) {
+            result = status;
+            pslLog(PSL_LOG_ERROR, status,
+                   "Unable to restore the characterization for %s:%d",
+                   module->alias, fDetector->modDetChan);
+        }
+    }
+
+    for (e = 0; e < mirror.size; ++e) {
+        SiToro__Sinc__KeyValue kv;
+        boolean_t              same;
+        size_t                 s;
+
+        param = mirror.entries[e].value;
+        if ((param == NULL) || !param->settable)
+            continue;
+
+        for (s = 0; s < sizeof(RESTORE_SKIP_PARAMS) / sizeof(RESTORE_SKIP_PARAMS[0]); ++s) {
+            if (STREQ(param->key, RESTORE_SKIP_PARAMS[s]))
+                break;
+        }
+        if (s < sizeof(RESTORE_SKIP_PARAMS) / sizeof(RESTORE_SKIP_PARAMS[0]))
+            continue;
+
+        if (!psl__Restoring(module->pslData)) {
+            result = XIA_TIMEOUT;
+            break;
+        }
+
+        psl__DetectorLock(fDetector);
+        {
+            FalconXNParam* current = xia_map_get(&fDetector->params, param->key);
+            same = (current != NULL) && psl__ParamEqual(current, param);
+        }
+        psl__DetectorUnlock(fDetector);
+
+        if (same)
+            continue;
+
+        si_toro__sinc__key_value__init(&kv);
+        kv.key = param->key;
+        kv.has_paramtype = TRUE_;
+        kv.paramtype = param->type;
+
+        switch (param->type) {
+        case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE:
+            kv.has_intval = TRUE_;
+            kv.intval = param->intval;
+            break;
+        case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE:
+            kv.has_floatval = TRUE_;
+            kv.floatval = param->floatval;
+            break;
+        case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE:
+            kv.has_boolval = TRUE_;
+            kv.boolval = param->boolval;
+            break;
+        case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE:
+            kv.strval = param->str;
+            break;
+        case SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE:
+            kv.optionval = param->str;
+            break;
+        default:
+            break;
+        }
+
+        pslLog(PSL_LOG_DEBUG, "Restoring %s:%d %s",
+               module->alias, fDetector->modDetChan, param->key);
+
+        status = psl__SetParam(module, fDetector->modDetChan, &kv);
+        if (status != XIA_SUCCESS) {
+            result = status;
+            pslLog(PSL_LOG_ERROR, status,
+                   "Unable to restore %s for %s:%d",
+                   param->key, module->alias, fDetector->modDetChan);
+            continue;
+        }
+
+        ++(*restored);
+    }
+
+    psl__ParamMapFree(&mirror);
+
+    return result;
+}
+
+/*
+ * Restore the box's state after a reconnect. The channels are monitored
+ * again and each channel is restored.
+ */
+PSL_STATIC int psl__RestoreModule(Module* module)
+{
+    int status;
+    int result = XIA_SUCCESS;
+
+    FalconXNModule* fModule = module->pslData;
+
+    uint32_t restored = 0;
+    int      channel;
+
+    status = psl__MonitorChannel(module);
+    if (status != XIA_SUCCESS) {
+        pslLog(PSL_LOG_ERROR, status,
+               "Unable to monitor the channels of %s", module->alias);
+        return status;
+    }
+
+    for (channel = 0; channel < (int) module->number_of_channels; ++channel) {
+        FalconXNDetector* fDetector = psl__FindDetector(module, channel);
+
+        if ((fDetector == NULL) || !fModule->channelActive[channel])
+            continue;
+
+        if (!psl__Restoring(fModule))
+            break;
+
+        status = psl__RestoreDetector(module, fDetector, &restored);
+        if (status != XIA_SUCCESS)
+            result = status;
+    }
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->paramsRestored += restored;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    return result;
+}
+
+/*
+ * Make a new connection to the box. The send lock is held so no command
+ * goes to the connection while it is replaced and the receiver does not
+ * read while the link is down.
+ */
+PSL_STATIC boolean_t psl__Reconnect(Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+    boolean_t       connected = FALSE_;
+
+    handel_md_mutex_lock(&fModule->sendLock);
+
+    if (fModule->sinc.connected)
+        SincDisconnect(&fModule->sinc);
+
+    if (SincConnect(&fModule->sinc, fModule->hostAddress, fModule->portBase)) {
+        if (SincPing(&fModule->sinc, 0)) {
+            struct timeval tod = dxp_md_gettimeofday();
+            SincSetTime(&fModule->sinc, &tod);
+            connected = TRUE_;
+        }
+        else {
+            SincDisconnect(&fModule->sinc);
+        }
+    }
+
+    if (!connected) {
+        pslLog(PSL_LOG_DEBUG, "Reconnect to %s:%d failed: %s",
+               fModule->hostAddress, fModule->portBase,
+               SincCurrentErrorMessage(&fModule->sinc));
+    }
+
+    handel_md_mutex_unlock(&fModule->sendLock);
+
+    return connected;
+}
+
+/*
+ * Reconnect thread. It is started when the receiver loses the connection
+ * and connects again backing off between attempts. Once connected the
+ * box's state is restored and the thread exits. Losing the connection
+ * again while restoring starts over.
+ */
+PSL_STATIC void psl__ModuleReconnector(void* arg)
+{
+    Module*          module = (Module*) arg;
+    FalconXNModule*  fModule = module->pslData;
+    handel_md_Thread self;
+    unsigned int     delay = FALCONXN_RECONNECT_MIN_MSECS;
+
+    pslLog(PSL_LOG_DEBUG, "Reconnect thread starting: %s", module->alias);
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    while (fModule->reconnectActive && (fModule->linkState != LinkConnected)) {
+        unsigned int waited;
+        boolean_t    connected;
+        int          status;
+
+        for (waited = 0; fModule->reconnectActive && (waited < delay); waited += 50) {
+            handel_md_mutex_unlock(&fModule->lock);
+            handel_md_thread_sleep(50);
+            handel_md_mutex_lock(&fModule->lock);
+        }
+
+        if (!fModule->reconnectActive)
+            break;
+
+        ++fModule->reconnectAttempts;
+
+        handel_md_mutex_unlock(&fModule->lock);
+
+        connected = psl__Reconnect(module);
+
+        handel_md_mutex_lock(&fModule->lock);
+
+        if (!connected) {
+            delay *= 2;
+            if (delay > FALCONXN_RECONNECT_MAX_MSECS)
+                delay = FALCONXN_RECONNECT_MAX_MSECS;
+            continue;
+        }
+
+        delay = FALCONXN_RECONNECT_MIN_MSECS;
+
+        fModule->linkState = LinkRestoring;
+
+#if PSL_RECEIVE_ENGINE
+        psl__ReceiveEngineRearm(module);
+#endif
+
+        handel_md_mutex_unlock(&fModule->lock);
+
+        handel_md_event_signal(&fModule->receiverEvent);
+
+        status = psl__RestoreModule(module);
+
+        handel_md_mutex_lock(&fModule->lock);
+
+        if (fModule->linkState != LinkRestoring)
+            continue;
+
+        fModule->linkState = LinkConnected;
+        fModule->outageLength = psl__CaptureNow() - fModule->outageStart;
+
+        if (status == XIA_SUCCESS) {
+            pslLog(PSL_LOG_INFO,
+                   "Connection restored: %s after %.1f secs and %u attempts, "
+                   "%u parameters restored", module->alias,
+                   (double) fModule->outageLength / 1.0e9,
+                   fModule->reconnectAttempts, fModule->paramsRestored);
+        }
+        else {
+            pslLog(PSL_LOG_WARNING,
+                   "Connection restored with errors: %s after %.1f secs and "
+                   "%u attempts, %u parameters restored", module->alias,
+                   (double) fModule->outageLength / 1.0e9,
+                   fModule->reconnectAttempts, fModule->paramsRestored);
+        }
+    }
+
+    pslLog(PSL_LOG_DEBUG, "Reconnect thread stopping: %s", module->alias);
+
+    /*
+     * Clear the handle so the next outage can create the thread again.
+     * The module may be released once unlocked so it is not touched
+     * again.
+     */
+    self = fModule->reconnector;
+    fModule->reconnector.handle = NULL;
+    fModule->reconnectRunning = FALSE_;
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    handel_md_thread_destroy(&self);
+}
+
+/*
+ * Stop reconnecting and wait for a reconnect in progress to finish. Called
+ * before the module's channels are released. The thread uses the module
+ * data so the wait does not give up; every step it takes ends with a
+ * timeout.
+ */
+PSL_STATIC void psl__ReconnectStop(Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+    int             period;
+
+    /*
+     * The longest step is a connect and a ping or a command's response.
+     */
+    period = (2 * (fModule->timeout > 0 ? fModule->timeout : 0)) +
+        (2 * FALCONXN_RESPONSE_TIMEOUT * 1000);
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    fModule->reconnectActive = FALSE_;
+
+    while (fModule->reconnectRunning) {
+        handel_md_mutex_unlock(&fModule->lock);
+        handel_md_thread_sleep(50);
+        if (period > 0) {
+            period -= 50;
+            if (period <= 0) {
+                pslLog(PSL_LOG_WARNING,
+                       "Reconnect thread slow to stop for %s, waiting",
+                       module->alias);
+            }
+        }
+        handel_md_mutex_lock(&fModule->lock);
+    }
+
+    handel_md_mutex_unlock(&fModule->lock);
+}
+
+PSL_STATIC int psl__SetupModule(Module *module)
+{
+    int status;
+
+    FalconXNModule* fModule = NULL;
+    char            item[MAXITEM_LEN];
+    char            capture[MAXITEM_LEN];
+    int             value;
+    int             period;
+    int             receiveThreads;
+    int             receiveBuffer;
+
+    pslLog(PSL_LOG_DEBUG, "Module %s", module->alias);
+
+    ASSERT(module->pslData == NULL);
+
+    fModule = handel_md_alloc(sizeof(FalconXNModule));
+    if (fModule == NULL) {
+        pslLog(PSL_LOG_ERROR, XIA_NOMEM,
+               "No memory for SiToro module PSL data");
+        return XIA_NOMEM;
+    }
+
+    memset(fModule, 0, sizeof(*fModule));
+
+    fModule->receiveWorker = -1;
+
+    /*
+     * The module level set up need to change once we move to a single
+     * connection for the module the detectors share. This will allow us to
+     * determine the number of detectors.
+     */
+    status = xiaGetModuleItem(module->alias, "inet_address", item);
+    if (status != XIA_SUCCESS) {
+        handel_md_free(fModule);
+        pslLog(PSL_LOG_ERROR, status,
+               "Error getting the INET address from the module:");
+        return status;
+    }
 
     strcpy(fModule->hostAddress, item);
 
@@ -7719,8 +9639,53 @@ PSL_STATIC int psl__SetupModule(Module *module)
 
     fModule->timeout = value;
 
+    status = xiaGetModuleItem(module->alias, "inet_receive_threads", &value);
+    if (status != XIA_SUCCESS) {
+        handel_md_free(fModule);
+        pslLog(PSL_LOG_ERROR, status,
+               "Error getting the INET receive threads from the module:");
+        return status;
+    }
+
+    receiveThreads = value;
+
+    status = xiaGetModuleItem(module->alias, "inet_receive_buffer", &value);
+    if (status != XIA_SUCCESS) {
+        handel_md_free(fModule);
+        pslLog(PSL_LOG_ERROR, status,
+               "Error getting the INET receive buffer from the module:");
+        return status;
+    }
+
+    receiveBuffer = value;
+
+    status = xiaGetModuleItem(module->alias, "inet_capture", capture);
+    if (status != XIA_SUCCESS) {
+        handel_md_free(fModule);
+        pslLog(PSL_LOG_ERROR, status,
+               "Error getting the INET capture from the module:");
+        return status;
+    }
+
+#if !PSL_RECEIVE_ENGINE
+    if (receiveThreads > 0) {
+        pslLog(PSL_LOG_WARNING,
+               "Receive engine not supported on this host, using a module thread: %s",
+               module->alias);
+        receiveThreads = 0;
+    }
+#endif
+
     SincInit(&fModule->sinc);
     SincSetTimeout(&fModule->sinc, fModule->timeout);
+    SincSetReceiveBufferSize(&fModule->sinc, receiveBuffer);
+
+    /*
+     * The "loopback" address connects to a SINC device emulated in this
+     * process. The tests register the emulator with libsinc.
+     */
+    if (STREQ(fModule->hostAddress, "loopback"))
+        SincSetTransport(&fModule->sinc, &SincLoopbackTransport, NULL);
 
     status = SincConnect(&fModule->sinc,
                          fModule->hostAddress,
@@ -7780,31 +9745,61 @@ PSL_STATIC int psl__SetupModule(Module *module)
         return status;
     }
 
-    fModule->receiver.name = "Module.receiver";
-    fModule->receiver.priority = 10;
-    fModule->receiver.stackSize = 128 * 1024;
-    fModule->receiver.attributes = 0;
-    fModule->receiver.realtime = FALSE_;
-    fModule->receiver.entryPoint = psl__ModuleReceiver;
-    fModule->receiver.argument = module;
-
-    fModule->receiverActive = TRUE_;
-
-    status = handel_md_thread_create(&fModule->receiver);
-    if (status != 0) {
-        int te = status;
-        status = XIA_THREAD_ERROR;
+    if (!SincArenaInit(&fModule->arena, 0)) {
+        status = XIA_NOMEM;
         SincDisconnect(&fModule->sinc);
         handel_md_event_destroy(&fModule->receiverEvent);
         handel_md_mutex_destroy(&fModule->lock);
         handel_md_free(fModule);
         module->pslData = NULL;
         pslLog(PSL_LOG_ERROR, status,
-               "Receive thread create failed for %s: %d",
-               module->alias, te);
+               "Unable to allocate the decode arena for %s", module->alias);
         return status;
     }
 
+#if PSL_RECEIVE_ENGINE
+    if (receiveThreads > 0) {
+        status = psl__ReceiveEngineAdd(module);
+        if (status != XIA_SUCCESS) {
+            SincArenaFree(&fModule->arena);
+            SincDisconnect(&fModule->sinc);
+            handel_md_event_destroy(&fModule->receiverEvent);
+            handel_md_mutex_destroy(&fModule->lock);
+            handel_md_free(fModule);
+            module->pslData = NULL;
+            return status;
+        }
+    }
+    else
+#endif
+    {
+        fModule->receiver.name = "Module.receiver";
+        fModule->receiver.priority = 10;
+        fModule->receiver.stackSize = 128 * 1024;
+        fModule->receiver.attributes = 0;
+        fModule->receiver.realtime = FALSE_;
+        fModule->receiver.entryPoint = psl__ModuleReceiver;
+        fModule->receiver.argument = module;
+
+        fModule->receiverActive = TRUE_;
+
+        status = handel_md_thread_create(&fModule->receiver);
+        if (status != 0) {
+            int te = status;
+            status = XIA_THREAD_ERROR;
+            SincArenaFree(&fModule->arena);
+            SincDisconnect(&fModule->sinc);
+            handel_md_event_destroy(&fModule->receiverEvent);
+            handel_md_mutex_destroy(&fModule->lock);
+            handel_md_free(fModule);
+            module->pslData = NULL;
+            pslLog(PSL_LOG_ERROR, status,
+                   "Receive thread create failed for %s: %d",
+                   module->alias, te);
+            return status;
+        }
+    }
+
     /*
      * Wait 2 seconds for the thread to say it is running.
      */
@@ -7829,6 +9824,7 @@ PSL_STATIC int psl__SetupModule(Module *module)
         handel_md_event_destroy(&fModule->receiverEvent);
         handel_md_mutex_destroy(&fModule->lock);
         SincDisconnect(&fModule->sinc);
+        SincArenaFree(&fModule->arena);
         handel_md_free(fModule);
         module->pslData = NULL;
         pslLog(PSL_LOG_ERROR, status,
@@ -7844,6 +9840,7 @@ PSL_STATIC int psl__SetupModule(Module *module)
         handel_md_event_destroy(&fModule->receiverEvent);
         handel_md_mutex_destroy(&fModule->lock);
         SincDisconnect(&fModule->sinc);
+        SincArenaFree(&fModule->arena);
         handel_md_free(fModule);
         module->pslData = NULL;
         pslLog(PSL_LOG_ERROR, status,
@@ -7860,6 +9857,7 @@ PSL_STATIC int psl__SetupModule(Module *module)
         handel_md_event_destroy(&fModule->receiverEvent);
         handel_md_mutex_destroy(&fModule->lock);
         SincDisconnect(&fModule->sinc);
+        SincArenaFree(&fModule->arena);
         handel_md_free(fModule);
         module->pslData = NULL;
         pslLog(PSL_LOG_ERROR, status,
@@ -7867,6 +9865,21 @@ PSL_STATIC int psl__SetupModule(Module *module)
         return status;
     }
 
+    /*
+     * A capture is a diagnostic so a bad path is logged and the module
+     * runs without one. Packets received during set up are not captured.
+     */
+    if (capture[0] != '\0') {
+        handel_md_mutex_lock(&fModule->lock);
+        psl__CaptureOpen(&fModule->capture, capture);
+        handel_md_mutex_unlock(&fModule->lock);
+    }
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->linkState = LinkConnected;
+    fModule->reconnectActive = TRUE_;
+    handel_md_mutex_unlock(&fModule->lock);
+
     return XIA_SUCCESS;
 }
 
@@ -7877,8 +9890,18 @@ PSL_STATIC int psl__EndModule(Module *module)
 
         pslLog(PSL_LOG_DEBUG, "Module %s", module->alias);
 
+        psl__ReconnectStop(module);
+        psl__DetcCollectorStop(module);
         psl__ModuleReceiverStop(module->alias, fModule);
 
+        if (psl__CaptureIsOpen(&fModule->capture)) {
+            pslLog(PSL_LOG_INFO,
+                   "Captured %" PRIu64 " packets, %" PRIu64 " bytes: %s",
+                   fModule->capture.packets, fModule->capture.bytes,
+                   module->alias);
+            psl__CaptureClose(&fModule->capture);
+        }
+
         if (fModule->sinc.connected) {
             pslLog(PSL_LOG_DEBUG, "Disconnecting %s:%d",
                    fModule->hostAddress, fModule->portBase);
@@ -7892,6 +9915,8 @@ PSL_STATIC int psl__EndModule(Module *module)
         handel_md_event_destroy(&fModule->receiverEvent);
         handel_md_mutex_destroy(&fModule->lock);
 
+        SincArenaFree(&fModule->arena);
+
         handel_md_free(module->pslData);
         module->pslData = NULL;
     }
@@ -8006,25 +10031,31 @@ PSL_STATIC int psl__SetupDetChan(int detChan, Detector *detector, Module *module
         fDetector->channelState = ChannelReady;
     }
 
-    status = psl__LoadChannelFeatures(module, modChan);
+    /*
+     * Monitor the channel before loading the features so the parameter
+     * mirror they fill misses no updates.
+     */
+    status = psl__MonitorChannel(module);
     if (status != XIA_SUCCESS) {
         module->ch[modChan].pslData = NULL;
+        psl__ParamCacheClear(fDetector);
         handel_md_event_destroy(&fDetector->asyncEvent);
         handel_md_mutex_destroy(&fDetector->lock);
         handel_md_free(fDetector);
         pslLog(PSL_LOG_ERROR, status,
-               "Unable to get channel features");
+               "Unable to set channel monitoring");
         return status;
     }
 
-    status = psl__MonitorChannel(module);
+    status = psl__LoadChannelFeatures(module, modChan);
     if (status != XIA_SUCCESS) {
         module->ch[modChan].pslData = NULL;
+        psl__ParamCacheClear(fDetector);
         handel_md_event_destroy(&fDetector->asyncEvent);
         handel_md_mutex_destroy(&fDetector->lock);
         handel_md_free(fDetector);
         pslLog(PSL_LOG_ERROR, status,
-               "Unable to set channel monitoring");
+               "Unable to get channel features");
         return status;
     }
 
@@ -8062,10 +10093,25 @@ PSL_STATIC int psl__EndDetChan(int detChan, Detector *detector, Module *module)
         FalconXNModule* fModule = module->pslData;
         FalconXNDetector* fDetector = psl__FindDetector(module, modChan);
 
+        /*
+         * A reconnect restores the channels and the collector collects
+         * their characterization so both are stopped before they are
+         * released.
+         */
+        psl__ReconnectStop(module);
+        psl__DetcCollectorStop(module);
+
         psl__ModuleLock(module);
 
         falconXNClearDetectorCalibrationData(fDetector);
 
+        psl__DetectorLock(fDetector);
+        psl__ParamCacheClear(fDetector);
+        fDetector->scopeContinuous = FALSE_;
+        falconXNClearDetectorScopeRing(fDetector);
+        falconXNClearOscPlot(&fDetector->adcTrace);
+        psl__DetectorUnlock(fDetector);
+
         fModule->channelActive[fDetector->modDetChan] = FALSE_;
 
         if (fModule->receiverRunning) {
@@ -8372,6 +10418,8 @@ PSL_STATIC int psl__DetCharacterizeStart(int detChan, FalconXNDetector* fDetecto
 
     SiToro__Sinc__KeyValue kv;
 
+    char noHash[1] = "";
+
     modChan = xiaGetModChan(detChan);
 
     /*
@@ -8415,6 +10463,12 @@ PSL_STATIC int psl__DetCharacterizeStart(int detChan, FalconXNDetector* fDetecto
         return status;
     }
 
+    /*
+     * The channel's characterization is about to change so clear the hash
+     * of the one last uploaded.
+     */
+    psl__SetCalibrationHash(module, fDetector, noHash);
+
     /*
      * Start the detector characterization.
      */
@@ -8434,6 +10488,291 @@ PSL_STATIC int psl__DetCharacterizeStart(int detChan, FalconXNDetector* fDetecto
     return status;
 }
 
+/*
+ * The box characterizes its channels in parallel. A characterization
+ * job groups the channels started together across all the FalconXN
+ * modules so the progress can be reported as a whole and the results
+ * are collected as each channel finishes rather than when the user
+ * asks for each channel in turn.
+ */
+
+PSL_STATIC boolean_t psl__DetcJobModule(Module* module)
+{
+    return (module->psl == &handlers) && (module->pslData != NULL);
+}
+
+/*
+ * Add a started channel to the job. A channel started once every
+ * channel in the last job is done begins a new job.
+ */
+PSL_STATIC int psl__DetcJobJoin(Module* module, FalconXNDetector* fDetector)
+{
+    int status = XIA_SUCCESS;
+
+    FalconXNModule* fModule = module->pslData;
+
+    int channels = 0;
+    int running = 0;
+
+    psl__DetcJobStatus(&channels, &running, NULL, NULL);
+
+    if (running == 0) {
+        Module* other;
+
+        for (other = xiaGetModuleHead(); other != NULL; other = other->next) {
+            int channel;
+
+            if (!psl__DetcJobModule(other))
+                continue;
+
+            psl__ModuleLock(other);
+
+            for (channel = 0; channel < (int) other->number_of_channels; ++channel) {
+                FalconXNDetector* oDetector = psl__FindDetector(other, channel);
+                if (oDetector == NULL)
+                    continue;
+                psl__DetectorLock(oDetector);
+                oDetector->detcJob = FALSE_;
+                psl__DetectorUnlock(oDetector);
+            }
+
+            psl__ModuleUnlock(other);
+        }
+    }
+
+    psl__DetectorLock(fDetector);
+    fDetector->detcJob = TRUE_;
+    fDetector->detcDone = FALSE_;
+    fDetector->detcSuccessful = FALSE_;
+    psl__DetectorUnlock(fDetector);
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    fModule->collectorActive = TRUE_;
+
+    if (!fModule->collectorRunning) {
+        fModule->collector.name = "Module.detc";
+        fModule->collector.priority = 10;
+        fModule->collector.stackSize = 128 * 1024;
+        fModule->collector.attributes = 0;
+        fModule->collector.realtime = FALSE_;
+        fModule->collector.entryPoint = psl__DetcCollector;
+        fModule->collector.argument = module;
+
+        fModule->collectorRunning = TRUE_;
+
+        status = handel_md_thread_create(&fModule->collector);
+        if (status != 0) {
+            int te = status;
+            fModule->collectorRunning = FALSE_;
+            status = XIA_THREAD_ERROR;
+            pslLog(PSL_LOG_ERROR, status,
+                   "Characterization collector create failed for %s: %d",
+                   module->alias, te);
+        }
+    }
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    return status;
+}
+
+/*
+ * The job's progress across all the modules. Running counts the
+ * channels whose results are yet to be collected. The percentage is the
+ * mean of the channels with the done channels at 100%. Any argument can
+ * be NULL.
+ *
+ * Each module's lock is held while its channels are walked as a channel
+ * is released with the lock held.
+ */
+PSL_STATIC void psl__DetcJobStatus(int* channels, int* running, int* successful,
+                                   double* percentage)
+{
+    Module* module;
+
+    int    jobChannels = 0;
+    int    jobRunning = 0;
+    int    jobSuccessful = 0;
+    double total = 0.0;
+
+    for (module = xiaGetModuleHead(); module != NULL; module = module->next) {
+        int channel;
+
+        if (!psl__DetcJobModule(module))
+            continue;
+
+        psl__ModuleLock(module);
+
+        for (channel = 0; channel < (int) module->number_of_channels; ++channel) {
+            FalconXNDetector* fDetector = psl__FindDetector(module, channel);
+
+            if (fDetector == NULL)
+                continue;
+
+            psl__DetectorLock(fDetector);
+
+            if (fDetector->detcJob) {
+                ++jobChannels;
+                if (!fDetector->detcDone) {
+                    ++jobRunning;
+                    total += fDetector->calibPercentage;
+                }
+                else {
+                    if (fDetector->detcSuccessful)
+                        ++jobSuccessful;
+                    total += 100.0;
+                }
+            }
+
+            psl__DetectorUnlock(fDetector);
+        }
+
+        psl__ModuleUnlock(module);
+    }
+
+    if (channels != NULL)
+        *channels = jobChannels;
+    if (running != NULL)
+        *running = jobRunning;
+    if (successful != NULL)
+        *successful = jobSuccessful;
+    if (percentage != NULL)
+        *percentage = jobChannels > 0 ? total / jobChannels : 0.0;
+}
+
+/*
+ * Collector thread. Collects the characterization of each of the
+ * module's job channels once the box reports the channel is no longer
+ * characterizing and exits when there are none left. The results are
+ * fetched without the module lock held as the receive thread needs it.
+ */
+PSL_STATIC void psl__DetcCollector(void* arg)
+{
+    Module*          module = (Module*) arg;
+    FalconXNModule*  fModule = module->pslData;
+    handel_md_Thread self;
+
+    pslLog(PSL_LOG_DEBUG, "Characterization collector starting: %s", module->alias);
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    while (fModule->collectorActive) {
+        int pending = 0;
+        int channel;
+
+        for (channel = 0;
+             fModule->collectorActive && (channel < (int) module->number_of_channels);
+             ++channel) {
+            FalconXNDetector* fDetector = psl__FindDetector(module, channel);
+            boolean_t         finished;
+            boolean_t         successful;
+
+            if (fDetector == NULL)
+                continue;
+
+            psl__DetectorLock(fDetector);
+            finished = fDetector->detcJob && !fDetector->detcDone &&
+                (fDetector->channelState != ChannelCharacterizing);
+            if (fDetector->detcJob && !fDetector->detcDone)
+                ++pending;
+            psl__DetectorUnlock(fDetector);
+
+            if (!finished)
+                continue;
+
+            handel_md_mutex_unlock(&fModule->lock);
+
+            successful = psl__GetCalibrated(module, fDetector);
+
+            psl__DetectorLock(fDetector);
+            fDetector->detcDone = TRUE_;
+            fDetector->detcSuccessful = successful;
+            psl__DetectorUnlock(fDetector);
+
+            pslLog(PSL_LOG_INFO, "Characterization %s: %s:%d",
+                   successful ? "successful" : "failed",
+                   module->alias, fDetector->modDetChan);
+
+            handel_md_mutex_lock(&fModule->lock);
+
+            --pending;
+        }
+
+        if (pending == 0)
+            break;
+
+        handel_md_mutex_unlock(&fModule->lock);
+        handel_md_thread_sleep(50);
+        handel_md_mutex_lock(&fModule->lock);
+    }
+
+    pslLog(PSL_LOG_DEBUG, "Characterization collector stopping: %s", module->alias);
+
+    /*
+     * The module may be released once unlocked so it is not touched
+     * again, see psl__ModuleReconnector.
+     */
+    self = fModule->collector;
+    fModule->collector.handle = NULL;
+    fModule->collectorRunning = FALSE_;
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    handel_md_thread_destroy(&self);
+}
+
+/*
+ * Stop the collector and wait for a collection in progress to finish. The
+ * wait does not give up as the collector uses the module data, see
+ * psl__ReconnectStop.
+ */
+PSL_STATIC void psl__DetcCollectorStop(Module* module)
+{
+    FalconXNModule* fModule = module->pslData;
+    int             period;
+
+    /*
+     * A collection is a param get and the characterization data.
+     */
+    period = (2 * (fModule->timeout > 0 ? fModule->timeout : 0)) +
+        (2 * FALCONXN_RESPONSE_TIMEOUT * 1000);
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    fModule->collectorActive = FALSE_;
+
+    while (fModule->collectorRunning) {
+        handel_md_mutex_unlock(&fModule->lock);
+        handel_md_thread_sleep(50);
+        if (period > 0) {
+            period -= 50;
+            if (period <= 0) {
+                pslLog(PSL_LOG_WARNING,
+                       "Characterization collector slow to stop for %s, waiting",
+                       module->alias);
+            }
+        }
+        handel_md_mutex_lock(&fModule->lock);
+    }
+
+    handel_md_mutex_unlock(&fModule->lock);
+}
+
+PSL_STATIC void psl__PutU32(byte_t** p, uint32_t value)
+{
+    memcpy(*p, &value, sizeof(value));
+    *p += sizeof(value);
+}
+
+PSL_STATIC uint32_t psl__GetU32(const byte_t** p)
+{
+    uint32_t value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return value;
+}
+
 PSL_STATIC int psl__WriteDetCharacterizationWave(xia_sio *dcFile,
                                                  const char* name,
                                                  const double* data,
@@ -8523,9 +10862,48 @@ PSL_STATIC int psl__WriteDetCharacterizationWave(xia_sio *dcFile,
     return status;
 }
 
-PSL_STATIC int psl__UnloadDetCharacterization(Module* module,
-                                              FalconXNDetector* fDetector,
-                                              xia_sio *dcFile)
+/*
+ * Hash the detector characterization text, up to the hash, as it is
+ * read back.
+ */
+PSL_STATIC int psl__TextCalibrationHash(const char* text, char* hash)
+{
+    int status;
+
+    FalconXNDetector* fDetector;
+    xia_sio dcStream;
+    int lc = 0;
+
+    fDetector = handel_md_alloc(sizeof(FalconXNDetector));
+    if (fDetector == NULL) {
+        status = XIA_NOMEM;
+        pslLog(PSL_LOG_ERROR, status,
+               "No memory to hash the detector characterization");
+        return status;
+    }
+
+    memset(fDetector, 0, sizeof(FalconXNDetector));
+
+    xia_sio_openro(&dcStream, text);
+
+    status = psl__ReadDetCharacterization(fDetector, &dcStream, &lc);
+    if (status == XIA_SUCCESS)
+        psl__CalibrationHash(fDetector, hash);
+
+    falconXNClearDetectorCalibrationData(fDetector);
+    handel_md_free(fDetector);
+
+    return status;
+}
+
+/*
+ * Unload the detector characterization as text. This is the format
+ * written inline in .ini files so releases without the binary loader
+ * can read them.
+ */
+PSL_STATIC int psl__UnloadDetCharacterizationS(Module* module,
+                                               FalconXNDetector* fDetector,
+                                               xia_sio *dcFile)
 {
     int status = XIA_SUCCESS;
 
@@ -8558,6 +10936,9 @@ PSL_STATIC int psl__UnloadDetCharacterization(Module* module,
     int written = 0;
     int i;
 
+    size_t start = xia_sio_level(dcFile);
+    char hash[PSL_CALIBRATION_HASH_LEN];
+
     written = xia_sio_printf(dcFile, "data=%d\n", fDetector->calibData.len);
     if (written < 0) {
         status = -written;
@@ -8613,46 +10994,153 @@ PSL_STATIC int psl__UnloadDetCharacterization(Module* module,
     if (status != XIA_SUCCESS) {
         return status;
     }
-
-    /*
-     * Model waveform.
-     */
-    status = psl__WriteDetCharacterizationWave(dcFile,
-                                               "model-x",
-                                               fDetector->calibModel.x,
-                                               fDetector->calibModel.len);
+
+    /*
+     * Model waveform.
+     */
+    status = psl__WriteDetCharacterizationWave(dcFile,
+                                               "model-x",
+                                               fDetector->calibModel.x,
+                                               fDetector->calibModel.len);
+    if (status != XIA_SUCCESS) {
+        return status;
+    }
+    status = psl__WriteDetCharacterizationWave(dcFile,
+                                               "model-y",
+                                               fDetector->calibModel.y,
+                                               fDetector->calibModel.len);
+    if (status != XIA_SUCCESS) {
+        return status;
+    }
+
+    /*
+     * Final waveform.
+     */
+    status = psl__WriteDetCharacterizationWave(dcFile,
+                                               "final-x",
+                                               fDetector->calibFinal.x,
+                                               fDetector->calibFinal.len);
+    if (status != XIA_SUCCESS) {
+        return status;
+    }
+    status = psl__WriteDetCharacterizationWave(dcFile,
+                                               "final-y",
+                                               fDetector->calibFinal.y,
+                                               fDetector->calibFinal.len);
+    if (status != XIA_SUCCESS) {
+        return status;
+    }
+
+    /*
+     * The values are rounded in the text so the hash is of the data read
+     * back from it. The hash is written last so older versions ignore it.
+     */
+    status = psl__TextCalibrationHash(dcFile->s.s + start, hash);
+    if (status != XIA_SUCCESS) {
+        return status;
+    }
+
+    written = xia_sio_printf(dcFile, "hash=%s\n", hash);
+    if (written < 0) {
+        status = -written;
+        pslLog(PSL_LOG_ERROR, status,
+               "Writing to detector characterization hash failed.");
+        return status;
+    }
+
+    return status;
+}
+
+/*
+ * Unload the detector characterization to a binary buffer, see
+ * PSL_DETC_MAGIC. The buffer is empty if the channel has not been
+ * characterized.
+ */
+PSL_STATIC int psl__UnloadDetCharacterizationB(Module* module,
+                                               FalconXNDetector* fDetector,
+                                               GenBuffer* buf)
+{
+    int status = XIA_SUCCESS;
+
+    const SincCalibrationPlot* plots[3];
+    char hash[PSL_CALIBRATION_HASH_LEN];
+    size_t size;
+    byte_t* p;
+    byte_t* hashField;
+    int i;
+
+    buf->data = NULL;
+    buf->length = 0;
+
+    if (!psl__GetCalibrated(module, fDetector))
+        return XIA_SUCCESS;
+
+    /*
+     * Make sure the data returned from the FalconX is sane. Reject it
+     * if it is rubish.
+     */
+    status = psl__CheckDetCharWaveform("Example", &fDetector->calibExample);
+    if (status != XIA_SUCCESS) {
+        falconXNClearDetectorCalibrationData(fDetector);
+        return XIA_SUCCESS;
+    }
+    status = psl__CheckDetCharWaveform("Model", &fDetector->calibModel);
     if (status != XIA_SUCCESS) {
-        return status;
+        falconXNClearDetectorCalibrationData(fDetector);
+        return XIA_SUCCESS;
     }
-    status = psl__WriteDetCharacterizationWave(dcFile,
-                                               "model-y",
-                                               fDetector->calibModel.y,
-                                               fDetector->calibModel.len);
+    status = psl__CheckDetCharWaveform("Final", &fDetector->calibFinal);
     if (status != XIA_SUCCESS) {
-        return status;
+        falconXNClearDetectorCalibrationData(fDetector);
+        return XIA_SUCCESS;
     }
 
-    /*
-     * Final waveform.
-     */
-    status = psl__WriteDetCharacterizationWave(dcFile,
-                                               "final-x",
-                                               fDetector->calibFinal.x,
-                                               fDetector->calibFinal.len);
-    if (status != XIA_SUCCESS) {
+    plots[0] = &fDetector->calibExample;
+    plots[1] = &fDetector->calibModel;
+    plots[2] = &fDetector->calibFinal;
+
+    size = PSL_DETC_HEADER_LEN + (size_t) fDetector->calibData.len;
+    for (i = 0; i < 3; i++)
+        size += sizeof(double) * (size_t) plots[i]->len;
+
+    buf->data = handel_md_alloc(size);
+    if (buf->data == NULL) {
+        status = XIA_NOMEM;
+        pslLog(PSL_LOG_ERROR, status,
+               "No memory for the detector characterization: %zu", size);
         return status;
     }
-    status = psl__WriteDetCharacterizationWave(dcFile,
-                                               "final-y",
-                                               fDetector->calibFinal.y,
-                                               fDetector->calibFinal.len);
-    if (status != XIA_SUCCESS) {
-        return status;
+
+    p = buf->data;
+
+    memcpy(p, PSL_DETC_MAGIC, PSL_DETC_MAGIC_LEN);
+    p += PSL_DETC_MAGIC_LEN;
+    psl__PutU32(&p, PSL_DETC_ORDER);
+    psl__PutU32(&p, (uint32_t) fDetector->calibData.len);
+    for (i = 0; i < 3; i++)
+        psl__PutU32(&p, (uint32_t) plots[i]->len);
+    hashField = p;
+    p += PSL_CALIBRATION_HASH_LEN - 1;
+
+    if (fDetector->calibData.len > 0) {
+        memcpy(p, fDetector->calibData.data, (size_t) fDetector->calibData.len);
+        p += fDetector->calibData.len;
     }
 
-    return status;
-}
+    for (i = 0; i < 3; i++) {
+        if (plots[i]->len > 0) {
+            memcpy(p, plots[i]->y, sizeof(double) * (size_t) plots[i]->len);
+            p += sizeof(double) * (size_t) plots[i]->len;
+        }
+    }
+
+    psl__CalibrationHash(fDetector, hash);
+    memcpy(hashField, hash, PSL_CALIBRATION_HASH_LEN - 1);
 
+    buf->length = size;
+
+    return XIA_SUCCESS;
+}
 
 /*
  * Read waveform data from a string. The first line of a waveform is
@@ -8824,13 +11312,14 @@ PSL_STATIC int psl__LoadDetCharacterizationF(FalconXNDetector *fDetector, Module
     return status;
 }
 
-PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module *module,
-                                             const char *detCharacterizationStr)
+/*
+ * Read the detector characterization text, up to the hash, into the
+ * detector. The detector's characterization is cleared on an error.
+ */
+PSL_STATIC int psl__ReadDetCharacterization(FalconXNDetector *fDetector,
+                                            xia_sio *dcStream, int *lc)
 {
-    xia_sio dcStream;
-
     char line[XIA_LINE_LEN];
-    int lc = 0;
     char* p;
     int i;
 
@@ -8838,28 +11327,20 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
 
     falconXNClearDetectorCalibrationData(fDetector);
 
-    status = xia_sio_openro(&dcStream, detCharacterizationStr);
-    if (status != XIA_SUCCESS) {
-        pslLog(PSL_LOG_ERROR, status,
-               "Opening buffer to parse detector characterization: %.40s",
-               detCharacterizationStr);
-        return status;
-    }
-
-    ++lc;
-    p = xia_sio_gets(&dcStream, line, XIA_LINE_LEN);
+    ++*lc;
+    p = xia_sio_gets(dcStream, line, XIA_LINE_LEN);
 
     if (p == NULL) {
         status = XIA_BAD_FILE_READ;
         pslLog(PSL_LOG_ERROR, status,
-               "Could not read data length: %d:%.40s", lc, line);
+               "Could not read data length: %d:%.40s", *lc, line);
         return status;
     }
 
     if (!STRNEQ(line, "data=")) {
         status = XIA_BAD_FILE_READ;
         pslLog(PSL_LOG_ERROR, status,
-               "Could not find data length: %d:%.40s", lc, line);
+               "Could not find data length: %d:%.40s", *lc, line);
         return status;
     }
 
@@ -8870,7 +11351,7 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
         status = XIA_NOMEM;
         pslLog(PSL_LOG_ERROR, status,
                "No memory for data length of %d %d:%.40s",
-               fDetector->calibData.len, lc, line);
+               fDetector->calibData.len, *lc, line);
         return status;
     }
 
@@ -8880,13 +11361,13 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
         int value;
 
         if (p == NULL) {
-            ++lc;
-            p = xia_sio_gets(&dcStream, line, XIA_LINE_LEN);
+            ++*lc;
+            p = xia_sio_gets(dcStream, line, XIA_LINE_LEN);
             if (p == NULL) {
                 falconXNClearDetectorCalibrationData(fDetector);
                 status = XIA_BAD_FILE_READ;
                 pslLog(PSL_LOG_ERROR, status,
-                       "Could not read data values: %d:%.40s", lc, line);
+                       "Could not read data values: %d:%.40s", *lc, line);
                 return status;
             }
         }
@@ -8897,7 +11378,7 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
             falconXNClearDetectorCalibrationData(fDetector);
             status = XIA_BAD_FILE_READ;
             pslLog(PSL_LOG_ERROR, status,
-                   "Could not parse data value: %d:%.40s", lc, p);
+                   "Could not parse data value: %d:%.40s", *lc, p);
             return status;
         }
 
@@ -8912,20 +11393,20 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
     /*
      * Example waveform.
      */
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "example-x",
                                               &fDetector->calibExample.x,
                                               &fDetector->calibExample.len,
-                                              &lc);
+                                              lc);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         return status;
     }
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "example-y",
                                               &fDetector->calibExample.y,
                                               &fDetector->calibExample.len,
-                                              &lc);
+                                              lc);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         return status;
@@ -8934,20 +11415,20 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
     /*
      * Model waveform.
      */
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "model-x",
                                               &fDetector->calibModel.x,
                                               &fDetector->calibModel.len,
-                                              &lc);
+                                              lc);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         return status;
     }
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "model-y",
                                               &fDetector->calibModel.y,
                                               &fDetector->calibModel.len,
-                                              &lc);
+                                              lc);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         return status;
@@ -8956,26 +11437,177 @@ PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module
     /*
      * Final waveform.
      */
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "final-x",
                                               &fDetector->calibFinal.x,
                                               &fDetector->calibFinal.len,
-                                              &lc);
+                                              lc);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         return status;
     }
-    status = psl__ReadDetCharacterizationWave(&dcStream,
+    status = psl__ReadDetCharacterizationWave(dcStream,
                                               "final-y",
                                               &fDetector->calibFinal.y,
                                               &fDetector->calibFinal.len,
-                                              &lc);
+                                              lc);
+    if (status != XIA_SUCCESS) {
+        falconXNClearDetectorCalibrationData(fDetector);
+        return status;
+    }
+
+    return XIA_SUCCESS;
+}
+
+PSL_STATIC int psl__LoadDetCharacterizationS(FalconXNDetector *fDetector, Module *module,
+                                             const char *detCharacterizationStr)
+{
+    xia_sio dcStream;
+
+    char line[XIA_LINE_LEN];
+    char hash[PSL_CALIBRATION_HASH_LEN];
+    int lc = 0;
+    char* p;
+
+    int status;
+
+    falconXNClearDetectorCalibrationData(fDetector);
+
+    status = xia_sio_openro(&dcStream, detCharacterizationStr);
+    if (status != XIA_SUCCESS) {
+        pslLog(PSL_LOG_ERROR, status,
+               "Opening buffer to parse detector characterization: %.40s",
+               detCharacterizationStr);
+        return status;
+    }
+
+    status = psl__ReadDetCharacterization(fDetector, &dcStream, &lc);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    /*
+     * Files saved by older versions have no hash. The hash of the data
+     * read is what is checked against the box so a mismatch only means
+     * the data was edited.
+     */
+    psl__CalibrationHash(fDetector, hash);
+
+    ++lc;
+    p = xia_sio_gets(&dcStream, line, XIA_LINE_LEN);
+
+    if (p != NULL && STRNEQ(line, "hash=") &&
+        strncmp(line + sizeof("hash=") - 1, hash, PSL_CALIBRATION_HASH_LEN - 1) != 0) {
+        pslLog(PSL_LOG_WARNING,
+               "Detector characterization hash does not match the data: "
+               "%d:%.40s", lc, line);
+    }
+
+    status = psl__SetCalibration(module, fDetector, hash);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
+        pslLog(PSL_LOG_ERROR, status,
+               "Error setting the detector characterization");
+        return status;
+    }
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Load the binary detector characterization, see PSL_DETC_MAGIC. The
+ * buffer can be longer than the data.
+ */
+PSL_STATIC int psl__LoadDetCharacterizationB(FalconXNDetector *fDetector, Module *module,
+                                             const byte_t *data, size_t len)
+{
+    int status;
+
+    SincCalibrationPlot* plots[3];
+    uint32_t dataLen;
+    uint32_t pulseLen[3];
+    char hash[PSL_CALIBRATION_HASH_LEN];
+    const byte_t* p = data + PSL_DETC_MAGIC_LEN;
+    const byte_t* hashField;
+    size_t size;
+    int i;
+    int s;
+
+    falconXNClearDetectorCalibrationData(fDetector);
+
+    if (psl__GetU32(&p) != PSL_DETC_ORDER) {
+        status = XIA_BAD_FILE_READ;
+        pslLog(PSL_LOG_ERROR, status,
+               "Detector characterization has the wrong byte order");
+        return status;
+    }
+
+    dataLen = psl__GetU32(&p);
+    size = PSL_DETC_HEADER_LEN + dataLen;
+    for (i = 0; i < 3; i++) {
+        pulseLen[i] = psl__GetU32(&p);
+        if (pulseLen[i] > FALCONXN_MAX_ADC_SAMPLES)
+            size = SIZE_MAX;
+        else if (size != SIZE_MAX)
+            size += sizeof(double) * pulseLen[i];
+    }
+
+    hashField = p;
+    p += PSL_CALIBRATION_HASH_LEN - 1;
+
+    if (size > len || dataLen > INT_MAX) {
+        status = XIA_BAD_FILE_READ;
+        pslLog(PSL_LOG_ERROR, status,
+               "Detector characterization is truncated: %zu of %zu bytes",
+               len, size);
+        return status;
+    }
+
+    plots[0] = &fDetector->calibExample;
+    plots[1] = &fDetector->calibModel;
+    plots[2] = &fDetector->calibFinal;
+
+    fDetector->calibData.len = (int) dataLen;
+    fDetector->calibData.data = handel_md_alloc(dataLen > 0 ? dataLen : 1);
+    if (fDetector->calibData.data == NULL) {
+        status = XIA_NOMEM;
+        pslLog(PSL_LOG_ERROR, status,
+               "No memory for data length of %u", dataLen);
         return status;
     }
 
-    status = psl__SetCalibration(module, fDetector);
+    memcpy(fDetector->calibData.data, p, dataLen);
+    p += dataLen;
+
+    for (i = 0; i < 3; i++) {
+        size_t bytes = sizeof(double) * pulseLen[i];
+
+        plots[i]->x = handel_md_alloc(bytes > 0 ? bytes : 1);
+        plots[i]->y = handel_md_alloc(bytes > 0 ? bytes : 1);
+        if (plots[i]->x == NULL || plots[i]->y == NULL) {
+            falconXNClearDetectorCalibrationData(fDetector);
+            status = XIA_NOMEM;
+            pslLog(PSL_LOG_ERROR, status,
+                   "No memory for pulse length of %u", pulseLen[i]);
+            return status;
+        }
+
+        plots[i]->len = (int) pulseLen[i];
+
+        for (s = 0; s < plots[i]->len; s++)
+            plots[i]->x[s] = s;
+
+        memcpy(plots[i]->y, p, bytes);
+        p += bytes;
+    }
+
+    psl__CalibrationHash(fDetector, hash);
+
+    if (memcmp(hashField, hash, PSL_CALIBRATION_HASH_LEN - 1) != 0) {
+        pslLog(PSL_LOG_WARNING,
+               "Detector characterization hash does not match the data");
+    }
+
+    status = psl__SetCalibration(module, fDetector, hash);
     if (status != XIA_SUCCESS) {
         falconXNClearDetectorCalibrationData(fDetector);
         pslLog(PSL_LOG_ERROR, status,
@@ -9732,3 +12364,168 @@ PSL_STATIC int psl__BoardOp_GetFirmwareVersion(int detChan, Detector* detector,
 
     return XIA_SUCCESS;
 }
+
+PSL_STATIC int psl__BoardOp_GetReceiveStats(int detChan, Detector* detector, Module* module,
+                                            const char *name, void *value)
+{
+    FalconXNModule* fModule;
+    SincReadStats   stats;
+    double*         dvalue = (double*) value;
+
+    UNUSED(detChan);
+    UNUSED(detector);
+    UNUSED(name);
+
+    ASSERT(value);
+
+    fModule = module->pslData;
+
+    handel_md_mutex_lock(&fModule->lock);
+    SincGetReadStats(&fModule->sinc, &stats, false);
+    handel_md_mutex_unlock(&fModule->lock);
+
+    dvalue[0] = (double) stats.bytes;
+    dvalue[1] = (double) stats.reads;
+    dvalue[2] = (double) stats.wakeups;
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * The state of the connection to the box. The value is an array of 5
+ * doubles, the link state (0 connected, 1 disconnected, 2 restoring),
+ * the number of outages, the reconnect attempts in the last outage, the
+ * length of the last outage in seconds, or the current outage so far,
+ * and the parameters restored after the last outage.
+ */
+PSL_STATIC int psl__BoardOp_GetConnectionStatus(int detChan, Detector* detector, Module* module,
+                                                const char *name, void *value)
+{
+    FalconXNModule* fModule;
+    double*         dvalue = (double*) value;
+    uint64_t        length;
+
+    UNUSED(detChan);
+    UNUSED(detector);
+    UNUSED(name);
+
+    ASSERT(value);
+
+    fModule = module->pslData;
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    if (fModule->linkState == LinkConnected)
+        length = fModule->outageLength;
+    else
+        length = psl__CaptureNow() - fModule->outageStart;
+
+    dvalue[0] = (double) fModule->linkState;
+    dvalue[1] = (double) fModule->outages;
+    dvalue[2] = (double) fModule->reconnectAttempts;
+    dvalue[3] = (double) length / 1.0e9;
+    dvalue[4] = (double) fModule->paramsRestored;
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Replay a SINC capture through the module's receive processor. The
+ * value is the capture file name. replay_capture keeps the recorded
+ * timing and replay_capture_fast replays the packets as fast as they
+ * are processed. Only asynchronous data is replayed as there is no
+ * command waiting for a captured response. Live asynchronous data from
+ * the box is dropped until the replay finishes.
+ */
+PSL_STATIC int psl__BoardOp_ReplayCapture(int detChan, Detector* detector, Module* module,
+                                          const char *name, void *value)
+{
+    FalconXNModule* fModule;
+    FalconXNCapture capture;
+    boolean_t       recorded;
+    uint64_t        first = 0;
+    uint64_t        start = 0;
+    uint64_t        replayed = 0;
+    int             status;
+
+    UNUSED(detChan);
+    UNUSED(detector);
+
+    ASSERT(value);
+
+    fModule = module->pslData;
+    recorded = STREQ(name, "replay_capture");
+
+    status = psl__CaptureOpenReplay(&capture, (const char*) value);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    handel_md_mutex_lock(&fModule->lock);
+
+    if (fModule->replaying) {
+        handel_md_mutex_unlock(&fModule->lock);
+        psl__CaptureClose(&capture);
+        status = XIA_BAD_VALUE;
+        pslLog(PSL_LOG_ERROR, status,
+               "A capture is already being replayed: %s", module->alias);
+        return status;
+    }
+
+    fModule->replaying = TRUE_;
+
+    handel_md_mutex_unlock(&fModule->lock);
+
+    while (TRUE_) {
+        uint8_t                   packetData[16];
+        SincBuffer                packet = PSL_SINC_BUFFER_INIT(packetData);
+        SiToro__Sinc__MessageType msgType;
+        uint64_t                  time;
+
+        status = psl__CaptureRead(&capture, &time, &msgType, &packet);
+        if (status != XIA_SUCCESS)
+            break;
+
+        if (!psl__AsyncMessage(msgType))
+            continue;
+
+        /*
+         * The first replayed packet is sent at once and the rest at the
+         * same offsets from it as when they were received.
+         */
+        if (replayed == 0) {
+            first = time;
+            start = psl__CaptureNow();
+        }
+        else if (recorded) {
+            uint64_t due = time - first;
+            uint64_t elapsed = psl__CaptureNow() - start;
+            if (due > elapsed + 1000000)
+                handel_md_thread_sleep((unsigned int) ((due - elapsed) / 1000000));
+        }
+
+        handel_md_mutex_lock(&fModule->lock);
+        psl__ModuleReceiveProcessor(module, msgType, &packet);
+        handel_md_mutex_unlock(&fModule->lock);
+
+        ++replayed;
+    }
+
+    if (status == XIA_EOF)
+        status = XIA_SUCCESS;
+
+    handel_md_mutex_lock(&fModule->lock);
+    fModule->replaying = FALSE_;
+    handel_md_mutex_unlock(&fModule->lock);
+
+    pslLog(PSL_LOG_INFO,
+           "Replayed %" PRIu64 " of %" PRIu64 " packets in %.3f secs: %s",
+           replayed, capture.packets,
+           replayed > 0 ? (double) (psl__CaptureNow() - start) / 1.0e9 : 0.0,
+           module->alias);
+
+    psl__CaptureClose(&capture);
+
+    return status;
+}
@@ -142,10 +142,12 @@ HANDEL_EXPORT int HANDEL_API xiaInitHandel(void)
          * imported utils variable
          */
         handel_md_log           = dxp_md_log;
+        handel_md_log_enabled   = dxp_md_log_enabled;
         handel_md_output        = dxp_md_output;
         handel_md_enable_log    = dxp_md_enable_log;
         handel_md_suppress_log  = dxp_md_suppress_log;
         handel_md_set_log_level = dxp_md_set_log_level;
+        handel_md_log_async     = dxp_md_log_async;
         handel_md_alloc         = malloc;
         handel_md_free          = free;
         handel_md_wait          = dxp_md_wait;
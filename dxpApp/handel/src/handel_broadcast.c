@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "handeldef.h"
+#include "xia_handel_structures.h"
+#include "xia_handel.h"
+#include "xia_system.h"
+#include "xia_assert.h"
+#include "xia_common.h"
+
+#include "handel_errors.h"
+#include "handel_log.h"
+
+#include "md_threads.h"
+
+
+/*
+ * The detChans of a set that belong to one module.
+ */
+typedef struct
+{
+    Module*          module;
+    int*             detChans;
+    int              numDetChans;
+    xiaBroadcastOp   op;
+    void*            arg;
+    int              status;
+    handel_md_Thread thread;
+    handel_md_Event  done;
+} BroadcastGroup;
+
+
+static void xiaBroadcastWorker(void* arg)
+{
+    BroadcastGroup* group = (BroadcastGroup*) arg;
+    handel_md_Thread self = group->thread;
+    int i;
+
+    group->status = XIA_SUCCESS;
+
+    for (i = 0; i < group->numDetChans; i++) {
+        group->status = group->op(group->detChans[i], group->arg);
+        if (group->status != XIA_SUCCESS)
+            break;
+    }
+
+    /*
+     * The group is released once signalled. The thread ends itself as a
+     * cancel from the caller could hit another thread if this one has
+     * exited and its id has been reused.
+     */
+    handel_md_event_signal(&group->done);
+
+    if (self.handle != NULL)
+        handel_md_thread_destroy(&self);
+}
+
+
+/*
+ * Walk the set in order calling the operation for each detChan.
+ */
+static int xiaBroadcastSerial(DetChanSetElem* head, xiaBroadcastOp op, void* arg)
+{
+    DetChanSetElem* elem;
+
+    for (elem = head; elem != NULL; elem = getListNext(elem)) {
+        int status = op((int) elem->channel, arg);
+        if (status != XIA_SUCCESS)
+            return status;
+    }
+
+    return XIA_SUCCESS;
+}
+
+
+/*****************************************************************************
+ *
+ * Calls op for every detChan in the set detChanSet.
+ *
+ * The detChans are grouped by module. If every module's PSL allows
+ * concurrent module operations, and there is more than one module, each
+ * module's detChans are handled by a thread of their own, in set order, so
+ * the broadcast takes as long as the slowest module rather than the sum of
+ * all of them. Otherwise the set is walked in order on the calling thread.
+ *
+ * The first failing status is returned once all modules have finished.
+ *
+ *****************************************************************************/
+HANDEL_SHARED int HANDEL_API xiaBroadcast(int detChanSet, xiaBroadcastOp op,
+                                          void* arg)
+{
+    int status = XIA_SUCCESS;
+    int numDetChans = 0;
+    int numGroups = 0;
+    int g;
+
+    boolean_t concurrent = TRUE_;
+
+    DetChanElement* detChanElem = NULL;
+    DetChanSetElem* head = NULL;
+    DetChanSetElem* elem = NULL;
+
+    BroadcastGroup* groups = NULL;
+    int*            detChans = NULL;
+
+    detChanElem = xiaGetDetChanPtr(detChanSet);
+
+    if (detChanElem == NULL || detChanElem->type != SET) {
+        status = XIA_INVALID_DETCHAN;
+        xiaLog(XIA_LOG_ERROR, status, "xiaBroadcast",
+               "detChan %d is not a detChan set", detChanSet);
+        return status;
+    }
+
+    head = detChanElem->data.detChanSet;
+
+    /*
+     * Count the modules. Nested sets and PSLs that cannot handle concurrent
+     * module operations use the serial walk.
+     */
+    for (elem = head; elem != NULL && concurrent; elem = getListNext(elem)) {
+        Module* module = NULL;
+
+        if (xiaGetElemType((int) elem->channel) != SINGLE ||
+            xiaFindModuleAndDetector((int) elem->channel, &module, NULL) != XIA_SUCCESS ||
+            !module->psl->concurrentModules) {
+            concurrent = FALSE_;
+            break;
+        }
+
+        ++numDetChans;
+    }
+
+    if (!concurrent || numDetChans < 2)
+        return xiaBroadcastSerial(head, op, arg);
+
+    groups = handel_md_alloc(sizeof(BroadcastGroup) * (size_t) numDetChans);
+    detChans = handel_md_alloc(sizeof(int) * (size_t) numDetChans);
+
+    if (groups == NULL || detChans == NULL) {
+        if (groups != NULL)
+            handel_md_free(groups);
+        if (detChans != NULL)
+            handel_md_free(detChans);
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaBroadcast",
+               "Unable to allocate the broadcast groups");
+        return status;
+    }
+
+    memset(groups, 0, sizeof(BroadcastGroup) * (size_t) numDetChans);
+
+    /*
+     * Group the detChans by module keeping the set order within each module.
+     * Each group's detChans are stored contiguously in detChans.
+     */
+    for (elem = head; elem != NULL; elem = getListNext(elem)) {
+        Module* module = NULL;
+
+        xiaFindModuleAndDetector((int) elem->channel, &module, NULL);
+
+        for (g = 0; g < numGroups; g++) {
+            if (groups[g].module == module)
+                break;
+        }
+
+        if (g == numGroups) {
+            groups[g].module = module;
+            ++numGroups;
+        }
+
+        ++groups[g].numDetChans;
+    }
+
+    if (numGroups < 2) {
+        handel_md_free(detChans);
+        handel_md_free(groups);
+        return xiaBroadcastSerial(head, op, arg);
+    }
+
+    numDetChans = 0;
+    for (g = 0; g < numGroups; g++) {
+        groups[g].detChans = &detChans[numDetChans];
+        numDetChans += groups[g].numDetChans;
+        groups[g].numDetChans = 0;
+    }
+
+    for (elem = head; elem != NULL; elem = getListNext(elem)) {
+        Module* module = NULL;
+
+        xiaFindModuleAndDetector((int) elem->channel, &module, NULL);
+
+        for (g = 0; g < numGroups; g++) {
+            if (groups[g].module == module) {
+                groups[g].detChans[groups[g].numDetChans++] = (int) elem->channel;
+                break;
+            }
+        }
+    }
+
+    /*
+     * Start a thread per module. A module that cannot get a thread is run
+     * on this thread once the others have started.
+     */
+    for (g = 0; g < numGroups; g++) {
+        BroadcastGroup* group = &groups[g];
+
+        group->op = op;
+        group->arg = arg;
+        group->status = XIA_SUCCESS;
+
+        group->thread.name = "Handel.broadcast";
+        group->thread.priority = 0;
+        group->thread.stackSize = 128 * 1024;
+        group->thread.attributes = 0;
+        group->thread.realtime = FALSE_;
+        group->thread.entryPoint = xiaBroadcastWorker;
+        group->thread.argument = group;
+
+        if (handel_md_event_create(&group->done) != 0 ||
+            handel_md_thread_create(&group->thread) != 0) {
+            xiaLog(XIA_LOG_WARNING, "xiaBroadcast",
+                   "Unable to start a broadcast thread for module %s",
+                   group->module->alias);
+            if (group->done.handle != NULL)
+                handel_md_event_destroy(&group->done);
+            group->thread.handle = NULL;
+        }
+    }
+
+    for (g = 0; g < numGroups; g++) {
+        BroadcastGroup* group = &groups[g];
+
+        if (group->thread.handle == NULL)
+            xiaBroadcastWorker(group);
+    }
+
+    /*
+     * Wait for every module before returning, even if one has failed, as
+     * the threads use the groups.
+     */
+    for (g = 0; g < numGroups; g++) {
+        BroadcastGroup* group = &groups[g];
+
+        if (group->thread.handle != NULL) {
+            handel_md_event_wait(&group->done, 0);
+            handel_md_event_destroy(&group->done);
+        }
+
+        if (group->status != XIA_SUCCESS && status == XIA_SUCCESS) {
+            status = group->status;
+            xiaLog(XIA_LOG_ERROR, status, "xiaBroadcast",
+                   "Broadcast to module %s failed", group->module->alias);
+        }
+    }
+
+    handel_md_free(detChans);
+    handel_md_free(groups);
+
+    return status;
+}
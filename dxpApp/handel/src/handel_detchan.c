@@ -36,6 +36,7 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "xia_assert.h"
 #include "xia_handel.h"
@@ -50,9 +51,22 @@
  */
 static DetChanElement *xiaDetChanHead = NULL;
 
+/*
+ * The DetectorChannel LL indexed by detChan. Slot 0 holds the -1 master
+ * set so that detChan n is in slot n + 1. detChans beyond the largest
+ * table size are found by walking the list.
+ */
+static DetChanElement **xiaDetChanTable = NULL;
+static int xiaDetChanTableSize = 0;
+
+#define DETCHAN_TABLE_MAX 65536
+
 
 HANDEL_STATIC DetChanSetElem* HANDEL_API xiaGetDetSetTail(DetChanSetElem *head);
 HANDEL_STATIC int HANDEL_API xiaAddToExistingSet(int detChan, int newChan);
+HANDEL_STATIC int HANDEL_API xiaTableDetChan(DetChanElement *element);
+HANDEL_STATIC void HANDEL_API xiaUntableDetChan(DetChanElement *element);
+HANDEL_STATIC DetChanElement* HANDEL_API xiaFindDetChan(int detChan);
 
 
 /*****************************************************************************
@@ -63,26 +77,7 @@ HANDEL_STATIC int HANDEL_API xiaAddToExistingSet(int detChan, int newChan);
  *****************************************************************************/
 HANDEL_SHARED boolean_t HANDEL_API xiaIsDetChanFree(int detChan)
 {
-    DetChanElement *current;
-
-    current = xiaDetChanHead;
-
-    if (isListEmpty(current))
-    {
-        return TRUE_;
-    }
-
-    while (current != NULL)
-    {
-        if (current->detChan == detChan)
-        {
-            return FALSE_;
-        }
-
-        current = current->next;
-    }
-
-    return TRUE_;
+    return xiaFindDetChan(detChan) == NULL ? TRUE_ : FALSE_;
 }
 
 /*****************************************************************************
@@ -139,6 +134,15 @@ HANDEL_SHARED int HANDEL_API xiaAddDetChan(int type, int detChan, void *data)
     newDetChan->isTagged = FALSE_;
     newDetChan->next = NULL;
 
+    status = xiaTableDetChan(newDetChan);
+    if (status != XIA_SUCCESS)
+    {
+        handel_md_free(newDetChan);
+        xiaLog(XIA_LOG_ERROR, status, "xiaAddDetChan",
+               "Not enough memory to index detChan %d", detChan);
+        return status;
+    }
+
     current = xiaDetChanHead;
 
     if (isListEmpty(current))
@@ -196,6 +200,14 @@ HANDEL_SHARED int HANDEL_API xiaAddDetChan(int type, int detChan, void *data)
                 masterDetChan->data.detChanSet = NULL;
                 masterDetChan->detChan         = -1;
 
+                status = xiaTableDetChan(masterDetChan);
+                if (status != XIA_SUCCESS) {
+                    handel_md_free(masterDetChan);
+                    xiaLog(XIA_LOG_ERROR, status, "xiaAddDetChan",
+                           "Not enough memory to index the master detChan list");
+                    return status;
+                }
+
                 /* List cannot be empty thanks to check above */
                 while (current->next != NULL) {
 
@@ -340,6 +352,8 @@ HANDEL_SHARED int HANDEL_API xiaRemoveDetChan(int detChan)
         prev->next = next;
     }
 
+    xiaUntableDetChan(current);
+
     switch (current->type)
     {
         case SINGLE:
@@ -741,16 +755,11 @@ HANDEL_SHARED int HANDEL_API xiaGetElemType(int detChan)
 {
     DetChanElement *current = NULL;
 
-    current = xiaDetChanHead;
+    current = xiaFindDetChan(detChan);
 
-    while (current != NULL)
+    if (current != NULL)
     {
-        if (current->detChan == detChan)
-        {
-            return current->type;
-        }
-
-        current = current->next;
+        return current->type;
     }
 
     /* This isn't an error code, this is just an "invalid" type */
@@ -801,21 +810,9 @@ HANDEL_SHARED char* HANDEL_API xiaGetAliasFromDetChan(int detChan)
 {
     DetChanElement *current = NULL;
 
-    if (xiaIsDetChanFree(detChan))
-    {
-        return NULL;
-    }
-
-    current = xiaDetChanHead;
+    current = xiaFindDetChan(detChan);
 
-    while ((current->next != NULL) &&
-           (current->detChan != detChan))
-    {
-        current = current->next;
-    }
-
-    if ((current->next == NULL) &&
-        (current->detChan != detChan))
+    if (current == NULL)
     {
         return NULL;
     }
@@ -856,21 +853,7 @@ HANDEL_SHARED void HANDEL_API xiaClearTags(void)
  *****************************************************************************/
 HANDEL_SHARED DetChanElement* HANDEL_API xiaGetDetChanPtr(int detChan)
 {
-    DetChanElement *current = NULL;
-
-    current = xiaDetChanHead;
-
-    while (current != NULL)
-    {
-        if (current->detChan == detChan)
-        {
-            return current;
-        }
-
-        current = getListNext(current);
-    }
-
-    return NULL;
+    return xiaFindDetChan(detChan);
 }
 
 
@@ -905,16 +888,35 @@ HANDEL_SHARED int HANDEL_API xiaGetDefaultStrFromDetChan(int detChan,
 HANDEL_SHARED XiaDefaults* HANDEL_API xiaGetDefaultFromDetChan(int detChan)
 {
     int status;
+    int modChan;
+
+    char *alias = NULL;
 
-    char defaultStr[MAXALIAS_LEN];
+    Module *module = NULL;
 
-    status = xiaGetDefaultStrFromDetChan(detChan, defaultStr);
+    /* This is called for most acquisition value and run data accesses so
+     * go straight to the module's defaults rather than through
+     * xiaGetModuleItem() and its "default_chanN" name parsing.
+     */
+    alias = xiaGetAliasFromDetChan(detChan);
 
-    if (status != XIA_SUCCESS) {
+    if (alias == NULL) {
         return NULL;
     }
 
-    return xiaFindDefault(defaultStr);
+    module = xiaFindModule(alias);
+
+    if (module == NULL || module->defaults == NULL) {
+        return NULL;
+    }
+
+    status = xiaGetAbsoluteChannel(detChan, module, &modChan);
+
+    if (status != XIA_SUCCESS || module->defaults[modChan] == NULL) {
+        return NULL;
+    }
+
+    return xiaFindDefault(module->defaults[modChan]);
 }
 
 
@@ -926,10 +928,124 @@ HANDEL_SHARED XiaDefaults* HANDEL_API xiaGetDefaultFromDetChan(int detChan)
 HANDEL_SHARED int HANDEL_API xiaInitDetChanDS(void)
 {
     xiaDetChanHead = NULL;
+
+    if (xiaDetChanTable != NULL)
+    {
+        handel_md_free(xiaDetChanTable);
+        xiaDetChanTable = NULL;
+    }
+
+    xiaDetChanTableSize = 0;
+
+    return XIA_SUCCESS;
+}
+
+
+/*****************************************************************************
+ *
+ * This routine adds a new DetChanElement to the detChan table, growing the
+ * table if needed. Elements beyond the table's maximum size are only in
+ * the LL.
+ *
+ *****************************************************************************/
+HANDEL_STATIC int HANDEL_API xiaTableDetChan(DetChanElement *element)
+{
+    int slot;
+    int size;
+
+    DetChanElement **table = NULL;
+
+    if ((element->detChan < -1) || (element->detChan >= DETCHAN_TABLE_MAX - 1))
+    {
+        return XIA_SUCCESS;
+    }
+
+    slot = element->detChan + 1;
+
+    if (slot >= xiaDetChanTableSize)
+    {
+        size = xiaDetChanTableSize == 0 ? 64 : xiaDetChanTableSize;
+
+        while (size <= slot)
+        {
+            size *= 2;
+        }
+
+        table = (DetChanElement **)handel_md_alloc(sizeof(DetChanElement *) *
+                                                   (size_t)size);
+        if (table == NULL)
+        {
+            return XIA_NOMEM;
+        }
+
+        memset(table, 0, sizeof(DetChanElement *) * (size_t)size);
+
+        if (xiaDetChanTable != NULL)
+        {
+            memcpy(table, xiaDetChanTable,
+                   sizeof(DetChanElement *) * (size_t)xiaDetChanTableSize);
+            handel_md_free(xiaDetChanTable);
+        }
+
+        xiaDetChanTable = table;
+        xiaDetChanTableSize = size;
+    }
+
+    xiaDetChanTable[slot] = element;
+
     return XIA_SUCCESS;
 }
 
 
+/*****************************************************************************
+ *
+ * This routine removes a DetChanElement from the detChan table.
+ *
+ *****************************************************************************/
+HANDEL_STATIC void HANDEL_API xiaUntableDetChan(DetChanElement *element)
+{
+    if ((element->detChan >= -1) &&
+        (element->detChan < xiaDetChanTableSize - 1) &&
+        (xiaDetChanTable[element->detChan + 1] == element))
+    {
+        xiaDetChanTable[element->detChan + 1] = NULL;
+    }
+}
+
+
+/*****************************************************************************
+ *
+ * This routine returns the DetChanElement for detChan, or NULL if it
+ * doesn't exist. Uses the detChan table and only walks the LL for
+ * detChans that are outside of the table's range.
+ *
+ *****************************************************************************/
+HANDEL_STATIC DetChanElement* HANDEL_API xiaFindDetChan(int detChan)
+{
+    DetChanElement *current = NULL;
+
+    if ((detChan >= -1) && (detChan < DETCHAN_TABLE_MAX - 1))
+    {
+        return detChan < xiaDetChanTableSize - 1 ?
+            xiaDetChanTable[detChan + 1] : NULL;
+    }
+
+    current = xiaDetChanHead;
+
+    while (current != NULL)
+    {
+        if (current->detChan == detChan)
+        {
+            return current;
+        }
+
+        current = current->next;
+    }
+
+    return NULL;
+}
+
+
 /*****************************************************************************
  *
  * Return the detector channel list's head.
@@ -48,11 +48,42 @@
 #include "handel_errors.h"
 #include "handel_log.h"
 
+#include "xia_map.h"
+
+#include "md_threads.h"
+
 /*
  * Define the head of the XiaDefaults LL
  */
 static XiaDefaults *xiaDefaultsHead = NULL;
 
+/*
+ * The XiaDefaults LL indexed by alias
+ */
+static xia_map_t xiaDefaultsMap = XIA_MAP_INITIALIZER;
+
+/*
+ * Serialises changes to and lookups in the XiaDefaults LL and its index.
+ * The broadcast threads of different modules can add defaults at the
+ * same time. The lock is recursive.
+ */
+static handel_md_Mutex xiaDefaultsLock;
+
+static void xiaDefaultsLockTake(void)
+{
+    if (!handel_md_mutex_ready(&xiaDefaultsLock))
+        handel_md_mutex_create(&xiaDefaultsLock);
+    handel_md_mutex_lock(&xiaDefaultsLock);
+}
+
+static void xiaDefaultsLockGive(void)
+{
+    handel_md_mutex_unlock(&xiaDefaultsLock);
+}
+
+static int xiaNewDefaultEntry(const char *alias);
+static int xiaRemoveDefaultEntry(const char *alias);
+
 
 /*****************************************************************************
  *
@@ -63,8 +94,6 @@ HANDEL_SHARED int HANDEL_API xiaNewDefault(const char *alias)
 {
     int status = XIA_SUCCESS;
 
-    XiaDefaults *current=NULL;
-
 
     /* If HanDeL isn't initialized, go ahead and call it... */
     if (!isHandelInit)
@@ -80,6 +109,23 @@ HANDEL_SHARED int HANDEL_API xiaNewDefault(const char *alias)
                "HanDeL was initialized silently");
     }
 
+    xiaDefaultsLockTake();
+    status = xiaNewDefaultEntry(alias);
+    xiaDefaultsLockGive();
+
+    return status;
+}
+
+/*
+ * Add the XiaDefaults entry to the LL and index. The defaults lock is
+ * held.
+ */
+static int xiaNewDefaultEntry(const char *alias)
+{
+    int status = XIA_SUCCESS;
+
+    XiaDefaults *current=NULL;
+
     if ((strlen(alias) + 1) > MAXALIAS_LEN)
     {
         status = XIA_ALIAS_SIZE;
@@ -139,6 +185,14 @@ HANDEL_SHARED int HANDEL_API xiaNewDefault(const char *alias)
     current->entry = NULL;
     current->next = NULL;
 
+    if (xia_map_put(&xiaDefaultsMap, current->alias, current) != 0)
+    {
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaNewDefault",
+               "Unable to allocate memory to index default %s", alias);
+        return status;
+    }
+
     return XIA_SUCCESS;
 }
 
@@ -381,6 +435,24 @@ HANDEL_SHARED int HANDEL_API xiaGetDefaultItem(const char *alias,
  *
  *****************************************************************************/
 HANDEL_SHARED int HANDEL_API xiaRemoveDefault(const char *alias)
+{
+    int status;
+
+    xiaLog(XIA_LOG_DEBUG, "xiaRemoveDefault",
+           "Preparing to remove default w/ alias %s", alias);
+
+    xiaDefaultsLockTake();
+    status = xiaRemoveDefaultEntry(alias);
+    xiaDefaultsLockGive();
+
+    return status;
+}
+
+/*
+ * Remove the XiaDefaults entry from the LL and index. The defaults lock
+ * is held.
+ */
+static int xiaRemoveDefaultEntry(const char *alias)
 {
     int status = XIA_SUCCESS;
 
@@ -389,9 +461,6 @@ HANDEL_SHARED int HANDEL_API xiaRemoveDefault(const char *alias)
     XiaDefaults *next    = NULL;
     XiaDaqEntry *entry   = NULL;
 
-    xiaLog(XIA_LOG_DEBUG, "xiaRemoveDefault",
-           "Preparing to remove default w/ alias %s", alias);
-
     if (isListEmpty(xiaDefaultsHead))
     {
         status = XIA_NO_ALIAS;
@@ -439,6 +508,7 @@ HANDEL_SHARED int HANDEL_API xiaRemoveDefault(const char *alias)
     /* Free up the memory associated with this element */
     if (current->alias != NULL)
     {
+        xia_map_remove(&xiaDefaultsMap, current->alias);
         handel_md_free(current->alias);
     }
 
@@ -472,11 +542,15 @@ HANDEL_SHARED int HANDEL_API xiaRemoveDefault(const char *alias)
  *****************************************************************************/
 HANDEL_SHARED int HANDEL_API xiaRemoveAllDefaults(void)
 {
+    xiaDefaultsLockTake();
+
     while (xiaDefaultsHead != NULL)
     {
         xiaRemoveDefault(xiaDefaultsHead->alias);
     }
 
+    xiaDefaultsLockGive();
+
     return XIA_SUCCESS;
 }
 
@@ -489,22 +563,13 @@ HANDEL_SHARED int HANDEL_API xiaRemoveAllDefaults(void)
  *****************************************************************************/
 HANDEL_SHARED XiaDefaults* HANDEL_API xiaFindDefault(const char *alias)
 {
-    XiaDefaults *current = NULL;
+    XiaDefaults *current;
 
-    /* First check if this alias exists already? */
-    current = xiaDefaultsHead;
-    while (current != NULL)
-    {
-        /* If the alias matches, return a pointer to the detector */
-        if (STREQ(alias, current->alias))
-        {
-            return current;
-        }
-        /* Move to the next element */
-        current = current->next;
-    }
+    xiaDefaultsLockTake();
+    current = (XiaDefaults *) xia_map_get(&xiaDefaultsMap, alias);
+    xiaDefaultsLockGive();
 
-    return NULL;
+    return current;
 }
 
 
@@ -552,7 +617,10 @@ HANDEL_SHARED double HANDEL_API xiaGetValueFromDefaults(const char *name,
  *****************************************************************************/
 HANDEL_SHARED int HANDEL_API xiaInitXiaDefaultsDS(void)
 {
+    xiaDefaultsLockTake();
     xiaDefaultsHead = NULL;
+    xia_map_clear(&xiaDefaultsMap);
+    xiaDefaultsLockGive();
     return XIA_SUCCESS;
 }
 
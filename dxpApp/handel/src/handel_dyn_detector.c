@@ -49,12 +49,19 @@
 #include "handel_errors.h"
 #include "handel_log.h"
 
+#include "xia_map.h"
+
 
 /*
  * Define the head of the Detector list
  */
 static Detector *xiaDetectorHead = NULL;
 
+/*
+ * The Detector list indexed by alias
+ */
+static xia_map_t xiaDetectorMap = XIA_MAP_INITIALIZER;
+
 /*
  * Static functions.
  */
@@ -164,6 +171,14 @@ HANDEL_EXPORT int HANDEL_API xiaNewDetector(const char *alias)
     current->pslData   = NULL;
     current->next      = NULL;
 
+    if (xia_map_put(&xiaDetectorMap, current->alias, current) != 0)
+    {
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaNewDetector",
+               "Unable to allocate memory to index detector %s", alias);
+        return status;
+    }
+
     return XIA_SUCCESS;
 }
 
@@ -1239,6 +1254,7 @@ HANDEL_STATIC int HANDEL_API xiaDeleteDetector(Detector* detector)
 
     if (current->alias != NULL)
     {
+        xia_map_remove(&xiaDetectorMap, current->alias);
         handel_md_free(current->alias);
     }
     if (current->polarity != NULL)
@@ -1313,8 +1329,6 @@ HANDEL_SHARED Detector* HANDEL_API xiaFindDetector(const char *alias)
 
     char strtemp[MAXALIAS_LEN];
 
-    Detector *current = NULL;
-
     /* Turn the alias into lower case version, and terminate with a null
      * char */
     for (i = 0; i < (int)strlen(alias); i++)
@@ -1323,19 +1337,7 @@ HANDEL_SHARED Detector* HANDEL_API xiaFindDetector(const char *alias)
     }
     strtemp[strlen(alias)] = '\0';
 
-    /* First check if this alias exists already? */
-    current = xiaDetectorHead;
-    while (current != NULL)
-    {
-        if (STREQ(strtemp, current->alias))
-        {
-            return current;
-        }
-
-        current = current->next;
-    }
-
-    return NULL;
+    return (Detector *) xia_map_get(&xiaDetectorMap, strtemp);
 }
 
 
@@ -1347,6 +1349,7 @@ HANDEL_SHARED Detector* HANDEL_API xiaFindDetector(const char *alias)
 HANDEL_SHARED int HANDEL_API xiaInitDetectorDS(void)
 {
     xiaDetectorHead = NULL;
+    xia_map_clear(&xiaDetectorMap);
     return XIA_SUCCESS;
 }
 
@@ -52,11 +52,18 @@
 #include "handel_errors.h"
 #include "handel_log.h"
 
+#include "xia_map.h"
+
 /*
  * Define the head of the Modules LL
  */
 static Module *xiaModuleHead = NULL;
 
+/*
+ * The Modules LL indexed by alias
+ */
+static xia_map_t xiaModuleMap = XIA_MAP_INITIALIZER;
+
 
 static const char *MODULE_NULL_STRING = "null";
 #define MODULE_NULL_STRING_LEN  (strlen(MODULE_NULL_STRING) + 1)
@@ -146,6 +153,9 @@ static const char *subInterfaceStr[] = {
     "inet_address",
     "inet_port",
     "inet_timeout",
+    "inet_receive_threads",
+    "inet_receive_buffer",
+    "inet_capture",
 };
 
 
@@ -160,6 +170,9 @@ static ModItem_t items[] = {
     {"inet_address",       _addInterface,  TRUE_},
     {"inet_port",          _addInterface,  TRUE_},
     {"inet_timeout",       _addInterface,  TRUE_},
+    {"inet_receive_threads", _addInterface, TRUE_},
+    {"inet_receive_buffer",  _addInterface, TRUE_},
+    {"inet_capture",         _addInterface, TRUE_},
 };
 
 #define NUM_ITEMS (sizeof(items) / sizeof(items[0]))
@@ -270,6 +283,13 @@ HANDEL_EXPORT int HANDEL_API xiaNewModule(const char *alias)
         return status;
     }
 
+    if (xia_map_put(&xiaModuleMap, current->alias, current) != 0) {
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaNewModule",
+               "Unable to allocate memory to index module %s", alias);
+        return status;
+    }
+
     return XIA_SUCCESS;
 }
 
@@ -413,8 +433,6 @@ HANDEL_SHARED Module* HANDEL_API xiaFindModule(const char *alias)
 
     char strtemp[MAXALIAS_LEN];
 
-    Module *current = NULL;
-
     ASSERT(alias != NULL);
     ASSERT(strlen(alias) < (MAXALIAS_LEN - 1));
 
@@ -425,20 +443,7 @@ HANDEL_SHARED Module* HANDEL_API xiaFindModule(const char *alias)
     }
     strtemp[strlen(alias)] = '\0';
 
-    /* Walk through the linked-list until we find it or we run out of elements */
-    current = xiaGetModuleHead();
-
-    while (current != NULL)
-    {
-        if (STREQ(strtemp, current->alias))
-        {
-            return current;
-        }
-
-        current = current->next;
-    }
-
-    return NULL;
+    return (Module *) xia_map_get(&xiaModuleMap, strtemp);
 }
 
 
@@ -478,6 +483,9 @@ HANDEL_STATIC int HANDEL_API xiaProcessInterface(Module *chosen,
     if (STREQ(name, "inet_address") ||
         STREQ(name, "inet_port")    ||
         STREQ(name, "inet_timeout") ||
+        STREQ(name, "inet_receive_threads") ||
+        STREQ(name, "inet_receive_buffer") ||
+        STREQ(name, "inet_capture") ||
         STREQ(interface_, "inet")) {
         /* Check that this module is really a INET */
         if ((chosen->interface_->type != INET)  &&
@@ -503,6 +511,9 @@ HANDEL_STATIC int HANDEL_API xiaProcessInterface(Module *chosen,
             chosen->interface_->info.inet->address = NULL;
             chosen->interface_->info.inet->port    = 0;
             chosen->interface_->info.inet->timeout = 0;
+            chosen->interface_->info.inet->receive_threads = 0;
+            chosen->interface_->info.inet->receive_buffer = 0;
+            chosen->interface_->info.inet->capture = NULL;
         }
 
         if (STREQ(name, "inet_address")) {
@@ -524,6 +535,25 @@ HANDEL_STATIC int HANDEL_API xiaProcessInterface(Module *chosen,
         else if (STREQ(name, "inet_timeout")) {
             chosen->interface_->info.inet->timeout = *((unsigned int*) value);
         }
+        else if (STREQ(name, "inet_receive_threads")) {
+            chosen->interface_->info.inet->receive_threads = *((unsigned int*) value);
+        }
+        else if (STREQ(name, "inet_receive_buffer")) {
+            chosen->interface_->info.inet->receive_buffer = *((unsigned int*) value);
+        }
+        else if (STREQ(name, "inet_capture")) {
+            char* capture = (char *) handel_md_alloc(strlen(value) + 1);
+            if (capture == NULL) {
+                status = XIA_NOMEM;
+                xiaLog(XIA_LOG_ERROR, status, "xiaProcessInterface",
+                       "Unable to allocate memory for INET capture");
+                return status;
+            }
+            strcpy(capture, (char*) value);
+            if (chosen->interface_->info.inet->capture != NULL)
+                handel_md_free(chosen->interface_->info.inet->capture);
+            chosen->interface_->info.inet->capture = capture;
+        }
     }
     else {
         status = XIA_MISSING_INTERFACE;
@@ -1263,6 +1293,15 @@ HANDEL_STATIC int xiaGetIFaceInfo(Module *chosen, const char *name, void *value)
                 *((unsigned int *)value) = chosen->interface_->info.inet->port;
             } else if (STREQ(name, "inet_timeout")) {
                 *((unsigned int *)value) = chosen->interface_->info.inet->timeout;
+            } else if (STREQ(name, "inet_receive_threads")) {
+                *((unsigned int *)value) = chosen->interface_->info.inet->receive_threads;
+            } else if (STREQ(name, "inet_receive_buffer")) {
+                *((unsigned int *)value) = chosen->interface_->info.inet->receive_buffer;
+            } else if (STREQ(name, "inet_capture")) {
+                if (chosen->interface_->info.inet->capture != NULL)
+                    strcpy((char*) value, chosen->interface_->info.inet->capture);
+                else
+                    *((char*) value) = '\0';
             } else {
                 status = XIA_BAD_NAME;
                 xiaLog(XIA_LOG_ERROR, status, "xiaGetIFaceInfo",
@@ -1732,6 +1771,9 @@ HANDEL_EXPORT int HANDEL_API xiaRemoveModule(const char *alias)
             if (current->interface_->info.inet->address != NULL) {
                 handel_md_free((void*) current->interface_->info.inet->address);
             }
+            if (current->interface_->info.inet->capture != NULL) {
+                handel_md_free((void*) current->interface_->info.inet->capture);
+            }
             handel_md_free(current->interface_->info.inet);
         }
         handel_md_free(current->interface_);
@@ -1752,6 +1794,7 @@ HANDEL_EXPORT int HANDEL_API xiaRemoveModule(const char *alias)
         prev->next = current->next;
     }
 
+    xia_map_remove(&xiaModuleMap, current->alias);
     handel_md_free(current->alias);
     current->alias = NULL;
 
@@ -3212,5 +3255,6 @@ HANDEL_SHARED Module * HANDEL_API xiaGetModuleHead(void)
 HANDEL_SHARED int HANDEL_API xiaInitModuleDS(void)
 {
     xiaModuleHead = NULL;
+    xia_map_clear(&xiaModuleMap);
     return XIA_SUCCESS;
 }
@@ -66,6 +66,31 @@ PRAGMA_POP
 
 /** Structures **/
 
+/* A non-blank line of an .ini file. For "name = value" lines the name
+ * and value are trimmed and terminated in place; name is NULL for
+ * section headings, START/END markers and anything else without an
+ * '='. Comment lines starting with '*' are named "COMMENT".
+ */
+typedef struct
+{
+    char *line;
+    const char *name;
+    char *value;
+    size_t valueLen;
+} IniLine;
+
+/* An .ini file read into memory and tokenised in a single pass by
+ * xiaIndexIniFile(). The loaders address it by line index, replacing
+ * the repeated fpos_t seeking and line re-reading through the FILE.
+ */
+typedef struct
+{
+    char filename[MAXFILENAME_LEN];
+    char *text;
+    IniLine *lines;
+    int numLines;
+} IniFile;
+
 /* This structure exists so that we can re-use the
  * section of the code that parses in the sections
  * of the ini files
@@ -73,7 +98,7 @@ PRAGMA_POP
 typedef struct
 {
     /* Pointer to the proper xiaLoadRoutine */
-    int (*function_ptr)(FILE *, fpos_t *, fpos_t *);
+    int (*function_ptr)(IniFile *, int, int);
 
     /* Section heading name: the part in brackets */
     const char *section;
@@ -84,28 +109,36 @@ typedef struct
 
 
 /** Prototypes **/
-HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename);
-
-HANDEL_STATIC int HANDEL_API xiaFindEntryStart(FILE *fp, const char *section, fpos_t *start);
-HANDEL_STATIC int HANDEL_API xiaFindEntryLimits(FILE *fp, const char *section,
-                        fpos_t *start, fpos_t *end);
+HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename,
+                                             boolean_t sidecar);
+HANDEL_STATIC int xiaWriteChanDataSidecar(FILE *iniFile, const char *filename,
+                                          Module *module);
+HANDEL_STATIC int xiaReadChanDataSidecar(IniFile *ini, const char *alias,
+                                         unsigned int ch, const char *value);
+
+HANDEL_STATIC int xiaIndexIniFile(FILE *fp, const char *filename, IniFile *ini);
+HANDEL_STATIC void xiaFreeIniFile(IniFile *ini);
+HANDEL_STATIC void xiaSplitIniLine(IniLine *line, char *eol);
+HANDEL_STATIC int xiaIniFindSection(IniFile *ini, const char *section,
+                                    int *start, int *end);
+HANDEL_STATIC int xiaIniFindLine(IniFile *ini, int start, int end,
+                                 const char *name, int *line);
+HANDEL_STATIC int xiaIniRA(IniFile *ini, int start, int end,
+                           const char *name, char *value);
 HANDEL_STATIC int HANDEL_API xiaGetLine_N(FILE *fp, char *lline, int len);
 HANDEL_STATIC int HANDEL_API xiaGetLine(FILE *fp, char *line);
 HANDEL_STATIC int HANDEL_API xiaGetLineData(const char *line,
                                             char *name, char *value);
-HANDEL_STATIC int HANDEL_API xiaSetPosOnNext(FILE *fp, fpos_t *start, fpos_t *end,
-                                             const char *name, fpos_t *newPos,
-                                             boolean_t after);
 HANDEL_SHARED int HANDEL_API xiaCopyFile(const char *src, const char *dest);
 
-HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end);
-HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end);
-HANDEL_STATIC int xiaLoadModChanData(FILE *fp, fpos_t *start, fpos_t *end);
-HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end);
-HANDEL_STATIC int xiaLoadDefaults(FILE *fp, fpos_t *start, fpos_t *end);
+HANDEL_STATIC int xiaLoadDetector(IniFile *ini, int start, int end);
+HANDEL_STATIC int xiaLoadModule(IniFile *ini, int start, int end);
+HANDEL_STATIC int xiaLoadModChanData(IniFile *ini, int start, int end);
+HANDEL_STATIC int xiaLoadFirmware(IniFile *ini, int start, int end);
+HANDEL_STATIC int xiaLoadDefaults(IniFile *ini, int start, int end);
 
-HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start, fpos_t *end, char *alias);
-HANDEL_STATIC int HANDEL_API xiaReadChanData(FILE *fp);
+HANDEL_STATIC int HANDEL_API xiaReadPTRRs(IniFile *ini, int start, int end, char *alias);
+HANDEL_STATIC int HANDEL_API xiaReadChanData(IniFile *ini, int start, int end);
 
 static int writeInterface(FILE *fp, Module *m);
 
@@ -194,7 +227,10 @@ HANDEL_EXPORT int HANDEL_API xiaLoadSystem(const char *type, const char *filenam
 /*****************************************************************************
  *
  * This routine saves the configuration to the file filename and of type type.
- * Currently, the only supported types are "handel_ini".
+ * Currently, the only supported types are "handel_ini" and
+ * "handel_ini_sidecar". The latter writes the module channel data to a
+ * compressed binary file per module next to the .ini file rather than
+ * base64 encoding it in the .ini file.
  *
  *****************************************************************************/
 HANDEL_EXPORT int HANDEL_API xiaSaveSystem(const char *type, const char *filename)
@@ -204,7 +240,11 @@ HANDEL_EXPORT int HANDEL_API xiaSaveSystem(const char *type, const char *filenam
 
     if (STREQ(type, "handel_ini")) {
 
-        status = xiaWriteIniFile(filename);
+        status = xiaWriteIniFile(filename, FALSE_);
+
+    } else if (STREQ(type, "handel_ini_sidecar")) {
+
+        status = xiaWriteIniFile(filename, TRUE_);
 
     } else {
 
@@ -228,7 +268,8 @@ HANDEL_EXPORT int HANDEL_API xiaSaveSystem(const char *type, const char *filenam
  * information in the data structures.
  *
  *****************************************************************************/
-HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename)
+HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename,
+                                             boolean_t sidecar)
 {
     int status;
     int i;
@@ -538,8 +579,9 @@ HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename)
 
         if (module && module->psl->iniWrite)
         {
+            /* The PSL is told if the channel data goes to a sidecar. */
             status = module->psl->iniWrite(iniFile, "module", path,
-                                           NULL, i, module);
+                                           &sidecar, i, module);
 
             if (status != XIA_SUCCESS)
             {
@@ -575,6 +617,22 @@ HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename)
     {
         fprintf(iniFile, "START %s\n", module->alias);
 
+        if (sidecar)
+        {
+            status = xiaWriteChanDataSidecar(iniFile, filename, module);
+
+            if (status != XIA_SUCCESS)
+            {
+                if (path)
+                    handel_md_free(path);
+                xia_file_close(iniFile);
+                return status;
+            }
+
+            fprintf(iniFile, "END %s\n", module->alias);
+            continue;
+        }
+
         for (j = 0; j < module->number_of_channels; j++)
         {
             /*
@@ -674,6 +732,123 @@ HANDEL_STATIC int HANDEL_API xiaWriteIniFile(const char *filename)
     return XIA_SUCCESS;
 }
 
+/*
+ * Writes the module's channel data to the sidecar file <filename>.<alias>.dat
+ * and a data_chanN_file line for each channel to the .ini file. The value
+ * is the offset, compressed length and length of the channel's data
+ * followed by the sidecar's name relative to the .ini file.
+ */
+HANDEL_STATIC int xiaWriteChanDataSidecar(FILE *iniFile, const char *filename,
+                                          Module *module)
+{
+    int status;
+    unsigned int j;
+
+    FILE *dataFile = NULL;
+    char dataFilename[MAX_PATH_LEN];
+    char tmpFilename[MAX_PATH_LEN];
+    const char *dataName;
+
+    long offset = 0;
+
+    int len = snprintf(dataFilename, sizeof(dataFilename), "%s.%s.dat",
+                       filename, module->alias);
+
+    if (len < 0 || len >= (int) sizeof(dataFilename)) {
+        status = XIA_BAD_NAME;
+        xiaLog(XIA_LOG_ERROR, status, "xiaWriteChanDataSidecar",
+               "Channel data file name too long for %s", module->alias);
+        return status;
+    }
+
+    len = snprintf(tmpFilename, sizeof(tmpFilename), "%s.tmp", dataFilename);
+
+    if (len < 0 || len >= (int) sizeof(tmpFilename)) {
+        status = XIA_BAD_NAME;
+        xiaLog(XIA_LOG_ERROR, status, "xiaWriteChanDataSidecar",
+               "Channel data temporary file name too long for %s", module->alias);
+        return status;
+    }
+
+    dataName = dataFilename + strlen(dataFilename);
+    while (dataName != dataFilename &&
+           dataName[-1] != HANDLE_PATHNAME_SEP && dataName[-1] != '/')
+        --dataName;
+
+    dataFile = xia_file_open(tmpFilename, "wb");
+    if (dataFile == NULL) {
+        status = XIA_OPEN_FILE;
+        xiaLog(XIA_LOG_ERROR, status, "xiaWriteChanDataSidecar",
+               "Could not open %s", tmpFilename);
+        return status;
+    }
+
+    for (j = 0; j < module->number_of_channels; j++) {
+        uLong dataCmpSize;
+        byte_t *dataCmp;
+        int cmpStatus;
+
+        if (module->ch[j].data.length == 0)
+            continue;
+
+        dataCmpSize = compressBound((uLong) module->ch[j].data.length);
+
+        dataCmp = handel_md_alloc(dataCmpSize);
+        if (!dataCmp) {
+            xia_file_close(dataFile);
+            remove(tmpFilename);
+            return XIA_NOMEM;
+        }
+
+        cmpStatus = compress(dataCmp, &dataCmpSize, module->ch[j].data.data,
+                             (uLong) module->ch[j].data.length);
+        if (cmpStatus != Z_OK) {
+            handel_md_free(dataCmp);
+            xia_file_close(dataFile);
+            remove(tmpFilename);
+            xiaLog(XIA_LOG_ERROR, XIA_ENCODE, "xiaWriteChanDataSidecar",
+                   "Compressing %s data_chan%u: %d",
+                   module->alias, j, cmpStatus);
+            return XIA_ENCODE;
+        }
+
+        if (fwrite(dataCmp, 1, dataCmpSize, dataFile) != dataCmpSize) {
+            handel_md_free(dataCmp);
+            xia_file_close(dataFile);
+            remove(tmpFilename);
+            status = XIA_BAD_FILE_WRITE;
+            xiaLog(XIA_LOG_ERROR, status, "xiaWriteChanDataSidecar",
+                   "Writing %s: (%d) %s", tmpFilename, errno, strerror(errno));
+            return status;
+        }
+
+        handel_md_free(dataCmp);
+
+        fprintf(iniFile, "data_chan%u_file = %ld,%lu,%lu,%s\n", j, offset,
+                (unsigned long) dataCmpSize,
+                (unsigned long) module->ch[j].data.length, dataName);
+
+        offset += (long) dataCmpSize;
+    }
+
+    xia_file_close(dataFile);
+
+    /*
+     * Binary data cannot go through xiaCopyFile, which writes in text
+     * mode.
+     */
+    remove(dataFilename);
+    if (rename(tmpFilename, dataFilename) != 0) {
+        status = XIA_BAD_FILE_WRITE;
+        xiaLog(XIA_LOG_ERROR, status, "xiaWriteChanDataSidecar",
+               "Failed to rename %s to %s: (%d) %s", tmpFilename,
+               dataFilename, errno, strerror(errno));
+        return status;
+    }
+
+    return XIA_SUCCESS;
+}
+
 HANDEL_SHARED int HANDEL_API xiaCopyFile(const char *src, const char *dest)
 {
     int status;
@@ -777,19 +952,18 @@ HANDEL_SHARED int HANDEL_API xiaReadIniFile(const char *inifile)
     int status = XIA_SUCCESS;
     int numSections;
     int i;
+    int line;
+    int start;
+    int end;
+    int blockStart;
     /*
      * Pointers to keep track of the xia.ini file
      */
     FILE *fp = NULL;
 
-    char newFile[MAXFILENAME_LEN];
-    char tmpLine[XIA_LINE_LEN];
-    char line[XIA_LINE_LEN];
+    IniFile ini;
 
-    fpos_t start;
-    fpos_t end;
-    fpos_t local;
-    fpos_t local_end;
+    char newFile[MAXFILENAME_LEN];
 
     char xiaini[8] = "xia.ini";
 
@@ -811,28 +985,39 @@ HANDEL_SHARED int HANDEL_API xiaReadIniFile(const char *inifile)
         return status;
     }
 
-    /* Loop over all the sections as defined in sectionInfo */
-    /* XXX BUG: Should be sectionInfo / sectionInfo[0]?
+    /* The whole file is read and tokenised once. The sections are then
+     * loaded from the in-memory index rather than by seeking through the
+     * file for each section and START/END block.
      */
+    status = xiaIndexIniFile(fp, newFile, &ini);
+
+    xia_file_close(fp);
+
+    if (status != XIA_SUCCESS) {
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
+               "Error reading %s", newFile);
+        return status;
+    }
+
+    /* Loop over all the sections as defined in sectionInfo */
     numSections = (int) (sizeof(sectionInfo) / sizeof(SectionInfo));
 
     for (i = 0; i < numSections; i++)
     {
-        if (!sectionInfo[i].multiSection) {
-            fpos_t unknownEnd;
+        status = xiaIniFindSection(&ini, sectionInfo[i].section, &start, &end);
 
-            status = xiaFindEntryStart(fp, sectionInfo[i].section, &start);
-
-            if (status != XIA_SUCCESS) {
-                xiaLog(XIA_LOG_WARNING, "xiaReadIniFile",
-                       "Section missing from ini file: %s", sectionInfo[i].section);
-                continue;
-            }
+        if (status != XIA_SUCCESS)
+        {
+            xiaLog(XIA_LOG_WARNING, "xiaReadIniFile",
+                   "Section missing from ini file: %s", sectionInfo[i].section);
+            continue;
+        }
 
-            status = sectionInfo[i].function_ptr(fp, &local, &unknownEnd);
+        if (!sectionInfo[i].multiSection) {
+            status = sectionInfo[i].function_ptr(&ini, start, end);
 
             if (status != XIA_SUCCESS) {
-                xia_file_close(fp);
+                xiaFreeIniFile(&ini);
                 xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
                        "Error loading \"%s\" section from ini file", sectionInfo[i].section);
                 return status;
@@ -841,120 +1026,46 @@ HANDEL_SHARED int HANDEL_API xiaReadIniFile(const char *inifile)
             continue;
         }
 
-        status = xiaFindEntryLimits(fp, sectionInfo[i].section, &start, &end);
-
-        if (status != XIA_SUCCESS)
-        {
-            xiaLog(XIA_LOG_WARNING, "xiaReadIniFile",
-                   "Section missing from ini file: %s", sectionInfo[i].section);
-            continue;
-        }
-
-        /* Here is the psuedocode for parsing in a section w/ multiple headings
-         *
-         * 1) Set local to line with START on it (this is a one shot thing)
-         * 2) Cache line pointed to by "end" (this is because we can't do direct
-         *    arithmetic comparisons with fpos_t structs). Also, actually do a
-         *    comparison between local's "line" and the end's "line". If they
-         *    match then we've reached the end of the section and are finished.
-         *    N.b.: I pray to god that a situation never somes up that would
-         *    break this comparison. In principle it shouldn't happen since
-         *    end's "line" is either EOF or a section heading.
-         * 3) Increment local until we run into END
-         * 4) Set local_end
-         * 5) xiaLoadxxxxx(local, local_end);
-         * 6) Set current to local_end and jump to step (2)
+        /* Each START/END block in the section is passed to the loader
+         * without the START and END lines themselves.
          */
-
-        status = fsetpos(fp, &end);
-
-        if (status != 0) {
-            xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                   "Error setting file position to the end of the current section."
-                   " errno = %d, '%s'.", (int)errno, strerror(errno));
-            return XIA_SET_POS;
-        }
-
-        status = xiaGetLine(fp, tmpLine);
-
-        if (status != XIA_SUCCESS && status != XIA_EOF) {
-            xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                   "Error getting end of section line after setting the file position.");
-            return status;
-        }
-
-        ASSERT(tmpLine[0] == '[');
-
-        xiaLog(XIA_LOG_DEBUG, "xiaReadIniFile",
-               "Cached end string = %s", tmpLine);
-
-        status = fsetpos(fp, &start);
-
-        if (status != 0) {
-            xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                   "Error setting file position to the end of the current section."
-                   " errno = %d, '%s'.", (int)errno, strerror(errno));
-            return XIA_SET_POS;
-        }
-
-        status = xiaGetLine(fp, line);
-
-        if (status != XIA_SUCCESS && status != XIA_EOF) {
-            xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                   "Error getting start of section line after setting the file position.");
-            return status;
-        }
-
-        while(!STREQ(line, tmpLine))
+        for (line = start; line < end; line++)
         {
-            status = fgetpos(fp, &local);
-
-            if (STRNEQ(line, "START"))
-            {
-                int count = 0;
-
-                do
-                {
-                    status = fgetpos(fp, &local_end);
-
-                    status = xiaGetLine(fp, line);
-
-                    xiaLog(XIA_LOG_DEBUG, "xiaReadIniFile",
-                           "Inside START/END bracket: %s", line);
-
-                    if (++count > 500) {
-                        xia_file_close(fp);
-                        status = XIA_FILE_RA;
-                        xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                               "Error loading information from ini file, no END found");
-                        return status;
-                    }
+            xiaLog(XIA_LOG_DEBUG, "xiaReadIniFile",
+                   "Looking for START: %s", ini.lines[line].line);
 
-                } while (!STRNEQ(line, "END"));
+            if (!STRNEQ(ini.lines[line].line, "START")) {
+                continue;
+            }
 
-                status = sectionInfo[i].function_ptr(fp, &local, &local_end);
+            blockStart = line + 1;
 
-                if (status != XIA_SUCCESS) {
-                    xia_file_close(fp);
-                    xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
-                           "Error loading information from ini file");
-                    return status;
+            for (line = blockStart; line < end; line++) {
+                if (STRNEQ(ini.lines[line].line, "END")) {
+                    break;
                 }
             }
 
-            status = xiaGetLine(fp, line);
-
-            if (status == XIA_EOF)
-            {
-                break;
+            if (line == end) {
+                xiaFreeIniFile(&ini);
+                status = XIA_FILE_RA;
+                xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
+                       "Error loading information from ini file, no END found");
+                return status;
             }
 
-            xiaLog(XIA_LOG_DEBUG, "xiaReadIniFile",
-                   "Looking for START: %s", line);
+            status = sectionInfo[i].function_ptr(&ini, blockStart, line);
+
+            if (status != XIA_SUCCESS) {
+                xiaFreeIniFile(&ini);
+                xiaLog(XIA_LOG_ERROR, status, "xiaReadIniFile",
+                       "Error loading information from ini file");
+                return status;
+            }
         }
     }
 
-    xia_file_close(fp);
+    xiaFreeIniFile(&ini);
 
     return XIA_SUCCESS;
 }
@@ -1239,124 +1350,339 @@ HANDEL_STATIC int HANDEL_API xiaGetLine_N(FILE *fp, char *lline, int llen)
 }
 
 /*
- * Searches thru the .ini file and finds the start of a specific
- * section starting at [section]. The fp is left on the first line
- * after the section tag.
+ * Reads the whole .ini file into memory and tokenises it into an index
+ * of its non-blank lines. The line terminators are removed and "name =
+ * value" pairs are split in place, so the index points into the text
+ * buffer. Free with xiaFreeIniFile().
  */
-HANDEL_STATIC int HANDEL_API xiaFindEntryStart(FILE *fp, const char *section, fpos_t *start)
+HANDEL_STATIC int xiaIndexIniFile(FILE *fp, const char *filename, IniFile *ini)
 {
-    int status = XIA_SUCCESS;
-    unsigned int j;
+    int status;
+    int maxLines;
 
-    boolean_t isStartFound = FALSE_;
+    size_t size;
+    size_t i;
 
-    char *cstatus;
+    struct stat sb;
 
-    char line[XIA_LINE_LEN];
+    char *p;
+    char *eol;
+    char *next;
+    char *textEnd;
 
-    /* First rewind the file to the beginning */
-    rewind(fp);
 
-    /* Now find the match to the section entry */
-    do {
-        do {
-            cstatus = handel_md_fgets(line, XIA_LINE_LEN, fp);
+    ASSERT(fp);
+    ASSERT(ini);
 
-        } while ((line[0]!='[') &&
-                 (cstatus!=NULL));
+    ini->text = NULL;
+    ini->lines = NULL;
+    ini->numLines = 0;
 
-        if (cstatus == NULL)
-        {
-            status = XIA_NOSECTION;
-            /* This isn't an error since the user has the option of specifying
-             * the missing information using the dynamic configuration
-             * routines.
-             */
-            xiaLog(XIA_LOG_WARNING, "xiaFindEntryLimits",
-                   "Unable to find section %s", section);
-            return status;
+    strncpy(ini->filename, filename, sizeof(ini->filename) - 1);
+    ini->filename[sizeof(ini->filename) - 1] = '\0';
+
+    if (stat(filename, &sb) < 0) {
+        status = XIA_NOT_FOUND;
+        xiaLog(XIA_LOG_ERROR, status, "xiaIndexIniFile",
+               "Could not stat: %s", filename);
+        return status;
+    }
+
+    ini->text = handel_md_alloc((size_t) sb.st_size + 1);
+
+    if (ini->text == NULL) {
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaIndexIniFile",
+               "No memory to read %s: %d bytes", filename, (int) sb.st_size);
+        return status;
+    }
+
+    size = fread(ini->text, 1, (size_t) sb.st_size, fp);
+
+    if (ferror(fp)) {
+        xiaFreeIniFile(ini);
+        status = XIA_BAD_FILE_READ;
+        xiaLog(XIA_LOG_ERROR, status, "xiaIndexIniFile",
+               "Could not read: %s", filename);
+        return status;
+    }
+
+    ini->text[size] = '\0';
+    textEnd = ini->text + size;
+
+    /* Size the index for the worst case of every line having text. */
+    maxLines = 1;
+
+    for (i = 0; i < size; i++) {
+        if (ini->text[i] == '\n') {
+            maxLines++;
         }
+    }
 
-        /* Find the terminating ] to this section */
-        for (j = 1; j < (strlen(line) + 1); j++)
-        {
-            if (line[j]==']')
-            {
+    ini->lines = handel_md_alloc(sizeof(IniLine) * (size_t) maxLines);
+
+    if (ini->lines == NULL) {
+        xiaFreeIniFile(ini);
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaIndexIniFile",
+               "No memory for the index of %d lines in %s", maxLines, filename);
+        return status;
+    }
+
+    for (p = ini->text; p < textEnd; p = next) {
+        eol = memchr(p, '\n', (size_t) (textEnd - p));
+
+        if (eol == NULL) {
+            eol = textEnd;
+            next = textEnd;
+        } else {
+            next = eol + 1;
+            *eol = '\0';
+        }
+
+        if (eol > p && eol[-1] == '\r') {
+            eol--;
+            *eol = '\0';
+        }
+
+        /* Only keep lines with some visible text, like xiaGetLine(). */
+        for (i = 0; p + i < eol; i++) {
+            if (isgraph(CTYPE_CHAR(p[i]))) {
                 break;
             }
         }
-        /* Did we not find the terminating ]? */
-        if (j == (unsigned int)strlen(line))
-        {
+
+        if (p + i == eol) {
+            continue;
+        }
+
+        ini->lines[ini->numLines].line = p;
+        xiaSplitIniLine(&ini->lines[ini->numLines], eol);
+        ini->numLines++;
+    }
+
+    xiaLog(XIA_LOG_DEBUG, "xiaIndexIniFile",
+           "Indexed %d lines from %s", ini->numLines, filename);
+
+    return XIA_SUCCESS;
+}
+
+
+HANDEL_STATIC void xiaFreeIniFile(IniFile *ini)
+{
+    if (ini->lines != NULL) {
+        handel_md_free(ini->lines);
+        ini->lines = NULL;
+    }
+
+    if (ini->text != NULL) {
+        handel_md_free(ini->text);
+        ini->text = NULL;
+    }
+
+    ini->numLines = 0;
+}
+
+
+/*
+ * Splits a "name = value" line in place using the same trimming rules as
+ * xiaGetLineData(). Lines that do not parse are left whole with a NULL
+ * name so the error is reported by whichever loader reaches them.
+ */
+HANDEL_STATIC void xiaSplitIniLine(IniLine *line, char *eol)
+{
+    char *eq;
+    char *nameBegin;
+    char *nameEnd;
+    char *valueBegin;
+    char *valueEnd;
+
+
+    line->name = NULL;
+    line->value = NULL;
+    line->valueLen = 0;
+
+    if (line->line[0] == '*') {
+        line->name = "COMMENT";
+        line->value = line->line;
+        line->valueLen = (size_t) (eol - line->line);
+        return;
+    }
+
+    if (line->line[0] == '[') {
+        return;
+    }
+
+    eq = strchr(line->line, '=');
+
+    if (eq == NULL || eq == line->line) {
+        return;
+    }
+
+    nameBegin = line->line;
+    while (nameBegin < eq && isspace(CTYPE_CHAR(*nameBegin))) {
+        nameBegin++;
+    }
+
+    nameEnd = eq;
+    while (nameEnd > nameBegin && isspace(CTYPE_CHAR(nameEnd[-1]))) {
+        nameEnd--;
+    }
+
+    valueBegin = eq + 1;
+    while (valueBegin < eol && isspace(CTYPE_CHAR(*valueBegin))) {
+        valueBegin++;
+    }
+
+    valueEnd = eol;
+    while (valueEnd > valueBegin && isspace(CTYPE_CHAR(valueEnd[-1]))) {
+        valueEnd--;
+    }
+
+    if (nameEnd == nameBegin || valueEnd == valueBegin) {
+        return;
+    }
+
+    *nameEnd = '\0';
+    *valueEnd = '\0';
+
+    line->name = nameBegin;
+    line->value = valueBegin;
+    line->valueLen = (size_t) (valueEnd - valueBegin);
+}
+
+
+/*
+ * Finds the lines of a specific section starting at [section] and
+ * ending at the next [] or the end of the file. start is the first
+ * line after the section tag and end is one past the last line.
+ */
+HANDEL_STATIC int xiaIniFindSection(IniFile *ini, const char *section,
+                                    int *start, int *end)
+{
+    int status;
+    int i;
+
+    char *close;
+
+
+    for (i = 0; i < ini->numLines; i++) {
+        if (ini->lines[i].line[0] != '[') {
+            continue;
+        }
+
+        close = strchr(ini->lines[i].line, ']');
+
+        if (close == NULL) {
             status = XIA_FORMAT_ERROR;
-            xiaLog(XIA_LOG_ERROR, status, "xiaFindEntryLimits",
+            xiaLog(XIA_LOG_ERROR, status, "xiaIniFindSection",
                    "Syntax error in Init file, no terminating ] found");
             return status;
         }
 
-        if (strncmp(line + 1, section, j - 1) == 0)
-        {
-            /* Recorcd the starting position) */
-            fgetpos(fp, start);
+        if (strncmp(ini->lines[i].line + 1, section,
+                    (size_t) (close - ini->lines[i].line - 1)) == 0) {
+            break;
+        }
+    }
 
-            isStartFound = TRUE_;
+    if (i == ini->numLines) {
+        /* This isn't an error since the user has the option of specifying
+         * the missing information using the dynamic configuration
+         * routines.
+         */
+        xiaLog(XIA_LOG_WARNING, "xiaIniFindSection",
+               "Unable to find section %s", section);
+        return XIA_NOSECTION;
+    }
+
+    *start = i + 1;
+
+    for (i = *start; i < ini->numLines; i++) {
+        if (ini->lines[i].line[0] == '[') {
+            break;
         }
-        /* Else look for the next section entry */
-    } while (!isStartFound);
+    }
+
+    *end = i;
 
     return XIA_SUCCESS;
 }
 
+
 /*
- * Searches thru the .ini file and finds the start and end of a
- * specific section starting at [section] and ending at the
- * next [].
+ * Searches the lines from start up to end for name. If it is found,
+ * line is set to its index. If not, XIA_END is returned and line is set
+ * to end.
  */
-HANDEL_STATIC int HANDEL_API xiaFindEntryLimits(FILE *fp, const char *section,
-                                                fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaIniFindLine(IniFile *ini, int start, int end,
+                                 const char *name, int *line)
 {
-    int status = XIA_SUCCESS;
+    int status;
+    int i;
 
-    char *cstatus;
 
-    char line[XIA_LINE_LEN];
+    for (i = start; i < end; i++) {
+        if (ini->lines[i].name == NULL) {
+            status = XIA_FORMAT_ERROR;
+            xiaLog(XIA_LOG_ERROR, status, "xiaIniFindLine",
+                   "Error trying to find %s, no name = value in line: %.40s",
+                   name, ini->lines[i].line);
+            return status;
+        }
 
-    status = xiaFindEntryStart(fp, section, start);
-    if (status != XIA_SUCCESS) {
-        xiaLog(XIA_LOG_ERROR, status, "xiaFindEntryLimits",
-               "Finding \"%s\" section start.", section);
-        return status;
+        if (STREQ(ini->lines[i].name, name)) {
+            *line = i;
+            return XIA_SUCCESS;
+        }
     }
 
-    do
-    {
-        /* Get the current file position before the next read.  If the file
-         * ends or we find a '[' then we are done and want to sent the ending
-         * position to the location of the previous read
-         */
-        status = fgetpos(fp, end);
+    *line = end;
+
+    return XIA_END;
+}
+
+
+/*
+ * Copies the value of name from the lines between start and end into
+ * value, which must hold MAXITEM_LEN characters. Returns XIA_FILE_RA if
+ * name is not present. The index equivalent of xiaFileRA().
+ */
+HANDEL_STATIC int xiaIniRA(IniFile *ini, int start, int end,
+                           const char *name, char *value)
+{
+    int status;
+    int line;
+
+    size_t len;
+
 
-        cstatus = handel_md_fgets(line, XIA_LINE_LEN, fp);
+    status = xiaIniFindLine(ini, start, end, name, &line);
 
-    } while ((line[0] != '[') &&
-             (cstatus != NULL));
+    if (status == XIA_END) {
+        return XIA_FILE_RA;
+    }
 
-    if (!cstatus) {
-        ASSERT(feof(fp));
+    if (status != XIA_SUCCESS) {
+        return status;
     }
 
+    len = MIN(ini->lines[line].valueLen, MAXITEM_LEN - 1);
+    memcpy(value, ini->lines[line].value, len);
+    value[len] = '\0';
+
     return XIA_SUCCESS;
 }
 
 
 /*****************************************************************************
  *
- * This routine parses data in from fp (and bounded by start & end) as
+ * This routine parses data in from ini (between lines start & end) as
  * detector information. If it fails, then it fails hard and the user needs
  * to fix their inifile.
  *
  *****************************************************************************/
-HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaLoadDetector(IniFile *ini, int start, int end)
 {
     int status;
 
@@ -1377,7 +1703,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
      * 3) rest of the detector information
      */
 
-    status = xiaFileRA(fp, start, end, "alias", value);
+    status = xiaIniRA(ini, start, end, "alias", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1400,7 +1726,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
         return status;
     }
 
-    status = xiaFileRA(fp, start, end, "number_of_channels", value);
+    status = xiaIniRA(ini, start, end, "number_of_channels", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1423,7 +1749,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
         return status;
     }
 
-    status = xiaFileRA(fp, start, end, "type", value);
+    status = xiaIniRA(ini, start, end, "type", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1441,7 +1767,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
         return status;
     }
 
-    status = xiaFileRA(fp, start, end, "type_value", value);
+    status = xiaIniRA(ini, start, end, "type_value", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1464,7 +1790,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
     for (i = 0; i < numChans; i++)
     {
         sprintf(name, "channel%hu_gain", i);
-        status = xiaFileRA(fp, start, end, name, value);
+        status = xiaIniRA(ini, start, end, name, value);
 
         if (status == XIA_FILE_RA)
         {
@@ -1496,7 +1822,7 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
         }
 
         sprintf(name, "channel%hu_polarity", i);
-        status = xiaFileRA(fp, start, end, name, value);
+        status = xiaIniRA(ini, start, end, name, value);
 
         if (status == XIA_FILE_RA)
         {
@@ -1534,12 +1860,12 @@ HANDEL_STATIC int xiaLoadDetector(FILE *fp, fpos_t *start, fpos_t *end)
 
 /*****************************************************************************
  *
- * This routine parses data in from fp (and bounded by start & end) as
+ * This routine parses data in from ini (between lines start & end) as
  * module information. If it fails, then it fails hard and the user needs
  * to fix their inifile.
  *
  *****************************************************************************/
-HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaLoadModule(IniFile *ini, int start, int end)
 {
     int status;
     int chanAlias;
@@ -1556,12 +1882,10 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
     char firmAlias[MAXALIAS_LEN];
     char defAlias[MAXALIAS_LEN];
 
-    ASSERT(fp);
-    ASSERT(start);
-    ASSERT(end);
+    ASSERT(ini);
 
 
-    status = xiaFileRA(fp, start, end, "alias", value);
+    status = xiaIniRA(ini, start, end, "alias", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1584,7 +1908,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
         return status;
     }
 
-    status = xiaFileRA(fp, start, end, "module_type", value);
+    status = xiaIniRA(ini, start, end, "module_type", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1606,7 +1930,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
                "Error adding module type to module %s", alias);
     }
 
-    status = xiaFileRA(fp, start, end, "number_of_channels", value);
+    status = xiaIniRA(ini, start, end, "number_of_channels", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -1630,7 +1954,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
     }
 
     /* Deal with interface here */
-    status = xiaFileRA(fp, start, end, "interface", value);
+    status = xiaIniRA(ini, start, end, "interface", value);
 
     sscanf(value, "%s", iface);
 
@@ -1658,7 +1982,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
             return status;
         }
 
-        status = xiaFileRA(fp, start, end, "inet_address", value);
+        status = xiaIniRA(ini, start, end, "inet_address", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -1680,7 +2004,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
             return status;
         }
 
-        status = xiaFileRA(fp, start, end, "inet_port", value);
+        status = xiaIniRA(ini, start, end, "inet_port", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -1702,7 +2026,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
             return status;
         }
 
-        status = xiaFileRA(fp, start, end, "inet_timeout", value);
+        status = xiaIniRA(ini, start, end, "inet_timeout", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -1723,6 +2047,62 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
                    "Error adding INET timeout to module %s", alias);
             return status;
         }
+
+        status = xiaIniRA(ini, start, end, "inet_receive_threads", value);
+
+        if (status == XIA_SUCCESS) {
+            unsigned int receiveThreads;
+
+            sscanf(value, "%u", &receiveThreads);
+
+            xiaLog(XIA_LOG_DEBUG, "xiaLoadModule",
+                   "INET receive threads = %u", receiveThreads);
+
+            status = xiaAddModuleItem(alias, "inet_receive_threads", &receiveThreads);
+
+            if (status != XIA_SUCCESS)
+            {
+                xiaLog(XIA_LOG_ERROR, status, "xiaLoadModule",
+                       "Error adding INET receive threads to module %s", alias);
+                return status;
+            }
+        }
+
+        status = xiaIniRA(ini, start, end, "inet_receive_buffer", value);
+
+        if (status == XIA_SUCCESS) {
+            unsigned int receiveBuffer;
+
+            sscanf(value, "%u", &receiveBuffer);
+
+            xiaLog(XIA_LOG_DEBUG, "xiaLoadModule",
+                   "INET receive buffer = %u", receiveBuffer);
+
+            status = xiaAddModuleItem(alias, "inet_receive_buffer", &receiveBuffer);
+
+            if (status != XIA_SUCCESS)
+            {
+                xiaLog(XIA_LOG_ERROR, status, "xiaLoadModule",
+                       "Error adding INET receive buffer to module %s", alias);
+                return status;
+            }
+        }
+
+        status = xiaIniRA(ini, start, end, "inet_capture", value);
+
+        if (status == XIA_SUCCESS) {
+            xiaLog(XIA_LOG_DEBUG, "xiaLoadModule",
+                   "INET capture = %s", value);
+
+            status = xiaAddModuleItem(alias, "inet_capture", value);
+
+            if (status != XIA_SUCCESS)
+            {
+                xiaLog(XIA_LOG_ERROR, status, "xiaLoadModule",
+                       "Error adding INET capture to module %s", alias);
+                return status;
+            }
+        }
     }
     else {
         xiaLog(XIA_LOG_ERROR, status, "xiaLoadModule",
@@ -1732,7 +2112,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
 
     for (i = 0; i < numChans; i++) {
         sprintf(name, "channel%u_alias", i);
-        status = xiaFileRA(fp, start, end, name, value);
+        status = xiaIniRA(ini, start, end, name, value);
 
         if (status != XIA_SUCCESS) {
             xiaLog(XIA_LOG_ERROR, status, "xiaLoadModule",
@@ -1754,7 +2134,7 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
         }
 
         sprintf(name, "channel%u_detector", i);
-        status = xiaFileRA(fp, start, end, name, value);
+        status = xiaIniRA(ini, start, end, name, value);
 
         if (status == XIA_FILE_RA) {
             xiaLog(XIA_LOG_WARNING, "xiaLoadModule",
@@ -1787,14 +2167,14 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
      * and defaults. Check for *_all first and if that isn't found then
      * try and find ones for individual channels.
      */
-    status = xiaFileRA(fp, start, end, "firmware_set_all", value);
+    status = xiaIniRA(ini, start, end, "firmware_set_all", value);
 
     if (status != XIA_SUCCESS)
     {
         for (i = 0; i < numChans; i++)
         {
             sprintf(name, "firmware_set_chan%u", i);
-            status = xiaFileRA(fp, start, end, name, value);
+            status = xiaIniRA(ini, start, end, name, value);
 
             if (status == XIA_FILE_RA)
             {
@@ -1839,14 +2219,14 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
         }
     }
 
-    status = xiaFileRA(fp, start, end, "default_all", value);
+    status = xiaIniRA(ini, start, end, "default_all", value);
 
     if (status != XIA_SUCCESS)
     {
         for (i = 0; i < numChans; i++)
         {
             sprintf(name, "default_chan%u", i);
-            status = xiaFileRA(fp, start, end, name, value);
+            status = xiaIniRA(ini, start, end, name, value);
 
             if (status == XIA_FILE_RA)
             {
@@ -1896,47 +2276,33 @@ HANDEL_STATIC int xiaLoadModule(FILE *fp, fpos_t *start, fpos_t *end)
 }
 
 
-HANDEL_STATIC int xiaLoadModChanData(FILE *fp, fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaLoadModChanData(IniFile *ini, int start, int end)
 {
-    int status;
-
-    UNUSED(start);
-    UNUSED(end);
-
-    do {
-        status = xiaReadChanData(fp);
-    } while (status == XIA_SUCCESS);
-
-    if (status == XIA_EOF) {
-        return XIA_SUCCESS;
-    }
-
-    return status;
+    return xiaReadChanData(ini, start, end);
 }
 
 
 /*
- * Search the section for module channel data starting with prefix,
- * e.g. "data_all" or "data_chan0". If both the length and data are
- * found, the data is parsed and added to the module. Otherwise
- * XIA_FILE_RA is returned.
+ * Parses the module channel data section between lines start and end.
+ * Each module is a START/END block of data_all or data_chanN entries,
+ * each a length line followed by the base64 encoded, compressed data
+ * line. The data is decoded straight out of the ini index and added to
+ * the module.
  */
-HANDEL_STATIC int xiaReadChanData(FILE *fp)
+HANDEL_STATIC int xiaReadChanData(IniFile *ini, int start, int end)
 {
-    char line[XIA_LINE_LEN];
-
-    char name[MAXITEM_LEN];
-    char value[MAXITEM_LEN];
     char prefix[MAXITEM_LEN];
-    char dataKey[MAXITEM_LEN];
 
     int match;
     char alias[MAXALIAS_LEN];
     unsigned int ch;
     int status;
+    int line;
+
+    IniLine *lenLine;
+    IniLine *dataLine;
 
     size_t dataEncLen;
-    char *dataEnc;
 
     int decStatus;
     size_t dataDecLen;
@@ -1946,114 +2312,103 @@ HANDEL_STATIC int xiaReadChanData(FILE *fp)
     uLong uncmpLen;
     GenBuffer buf;
 
-    /* Loop over the module sections: START module1. */
-    do {
-        /* Get the next module alias. */
-        status = xiaGetLine(fp, line);
-        if (status != XIA_SUCCESS) {
-            if (status != XIA_EOF) {
-                xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                       "Finding channel data.");
-            }
-            return status;
-        }
+    line = start;
 
-        /*
-         * If we hit another section, treat it like EOF for the
-         * purposes of this section parser.
-         */
-        if (line[0] == '[') {
-            return XIA_EOF;
-        }
-
-        if (!STRNEQ(line, "START ")) {
+    /* Loop over the module sections: START module1. */
+    while (line < end) {
+        if (!STRNEQ(ini->lines[line].line, "START ")) {
             status = XIA_FILE_RA;
             xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                   "Expected module name: %.40s", line);
+                   "Expected module name: %.40s", ini->lines[line].line);
             return status;
         }
 
-        strncpy(alias, line + strlen("START "), MAXALIAS_LEN);
+        strncpy(alias, ini->lines[line].line + strlen("START "), MAXALIAS_LEN - 1);
+        alias[MAXALIAS_LEN - 1] = '\0';
+        line++;
 
         xiaLog(XIA_LOG_DEBUG, "xiaReadChanData",
                "Channel data for %s.", alias);
 
-        do {
-            /* Get the next channel's data length. */
-            status = xiaGetLine(fp, line);
-            if (status != XIA_SUCCESS) {
-                if (status != XIA_EOF) {
-                    xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                           "Finding channel data.");
-                }
+        /* Channels in a module */
+        while (TRUE_) {
+            if (line == end) {
+                status = XIA_FILE_RA;
+                xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
+                       "No END found for the channel data of %s", alias);
                 return status;
             }
 
+            lenLine = &ini->lines[line++];
+
             /*
              * If we hit the end of the section, we're done with one module.
              */
-            if (STRNEQ(line, "END ")) {
+            if (STRNEQ(lenLine->line, "END ")) {
                 break;
             }
 
             /* Read the channel and length. */
-            status = xiaGetLineData(line, name, value);
-            if (status != XIA_SUCCESS) {
+            if (lenLine->name == NULL) {
+                status = XIA_FORMAT_ERROR;
                 xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                       "Finding channel data length: %.40s", line);
+                       "Finding channel data length: %.40s", lenLine->line);
                 return status;
             }
 
+            /* Data saved to a sidecar file. */
+            if (sscanf(lenLine->name, "data_chan%u_file", &ch) == 1 &&
+                STREQ(lenLine->name + strlen(lenLine->name) - strlen("_file"), "_file")) {
+                status = xiaReadChanDataSidecar(ini, alias, ch, lenLine->value);
+                if (status != XIA_SUCCESS)
+                    return status;
+                continue;
+            }
+
             /* Handle data_all or data_chanN. */
-            if (STRNEQ(line, "data_all_len")) {
+            if (STREQ(lenLine->name, "data_all_len")) {
                 sprintf(prefix, "data_all");
             }
             else {
                 /* Parse the channel from the name. */
-                match = sscanf(name, "data_chan%u_len", &ch);
+                match = sscanf(lenLine->name, "data_chan%u_len", &ch);
 
                 if (match != 1) {
                     status = XIA_FILE_RA;
                     xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                           "Finding channel number in %s, %d matches", name, match);
+                           "Finding channel number in %s, %d matches",
+                           lenLine->name, match);
                     return status;
                 }
 
                 sprintf(prefix, "data_chan%u", ch);
             }
 
-            xiaLog(XIA_LOG_DEBUG, "xiaLoadModule",
-                   "%s = %s", name, value);
+            xiaLog(XIA_LOG_DEBUG, "xiaReadChanData",
+                   "%s = %s", lenLine->name, lenLine->value);
 
             /* Parse the length from the value. */
-            sscanf(value, "%zu", &dataEncLen);
+            sscanf(lenLine->value, "%zu", &dataEncLen);
 
-            /*
-             * The next line should be the data for the same key. Scan the key, leaving
-             * the fp at the data.
-             */
-            match = fscanf(fp, "%200[^= ]%*10[= ]", name);
-            if (match != 1 || !STREQ(prefix, name)) {
+            /* The next line should be the data for the same key. */
+            dataLine = line < end ? &ini->lines[line] : NULL;
+
+            if (dataLine == NULL || dataLine->name == NULL ||
+                !STREQ(prefix, dataLine->name)) {
                 status = XIA_FILE_RA;
                 xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                       "Expected %s, got %s, %d matches", dataKey, name, match);
+                       "Expected %s for %s", prefix, alias);
                 return status;
             }
 
-            /* Now use the length to allocate and slurp the data. */
-            dataEnc = handel_md_alloc((dataEncLen + 1) * sizeof(char));
-            if (dataEnc == NULL) {
-                status = XIA_NOMEM;
-                xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                       "No memory for %s %s", alias, prefix);
-                return status;
-            }
+            line++;
 
-            status = xiaGetLine_N(fp, dataEnc, (int)dataEncLen + 1);
-            if (status != XIA_SUCCESS) {
-                handel_md_free(dataEnc);
+            if (dataLine->valueLen < dataEncLen) {
+                status = XIA_FILE_RA;
                 xiaLog(XIA_LOG_ERROR, status, "xiaReadChanData",
-                       "Unable to load %s %s", alias, prefix);
+                       "Unable to load %s %s, %lu of %lu characters present",
+                       alias, prefix, (unsigned long) dataLine->valueLen,
+                       (unsigned long) dataEncLen);
                 return status;
             }
 
@@ -2061,25 +2416,21 @@ HANDEL_STATIC int xiaReadChanData(FILE *fp)
             dataDecLen = dataEncLen * 3 / 4 + 1;
             dataDec = handel_md_alloc(dataDecLen);
             if (dataDec == NULL) {
-                handel_md_free(dataEnc);
                 status = XIA_NOMEM;
                 xiaLog(XIA_LOG_ERROR, status, "_addData",
                        "Unable to allocate memory to decode chosen->data[i]");
                 return status;
             }
 
-            decStatus = Base64Decode(dataEnc, dataEncLen, dataDec, &dataDecLen);
+            decStatus = Base64Decode(dataLine->value, dataEncLen, dataDec, &dataDecLen);
             if (decStatus) {
-                handel_md_free(dataEnc);
                 handel_md_free(dataDec);
                 status = XIA_DECODE;
                 xiaLog(XIA_LOG_ERROR, status, "_addData",
-                       "Unable to decode %s %s. Decode status=%d.", alias, name, decStatus);
+                       "Unable to decode %s %s. Decode status=%d.", alias, prefix, decStatus);
                 return status;
             }
 
-            handel_md_free(dataEnc);
-
             uncmpLen = (uLong)dataDecLen * 32; /* Conservative estimate 32x deflate */
             buf.data = handel_md_alloc(uncmpLen);
             if (buf.data == NULL) {
@@ -2098,7 +2449,7 @@ HANDEL_STATIC int xiaReadChanData(FILE *fp)
                 handel_md_free(buf.data);
                 status = XIA_DECODE;
                 xiaLog(XIA_LOG_ERROR, status, "_addData",
-                       "Unable to uncompress %s %s. Uncompress status=%d.", alias, name, uncmpStatus);
+                       "Unable to uncompress %s %s. Uncompress status=%d.", alias, prefix, uncmpStatus);
                 return status;
             }
 
@@ -2115,20 +2466,140 @@ HANDEL_STATIC int xiaReadChanData(FILE *fp)
                        "Error adding module %s %s", alias, prefix);
                 return status;
             }
-        } while (status == XIA_SUCCESS); /* Channels in a module */
-    } while (status == XIA_SUCCESS); /* Module sections */
+        }
+    }
+
+    return XIA_SUCCESS;
+}
+
+/*
+ * Loads a channel's data from a sidecar file written by
+ * xiaWriteChanDataSidecar. The file is found relative to the .ini file.
+ */
+HANDEL_STATIC int xiaReadChanDataSidecar(IniFile *ini, const char *alias,
+                                         unsigned int ch, const char *value)
+{
+    int status;
+
+    unsigned long offset;
+    unsigned long cmpLen;
+    unsigned long dataLen;
+    int nameStart = 0;
+
+    char prefix[MAXITEM_LEN];
+    char dataFilename[MAX_PATH_LEN];
+    size_t dirLen;
+
+    FILE *dataFile;
+    byte_t *dataCmp;
+    uLong uncmpLen;
+    int uncmpStatus;
+    GenBuffer buf;
+
+    if (sscanf(value, "%lu,%lu,%lu,%n", &offset, &cmpLen, &dataLen,
+               &nameStart) != 3 || nameStart == 0 || value[nameStart] == '\0') {
+        status = XIA_FORMAT_ERROR;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Invalid data_chan%u_file for %s: %.40s", ch, alias, value);
+        return status;
+    }
+
+    dirLen = strlen(ini->filename);
+    while (dirLen > 0 && ini->filename[dirLen - 1] != HANDLE_PATHNAME_SEP &&
+           ini->filename[dirLen - 1] != '/')
+        --dirLen;
+
+    if (dirLen + strlen(value + nameStart) >= sizeof(dataFilename)) {
+        status = XIA_BAD_NAME;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Channel data file name too long: %s", value + nameStart);
+        return status;
+    }
+
+    memcpy(dataFilename, ini->filename, dirLen);
+    strcpy(dataFilename + dirLen, value + nameStart);
+
+    sprintf(prefix, "data_chan%u", ch);
+
+    xiaLog(XIA_LOG_DEBUG, "xiaReadChanDataSidecar",
+           "%s %s: %lu bytes at %lu of %s", alias, prefix, cmpLen, offset,
+           dataFilename);
+
+    dataCmp = handel_md_alloc(cmpLen > 0 ? cmpLen : 1);
+    buf.data = handel_md_alloc(dataLen + 1);
+    if (dataCmp == NULL || buf.data == NULL) {
+        if (dataCmp)
+            handel_md_free(dataCmp);
+        if (buf.data)
+            handel_md_free(buf.data);
+        status = XIA_NOMEM;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "No memory for %s %s", alias, prefix);
+        return status;
+    }
+
+    dataFile = xia_file_open(dataFilename, "rb");
+    if (dataFile == NULL) {
+        handel_md_free(dataCmp);
+        handel_md_free(buf.data);
+        status = XIA_OPEN_FILE;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Could not open %s", dataFilename);
+        return status;
+    }
+
+    if (fseek(dataFile, (long) offset, SEEK_SET) != 0 ||
+        fread(dataCmp, 1, cmpLen, dataFile) != cmpLen) {
+        xia_file_close(dataFile);
+        handel_md_free(dataCmp);
+        handel_md_free(buf.data);
+        status = XIA_BAD_FILE_READ;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Unable to read %s %s from %s", alias, prefix, dataFilename);
+        return status;
+    }
+
+    xia_file_close(dataFile);
+
+    uncmpLen = (uLong) dataLen;
+    uncmpStatus = uncompress(buf.data, &uncmpLen, dataCmp, (uLong) cmpLen);
+
+    handel_md_free(dataCmp);
+
+    if (uncmpStatus != Z_OK || uncmpLen != dataLen) {
+        handel_md_free(buf.data);
+        status = XIA_DECODE;
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Unable to uncompress %s %s. Uncompress status=%d.",
+               alias, prefix, uncmpStatus);
+        return status;
+    }
+
+    /* Terminated the same as data read from the .ini file. */
+    ((byte_t *) buf.data)[dataLen] = 0;
+    buf.length = dataLen + 1;
+
+    status = xiaAddModuleItem(alias, prefix, &buf);
+
+    handel_md_free(buf.data);
+
+    if (status != XIA_SUCCESS) {
+        xiaLog(XIA_LOG_ERROR, status, "xiaReadChanDataSidecar",
+               "Error adding module %s %s", alias, prefix);
+        return status;
+    }
 
     return XIA_SUCCESS;
 }
 
 /*****************************************************************************
  *
- * This routine parses data in from fp (and bounded by start & end) as
+ * This routine parses data in from ini (between lines start & end) as
  * firmware information. If it fails, then it fails hard and the user needs
  * to fix their inifile.
  *
  *****************************************************************************/
-HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaLoadFirmware(IniFile *ini, int start, int end)
 {
     int status;
 
@@ -2145,7 +2616,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
      */
     char keyword[10];
 
-    status = xiaFileRA(fp, start, end, "alias", value);
+    status = xiaIniRA(ini, start, end, "alias", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -2169,7 +2640,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
     }
 
     /* Check for an MMU first since we'll be exiting if we find a filename */
-    status = xiaFileRA(fp, start, end, "mmu", value);
+    status = xiaIniRA(ini, start, end, "mmu", value);
 
     if (status == XIA_SUCCESS)
     {
@@ -2188,7 +2659,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
     }
 
     /* If we find a filename, then we are done and can return */
-    status = xiaFileRA(fp, start, end, "filename", value);
+    status = xiaIniRA(ini, start, end, "filename", value);
 
     if (status == XIA_SUCCESS)
     {
@@ -2205,7 +2676,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
             return status;
         }
 
-        status = xiaFileRA(fp, start, end, "fdd_tmp_path", value);
+        status = xiaIniRA(ini, start, end, "fdd_tmp_path", value);
 
         if (status == XIA_SUCCESS) {
             strcpy(path, value);
@@ -2222,7 +2693,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
         /* Check for keywords, if any...no need to really warn since the most
          * important "keywords" are generated by Handel.
          */
-        status = xiaFileRA(fp, start, end, "num_keywords", value);
+        status = xiaIniRA(ini, start, end, "num_keywords", value);
 
         if (status == XIA_SUCCESS)
         {
@@ -2233,7 +2704,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
             for (i = 0; i < numKeywords; i++)
             {
                 sprintf(keyword, "keyword%hu", i);
-                status = xiaFileRA(fp, start, end, keyword, value);
+                status = xiaIniRA(ini, start, end, keyword, value);
 
                 if (status != XIA_SUCCESS)
                 {
@@ -2262,7 +2733,7 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
     /* Need to be a little careful here about how we parse in the PTRR chunks.
      * Start slowly by getting the number of PTRRs first.
      */
-    status = xiaReadPTRRs(fp, start, end, alias);
+    status = xiaReadPTRRs(ini, start, end, alias);
 
     if (status != XIA_SUCCESS)
     {
@@ -2281,22 +2752,20 @@ HANDEL_STATIC int xiaLoadFirmware(FILE *fp, fpos_t *start, fpos_t *end)
  * definitions.
  *
  *****************************************************************************/
-HANDEL_STATIC int xiaLoadDefaults(FILE *fp, fpos_t *start, fpos_t *end)
+HANDEL_STATIC int xiaLoadDefaults(IniFile *ini, int start, int end)
 {
     int status;
 
+    int line;
+
     char value[MAXITEM_LEN];
     char alias[MAXALIAS_LEN];
-    char tmpName[MAXITEM_LEN];
-    char tmpValue[MAXITEM_LEN];
-    char endLine[XIA_LINE_LEN];
-    char line[XIA_LINE_LEN];
 
     double defValue;
 
-    fpos_t dataStart;
+    IniLine *entry;
 
-    status = xiaFileRA(fp, start, end, "alias", value);
+    status = xiaIniRA(ini, start, end, "alias", value);
 
     if (status != XIA_SUCCESS)
     {
@@ -2319,48 +2788,42 @@ HANDEL_STATIC int xiaLoadDefaults(FILE *fp, fpos_t *start, fpos_t *end)
         return status;
     }
 
-    /* Want a position after the alias line so that we can just read in line-
-     * by-line until we reach endLine
+    /* Start after the alias line so that we can just read in line-by-line
+     * until we reach the end of the block.
      */
-    xiaSetPosOnNext(fp, start, end, "alias", &dataStart, TRUE_);
-
-    fsetpos(fp, end);
-    status = xiaGetLine(fp, endLine);
-
-    fsetpos(fp, &dataStart);
-    status = xiaGetLine(fp, line);
+    xiaIniFindLine(ini, start, end, "alias", &line);
 
-    while (!STREQ(line, endLine))
+    for (line++; line < end; line++)
     {
-        status = xiaGetLineData(line, tmpName, tmpValue);
-        if (status != XIA_SUCCESS)
+        entry = &ini->lines[line];
+
+        if (entry->name == NULL)
         {
+            status = XIA_FORMAT_ERROR;
             xiaLog(XIA_LOG_ERROR, status, "xiaLoadDefaults",
-                   "Error getting data for entry %s", tmpName);
+                   "Error getting data for line %.40s", entry->line);
             return status;
         }
 
-        if (!STREQ(tmpName, "COMMENT"))
+        if (!STREQ(entry->name, "COMMENT"))
         {
-            sscanf(tmpValue, "%lf", &defValue);
+            sscanf(entry->value, "%lf", &defValue);
 
-            status = xiaAddDefaultItem(alias, tmpName, (void *)&defValue);
+            status = xiaAddDefaultItem(alias, entry->name, (void *)&defValue);
 
             if (status != XIA_SUCCESS)
             {
                 xiaLog(XIA_LOG_ERROR, status, "xiaLoadDefaults",
                        "Error adding %s (value = %.3f) to alias %s",
-                       tmpName, defValue, alias);
+                       entry->name, defValue, alias);
                 return status;
             }
 
 
             xiaLog(XIA_LOG_DEBUG, "xiaLoadDefaults",
                    "Added %s (value = %.3f) to alias %s",
-                   tmpName, defValue, alias);
+                   entry->name, defValue, alias);
         }
-
-        status = xiaGetLine(fp, line);
     }
 
     return XIA_SUCCESS;
@@ -2377,8 +2840,8 @@ HANDEL_STATIC int xiaLoadDefaults(FILE *fp, fpos_t *start, fpos_t *end)
  * (*) -- Actually, it will read in the number specified by number_of_ptrrs.
  *
  *****************************************************************************/
-HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
-                                          fpos_t *end, char *alias)
+HANDEL_STATIC int HANDEL_API xiaReadPTRRs(IniFile *ini, int start,
+                                          int end, char *alias)
 {
     int status;
 
@@ -2394,9 +2857,8 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
     char filterName[14];
     char value[MAXITEM_LEN];
 
-    fpos_t newStart;
-    fpos_t newEnd;
-    fpos_t lookAheadStart;
+    int newStart;
+    int newEnd;
 
     boolean_t isLast = FALSE_;
 
@@ -2405,14 +2867,13 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
            "Starting parse of PTRRs");
 
     /* This assumes that there is at least one PTRR for a specified alias */
-    newEnd = *start;
+    newEnd = start;
     while (!isLast)
     {
-        xiaSetPosOnNext(fp, &newEnd, end, "ptrr", &lookAheadStart, TRUE_);
-        xiaSetPosOnNext(fp, &newEnd, end, "ptrr", &newStart, FALSE_);
+        xiaIniFindLine(ini, newEnd, end, "ptrr", &newStart);
 
         /* Find the end here: either the END or another ptrr */
-        status = xiaSetPosOnNext(fp, &lookAheadStart, end, "ptrr", &newEnd, FALSE_);
+        status = xiaIniFindLine(ini, newStart + 1, end, "ptrr", &newEnd);
 
         if (status == XIA_END)
         {
@@ -2420,7 +2881,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
         }
 
         /* Do the actual actions here */
-        status = xiaFileRA(fp, &newStart, &newEnd, "ptrr", value);
+        status = xiaIniRA(ini, newStart, newEnd, "ptrr", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2443,7 +2904,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
             return status;
         }
 
-        status = xiaFileRA(fp, &newStart, &newEnd, "min_peaking_time", value);
+        status = xiaIniRA(ini, newStart, newEnd, "min_peaking_time", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2463,7 +2924,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
             return status;
         }
 
-        status = xiaFileRA(fp, &newStart, &newEnd, "max_peaking_time", value);
+        status = xiaIniRA(ini, newStart, newEnd, "max_peaking_time", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2483,7 +2944,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
             return status;
         }
 
-        status = xiaFileRA(fp, &newStart, &newEnd, "fippi", value);
+        status = xiaIniRA(ini, newStart, newEnd, "fippi", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2501,7 +2962,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
             return status;
         }
 
-        status = xiaFileRA(fp, &newStart, &newEnd, "dsp", value);
+        status = xiaIniRA(ini, newStart, newEnd, "dsp", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2520,7 +2981,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
         }
 
         /* Check for the quite optional "user_fippi"... */
-        status = xiaFileRA(fp, &newStart, &newEnd, "user_fippi", value);
+        status = xiaIniRA(ini, newStart, newEnd, "user_fippi", value);
 
         if (status == XIA_SUCCESS)
         {
@@ -2544,7 +3005,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
             return status;
         }
 
-        status = xiaFileRA(fp, &newStart, &newEnd, "num_filter", value);
+        status = xiaIniRA(ini, newStart, newEnd, "num_filter", value);
 
         if (status != XIA_SUCCESS)
         {
@@ -2561,7 +3022,7 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
         for (i = 0; i < numFilter; i++)
         {
             sprintf(filterName, "filter_info%hu", i);
-            status = xiaFileRA(fp, &newStart, &newEnd, filterName, value);
+            status = xiaIniRA(ini, newStart, newEnd, filterName, value);
 
             if (status != XIA_SUCCESS)
             {
@@ -2591,80 +3052,6 @@ HANDEL_STATIC int HANDEL_API xiaReadPTRRs(FILE *fp, fpos_t *start,
 }
 
 
-/*****************************************************************************
- *
- * This routine searches between start and end for name. If it finds a name,
- * it sets newPos to that location. If not, it returns a value of XIA_END
- * and sets newPos to end. There are a couple of important caveats here:
- * You can't use fpos_t pointers in direct arithmetic comparisons. They just
- * don't work that way. Instead, I set the file to the position and then read
- * a line from the file. This line serves as the "unique" identifier from
- * which all future comparisons are done. There is a finite probability that
- * the same string may appear elsewhere in the file. Hopefully the same string
- * won't appear twice between start and end.
- *
- *****************************************************************************/
-HANDEL_STATIC int HANDEL_API xiaSetPosOnNext(FILE *fp, fpos_t *start, fpos_t *end,
-                                             const char *name, fpos_t *newPos,
-                                             boolean_t after)
-{
-    int status;
-
-    char endLine[XIA_LINE_LEN];
-    char line[XIA_LINE_LEN];
-    char tmpValue[XIA_LINE_LEN];
-    char tmpName[XIA_LINE_LEN];
-
-    fsetpos(fp, end);
-    status = xiaGetLine(fp, endLine);
-
-    fsetpos(fp, start);
-    fgetpos(fp, newPos);
-    status = xiaGetLine(fp, line);
-
-    xiaLog(XIA_LOG_DEBUG, "xiaSetPosOnNext",
-           "endLine: %s", endLine);
-    xiaLog(XIA_LOG_DEBUG, "xiaSetPosOnNext",
-           "startLine: %s", line);
-
-    while (!STREQ(line, endLine))
-    {
-        status = xiaGetLineData(line, tmpName, tmpValue);
-
-        if (status != XIA_SUCCESS)
-        {
-            xiaLog(XIA_LOG_ERROR, status, "xiaSetPosOnNext",
-                   "Error trying to find %s", name);
-            return status;
-        }
-
-
-        if (STREQ(name, tmpName))
-        {
-            if (after)
-            {
-                fgetpos(fp, newPos);
-            }
-
-            fsetpos(fp, newPos);
-            status = xiaGetLine(fp, line);
-
-            xiaLog(XIA_LOG_DEBUG, "xiaSetPosOnNext",
-                   "newPos set to line: %s", line);
-
-            return XIA_SUCCESS;
-        }
-
-        fgetpos(fp, newPos);
-
-        status = xiaGetLine(fp, line);
-    }
-
-    /* Okay, we must have made it to the end of the file */
-    return XIA_END;
-}
-
-
 /*****************************************************************************
  *
  * This routine will attempt to find the value from the specified name-value
@@ -2770,6 +3157,15 @@ static int writeINET(FILE *fp, Module *module)
           module->interface_->info.inet->port);
   fprintf(fp, "inet_timeout = %u\n",
           module->interface_->info.inet->timeout);
+  if (module->interface_->info.inet->receive_threads > 0)
+      fprintf(fp, "inet_receive_threads = %u\n",
+              module->interface_->info.inet->receive_threads);
+  if (module->interface_->info.inet->receive_buffer > 0)
+      fprintf(fp, "inet_receive_buffer = %u\n",
+              module->interface_->info.inet->receive_buffer);
+  if (module->interface_->info.inet->capture != NULL)
+      fprintf(fp, "inet_capture = %s\n",
+              module->interface_->info.inet->capture);
 
   return XIA_SUCCESS;
 }
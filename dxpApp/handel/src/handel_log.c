@@ -54,6 +54,7 @@
 
 void (*handel_md_log)(int level, const char *func, const char *msg, int status,
                       const char *file, int line);
+boolean_t (*handel_md_log_enabled)(int level);
 
 /*****************************************************************************
  *
@@ -151,11 +152,41 @@ HANDEL_EXPORT int HANDEL_API xiaSetLogOutput(const char *filename)
 
 /*****************************************************************************
  *
- * This routine outputs the log.
+ * This routine turns the asynchronous log on or off. When on, messages are
+ * queued and written by a background thread so logging does not wait on
+ * the output. Messages are dropped, and the number reported, if the queue
+ * fills. Turning it off writes any queued messages.
  *
  *****************************************************************************/
-HANDEL_SHARED void HANDEL_API xiaLog(int level, const char* file, int line,
-                                     int status, const char* func, const char* fmt, ...)
+HANDEL_EXPORT int HANDEL_API xiaSetLogAsynchronous(int enable)
+{
+    int status;
+
+    if (handel_md_log_async == NULL)
+    {
+        xiaInitHandel();
+    }
+
+    status = handel_md_log_async(enable ? TRUE_ : FALSE_);
+
+    if (status != XIA_SUCCESS)
+    {
+        return XIA_MD;
+    }
+
+    return XIA_SUCCESS;
+}
+
+
+/*****************************************************************************
+ *
+ * This routine outputs the log. Use the xiaLog() macro, which skips the
+ * call for messages the log level filters out.
+ *
+ *****************************************************************************/
+HANDEL_SHARED void HANDEL_API xiaLogMessage(int level, const char* file, int line,
+                                            int status, const char* func,
+                                            const char* fmt, ...)
 {
     char formatBuffer[2048];
     va_list args;
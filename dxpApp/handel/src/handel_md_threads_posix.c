@@ -33,6 +33,10 @@
  * SUCH DAMAGE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <ctype.h>
 #include <errno.h>
 #include <pthread.h>
@@ -40,6 +44,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -56,6 +61,13 @@
 
 #pragma clang diagnostic ignored "-Wthread-safety-analysis"
 
+/*
+ * Held while a thread is created and named. A thread that destroys itself
+ * takes it before freeing its handle so a short lived thread cannot free
+ * the handle while its creator is still using it.
+ */
+static pthread_mutex_t threadCreateLock = PTHREAD_MUTEX_INITIALIZER;
+
 XIA_SHARED int handel_md_thread_create(handel_md_Thread* thread)
 {
     int r = EBUSY;
@@ -119,6 +131,7 @@ XIA_SHARED int handel_md_thread_create(handel_md_Thread* thread)
             {
                 thread->handle = pt;
                 thread->state = handel_md_ThreadsReady;
+                pthread_mutex_lock(&threadCreateLock);
                 r = pthread_create(pt, &attr,
                                    (void* (*)(void *)) thread->entryPoint,
                                    thread->argument);
@@ -127,6 +140,21 @@ XIA_SHARED int handel_md_thread_create(handel_md_Thread* thread)
                     free(thread->handle);
                     thread->handle = NULL;
                 }
+                #ifdef __linux__
+                else if (thread->name != NULL)
+                {
+                    /*
+                     * Name the thread so tools and per-thread CPU stats
+                     * can tell them apart. Linux limits names to 15
+                     * characters.
+                     */
+                    char name[16];
+                    strncpy(name, thread->name, sizeof(name) - 1);
+                    name[sizeof(name) - 1] = '\0';
+                    pthread_setname_np(*pt, name);
+                }
+                #endif
+                pthread_mutex_unlock(&threadCreateLock);
             }
             else
             {
@@ -152,6 +180,8 @@ XIA_SHARED int handel_md_thread_destroy(handel_md_Thread* thread)
         thread->state = handel_md_ThreadsDetached;
         if (pthread_self() == *pt)
         {
+            pthread_mutex_lock(&threadCreateLock);
+            pthread_mutex_unlock(&threadCreateLock);
             free(pt);
             pthread_exit(0);
         }
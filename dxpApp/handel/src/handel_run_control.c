@@ -47,6 +47,18 @@
 #include "handel_log.h"
 
 
+static int xiaStartRunOp(int detChan, void *arg)
+{
+    return xiaStartRun(detChan, *((unsigned short *) arg));
+}
+
+static int xiaStopRunOp(int detChan, void *arg)
+{
+    UNUSED(arg);
+    return xiaStopRun(detChan);
+}
+
+
 /*****************************************************************************
  *
  * This routine starts a run on the specified detChan by calling the
@@ -62,10 +74,6 @@ HANDEL_EXPORT int HANDEL_API xiaStartRun(int detChan, unsigned short resume)
 
     XiaDefaults *defaults = NULL;
 
-    DetChanElement *detChanElem = NULL;
-
-    DetChanSetElem *detChanSetElem = NULL;
-
     Module *module = NULL;
     Detector *detector = NULL;
 
@@ -138,22 +146,13 @@ HANDEL_EXPORT int HANDEL_API xiaStartRun(int detChan, unsigned short resume)
             break;
 
         case SET:
-            detChanElem = xiaGetDetChanPtr(detChan);
+            status = xiaBroadcast(detChan, xiaStartRunOp, &resume);
 
-            detChanSetElem = detChanElem->data.detChanSet;
-
-            while (detChanSetElem != NULL)
+            if (status != XIA_SUCCESS)
             {
-                status = xiaStartRun((int)detChanSetElem->channel, resume);
-
-                if (status != XIA_SUCCESS)
-                {
-                    xiaLog(XIA_LOG_ERROR, status, "xiaStartRun",
-                           "Error starting run for detChan %d", detChan);
-                    return status;
-                }
-
-                detChanSetElem = getListNext(detChanSetElem);
+                xiaLog(XIA_LOG_ERROR, status, "xiaStartRun",
+                       "Error starting run for detChan %d", detChan);
+                return status;
             }
 
             break;
@@ -188,10 +187,6 @@ HANDEL_EXPORT int HANDEL_API xiaStopRun(int detChan)
 
     int chan = 0;
 
-    DetChanElement *detChanElem = NULL;
-
-    DetChanSetElem *detChanSetElem = NULL;
-
     Module *module = NULL;
     Detector *detector = NULL;
 
@@ -254,23 +249,14 @@ HANDEL_EXPORT int HANDEL_API xiaStopRun(int detChan)
             break;
 
         case SET:
-            detChanElem = xiaGetDetChanPtr(detChan);
+            /* Recursive broadcast here to stop run for all channels */
+            status = xiaBroadcast(detChan, xiaStopRunOp, NULL);
 
-            detChanSetElem = detChanElem->data.detChanSet;
-
-            while (detChanSetElem != NULL)
+            if (status != XIA_SUCCESS)
             {
-                /* Recursive loop here to stop run for all channels */
-                status = xiaStopRun((int)detChanSetElem->channel);
-
-                if (status != XIA_SUCCESS)
-                {
-                    xiaLog(XIA_LOG_ERROR, status, "xiaStopRun",
-                           "Error stoping run for detChan %d", detChan);
-                    return status;
-                }
-
-                detChanSetElem = getListNext(detChanSetElem);
+                xiaLog(XIA_LOG_ERROR, status, "xiaStopRun",
+                       "Error stoping run for detChan %d", detChan);
+                return status;
             }
 
             break;
@@ -48,6 +48,34 @@
 #include "handel_log.h"
 
 
+/*
+ * Broadcast state for setting an acquisition value on a detChan set. Every
+ * detChan is given the user's value and the value returned for the last
+ * detChan in the set is handed back.
+ */
+typedef struct
+{
+    const char* name;
+    double      value;
+    int         lastDetChan;
+    double      lastValue;
+} AcqValueBroadcast;
+
+static int xiaSetAcquisitionValuesOp(int detChan, void *arg)
+{
+    AcqValueBroadcast* acq = (AcqValueBroadcast*) arg;
+    double value = acq->value;
+    int status;
+
+    status = xiaSetAcquisitionValues(detChan, acq->name, &value);
+
+    if (detChan == acq->lastDetChan)
+        acq->lastValue = value;
+
+    return status;
+}
+
+
 /*****************************************************************************
  *
  * This routine is responsible for calculating key DSP parameters from user
@@ -62,7 +90,7 @@ HANDEL_EXPORT int HANDEL_API xiaSetAcquisitionValues(int detChan,
     int status;
     int elemType;
 
-    double savedValue;
+    AcqValueBroadcast acq;
 
     DetChanElement *detChanElem = NULL;
 
@@ -116,23 +144,27 @@ HANDEL_EXPORT int HANDEL_API xiaSetAcquisitionValues(int detChan,
             /* Save the user value, else it will be changed by the return value
              * of the setAcquisitionValues call.  Use the last return value as
              * the actual return value */
-            savedValue = *((double *) value);
+            acq.name = name;
+            acq.value = *((double *) value);
+            acq.lastDetChan = -1;
+            acq.lastValue = acq.value;
 
             while (detChanSetElem != NULL)
             {
-                *((double *) value) = savedValue;
-                status =
-                    xiaSetAcquisitionValues((int)detChanSetElem->channel, name, value);
+                acq.lastDetChan = (int)detChanSetElem->channel;
+                detChanSetElem = getListNext(detChanSetElem);
+            }
 
-                if (status != XIA_SUCCESS)
-                {
-                    xiaLog(XIA_LOG_ERROR, status, "xiaSetAcquisitionValues",
-                           "Error setting acquisition values for detChan %d",
-                           detChan);
-                    return status;
-                }
+            status = xiaBroadcast(detChan, xiaSetAcquisitionValuesOp, &acq);
 
-                detChanSetElem = getListNext(detChanSetElem);
+            *((double *) value) = acq.lastValue;
+
+            if (status != XIA_SUCCESS)
+            {
+                xiaLog(XIA_LOG_ERROR, status, "xiaSetAcquisitionValues",
+                       "Error setting acquisition values for detChan %d",
+                       detChan);
+                return status;
             }
 
             break;
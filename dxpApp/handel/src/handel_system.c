@@ -66,6 +66,7 @@ char * (*handel_md_fgets)(char *s, int size, FILE *stream);
 int (*handel_md_enable_log)(void);
 int (*handel_md_suppress_log)(void);
 int (*handel_md_set_log_level)(int level);
+int (*handel_md_log_async)(boolean_t enable);
 
 HANDEL_SHARED boolean_t HANDEL_API xiaHandelSystemStarting(void)
 {
@@ -93,8 +94,10 @@ HANDEL_EXPORT int HANDEL_API xiaStartSystem(void)
 {
     int status;
 
+    ++starts;
+
     xiaLog(XIA_LOG_INFO, "xiaStartSystem",
-           "System start count: %d", ++starts);
+           "System start count: %d", starts);
 
     if (systemState != HANDEL_SYSTEM_STATE_DEAD) {
         xiaLog(XIA_LOG_ERROR, XIA_BAD_VALUE, "xiaStartSystem",
@@ -165,8 +168,10 @@ HANDEL_EXPORT int HANDEL_API xiaEndSystem(void)
         int modStatus;
         int detStatus;
 
+        ++ends;
+
         xiaLog(XIA_LOG_INFO, "xiaEndSystem",
-               "System end count: %d", ++ends);
+               "System end count: %d", ends);
 
         if ((systemState != HANDEL_SYSTEM_STATE_STARTING) &&
             (systemState != HANDEL_SYSTEM_STATE_RUNNING)) {
@@ -51,6 +51,7 @@ int gettimeofday(struct timeval *tp, void *tzp);
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 
 #include "xia_assert.h"
@@ -65,6 +66,18 @@ int gettimeofday(struct timeval *tp, void *tzp);
 
 #define INFO_LEN    400
 
+/* A formatted log line: the header plus the largest message the Handel and
+ * PSL log routines format.
+ */
+#define MD_LOG_LINE_LEN     (2048 + 256)
+
+/* Asynchronous log ring. Messages longer than MD_LOG_MESSAGE_LEN are
+ * truncated when queued.
+ */
+#define MD_LOG_RING_SIZE    1024
+#define MD_LOG_ROUTINE_LEN  64
+#define MD_LOG_MESSAGE_LEN  1024
+
 /* Current output for the logging routines. By default, this is set to stdout
  * in dxp_md_log().
  */
@@ -74,17 +87,42 @@ static boolean_t isSuppressed = FALSE_;
 
 static int logLevel = MD_ERROR;
 
+/* Serializes writes to out_stream. Lines are formatted before the lock is
+ * taken.
+ */
 static handel_md_Mutex lock;
 
-HANDEL_STATIC void dxp_md_error(const char* routine, const char* message,
-                                int* error_code, const char *file, int line);
-HANDEL_STATIC void dxp_md_warning(const char *routine, const char *message,
-                                  const char *file, int line);
-HANDEL_STATIC void dxp_md_info(const char *routine, const char *message,
-                               const char *file, int line);
-HANDEL_STATIC void dxp_md_debug(const char *routine, const char *message,
+/* A message queued for the log writer thread. The writer formats the
+ * header.
+ */
+typedef struct {
+    int            level;
+    int            error;
+    const char*    file;
+    int            line;
+    struct timeval tod;
+    char           routine[MD_LOG_ROUTINE_LEN];
+    char           message[MD_LOG_MESSAGE_LEN];
+} dxp_md_LogRecord;
+
+static dxp_md_LogRecord* volatile logRing = NULL;
+static unsigned int logRingHead = 0;
+static unsigned int logRingTail = 0;
+static unsigned int logRingDropped = 0;
+static handel_md_Mutex logRingLock;
+static handel_md_Event logRingEvent;
+static handel_md_Thread logWriter;
+static volatile boolean_t logWriterRunning = FALSE_;
+static volatile boolean_t logWriterStop = FALSE_;
+
+HANDEL_STATIC void dxp_md_write(int level, const char *routine,
+                                const char *message, int error,
                                 const char *file, int line);
-
+HANDEL_STATIC void dxp_md_log_format(char *buffer, size_t size, int level,
+                                     const char *routine, const char *message,
+                                     int error, const char *file, int line,
+                                     const struct timeval *tod);
+HANDEL_STATIC void dxp_md_log_drain(void);
 
 /** @brief Routine to wait a specified time in seconds.
  */
@@ -138,8 +176,8 @@ XIA_SHARED char * dxp_md_fgets(char *s, int length, FILE *stream)
 
     if (!cstatus) {
         if (ferror(stream)) {
-            dxp_md_warning("dxp_md_fgets", "Error detected reading from "
-                           "stream.", __FILE__, __LINE__);
+            dxp_md_write(MD_WARNING, "dxp_md_fgets", "Error detected reading "
+                         "from stream.", 0, __FILE__, __LINE__);
         }
 
         return NULL;
@@ -205,6 +243,15 @@ XIA_SHARED int dxp_md_set_log_level(int level)
 }
 
 
+/** Returns TRUE_ if a message at @a level would be logged. Callers check
+ * this before formatting a message.
+ */
+XIA_SHARED boolean_t dxp_md_log_enabled(int level)
+{
+    return !isSuppressed && (level >= MD_ERROR) && (level <= logLevel);
+}
+
+
 /*****************************************************************************
  *
  * This routine is the main logging routine. It shouldn't be called directly.
@@ -214,53 +261,223 @@ XIA_SHARED int dxp_md_set_log_level(int level)
 XIA_SHARED void dxp_md_log(int level, const char *routine, const char *message,
                            int error, const char *file, int line)
 {
+    dxp_md_LogRecord* record;
+    boolean_t         queued = FALSE_;
+    boolean_t         wake = FALSE_;
+
     /* If logging is disabled or we aren't set
      * to log this message level then return gracefully, NOW!
      */
-    if (isSuppressed || (level > logLevel)) {
-        return;
-    }
-
-    /* Validate level */
-    if ((level > MD_DEBUG) || (level < MD_ERROR)) {
-        /* Don't log the message */
+    if (!dxp_md_log_enabled(level)) {
         return;
     }
 
     /*
-     * Keep the log messaages ordered and sane in a threading environment.
+     * Hand the message to the writer thread if the asynchronous log is
+     * running. A full ring drops the message and the writer reports the
+     * number dropped. Errors are never dropped, they are written here.
      */
+    if (logRing != NULL) {
+        handel_md_mutex_lock(&logRingLock);
+
+        if (logRing != NULL) {
+            if ((logRingHead - logRingTail) < MD_LOG_RING_SIZE) {
+                record = &logRing[logRingHead % MD_LOG_RING_SIZE];
+
+                record->level = level;
+                record->error = error;
+                record->file  = file;
+                record->line  = line;
+                gettimeofday(&record->tod, NULL);
+                strncpy(record->routine, routine, MD_LOG_ROUTINE_LEN - 1);
+                record->routine[MD_LOG_ROUTINE_LEN - 1] = '\0';
+                strncpy(record->message, message, MD_LOG_MESSAGE_LEN - 1);
+                record->message[MD_LOG_MESSAGE_LEN - 1] = '\0';
+
+                wake = (logRingHead == logRingTail);
+                ++logRingHead;
+                queued = TRUE_;
+            } else if (level != MD_ERROR) {
+                ++logRingDropped;
+                queued = TRUE_;
+            }
+        }
+
+        handel_md_mutex_unlock(&logRingLock);
+    }
+
+    if (wake) {
+        handel_md_event_signal(&logRingEvent);
+    }
+
+    if (!queued) {
+        dxp_md_write(level, routine, message, error, file, line);
+    }
+}
+
+
+/*
+ * Drains the log ring to the output. Run by the writer thread and when
+ * the output changes or the asynchronous log stops.
+ */
+HANDEL_STATIC void dxp_md_log_drain(void)
+{
+    dxp_md_LogRecord record;
+    char             buffer[MD_LOG_LINE_LEN];
+    unsigned int     dropped = 0;
+    boolean_t        wrote = FALSE_;
 
     handel_md_mutex_lock(&lock);
 
-    /* Ordinarily, we'd set this in the globals section, but on Linux 'stdout'
-     * isn't a constant, so it can't be used as an initializer.
-     */
     if (out_stream == NULL) {
         out_stream = stdout;
     }
 
-    switch (level) {
-        case MD_ERROR:
-            dxp_md_error(routine, message, &error, file, line);
-            break;
-        case MD_WARNING:
-            dxp_md_warning(routine, message, file, line);
-            break;
-        case MD_INFO:
-            dxp_md_info(routine, message, file, line);
-            break;
-        case MD_DEBUG:
-            dxp_md_debug(routine, message, file, line);
-            break;
-        default:
-            FAIL();
+    for (;;) {
+        handel_md_mutex_lock(&logRingLock);
+
+        if ((logRing == NULL) || (logRingTail == logRingHead)) {
+            dropped = logRingDropped;
+            logRingDropped = 0;
+            handel_md_mutex_unlock(&logRingLock);
             break;
+        }
+
+        record = logRing[logRingTail % MD_LOG_RING_SIZE];
+        ++logRingTail;
+
+        handel_md_mutex_unlock(&logRingLock);
+
+        dxp_md_log_format(buffer, sizeof(buffer), record.level,
+                          record.routine, record.message, record.error,
+                          record.file, record.line, &record.tod);
+        fputs(buffer, out_stream);
+        wrote = TRUE_;
+    }
+
+    if (dropped > 0) {
+        struct timeval tod;
+        char           message[80];
+
+        gettimeofday(&tod, NULL);
+        sprintf(message, "%u log messages dropped, the log ring was full",
+                dropped);
+        dxp_md_log_format(buffer, sizeof(buffer), MD_WARNING,
+                          "dxp_md_log_drain", message, 0, __FILE__, __LINE__,
+                          &tod);
+        fputs(buffer, out_stream);
+        wrote = TRUE_;
+    }
+
+    if (wrote) {
+        fflush(out_stream);
     }
 
     handel_md_mutex_unlock(&lock);
 }
 
+
+/*
+ * Log writer thread entry point.
+ */
+HANDEL_STATIC void dxp_md_log_writer(void* arg)
+{
+    UNUSED(arg);
+
+    while (!logWriterStop) {
+        handel_md_event_wait(&logRingEvent, 100);
+        dxp_md_log_drain();
+    }
+
+    logWriterRunning = FALSE_;
+}
+
+
+/** Starts or stops the asynchronous log. When running, dxp_md_log()
+ * queues messages in a ring drained by a writer thread so the caller
+ * never waits on the output stream. Stopping drains the ring.
+ */
+XIA_SHARED int dxp_md_log_async(boolean_t enable)
+{
+    dxp_md_LogRecord* ring;
+
+    if (enable) {
+        if (logRing != NULL) {
+            return XIA_SUCCESS;
+        }
+
+        if (!handel_md_mutex_ready(&lock))
+            handel_md_mutex_create(&lock);
+
+        if (!handel_md_mutex_ready(&logRingLock) &&
+            (handel_md_mutex_create(&logRingLock) != 0)) {
+            return XIA_THREAD_ERROR;
+        }
+
+        if (!handel_md_event_ready(&logRingEvent) &&
+            (handel_md_event_create(&logRingEvent) != 0)) {
+            return XIA_THREAD_ERROR;
+        }
+
+        ring = malloc(MD_LOG_RING_SIZE * sizeof(dxp_md_LogRecord));
+
+        if (ring == NULL) {
+            return XIA_NOMEM;
+        }
+
+        logWriter.name       = "Handel.log";
+        logWriter.priority   = 0;
+        logWriter.stackSize  = 64 * 1024;
+        logWriter.attributes = 0;
+        logWriter.realtime   = FALSE_;
+        logWriter.entryPoint = dxp_md_log_writer;
+        logWriter.argument   = NULL;
+
+        handel_md_mutex_lock(&logRingLock);
+        logRingHead = 0;
+        logRingTail = 0;
+        logRingDropped = 0;
+        logRing = ring;
+        handel_md_mutex_unlock(&logRingLock);
+
+        logWriterStop = FALSE_;
+        logWriterRunning = TRUE_;
+
+        if (handel_md_thread_create(&logWriter) != 0) {
+            logWriterRunning = FALSE_;
+            handel_md_mutex_lock(&logRingLock);
+            logRing = NULL;
+            handel_md_mutex_unlock(&logRingLock);
+            free(ring);
+            return XIA_THREAD_ERROR;
+        }
+    } else {
+        if (logRing == NULL) {
+            return XIA_SUCCESS;
+        }
+
+        logWriterStop = TRUE_;
+        handel_md_event_signal(&logRingEvent);
+
+        while (logWriterRunning) {
+            handel_md_thread_sleep(10);
+        }
+
+        handel_md_thread_destroy(&logWriter);
+
+        dxp_md_log_drain();
+
+        handel_md_mutex_lock(&logRingLock);
+        ring = logRing;
+        logRing = NULL;
+        handel_md_mutex_unlock(&logRingLock);
+
+        free(ring);
+    }
+
+    return XIA_SUCCESS;
+}
+
 #ifdef WIN32
 /*
  * Win32 implementation of gettimeofday.
@@ -296,34 +513,33 @@ HANDEL_SHARED struct timeval dxp_md_gettimeofday()
 }
 
 /**
- * Returns the current local time as a struct tm for string formatting
- * and the milliseconds on the side for extra precision.
+ * Formats a complete log line, header and message, into @a buffer. The
+ * line is newline terminated and truncated to fit.
  */
-HANDEL_STATIC void dxp_md_local_time(struct tm **local, int *milli)
+HANDEL_STATIC void dxp_md_log_format(char *buffer, size_t size, int level,
+                                     const char *routine, const char *message,
+                                     int error, const char *file, int line,
+                                     const struct timeval *tod)
 {
-    struct timeval tod;
-    gettimeofday(&tod, NULL);
-    *milli = (int) tod.tv_usec / 1000;
-    time_t current = tod.tv_sec;
-    *local = localtime(&current);
-}
+    static const char* types[] = {
+        "[ERROR]", "[WARN ]", "[INFO ]", "[DEBUG]"
+    };
 
-/**
- * Write a standard log format header.
- */
-HANDEL_STATIC void dxp_md_log_header(const char* type, const char* routine,
-                                     int* error_code, const char *file, int line)
-{
-    struct tm *localTime;
-    int milli;
-    char logTimeFormat[80];
+    struct tm localTime;
+    time_t    seconds = (time_t) tod->tv_sec;
+    char      logTimeFormat[80];
 
     const char* basename;
     int out;
+    int len;
 
-    dxp_md_local_time(&localTime, &milli);
+#ifdef WIN32
+    localtime_s(&localTime, &seconds);
+#else
+    localtime_r(&seconds, &localTime);
+#endif
 
-    strftime(logTimeFormat, sizeof(logTimeFormat), "%Y-%m-%d %H:%M:%S", localTime);
+    strftime(logTimeFormat, sizeof(logTimeFormat), "%Y-%m-%d %H:%M:%S", &localTime);
 
     basename = strrchr(file, '/');
     if (basename != NULL) {
@@ -336,72 +552,56 @@ HANDEL_STATIC void dxp_md_log_header(const char* type, const char* routine,
             basename = file;
     }
 
-    out = fprintf(out_stream, "%s %s,%03d %s (%s:%d)",
-                  type, logTimeFormat, milli, routine, basename, line);
+    out = snprintf(buffer, size, "%s %s,%03d %s (%s:%d)",
+                   types[level - MD_ERROR], logTimeFormat,
+                   (int) tod->tv_usec / 1000, routine, basename, line);
 
-    fprintf(out_stream, "%*c ", 90 - out, ':');
+    len = out;
 
-    if (error_code)
-        fprintf(out_stream, "[%3d] ", *error_code);
-}
+    if (len < (int) size)
+        len += snprintf(buffer + len, size - len, "%*c ", 90 - out, ':');
 
-/*****************************************************************************
- *
- * Routine to handle error reporting.  Allows the user to pass errors to log
- * files or report the information in whatever fashion is desired.
- *
- *****************************************************************************/
-HANDEL_STATIC void dxp_md_error(const char* routine, const char* message,
-                                int* error_code, const char *file, int line)
-{
-    dxp_md_log_header("[ERROR]", routine, error_code, file, line);
-    fprintf(out_stream, "%s\n", message);
-    fflush(out_stream);
-}
+    if ((level == MD_ERROR) && (len < (int) size))
+        len += snprintf(buffer + len, size - len, "[%3d] ", error);
 
+    if (len < (int) size)
+        len += snprintf(buffer + len, size - len, "%s\n", message);
 
-/*****************************************************************************
- *
- * Routine to handle reporting warnings. Messages are written to the output
- * defined in out_stream.
- *
- *****************************************************************************/
-HANDEL_STATIC void dxp_md_warning(const char *routine, const char *message,
-                                  const char *file, int line)
-{
-    dxp_md_log_header("[WARN ]", routine, NULL, file, line);
-    fprintf(out_stream, "%s\n", message);
-    fflush(out_stream);
+    if (len >= (int) size) {
+        buffer[size - 2] = '\n';
+        buffer[size - 1] = '\0';
+    }
 }
 
-
-/*****************************************************************************
- *
- * Routine to handle reporting info messages. Messages are written to the
- * output defined in out_stream.
- *
- *****************************************************************************/
-HANDEL_STATIC void dxp_md_info(const char *routine, const char *message,
-                               const char *file, int line)
+/**
+ * Formats and writes a log line to the output. Only the write is done
+ * holding the lock.
+ */
+HANDEL_STATIC void dxp_md_write(int level, const char *routine,
+                                const char *message, int error,
+                                const char *file, int line)
 {
-    dxp_md_log_header("[INFO ]", routine, NULL, file, line);
-    fprintf(out_stream, "%s\n", message);
-    fflush(out_stream);
-}
+    struct timeval tod;
+    char           buffer[MD_LOG_LINE_LEN];
 
+    gettimeofday(&tod, NULL);
 
-/*****************************************************************************
- *
- * Routine to handle reporting debug messages. Messages are written to the
- * output defined in out_stream.
- *
- *****************************************************************************/
-HANDEL_STATIC void dxp_md_debug(const char *routine, const char *message,
-                                const char *file, int line)
-{
-    dxp_md_log_header("[DEBUG]", routine, NULL, file, line);
-    fprintf(out_stream, "%s\n", message);
+    dxp_md_log_format(buffer, sizeof(buffer), level, routine, message,
+                      error, file, line, &tod);
+
+    handel_md_mutex_lock(&lock);
+
+    /* Ordinarily, we'd set this in the globals section, but on Linux 'stdout'
+     * isn't a constant, so it can't be used as an initializer.
+     */
+    if (out_stream == NULL) {
+        out_stream = stdout;
+    }
+
+    fputs(buffer, out_stream);
     fflush(out_stream);
+
+    handel_md_mutex_unlock(&lock);
 }
 
 
@@ -421,12 +621,18 @@ HANDEL_SHARED void dxp_md_output(const char *filename)
     if (!handel_md_mutex_ready(&lock))
         handel_md_mutex_create(&lock);
 
+    /* Queued messages belong to the current output. */
+    dxp_md_log_drain();
+
+    handel_md_mutex_lock(&lock);
+
     if (out_stream != NULL && out_stream != stdout && out_stream != stderr) {
         fclose(out_stream);
     }
 
     if (filename == NULL || STREQ(filename, "")) {
         out_stream = stdout;
+        handel_md_mutex_unlock(&lock);
         return;
     }
 
@@ -458,9 +664,12 @@ HANDEL_SHARED void dxp_md_output(const char *filename)
             out_stream = stdout;
             sprintf(info_string, "Unable to open filename '%s' for logging. "
                     "Output redirected to stdout.", filename);
-            dxp_md_error("dxp_md_output", info_string, &status, __FILE__, __LINE__);
+            dxp_md_write(MD_ERROR, "dxp_md_output", info_string, status,
+                         __FILE__, __LINE__);
         }
     }
 
+    handel_md_mutex_unlock(&lock);
+
     free(strtmp);
 }
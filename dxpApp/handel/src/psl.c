@@ -50,27 +50,19 @@
 #include "handel_generic.h"
 #include "handel_log.h"
 
-#include "md_threads.h"
-
-static char formatBuffer[2048];
-static handel_md_Mutex lock;
-
 /**
- * The PSL layer logging.
+ * The PSL layer logging. Use the pslLog() macro, which skips the call for
+ * messages the log level filters out.
  */
-PSL_SHARED void PSL_API pslLog(int level, const char* file, int line,
-                               const char* routine, int error,
-                               const char* message, ...)
+PSL_SHARED void PSL_API pslLogMessage(int level, const char* file, int line,
+                                      const char* routine, int error,
+                                      const char* message, ...)
 {
+    char formatBuffer[2048];
     va_list args;
 
     va_start(args, message);
 
-    if (!handel_md_mutex_ready(&lock))
-        handel_md_mutex_create(&lock);
-
-    handel_md_mutex_lock(&lock);
-
     /*
      * Cannot use vsnprintf on MinGW currently because is generates
      * an unresolved external.
@@ -80,8 +72,6 @@ PSL_SHARED void PSL_API pslLog(int level, const char* file, int line,
 
     handel_md_log(level, routine, formatBuffer, error, file, line);
 
-    handel_md_mutex_unlock(&lock);
-
     va_end(args);
 }
 
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2026 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Dlldefs.h"
+
+#include "xia_handel.h" /* alloc/free */
+#include "xia_map.h"
+#include "xia_common.h"
+#include "xia_assert.h"
+
+
+/* The table is kept at most half full so probe sequences stay short. */
+#define XIA_MAP_MIN_SIZE 16
+
+
+/** Private functions **/
+static size_t xia__map_hash(const char *key);
+static size_t xia__map_find(const xia_map_t *map, const char *key);
+static int xia__map_grow(xia_map_t *map);
+
+
+/** @brief Adds @a key to the map or replaces its value.
+ *
+ * Returns 0 on success and -1 if the table could not be grown. The map
+ * holds on to @a key, it is not copied.
+ */
+XIA_SHARED int xia_map_put(xia_map_t *map, const char *key, void *value)
+{
+    size_t i;
+
+
+    ASSERT(map != NULL);
+    ASSERT(key != NULL);
+
+
+    if ((map->count + 1) * 2 > map->size) {
+        if (xia__map_grow(map) != 0) {
+            return -1;
+        }
+    }
+
+    i = xia__map_find(map, key);
+
+    if (map->entries[i].key == NULL) {
+        map->count++;
+    }
+
+    map->entries[i].key   = key;
+    map->entries[i].value = value;
+
+    return 0;
+}
+
+
+/** @brief Returns the value for @a key or @c NULL if it is not present.
+ *
+ */
+XIA_SHARED void *xia_map_get(const xia_map_t *map, const char *key)
+{
+    size_t i;
+
+
+    ASSERT(map != NULL);
+    ASSERT(key != NULL);
+
+
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    i = xia__map_find(map, key);
+
+    return map->entries[i].value;
+}
+
+
+/** @brief Removes @a key from the map and returns its value, or @c NULL if
+ * it was not present.
+ *
+ * Uses backward shift deletion so no tombstones are left behind.
+ */
+XIA_SHARED void *xia_map_remove(xia_map_t *map, const char *key)
+{
+    size_t i;
+    size_t j;
+    size_t home;
+    size_t mask;
+
+    void *value;
+
+
+    ASSERT(map != NULL);
+    ASSERT(key != NULL);
+
+
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    i = xia__map_find(map, key);
+
+    if (map->entries[i].key == NULL) {
+        return NULL;
+    }
+
+    value = map->entries[i].value;
+    mask  = map->size - 1;
+
+    /* Shift back any entry in the following run that would no longer be
+     * reachable from its home slot once slot i is emptied.
+     */
+    for (j = (i + 1) & mask; map->entries[j].key != NULL; j = (j + 1) & mask) {
+        home = xia__map_hash(map->entries[j].key) & mask;
+
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map->entries[i] = map->entries[j];
+            i = j;
+        }
+    }
+
+    map->entries[i].key   = NULL;
+    map->entries[i].value = NULL;
+    map->count--;
+
+    return value;
+}
+
+
+/** @brief Removes all of the entries and releases the table.
+ *
+ */
+XIA_SHARED void xia_map_clear(xia_map_t *map)
+{
+    ASSERT(map != NULL);
+
+
+    if (map->entries != NULL) {
+        handel_md_free(map->entries);
+    }
+
+    map->entries = NULL;
+    map->size    = 0;
+    map->count   = 0;
+}
+
+
+/** @brief FNV-1a hash of a NULL-terminated string.
+ *
+ */
+static size_t xia__map_hash(const char *key)
+{
+    unsigned long h = 2166136261UL;
+
+
+    while (*key != '\0') {
+        h ^= (unsigned char)*key++;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+
+    return (size_t)h;
+}
+
+
+/** @brief Returns the slot holding @a key or the empty slot where it would
+ * be inserted. The table must have been allocated.
+ */
+static size_t xia__map_find(const xia_map_t *map, const char *key)
+{
+    size_t i;
+    size_t mask = map->size - 1;
+
+
+    for (i = xia__map_hash(key) & mask;
+         map->entries[i].key != NULL;
+         i = (i + 1) & mask) {
+        if (STREQ(map->entries[i].key, key)) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/** @brief Doubles the size of the table and rehashes the entries.
+ *
+ */
+static int xia__map_grow(xia_map_t *map)
+{
+    size_t i;
+    size_t j;
+    size_t size;
+    size_t mask;
+
+    xia_map_entry_t *entries = NULL;
+
+
+    size = map->size == 0 ? XIA_MAP_MIN_SIZE : map->size * 2;
+    mask = size - 1;
+
+    entries = handel_md_alloc(size * sizeof(xia_map_entry_t));
+
+    if (entries == NULL) {
+        return -1;
+    }
+
+    memset(entries, 0, size * sizeof(xia_map_entry_t));
+
+    for (i = 0; i < map->size; i++) {
+        if (map->entries[i].key == NULL) {
+            continue;
+        }
+
+        for (j = xia__map_hash(map->entries[i].key) & mask;
+             entries[j].key != NULL;
+             j = (j + 1) & mask) {
+            /* Find the first empty slot. */
+        }
+
+        entries[j] = map->entries[i];
+    }
+
+    if (map->entries != NULL) {
+        handel_md_free(map->entries);
+    }
+
+    map->entries = entries;
+    map->size    = size;
+
+    return 0;
+}
@@ -36,6 +36,10 @@
  */
 
 
+#ifdef WIN32
+#include <windows.h>
+#endif
+
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
@@ -48,6 +52,7 @@
 
 static void plot_graph(unsigned int* adc_trace, int size, int scale);
 static void CHECK_ERROR(int status);
+static int SEC_SLEEP(float *time);
 
 static void usage(const char* prog)
 {
@@ -57,6 +62,7 @@ static void usage(const char* prog)
     printf(" -s step       : Set the step size\n");
     printf(" -i iterations : The number of traces to capture\n");
     printf(" -c count      : The number of samples\n");
+    printf(" -C            : Run the oscilloscope continuously\n");
     printf(" -f file       : Handel INI file to load\n");
 }
 
@@ -69,6 +75,7 @@ int main(int argc, char *argv[])
     int           iters = 10;
     int           gain = 0;
     int           scale = 0;
+    int           continuous = 0;
     int           p;
     int           a;
     char          ini[256] = "t_api/sandbox/xia_test_helper.ini";
@@ -116,6 +123,11 @@ int main(int argc, char *argv[])
                     }
                     size = atoi(argv[a]);
                     break;
+
+                case 'C':
+                    continuous = 1;
+                    break;
+
                 case 'f':
                     ++a;
                     if (a >= argc) {
@@ -161,8 +173,58 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (continuous) {
+        unsigned int* adc_trace;
+        unsigned long dropped;
+        int           available;
+        float         poll = 0.001f;
+
+        printf("Start continuous ADC Trace run.\n");
+        status = xiaDoSpecialRun(0, "adc_trace_stream_start", &size);
+        CHECK_ERROR(status);
+
+        adc_trace = malloc(sizeof(unsigned int) * (size_t)size);
+        if (!adc_trace) {
+            printf("No memory for ADC trace data\n");
+            xiaDoSpecialRun(0, "adc_trace_stream_stop", NULL);
+            CHECK_ERROR(XIA_NOMEM);
+        }
+
+        /* Take each trace as the box sends it. */
+        for (p = 0; p < iters; ) {
+            status = xiaGetSpecialRunData(0, "adc_trace_available", &available);
+            if (status != XIA_SUCCESS)
+                break;
+
+            if (available == 0) {
+                SEC_SLEEP(&poll);
+                continue;
+            }
+
+            status = xiaGetSpecialRunData(0, "adc_trace_next", adc_trace);
+            if (status != XIA_SUCCESS)
+                break;
+
+            plot_graph(adc_trace, (int)size, scale);
+            ++p;
+        }
+
+        free(adc_trace);
+
+        if (status == XIA_SUCCESS)
+            status = xiaGetSpecialRunData(0, "adc_trace_dropped", &dropped);
+        if (status == XIA_SUCCESS)
+            printf("Traces: %d, dropped: %lu\n", p, dropped);
+
+        xiaDoSpecialRun(0, "adc_trace_stream_stop", NULL);
+        CHECK_ERROR(status);
+
+        iters = 0;
+    }
+
     /* Use special run which returns, then poll */
-    printf("Start ADC Trace run.\n");
+    if (iters)
+        printf("Start ADC Trace run.\n");
     /* Number of plots to make. */
     for (p = 0; p < iters; ++p) {
         unsigned int* adc_trace;
@@ -271,6 +333,29 @@ static void plot_graph(unsigned int* adc_trace, int size, int scale)
     }
     printf("\n");
 }
+static int SEC_SLEEP(float *time)
+{
+#ifdef WIN32
+    DWORD wait = (DWORD)(1000.0 * (*time));
+    Sleep(wait);
+#else
+    unsigned long secs = (unsigned long) *time;
+    struct timespec req = {
+                           .tv_sec = (time_t) secs,
+                           .tv_nsec = (time_t) ((*time - secs) * 1000000000.0f)
+    };
+    struct timespec rem = {
+                           .tv_sec = 0,
+                           .tv_nsec = 0
+    };
+    while (TRUE_) {
+        if (nanosleep(&req, &rem) == 0)
+            break;
+        req = rem;
+    }
+#endif
+    return XIA_SUCCESS;
+}
 
 /*
  * This is just an example of how to handle error values.  A program
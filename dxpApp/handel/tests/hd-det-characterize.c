@@ -160,20 +160,19 @@ int main(int argc, char** argv)
     while (interval < TIMEOUT)
     {
         int running = 0;
+        int all_percentage = 0;
         float waitfor = 0.050f;
         int channel;
 
-        for (channel = 0; channel < channels; ++channel)
-        {
-            int channel_running = 0;
-            status = xiaGetSpecialRunData(channel, "detc-running", &channel_running);
-            CHECK_ERROR(status);
-
-            if (channel_running)
-                ++running;
-        }
+        /*
+         * The channels run as one job. Running counts the channels whose
+         * results are yet to be collected.
+         */
+        status = xiaGetSpecialRunData(-1, "detc-all-running", &running);
+        CHECK_ERROR(status);
 
-        printf("\r");
+        status = xiaGetSpecialRunData(-1, "detc-all-percentage", &all_percentage);
+        CHECK_ERROR(status);
 
         for (channel = 0; channel < channels; ++channel)
         {
@@ -182,8 +181,6 @@ int main(int argc, char** argv)
 
             status = xiaGetSpecialRunData(channel, "detc-progress-text", &text[0]);
             CHECK_ERROR(status);
-            printf("%3d%% %s%*c\r",
-                   percentage, text, (int) (65 - strlen(text)), ' ');
 
             if (percentage != last_percentage[channel])
             {
@@ -192,6 +189,8 @@ int main(int argc, char** argv)
             }
         }
 
+        printf("\r%3d%% %d running %s%*c",
+               all_percentage, running, text, (int) (55 - strlen(text)), ' ');
         fflush(stdout);
 
         if (running == 0)
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Runs Handel against the SINC simulator in this process with no network
+ * or separate simulator. The simulator runs on a thread and libsinc's
+ * loopback transport connects the module to it. A gated MM1 run is made
+ * and the pixels in the buffers plus the dropped pixels are checked
+ * against the pixels asked for. Exits with 0 if the run passes and 1 if
+ * it fails.
+ *
+ * Before the run the detector polarity is toggled and read back to
+ * check the PSL's parameter mirror follows the settings. The simulator
+ * is then rebooted with the polarity negative to check the module
+ * reconnects and sets the polarity on the box again.
+ *
+ * Use -D to have the simulator drop gated histograms to exercise the
+ * PSL's pixel recovery. Drops that end the run are reported in a buffer
+ * with no pixels.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "xia_common.h"
+
+#include "handel.h"
+#include "handel_constants.h"
+#include "handel_errors.h"
+
+#include "md_generic.h"
+
+#include "sinc.h"
+
+#include "sim_device.h"
+
+
+#define A 0
+#define B 1
+
+#define SWAP_BUFFER(x) ((x) == A ? B : A)
+
+/*
+ * Fail the run if no buffer fills for this long.
+ */
+#define STALL_TIMEOUT (10.0)
+
+/*
+ * The number of polarity settings checked before the run. Even so the
+ * polarity ends up positive.
+ */
+#define PARAM_CHECKS (200)
+
+/*
+ * Fail the reconnect check if the connection is not restored in this
+ * long.
+ */
+#define RECONNECT_TIMEOUT (10.0)
+
+static const char* INI =
+    "[detector definitions]\n"
+    "START #0\n"
+    "alias = detector1\n"
+    "number_of_channels = 1\n"
+    "type = reset\n"
+    "type_value = 10.000\n"
+    "channel0_gain = 5.000000\n"
+    "channel0_polarity = +\n"
+    "END #0\n"
+    "\n"
+    "[firmware definitions]\n"
+    "START #0\n"
+    "alias = firmware1\n"
+    "filename = null\n"
+    "num_keywords = 0\n"
+    "END #0\n"
+    "\n"
+    "[module definitions]\n"
+    "START #0\n"
+    "alias = module1\n"
+    "module_type = falconxn\n"
+    "interface = inet\n"
+    "inet_address = loopback\n"
+    "inet_port = 8756\n"
+    "inet_timeout = 1000\n"
+    "number_of_channels = 1\n"
+    "channel0_alias = 0\n"
+    "channel0_detector = detector1:0\n"
+    "firmware_set_chan0 = firmware1\n"
+    "END #0\n";
+
+static Sim sim;
+static char ini[] = "/tmp/hd-loopback-XXXXXX";
+
+static double loopback_now(void);
+static void loopback_sleep(double time);
+static void print_usage(void);
+
+
+static void loopback_exit(void)
+{
+    xiaExit();
+    sim_stop(&sim);
+    sim_close(&sim);
+    unlink(ini);
+}
+
+static void check(int status, const char* what)
+{
+    if (status != XIA_SUCCESS) {
+        xiaStopRun(-1);
+        loopback_exit();
+        fprintf(stderr, "Error %s: %d.\n", what, status);
+        exit(1);
+    }
+}
+
+static uint32_t header_read32(uint16_t* buffer)
+{
+    return (((uint32_t) buffer[1]) << 16) | (uint32_t) buffer[0];
+}
+
+int main(int argc, char *argv[])
+{
+    int ignore;
+    int fd;
+
+    double mode = 1.0;
+    double advance = XIA_MAPPING_CTL_GATE;
+    double num_map_pixels = 1000.0;
+    double num_map_pixels_per_buffer = 50.0;
+    double mca_channels = 1024.0;
+
+    const char *buffer_str[2] = {
+        "buffer_a",
+        "buffer_b"
+    };
+
+    const char *buffer_full_str[2] = {
+        "buffer_full_a",
+        "buffer_full_b"
+    };
+
+    const char buffer_done_char[2] = {
+        'a',
+        'b'
+    };
+
+    int current = A;
+
+    unsigned long pixels = 0;
+    unsigned long drops = 0;
+    unsigned long buffers = 0;
+    unsigned long bad_buffers = 0;
+    unsigned long overruns = 0;
+    unsigned long param_errors = 0;
+    unsigned long link_state = 0;
+    double connection[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+    int reconnected = 0;
+    const SimParam* invert;
+
+    unsigned long bufferLength = 0;
+    uint32_t *buffer = NULL;
+
+    double start;
+    double last_read;
+
+    double param_secs;
+    double polarity;
+
+    int arg = 1;
+    int failed;
+    int i;
+
+    sim_init(&sim);
+    sim.numChannels = 1;
+    sim.pixelRate = 5000.0;
+    sim.verbose = 0;
+
+    while (arg < argc) {
+        if (argv[arg][0] == '-') {
+            if (strlen(argv[arg]) != 2) {
+                fprintf(stderr, "error: invalid option: %s\n", argv[arg]);
+                exit(1);
+            }
+
+            switch (argv[arg][1]) {
+            case 'p':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -p requires the number of pixels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &num_map_pixels);
+                ++arg;
+                break;
+            case 'b':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -b requires the pixels per buffer\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &num_map_pixels_per_buffer);
+                ++arg;
+                break;
+            case 'r':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -r requires the pixel rate\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &sim.pixelRate);
+                ++arg;
+                break;
+            case 'D':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -D requires the drop interval\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%u", &sim.dropEvery);
+                ++arg;
+                break;
+            case 'v':
+                sim.verbose = 2;
+                ++arg;
+                break;
+            case '?':
+                print_usage();
+                exit(0);
+            default:
+                fprintf(stderr, "error: invalid option; try -?\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "error: invalid option; try -?\n");
+            exit(1);
+        }
+    }
+
+    if ((num_map_pixels < 1) || (num_map_pixels_per_buffer < 1) ||
+        (sim.pixelRate <= 0)) {
+        fprintf(stderr, "error: invalid run settings; try -?\n");
+        exit(1);
+    }
+
+    fd = mkstemp(ini);
+    if ((fd < 0) || (write(fd, INI, strlen(INI)) != (ssize_t) strlen(INI))) {
+        fprintf(stderr, "Unable to write the ini file '%s'.\n", ini);
+        exit(1);
+    }
+    close(fd);
+
+    if ((sim_open(&sim) != 0) || (sim_start(&sim) != 0)) {
+        unlink(ini);
+        fprintf(stderr, "Unable to start the simulator.\n");
+        exit(1);
+    }
+
+    SincLoopbackSetPeer(sim_loopback_accept, &sim);
+
+    xiaSetLogLevel(MD_WARNING);
+    xiaSetLogOutput("handel.log");
+
+    check(xiaInit(ini), "initializing Handel");
+    check(xiaStartSystem(), "starting the system");
+
+    start = loopback_now();
+
+    for (i = 0; i < PARAM_CHECKS; i++) {
+        double readback = -1.0;
+
+        polarity = (double) (i % 2);
+
+        check(xiaSetAcquisitionValues(0, "detector_polarity", &polarity),
+              "setting 'detector_polarity'");
+        check(xiaGetAcquisitionValues(0, "detector_polarity", &readback),
+              "getting 'detector_polarity'");
+
+        if (readback != polarity)
+            param_errors++;
+    }
+
+    param_secs = loopback_now() - start;
+
+    /*
+     * The box comes back with its defaults so the negative polarity is
+     * only there if the module restored it.
+     */
+    polarity = 0.0;
+    check(xiaSetAcquisitionValues(0, "detector_polarity", &polarity),
+          "setting 'detector_polarity'");
+
+    sim_reboot(&sim);
+
+    start = loopback_now();
+
+    while ((loopback_now() - start) < RECONNECT_TIMEOUT) {
+        loopback_sleep(0.01);
+        check(xiaBoardOperation(0, "get_connection_status", connection),
+              "getting the connection status");
+        if ((connection[0] == 0.0) && (connection[1] >= 1.0))
+            break;
+    }
+
+    check(xiaGetRunData(0, "connection_state", &link_state),
+          "getting the connection state");
+
+    invert = sim_param(&sim, 0, "afe.invert");
+
+    reconnected = (connection[0] == 0.0) && (connection[1] >= 1.0) &&
+        (link_state == 0) && (invert != NULL) && (invert->boolval != 0);
+
+    polarity = 1.0;
+    check(xiaSetAcquisitionValues(0, "detector_polarity", &polarity),
+          "setting 'detector_polarity'");
+
+    check(xiaSetAcquisitionValues(-1, "mapping_mode", &mode),
+          "setting 'mapping_mode'");
+    check(xiaSetAcquisitionValues(-1, "pixel_advance_mode", &advance),
+          "setting 'pixel_advance_mode'");
+    check(xiaSetAcquisitionValues(-1, "number_mca_channels", &mca_channels),
+          "setting 'number_mca_channels'");
+    check(xiaSetAcquisitionValues(-1, "num_map_pixels_per_buffer",
+                                  &num_map_pixels_per_buffer),
+          "setting 'num_map_pixels_per_buffer'");
+    check(xiaSetAcquisitionValues(-1, "num_map_pixels", &num_map_pixels),
+          "setting 'num_map_pixels'");
+    check(xiaBoardOperation(0, "apply", &ignore), "applying the mode settings");
+
+    check(xiaGetRunData(0, "buffer_len", &bufferLength), "reading 'buffer_len'");
+
+    buffer = malloc(bufferLength * sizeof(uint32_t));
+    if (!buffer)
+        check(XIA_NOMEM, "allocating the buffer");
+
+    check(xiaStartRun(-1, 0), "starting the mapping run");
+
+    start = loopback_now();
+    last_read = start;
+
+    for (;;) {
+        unsigned long active = 0;
+        int buffer_full = 0;
+        int buffer_overrun = 0;
+
+        check(xiaGetRunData(0, "run_active", &active), "getting the run active status");
+        check(xiaGetRunData(0, buffer_full_str[current], &buffer_full),
+              "getting the buffer status");
+
+        if (buffer_full) {
+            uint16_t* in = (uint16_t*) buffer;
+            char c = buffer_done_char[current];
+
+            check(xiaGetRunData(0, buffer_str[current], buffer), "reading the buffer");
+            check(xiaBoardOperation(0, "buffer_done", (void*) &c),
+                  "setting the buffer to done");
+
+            if ((header_read32(&in[26]) > bufferLength * 2) ||
+                (in[8] > num_map_pixels_per_buffer))
+                bad_buffers++;
+
+            pixels += in[8];
+            drops += in[25];
+            buffers++;
+
+            last_read = loopback_now();
+            current = SWAP_BUFFER(current);
+        }
+
+        check(xiaGetRunData(0, "buffer_overrun", &buffer_overrun),
+              "getting the overrun status");
+        overruns += (unsigned long) buffer_overrun;
+
+        if (!buffer_full) {
+            if (!active)
+                break;
+            if ((loopback_now() - last_read) >= STALL_TIMEOUT) {
+                fprintf(stderr, "Timeout on buffer filling.\n");
+                break;
+            }
+            loopback_sleep(0.001);
+        }
+    }
+
+    check(xiaStopRun(-1), "stopping the mapping run");
+
+    free(buffer);
+    loopback_exit();
+
+    /*
+     * Every pixel is either in a buffer or counted as dropped. Pixels are
+     * lost if the buffers overrun so that fails the run.
+     */
+    failed = (pixels + drops != (unsigned long) num_map_pixels) ||
+        (bad_buffers != 0) || (overruns != 0) || (param_errors != 0) ||
+        !reconnected ||
+        ((sim.dropEvery == 0) && (drops != 0));
+
+    printf("loopback: params: %d set and read back, %lu wrong in %.3f secs\n",
+           PARAM_CHECKS, param_errors, param_secs);
+
+    printf("loopback: reconnect: %s: outages=%.0f attempts=%.0f restored=%.0f "
+           "in %.3f secs\n",
+           reconnected ? "pass" : "FAIL", connection[1], connection[2],
+           connection[4], connection[3]);
+
+    printf("loopback: %s: pixels=%lu/%.0f buffers=%lu bad=%lu overruns=%lu "
+           "dropped=%lu sim sent=%llu dropped=%llu in %.3f secs\n",
+           failed ? "FAIL" : "pass", pixels, num_map_pixels, buffers,
+           bad_buffers, overruns, drops, (unsigned long long) sim.pixelsSent,
+           (unsigned long long) sim.pixelsDropped, last_read - start);
+
+    return failed ? 1 : 0;
+}
+
+
+static double loopback_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1.0e9);
+}
+
+
+static void loopback_sleep(double time)
+{
+    struct timespec req = {
+        .tv_sec = (time_t) time,
+        .tv_nsec = (long) ((time - (time_t) time) * 1000000000.0)
+    };
+    struct timespec rem;
+    while (nanosleep(&req, &rem) != 0)
+        req = rem;
+}
+
+
+static void print_usage(void)
+{
+    fprintf(stdout,
+            "hd-loopback [options]\n" \
+            "options and arguments: \n" \
+            " -?           : help\n" \
+            " -p pixels    : number of pixels, default 1000\n" \
+            " -b pixels    : pixels per buffer, default 50\n" \
+            " -r rate      : simulated pixels per second, default 5000\n" \
+            " -D n         : simulator drops every n'th pixel, default 0 (none)\n" \
+            " -v           : verbose simulator, log every command\n" \
+            "Where:\n" \
+            " The simulator runs in this process. No FalconX or network is\n" \
+            " used.\n");
+    return;
+}
@@ -0,0 +1,1043 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Microbenchmarks for the data path primitives: SINC packet framing and
+ * histogram decoding, the protobuf-c unpackers, list mode parsing and
+ * the MM1 buffer routines. Each is run on synthetic data of realistic
+ * size and timed in ns/op, GB/s and heap allocations per op.
+ *
+ * Each benchmark is timed over several passes and the fastest kept.
+ * Results can be saved as a baseline with -s and later runs compared
+ * against it with -b. A benchmark slower than the baseline by more than
+ * the threshold or making more allocations is a regression and the
+ * exit status is non-zero.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "xia_common.h"
+
+#include "handel.h"
+#include "handel_errors.h"
+
+#include "md_generic.h"
+
+#include "falconx_mm.h"
+
+#include "sinc.h"
+#include "sinc_internal.h"
+#include "lmbuf.h"
+
+
+/*
+ * Realistic sizes: a 4096 bin histogram with accepted and rejected
+ * plots, a socket read's worth of packets and a 64 pixel MM1 buffer.
+ */
+#define HISTOGRAM_BINS      4096
+#define PACKETS_PER_READ    16
+#define GET_PARAM_RESULTS   10
+#define LM_PULSES           200000
+#define LM_CHUNK_SIZE       65536
+#define LM_BATCH_PULSES     16384
+#define LM_BATCH_SIDE       256
+#define MM1_PIXELS          64
+
+#define MAX_BENCHMARKS      32
+#define REPEATS             3
+#define NAME_SIZE           64
+
+
+/*
+ * Count heap allocations by wrapping the C library's allocator. Only
+ * glibc provides the underlying entry points.
+ */
+#if defined(__GLIBC__)
+#define COUNT_ALLOCATIONS 1
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static unsigned long allocations;
+
+void* malloc(size_t size)
+{
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    ++allocations;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    ++allocations;
+    return __libc_realloc(ptr, size);
+}
+#else
+#define COUNT_ALLOCATIONS 0
+
+static unsigned long allocations;
+#endif
+
+
+typedef void (*BenchOp)(void* context);
+
+typedef struct {
+    char   name[NAME_SIZE];
+    double ns;
+    double gbs;
+    double allocs;
+} BenchResult;
+
+typedef struct {
+    BenchResult results[MAX_BENCHMARKS];
+    int         count;
+    double      minTime;
+    const char* filter;
+} Bench;
+
+typedef struct {
+    SincBuffer stream;
+    SincBuffer read;
+    SincBuffer packet;
+    int        packets;
+} NextPacketContext;
+
+typedef struct {
+    SincBuffer packet;
+} DecodeContext;
+
+typedef struct {
+    uint8_t* data;
+    size_t   len;
+} UnpackContext;
+
+typedef struct {
+    uint8_t* data;
+    size_t   len;
+    size_t   packets;
+    size_t   pulses;
+    LmBuf    lm;
+    LmBatch  batch;
+} ListModeContext;
+
+typedef struct {
+    MM_Control     mmc;
+    MMC1_Data*     mm1;
+    uint32_t*      histogram;
+    uint32_t*      out;
+    size_t         outSize;
+    MM_Pixel_Stats stats;
+} MappingContext;
+
+
+static double bench_now(void);
+static void bench_run(Bench* bench, const char* name, BenchOp op, void* context,
+                      size_t opsPerCall, size_t bytesPerCall);
+static int bench_sinc(Bench* bench);
+static int bench_protobuf(Bench* bench);
+static int bench_list_mode(Bench* bench);
+static int bench_mapping(Bench* bench);
+static int bench_save(Bench* bench, const char* file);
+static int bench_compare(Bench* bench, const char* file, double threshold);
+static void print_usage(void);
+
+
+int main(int argc, char *argv[])
+{
+    const char* baseline = NULL;
+    const char* save = NULL;
+    double threshold = 10.0;
+
+    Bench bench;
+
+    int status;
+    int arg = 1;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.minTime = 0.5;
+
+    while (arg < argc) {
+        if (argv[arg][0] == '-') {
+            if (strlen(argv[arg]) != 2) {
+                fprintf(stderr, "error: invalid option: %s\n", argv[arg]);
+                exit(1);
+            }
+
+            switch (argv[arg][1]) {
+            case 'b':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -b requires a file\n");
+                    exit(1);
+                }
+                baseline = argv[arg];
+                ++arg;
+                break;
+            case 's':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -s requires a file\n");
+                    exit(1);
+                }
+                save = argv[arg];
+                ++arg;
+                break;
+            case 't':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -t requires a percentage\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &threshold);
+                ++arg;
+                break;
+            case 'T':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -T requires the seconds\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &bench.minTime);
+                ++arg;
+                break;
+            case 'n':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -n requires a name\n");
+                    exit(1);
+                }
+                bench.filter = argv[arg];
+                ++arg;
+                break;
+            case '?':
+                print_usage();
+                exit(0);
+            default:
+                fprintf(stderr, "error: invalid option; try -?\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "error: invalid option; try -?\n");
+            exit(1);
+        }
+    }
+
+    if ((bench.minTime <= 0) || (threshold < 0)) {
+        fprintf(stderr, "error: invalid time or threshold; try -?\n");
+        exit(1);
+    }
+
+    /*
+     * The mapping routines log through Handel.
+     */
+    status = xiaInitHandel();
+
+    if (status != XIA_SUCCESS) {
+        fprintf(stderr, "Unable to initialize Handel.\n");
+        exit(1);
+    }
+
+    xiaSetLogLevel(MD_ERROR);
+
+    printf("%-28s %12s %10s %10s\n", "benchmark", "ns/op", "GB/s", "allocs/op");
+
+    status = bench_sinc(&bench);
+
+    if (status == XIA_SUCCESS)
+        status = bench_protobuf(&bench);
+
+    if (status == XIA_SUCCESS)
+        status = bench_list_mode(&bench);
+
+    if (status == XIA_SUCCESS)
+        status = bench_mapping(&bench);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Benchmark setup failed: %d\n", status);
+        exit(1);
+    }
+
+    if (save) {
+        status = bench_save(&bench, save);
+
+        if (status != XIA_SUCCESS) {
+            xiaExit();
+            fprintf(stderr, "Unable to save the baseline to '%s'.\n", save);
+            exit(1);
+        }
+    }
+
+    if (baseline) {
+        status = bench_compare(&bench, baseline, threshold);
+        fflush(stdout);
+
+        if (status < 0) {
+            xiaExit();
+            fprintf(stderr, "Unable to read the baseline '%s'.\n", baseline);
+            exit(1);
+        }
+
+        if (status > 0) {
+            xiaExit();
+            fprintf(stderr, "%d regression(s) against '%s'.\n", status, baseline);
+            exit(2);
+        }
+    }
+
+    xiaExit();
+
+    return 0;
+}
+
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1.0e9);
+}
+
+
+/*
+ * Call the op enough times to run for the minimum time and record the
+ * cost of each op. A call can perform more than one op, for example
+ * splitting a read into its packets.
+ */
+static void bench_run(Bench* bench, const char* name, BenchOp op, void* context,
+                      size_t opsPerCall, size_t bytesPerCall)
+{
+    BenchResult* result;
+
+    unsigned long calls = 1;
+    unsigned long c;
+    unsigned long allocs;
+    double elapsed;
+    double ops;
+    int repeat;
+
+    if (bench->filter && !strstr(name, bench->filter))
+        return;
+
+    if (bench->count == MAX_BENCHMARKS)
+        return;
+
+    /*
+     * Warm the caches and any lazily grown buffers.
+     */
+    op(context);
+
+    for (;;) {
+        double start;
+
+        allocs = allocations;
+        start = bench_now();
+
+        for (c = 0; c < calls; ++c)
+            op(context);
+
+        elapsed = bench_now() - start;
+        allocs = allocations - allocs;
+
+        if (elapsed >= bench->minTime)
+            break;
+
+        /*
+         * Aim past the minimum time so the next pass is the last.
+         */
+        if (elapsed < (bench->minTime / 100.0))
+            calls *= 100;
+        else
+            calls = (unsigned long) ((double) calls * (bench->minTime * 1.2) / elapsed) + 1;
+    }
+
+    /*
+     * Keep the fastest pass. Slower passes are other load on the host.
+     */
+    for (repeat = 1; repeat < REPEATS; ++repeat) {
+        double start = bench_now();
+        double pass;
+
+        for (c = 0; c < calls; ++c)
+            op(context);
+
+        pass = bench_now() - start;
+
+        if (pass < elapsed)
+            elapsed = pass;
+    }
+
+    ops = (double) calls * (double) opsPerCall;
+
+    result = &bench->results[bench->count++];
+    strncpy(result->name, name, sizeof(result->name) - 1);
+    result->ns = (elapsed * 1.0e9) / ops;
+    result->gbs = ((double) calls * (double) bytesPerCall) / elapsed / 1.0e9;
+    result->allocs = COUNT_ALLOCATIONS ? (double) allocs / ops : -1.0;
+
+    printf("%-28s %12.1f %10.3f ", result->name, result->ns, result->gbs);
+    if (result->allocs >= 0)
+        printf("%10.2f\n", result->allocs);
+    else
+        printf("%10s\n", "n/a");
+    fflush(stdout);
+}
+
+
+/*
+ * A histogram data packet as the box sends it: the protobuf header
+ * length and header then the accepted and rejected plots.
+ */
+static void histogram_payload(SincBuffer* buf, uint64_t dataSetId,
+                              uint32_t* accepted, uint32_t* rejected)
+{
+    SiToro__Sinc__HistogramDataResponse resp;
+    uint32_t plotLen[2] = { HISTOGRAM_BINS, HISTOGRAM_BINS };
+    uint16_t headerLen;
+
+    si_toro__sinc__histogram_data_response__init(&resp);
+    resp.has_channelid = 1;
+    resp.channelid = 0;
+    resp.has_datasetid = 1;
+    resp.datasetid = dataSetId;
+    resp.has_timeelapsed = 1;
+    resp.timeelapsed = 0.001 * (double) dataSetId;
+    resp.has_samplesdetected = 1;
+    resp.samplesdetected = 123456;
+    resp.has_sampleserased = 1;
+    resp.sampleserased = 12;
+    resp.has_pulsesaccepted = 1;
+    resp.pulsesaccepted = 98765;
+    resp.has_pulsesrejected = 1;
+    resp.pulsesrejected = 4321;
+    resp.has_inputcountrate = 1;
+    resp.inputcountrate = 100000.0;
+    resp.has_outputcountrate = 1;
+    resp.outputcountrate = 90909.0;
+    resp.has_deadtimepercent = 1;
+    resp.deadtimepercent = 9.1;
+    resp.has_gatestate = 1;
+    resp.gatestate = 1;
+    resp.has_spectrumselectionmask = 1;
+    resp.spectrumselectionmask = SINC_SPECTRUMSELECT_ACCEPTED | SINC_SPECTRUMSELECT_REJECTED;
+    resp.has_subregionstartindex = 1;
+    resp.subregionstartindex = 0;
+    resp.has_subregionendindex = 1;
+    resp.subregionendindex = HISTOGRAM_BINS;
+    resp.has_refreshrate = 1;
+    resp.refreshrate = 100;
+    resp.has_trigger = 1;
+    resp.trigger = SI_TORO__SINC__HISTOGRAM_TRIGGER__GATE_CHANGE;
+    resp.n_plotlen = 2;
+    resp.plotlen = plotLen;
+
+    headerLen = (uint16_t) si_toro__sinc__histogram_data_response__get_packed_size(&resp);
+
+    buf->cbuf.base.append(&buf->cbuf.base, sizeof(headerLen), (const uint8_t*) &headerLen);
+    si_toro__sinc__histogram_data_response__pack_to_buffer(&resp, &buf->cbuf.base);
+    buf->cbuf.base.append(&buf->cbuf.base, HISTOGRAM_BINS * sizeof(uint32_t),
+                          (const uint8_t*) accepted);
+    buf->cbuf.base.append(&buf->cbuf.base, HISTOGRAM_BINS * sizeof(uint32_t),
+                          (const uint8_t*) rejected);
+}
+
+
+static void op_next_packet(void* context)
+{
+    NextPacketContext* ctx = context;
+    SiToro__Sinc__MessageType packetType;
+    int found;
+
+    ctx->read.cbuf.len = 0;
+    ctx->read.cbuf.base.append(&ctx->read.cbuf.base, ctx->stream.cbuf.len,
+                               ctx->stream.cbuf.data);
+
+    do {
+        SincGetNextPacketFromBuffer(&ctx->read, &packetType, &ctx->packet, &found);
+    } while (found);
+}
+
+
+static void op_decode_histogram(void* context)
+{
+    DecodeContext* ctx = context;
+    SincError se;
+    SincHistogram accepted;
+    SincHistogram rejected;
+    SincHistogramCountStats stats;
+    int channel;
+
+    memset(&stats, 0, sizeof(stats));
+
+    if (SincDecodeHistogramDataResponse(&se, &ctx->packet, &channel,
+                                        &accepted, &rejected, &stats)) {
+        free(accepted.data);
+        free(rejected.data);
+        free(stats.intensityData);
+    }
+}
+
+
+static int bench_sinc(Bench* bench)
+{
+    NextPacketContext next;
+    DecodeContext decode;
+
+    uint8_t streamPad[256];
+    uint8_t readPad[256];
+    uint8_t packetPad[256];
+    uint8_t decodePad[256];
+    uint32_t* accepted;
+    uint32_t* rejected;
+    int i;
+
+    accepted = malloc(HISTOGRAM_BINS * sizeof(uint32_t));
+    rejected = malloc(HISTOGRAM_BINS * sizeof(uint32_t));
+
+    if (!accepted || !rejected) {
+        free(accepted);
+        free(rejected);
+        return XIA_NOMEM;
+    }
+
+    for (i = 0; i < HISTOGRAM_BINS; ++i) {
+        accepted[i] = (uint32_t) (i * 7) % 1000;
+        rejected[i] = (uint32_t) (i * 3) % 100;
+    }
+
+    {
+        SincBuffer stream = SINC_BUFFER_INIT(streamPad);
+        SincBuffer read = SINC_BUFFER_INIT(readPad);
+        SincBuffer packet = SINC_BUFFER_INIT(packetPad);
+        next.stream = stream;
+        next.read = read;
+        next.packet = packet;
+    }
+    next.packets = PACKETS_PER_READ;
+
+    for (i = 0; i < PACKETS_PER_READ; ++i) {
+        uint8_t payloadPad[256];
+        SincBuffer payload = SINC_BUFFER_INIT(payloadPad);
+        uint8_t header[SINC_HEADER_LENGTH];
+
+        histogram_payload(&payload, (uint64_t) i, accepted, rejected);
+
+        SincProtocolEncodeHeaderGeneric(header, (int) payload.cbuf.len,
+                                        SI_TORO__SINC__MESSAGE_TYPE__HISTOGRAM_DATA_RESPONSE,
+                                        SINC_RESPONSE_MARKER);
+        next.stream.cbuf.base.append(&next.stream.cbuf.base, SINC_HEADER_LENGTH, header);
+        next.stream.cbuf.base.append(&next.stream.cbuf.base, payload.cbuf.len,
+                                     payload.cbuf.data);
+        SINC_BUFFER_CLEAR(&payload);
+    }
+
+    bench_run(bench, "sinc_next_packet", op_next_packet, &next,
+              PACKETS_PER_READ, next.stream.cbuf.len);
+
+    {
+        SincBuffer packet = SINC_BUFFER_INIT(decodePad);
+        decode.packet = packet;
+    }
+
+    histogram_payload(&decode.packet, 1, accepted, rejected);
+
+    bench_run(bench, "sinc_decode_histogram", op_decode_histogram, &decode,
+              1, decode.packet.cbuf.len);
+
+    SINC_BUFFER_CLEAR(&next.stream);
+    SINC_BUFFER_CLEAR(&next.read);
+    SINC_BUFFER_CLEAR(&next.packet);
+    SINC_BUFFER_CLEAR(&decode.packet);
+
+    free(accepted);
+    free(rejected);
+
+    return XIA_SUCCESS;
+}
+
+
+static void op_unpack_histogram(void* context)
+{
+    UnpackContext* ctx = context;
+    SiToro__Sinc__HistogramDataResponse* resp;
+
+    resp = si_toro__sinc__histogram_data_response__unpack(NULL, ctx->len, ctx->data);
+    if (resp)
+        si_toro__sinc__histogram_data_response__free_unpacked(resp, NULL);
+}
+
+
+static void op_unpack_get_param(void* context)
+{
+    UnpackContext* ctx = context;
+    SiToro__Sinc__GetParamResponse* resp;
+
+    resp = si_toro__sinc__get_param_response__unpack(NULL, ctx->len, ctx->data);
+    if (resp)
+        si_toro__sinc__get_param_response__free_unpacked(resp, NULL);
+}
+
+
+static int bench_protobuf(Bench* bench)
+{
+    UnpackContext histogram;
+    UnpackContext getParam;
+
+    uint8_t pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+    uint32_t* plot;
+    uint16_t headerLen;
+
+    SiToro__Sinc__GetParamResponse resp;
+    SiToro__Sinc__SuccessResponse success;
+    SiToro__Sinc__KeyValue kv[GET_PARAM_RESULTS];
+    SiToro__Sinc__KeyValue* kvPtrs[GET_PARAM_RESULTS];
+    char keys[GET_PARAM_RESULTS][32];
+    int i;
+
+    /*
+     * The histogram header only, without the plots.
+     */
+    plot = calloc(HISTOGRAM_BINS, sizeof(uint32_t));
+
+    if (!plot)
+        return XIA_NOMEM;
+
+    histogram_payload(&buf, 1, plot, plot);
+    free(plot);
+
+    memcpy(&headerLen, buf.cbuf.data, sizeof(headerLen));
+
+    histogram.len = headerLen;
+    histogram.data = malloc(histogram.len);
+
+    if (!histogram.data) {
+        SINC_BUFFER_CLEAR(&buf);
+        return XIA_NOMEM;
+    }
+
+    memcpy(histogram.data, &buf.cbuf.data[sizeof(headerLen)], histogram.len);
+    SINC_BUFFER_CLEAR(&buf);
+
+    bench_run(bench, "pb_unpack_histogram_header", op_unpack_histogram, &histogram,
+              1, histogram.len);
+
+    free(histogram.data);
+
+    /*
+     * A typical multi-parameter read with mixed types.
+     */
+    si_toro__sinc__get_param_response__init(&resp);
+    si_toro__sinc__success_response__init(&success);
+    resp.success = &success;
+
+    for (i = 0; i < GET_PARAM_RESULTS; ++i) {
+        si_toro__sinc__key_value__init(&kv[i]);
+        snprintf(keys[i], sizeof(keys[i]), "afe.param%d", i);
+        kv[i].key = keys[i];
+        kv[i].has_channelid = 1;
+        kv[i].channelid = 0;
+        switch (i % 3) {
+        case 0:
+            kv[i].has_intval = 1;
+            kv[i].intval = 1000 + i;
+            break;
+        case 1:
+            kv[i].has_floatval = 1;
+            kv[i].floatval = 0.5 * i;
+            break;
+        default:
+            kv[i].has_boolval = 1;
+            kv[i].boolval = 1;
+            break;
+        }
+        kvPtrs[i] = &kv[i];
+    }
+
+    resp.n_results = GET_PARAM_RESULTS;
+    resp.results = kvPtrs;
+
+    getParam.len = si_toro__sinc__get_param_response__get_packed_size(&resp);
+    getParam.data = malloc(getParam.len);
+
+    if (!getParam.data)
+        return XIA_NOMEM;
+
+    si_toro__sinc__get_param_response__pack(&resp, getParam.data);
+
+    bench_run(bench, "pb_unpack_get_param", op_unpack_get_param, &getParam,
+              1, getParam.len);
+
+    free(getParam.data);
+
+    return XIA_SUCCESS;
+}
+
+
+/*
+ * A stream of mostly pulses with time of arrival packets, gate changes
+ * and periodic stats.
+ */
+static uint32_t* list_mode_stream(size_t* numWords)
+{
+    size_t maxWords = LM_PULSES * 2 + (LM_PULSES / 1000) + (LM_PULSES / 10000) * 4 + 2;
+    uint32_t* words = malloc(maxWords * sizeof(uint32_t));
+    size_t n = 0;
+    int i;
+
+    if (!words)
+        return NULL;
+
+    words[n++] = 0x70717273;
+
+    for (i = 0; i < LM_PULSES; ++i) {
+        words[n++] = (uint32_t) ((i * 2654435761u) & 0xffffff);
+        if (i & 3)
+            words[n++] = 0x10000000 | ((uint32_t) (i & 0xfff) << 8) | (uint32_t) (i & 0xff);
+
+        if (i % 1000 == 999)
+            words[n++] = 0xd0000000 | ((uint32_t) ((i / 1000) & 1) << 24) | (uint32_t) (i & 0xffffff);
+
+        if (i % 10000 == 9999) {
+            words[n++] = 0xe0000000 | 0x00000000 | 1000;
+            words[n++] = 0xe0000000 | 0x02000000 | 2;
+            words[n++] = 0xe0000000 | 0x05000000 | 55;
+            words[n++] = 0xe0000000 | 0x0f000000 | (uint32_t) i;
+        }
+    }
+
+    *numWords = n;
+
+    return words;
+}
+
+
+static void op_lm_next_packet(void* context)
+{
+    ListModeContext* ctx = context;
+    LmPacket packet;
+    size_t pos;
+
+    LmBufClear(&ctx->lm);
+
+    for (pos = 0; pos < ctx->len; pos += LM_CHUNK_SIZE) {
+        size_t len = ctx->len - pos < LM_CHUNK_SIZE ? ctx->len - pos : LM_CHUNK_SIZE;
+        LmBufAddData(&ctx->lm, &ctx->data[pos], len);
+        while (LmBufGetNextPacket(&ctx->lm, &packet))
+            ;
+    }
+}
+
+
+static void op_lm_decode_batch(void* context)
+{
+    ListModeContext* ctx = context;
+    size_t pos;
+
+    LmBufClear(&ctx->lm);
+
+    for (pos = 0; pos < ctx->len; pos += LM_CHUNK_SIZE) {
+        size_t len = ctx->len - pos < LM_CHUNK_SIZE ? ctx->len - pos : LM_CHUNK_SIZE;
+        LmBufAddData(&ctx->lm, &ctx->data[pos], len);
+        for (;;) {
+            LmBatchClear(&ctx->batch);
+            if (LmBufDecodeBatch(&ctx->lm, &ctx->batch) == 0)
+                break;
+        }
+    }
+}
+
+
+static int bench_list_mode(Bench* bench)
+{
+    ListModeContext ctx;
+    LmPacket packet;
+    uint32_t* words;
+    size_t numWords;
+    size_t pos;
+
+    memset(&ctx, 0, sizeof(ctx));
+
+    words = list_mode_stream(&numWords);
+
+    if (!words)
+        return XIA_NOMEM;
+
+    if (!LmBufInit(&ctx.lm) ||
+        !LmBatchInit(&ctx.batch, LM_BATCH_PULSES, LM_BATCH_SIDE)) {
+        LmBufClose(&ctx.lm);
+        free(words);
+        return XIA_NOMEM;
+    }
+
+    ctx.data = (uint8_t*) words;
+    ctx.len = numWords * sizeof(uint32_t);
+
+    /*
+     * Count the packets and pulses for the per op figures.
+     */
+    for (pos = 0; pos < ctx.len; pos += LM_CHUNK_SIZE) {
+        size_t len = ctx.len - pos < LM_CHUNK_SIZE ? ctx.len - pos : LM_CHUNK_SIZE;
+        LmBufAddData(&ctx.lm, &ctx.data[pos], len);
+        while (LmBufGetNextPacket(&ctx.lm, &packet)) {
+            ++ctx.packets;
+            if (packet.typ == LmPacketTypePulse)
+                ++ctx.pulses;
+        }
+    }
+
+    bench_run(bench, "lm_next_packet", op_lm_next_packet, &ctx,
+              ctx.packets, ctx.len);
+    bench_run(bench, "lm_decode_batch", op_lm_decode_batch, &ctx,
+              ctx.pulses, ctx.len);
+
+    LmBatchClose(&ctx.batch);
+    LmBufClose(&ctx.lm);
+    free(words);
+
+    return XIA_SUCCESS;
+}
+
+
+/*
+ * Add a pixel to the next buffer the way the MM1 histogram receive
+ * handler does, recycling the buffer once it is full.
+ */
+static void op_mm1_pixel(void* context)
+{
+    MappingContext* ctx = context;
+    MM_Buffers* mmb = &ctx->mm1->buffers;
+
+    if (psl__MappingModeBuffers_Next_Level(mmb) == 0)
+        psl__XMAP_WriteBufferHeader_MM1(ctx->mm1);
+
+    psl__XMAP_WritePixelHeader_MM1(ctx->mm1, &ctx->stats);
+    psl__MappingModeBuffers_Pixel_Inc(mmb);
+    psl__MappingModeBuffers_CopyIn(mmb, ctx->histogram, ctx->mm1->numMCAChannels);
+    psl__XMAP_UpdateBufferHeader_MM1(ctx->mm1);
+
+    if (psl__MappingModeBuffers_Next_Full(mmb))
+        psl__MappingModeBuffers_Next_Clear(mmb);
+}
+
+
+/*
+ * Read a full buffer out as buffer_a/buffer_b do.
+ */
+static void op_mm1_copy_out(void* context)
+{
+    MappingContext* ctx = context;
+    MM_Buffers* mmb = &ctx->mm1->buffers;
+    size_t size = 0;
+
+    mmb->buffer[psl__MappingModeBuffers_Active(mmb)].next = 0;
+    psl__MappingModeBuffers_CopyOut(mmb, ctx->out, &size);
+}
+
+
+static int bench_mapping(Bench* bench)
+{
+    MappingContext ctx;
+    MM_Buffers* mmb;
+    size_t pixelBytes;
+    int status;
+    int i;
+
+    memset(&ctx, 0, sizeof(ctx));
+
+    status = psl__MappingModeControl_OpenMM1(&ctx.mmc, 0, FALSE_, 1, 0,
+                                             HISTOGRAM_BINS, MM1_PIXELS);
+    if (status != XIA_SUCCESS)
+        return status;
+
+    ctx.mm1 = psl__MappingModeControl_MM1Data(&ctx.mmc);
+    mmb = &ctx.mm1->buffers;
+
+    ctx.histogram = malloc(HISTOGRAM_BINS * sizeof(uint32_t));
+    ctx.outSize = psl__MappingModeBuffers_Size(mmb);
+    ctx.out = malloc(ctx.outSize * sizeof(uint32_t));
+
+    if (!ctx.histogram || !ctx.out) {
+        free(ctx.histogram);
+        free(ctx.out);
+        psl__MappingModeControl_CloseAny(&ctx.mmc);
+        return XIA_NOMEM;
+    }
+
+    for (i = 0; i < HISTOGRAM_BINS; ++i)
+        ctx.histogram[i] = (uint32_t) (i * 7) % 1000;
+
+    ctx.stats.realtime = 1000;
+    ctx.stats.livetime = 900;
+    ctx.stats.triggers = 12345;
+    ctx.stats.output_events = 11111;
+    ctx.stats.icr = 100000.0;
+    ctx.stats.ocr = 90909.0;
+
+    pixelBytes = HISTOGRAM_BINS * sizeof(uint32_t);
+
+    bench_run(bench, "mm1_pixel", op_mm1_pixel, &ctx, 1, pixelBytes);
+
+    /*
+     * Fill the next buffer and make it the active one to read out.
+     */
+    psl__MappingModeBuffers_Next_Clear(mmb);
+    while (!psl__MappingModeBuffers_Next_Full(mmb)) {
+        if (psl__MappingModeBuffers_Next_Level(mmb) == 0)
+            psl__XMAP_WriteBufferHeader_MM1(ctx.mm1);
+        psl__XMAP_WritePixelHeader_MM1(ctx.mm1, &ctx.stats);
+        psl__MappingModeBuffers_Pixel_Inc(mmb);
+        psl__MappingModeBuffers_CopyIn(mmb, ctx.histogram, ctx.mm1->numMCAChannels);
+        psl__XMAP_UpdateBufferHeader_MM1(ctx.mm1);
+    }
+    psl__MappingModeBuffers_Update(mmb);
+
+    bench_run(bench, "mm1_copy_out", op_mm1_copy_out, &ctx, 1,
+              psl__MappingModeBuffers_Active_Level(mmb) * sizeof(uint32_t));
+
+    free(ctx.histogram);
+    free(ctx.out);
+    psl__MappingModeControl_CloseAny(&ctx.mmc);
+
+    return XIA_SUCCESS;
+}
+
+
+/*
+ * Baselines are a line per benchmark: name, ns/op, GB/s and allocs/op.
+ */
+static int bench_save(Bench* bench, const char* file)
+{
+    FILE* fp;
+    int r;
+
+    fp = fopen(file, "w");
+    if (!fp)
+        return XIA_OPEN_FILE;
+
+    fprintf(fp, "# name ns/op GB/s allocs/op\n");
+
+    for (r = 0; r < bench->count; ++r) {
+        BenchResult* result = &bench->results[r];
+        fprintf(fp, "%s %.3f %.6f %.4f\n",
+                result->name, result->ns, result->gbs, result->allocs);
+    }
+
+    fclose(fp);
+
+    return XIA_SUCCESS;
+}
+
+
+/*
+ * Returns the number of regressions or -1 if the baseline cannot be
+ * read.
+ */
+static int bench_compare(Bench* bench, const char* file, double threshold)
+{
+    FILE* fp;
+    char line[256];
+    int regressions = 0;
+
+    fp = fopen(file, "r");
+    if (!fp)
+        return -1;
+
+    printf("\n%-28s %12s %12s %8s %10s\n",
+           "benchmark", "baseline", "ns/op", "change", "allocs/op");
+
+    while (fgets(line, sizeof(line), fp)) {
+        char name[NAME_SIZE];
+        double ns;
+        double gbs;
+        double allocs;
+        int r;
+
+        if ((line[0] == '#') ||
+            (sscanf(line, "%63s %lf %lf %lf", name, &ns, &gbs, &allocs) != 4))
+            continue;
+
+        for (r = 0; r < bench->count; ++r) {
+            BenchResult* result = &bench->results[r];
+
+            if (strcmp(result->name, name) == 0) {
+                double change = ns > 0 ? ((result->ns - ns) * 100.0) / ns : 0.0;
+                int slower = change > threshold;
+                int allocating = (allocs >= 0) && (result->allocs > allocs + 0.005);
+
+                printf("%-28s %12.1f %12.1f %+7.1f%% %5.2f/%-5.2f%s\n",
+                       name, ns, result->ns, change, allocs, result->allocs,
+                       slower || allocating ? " REGRESSION" : "");
+
+                if (slower || allocating)
+                    ++regressions;
+                break;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return regressions;
+}
+
+
+static void print_usage(void)
+{
+    fprintf(stdout,
+            "hd-microbench [options]\n" \
+            "options and arguments: \n" \
+            " -?           : help\n" \
+            " -b file      : compare against a baseline file\n" \
+            " -s file      : save the results as a baseline file\n" \
+            " -t percent   : slowdown allowed before a regression (10)\n" \
+            " -T seconds   : minimum time for each timed pass (0.5)\n" \
+            " -n name      : only run benchmarks with name in their name\n" \
+            "Where:\n" \
+            " The exit status is 2 if there are regressions.\n");
+    return;
+}
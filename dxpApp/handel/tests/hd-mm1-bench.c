@@ -0,0 +1,927 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks MM1 mapping end to end. A gated run is made with the
+ * given channels, bins and pixels per buffer and the buffers are read
+ * as they fill. The sustained pixel and data rates, the buffer full to
+ * read latency, overruns, dropped pixels and the CPU used by each
+ * thread are written as JSON so results can be compared over time.
+ *
+ * The pixel rate is set by the box. Use sinc-sim's -r option to set it
+ * when running against the simulator and pass the same rate with -r
+ * here to have it recorded with the results.
+ *
+ * The latency is measured from the last poll that found the buffer not
+ * full to the buffer being handed back with buffer_done so it includes
+ * up to one poll period of detection delay.
+ *
+ * A SINC capture made with a module's inet_capture item can be replayed
+ * with -R in place of the box's data, as fast as possible or with -T at
+ * the recorded timing. The replay starts once the run has started and
+ * the box's own data is dropped while it runs. Use the same channels,
+ * bins and pixels as the captured run and a low sinc-sim pixel rate so
+ * few live pixels arrive before the replay starts.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "xia_common.h"
+
+#include "handel.h"
+#include "handel_constants.h"
+#include "handel_errors.h"
+
+#include "md_generic.h"
+
+
+#define A 0
+#define B 1
+
+#define SWAP_BUFFER(x) ((x) == A ? B : A)
+
+#define MAX_DET_CHANNELS (16)
+#define MAX_THREADS      (64)
+
+/*
+ * Fail the run if no buffer fills for this long.
+ */
+#define STALL_TIMEOUT (10.0)
+
+typedef struct {
+    double* values;
+    size_t  count;
+    size_t  size;
+} Samples;
+
+typedef struct {
+    int    tid;
+    char   name[32];
+    double start;
+    double end;
+} ThreadCPU;
+
+typedef struct {
+    const char*  file;
+    const char*  operation;
+    pthread_t    thread;
+    int          status;
+    volatile int done;
+} Replay;
+
+static double bench_now(void);
+static int bench_sleep(double time);
+static int samples_add(Samples* samples, double value);
+static double samples_percentile(Samples* samples, double percent);
+static int thread_cpu_read(ThreadCPU* threads, int count, int start);
+static void* replay_run(void* arg);
+static void print_usage(void);
+
+
+static uint32_t header_read32(uint16_t* buffer)
+{
+    return (((uint32_t) buffer[1]) << 16) | (uint32_t) buffer[0];
+}
+
+int main(int argc, char *argv[])
+{
+    const char* ini = "t_api/sandbox/xia_test_helper.ini";
+    const char* output = NULL;
+
+    int status;
+    int ignore;
+
+    double mode = 1.0;
+    double advance = XIA_MAPPING_CTL_GATE;
+    double num_map_pixels = 10000.0;
+    double num_map_pixels_per_buffer = 64.0;
+    double mca_channels = 1024.0;
+    double pixel_rate = 0.0;
+    double n_secs = 0.0;
+    double wait_period = 0.001;
+    int quiet = 0;
+
+    Replay replay = { NULL, "replay_capture_fast", 0, XIA_SUCCESS, 0 };
+
+    const char *buffer_str[2] = {
+        "buffer_a",
+        "buffer_b"
+    };
+
+    const char *buffer_full_str[2] = {
+        "buffer_full_a",
+        "buffer_full_b"
+    };
+
+    const char buffer_done_char[2] = {
+        'a',
+        'b'
+    };
+
+    int det_channels = 0;
+    int module_channels = 0;
+    int det;
+
+    int current[MAX_DET_CHANNELS];
+    double last_poll[MAX_DET_CHANNELS];
+    unsigned long det_pixels[MAX_DET_CHANNELS];
+    unsigned long det_buffers[MAX_DET_CHANNELS];
+
+    unsigned long pixels = 0;
+    unsigned long drops = 0;
+    unsigned long buffers = 0;
+    unsigned long overruns = 0;
+    double bytes = 0.0;
+
+    Samples latency = { NULL, 0, 0 };
+
+    ThreadCPU threads[MAX_THREADS];
+    int num_threads;
+    int t;
+
+    double start;
+    double last_read;
+    double end;
+    double elapsed;
+    double active_time;
+
+    unsigned long bufferLength = 0;
+    size_t bufferSize = 0;
+    uint32_t *buffer = NULL;
+
+    FILE* out = stdout;
+
+    int arg = 1;
+
+    while (arg < argc) {
+        if (argv[arg][0] == '-') {
+            if (strlen(argv[arg]) != 2) {
+                fprintf(stderr, "error: invalid option: %s\n", argv[arg]);
+                exit(1);
+            }
+
+            switch (argv[arg][1]) {
+            case 'f':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -f requires a file\n");
+                    exit(1);
+                }
+                ini = argv[arg];
+                ++arg;
+                break;
+            case 'o':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -o requires a file\n");
+                    exit(1);
+                }
+                output = argv[arg];
+                ++arg;
+                break;
+            case 'S':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -S requires the seconds\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &n_secs);
+                ++arg;
+                break;
+            case 'P':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -P requires the number of pixels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &num_map_pixels);
+                ++arg;
+                break;
+            case 'B':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr,
+                            "error: -B requires the number of buffer pixels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &num_map_pixels_per_buffer);
+                ++arg;
+                break;
+            case 'r':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -r requires the pixel rate\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &pixel_rate);
+                ++arg;
+                break;
+            case 'w':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr,
+                            "error: -w requires the number milli-seconds\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &wait_period);
+                wait_period /= 1000;
+                ++arg;
+                break;
+            case 'd':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr,
+                            "error: -d requires the number of detector channels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%d", &det_channels);
+                ++arg;
+                break;
+            case 'm':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr,
+                            "error: -m requires the number of MCA channels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &mca_channels);
+                ++arg;
+                break;
+            case 'q':
+                quiet = 1;
+                ++arg;
+                break;
+            case 'R':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -R requires a capture file\n");
+                    exit(1);
+                }
+                replay.file = argv[arg];
+                ++arg;
+                break;
+            case 'T':
+                replay.operation = "replay_capture";
+                ++arg;
+                break;
+            case '?':
+                print_usage();
+                exit(0);
+            default:
+                fprintf(stderr, "error: invalid option; try -?\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "error: invalid option; try -?\n");
+            exit(1);
+        }
+    }
+
+    if (n_secs > 0)
+        num_map_pixels = 0.0;
+    else if (num_map_pixels <= 0) {
+        fprintf(stderr, "error: no pixels or seconds set\n");
+        exit(1);
+    }
+
+    if ((num_map_pixels_per_buffer < 1) || (mca_channels < 1) ||
+        (wait_period <= 0) || (det_channels < 0)) {
+        fprintf(stderr, "error: invalid run settings; try -?\n");
+        exit(1);
+    }
+
+    /*
+     * Keep logging out of the measurements.
+     */
+    xiaSetLogLevel(MD_WARNING);
+
+    xiaSetLogOutput("handel.log");
+
+    status = xiaInit(ini);
+
+    if (status != XIA_SUCCESS) {
+        fprintf(stderr, "Unable to initialize Handel using '%s'.\n", ini);
+        exit(1);
+    }
+
+    status = xiaStartSystem();
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Unable to start the system.\n");
+        exit(1);
+    }
+
+    status = xiaGetModuleItem("module1", "number_of_channels", &module_channels);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Unable to get the number of channels.\n");
+        exit(1);
+    }
+
+    if ((det_channels == 0) || (det_channels > module_channels))
+        det_channels = module_channels;
+
+    if (det_channels > MAX_DET_CHANNELS) {
+        xiaExit();
+        fprintf(stderr, "Too many detector channels: %d (max %d).\n",
+                det_channels, MAX_DET_CHANNELS);
+        exit(1);
+    }
+
+    status = xiaSetAcquisitionValues(-1, "mapping_mode", &mode);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error setting 'mapping_mode' to %.1f.\n", mode);
+        exit(1);
+    }
+
+    status = xiaSetAcquisitionValues(-1, "pixel_advance_mode", &advance);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error setting 'pixel_advance_mode' to %.1f.\n", advance);
+        exit(1);
+    }
+
+    status = xiaSetAcquisitionValues(-1, "number_mca_channels", &mca_channels);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error setting 'number_mca_channels' to %.1f.\n",
+                mca_channels);
+        exit(1);
+    }
+
+    status = xiaSetAcquisitionValues(-1, "num_map_pixels_per_buffer",
+                                     &num_map_pixels_per_buffer);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error setting 'num_map_pixels_per_buffer' to %.1f.\n",
+                num_map_pixels_per_buffer);
+        exit(1);
+    }
+
+    status = xiaSetAcquisitionValues(-1, "num_map_pixels", &num_map_pixels);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error setting 'num_map_pixels' to %.1f.\n",
+                num_map_pixels);
+        exit(1);
+    }
+
+    for (det = 0; det < det_channels; ++det) {
+        status = xiaBoardOperation(det, "apply", &ignore);
+
+        if (status != XIA_SUCCESS) {
+            xiaExit();
+            fprintf(stderr, "Error applying the mode settings.\n");
+            exit(1);
+        }
+    }
+
+    status = xiaGetRunData(0, "buffer_len", &bufferLength);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error reading 'buffer_len'.\n");
+        exit(1);
+    }
+
+    bufferSize = bufferLength * sizeof(uint32_t);
+    buffer = malloc(bufferSize);
+
+    if (!buffer) {
+        xiaExit();
+        fprintf(stderr, "Unable to allocate a buffer of %zu bytes.\n",
+                bufferSize);
+        exit(1);
+    }
+
+    if (output) {
+        out = fopen(output, "w");
+        if (!out) {
+            xiaExit();
+            fprintf(stderr, "Unable to open '%s' for writing.\n", output);
+            free(buffer);
+            exit(1);
+        }
+    }
+
+    for (det = 0; det < det_channels; ++det) {
+        current[det] = A;
+        det_pixels[det] = 0;
+        det_buffers[det] = 0;
+    }
+
+    num_threads = thread_cpu_read(threads, 0, 1);
+
+    status = xiaStartRun(-1, 0);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error starting the mapping run.\n");
+        free(buffer);
+        exit(1);
+    }
+
+    if (replay.file) {
+        if (pthread_create(&replay.thread, NULL, replay_run, &replay) != 0) {
+            xiaStopRun(-1);
+            xiaExit();
+            fprintf(stderr, "Unable to start the replay thread.\n");
+            free(buffer);
+            exit(1);
+        }
+    }
+
+    start = bench_now();
+    last_read = start;
+
+    for (det = 0; det < det_channels; ++det)
+        last_poll[det] = start;
+
+    for (;;) {
+        int any_running = 0;
+        int any_buffer_full = 0;
+        int replayed = replay.file && replay.done;
+        double now = bench_now();
+
+        for (det = 0; det < det_channels; ++det) {
+            unsigned long active = 0;
+            int buffer_full = 0;
+            int buffer_overrun = 0;
+
+            status = xiaGetRunData(det, "run_active", &active);
+
+            if (status != XIA_SUCCESS) {
+                xiaStopRun(-1);
+                xiaExit();
+                fprintf(stderr, "Error get the run active status.\n");
+                free(buffer);
+                exit(1);
+            }
+
+            if (active)
+                any_running = 1;
+
+            status = xiaGetRunData(det, buffer_full_str[current[det]],
+                                   &buffer_full);
+
+            if (status != XIA_SUCCESS) {
+                xiaStopRun(-1);
+                xiaExit();
+                fprintf(stderr, "Error getting the status of buffer '%c'.\n",
+                        buffer_done_char[current[det]]);
+                free(buffer);
+                exit(1);
+            }
+
+            if (buffer_full) {
+                uint16_t* in = (uint16_t*) buffer;
+                uint32_t buffer_size_u16;
+                char c = buffer_done_char[current[det]];
+                double done;
+
+                any_buffer_full = 1;
+
+                status = xiaGetRunData(det, buffer_str[current[det]], buffer);
+
+                if (status != XIA_SUCCESS) {
+                    xiaStopRun(-1);
+                    xiaExit();
+                    fprintf(stderr, "Error reading '%s'.\n",
+                            buffer_str[current[det]]);
+                    free(buffer);
+                    exit(1);
+                }
+
+                status = xiaBoardOperation(det, "buffer_done", (void*) &c);
+
+                if (status != XIA_SUCCESS) {
+                    xiaStopRun(-1);
+                    xiaExit();
+                    fprintf(stderr, "Error setting buffer '%c' to done.\n", c);
+                    free(buffer);
+                    exit(1);
+                }
+
+                done = bench_now();
+
+                if (samples_add(&latency, done - last_poll[det]) != 0) {
+                    xiaStopRun(-1);
+                    xiaExit();
+                    fprintf(stderr, "Unable to allocate the latency samples.\n");
+                    free(buffer);
+                    exit(1);
+                }
+
+                buffer_size_u16 = header_read32(&in[26]);
+                if (buffer_size_u16 > bufferLength * 2) {
+                    xiaStopRun(-1);
+                    xiaExit();
+                    fprintf(stderr, "Bad buffer size %u, max %lu\n",
+                            buffer_size_u16, bufferLength * 2);
+                    free(buffer);
+                    exit(1);
+                }
+
+                det_pixels[det] += in[8];
+                det_buffers[det]++;
+                pixels += in[8];
+                drops += in[25];
+                bytes += (double) buffer_size_u16 * sizeof(uint16_t);
+                buffers++;
+
+                last_read = done;
+                current[det] = SWAP_BUFFER(current[det]);
+
+                if (!quiet)
+                    fprintf(stderr, "%8.3f det:%d buffers:%lu pixels:%lu\n",
+                            done - start, det, det_buffers[det], det_pixels[det]);
+            }
+
+            last_poll[det] = now;
+
+            status = xiaGetRunData(det, "buffer_overrun", &buffer_overrun);
+
+            if (status != XIA_SUCCESS) {
+                xiaStopRun(-1);
+                xiaExit();
+                fprintf(stderr, "Error getting the overrun status.\n");
+                free(buffer);
+                exit(1);
+            }
+
+            overruns += (unsigned long) buffer_overrun;
+        }
+
+        if (!any_running && !any_buffer_full)
+            break;
+
+        /*
+         * A replay's last buffer is only partly filled.
+         */
+        if (replayed && !any_buffer_full)
+            break;
+
+        if ((n_secs > 0) && ((now - start) >= n_secs))
+            break;
+
+        if (!any_buffer_full) {
+            if ((now - last_read) >= STALL_TIMEOUT) {
+                xiaStopRun(-1);
+                xiaExit();
+                fprintf(stderr, "Timeout on buffer filling.\n");
+                free(buffer);
+                exit(1);
+            }
+
+            bench_sleep(wait_period);
+        }
+    }
+
+    end = bench_now();
+
+    /*
+     * Sample the threads before stopping as the run's threads can exit.
+     */
+    num_threads = thread_cpu_read(threads, num_threads, 0);
+
+    if (replay.file) {
+        pthread_join(replay.thread, NULL);
+
+        if (replay.status != XIA_SUCCESS) {
+            xiaStopRun(-1);
+            xiaExit();
+            fprintf(stderr, "Error replaying '%s': %d.\n",
+                    replay.file, replay.status);
+            free(buffer);
+            exit(1);
+        }
+    }
+
+    status = xiaStopRun(-1);
+
+    if (status != XIA_SUCCESS) {
+        xiaExit();
+        fprintf(stderr, "Error stopping the mapping mode run.\n");
+        free(buffer);
+        exit(1);
+    }
+
+    elapsed = end - start;
+    active_time = last_read - start;
+    if (active_time <= 0)
+        active_time = elapsed;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"hd-mm1-bench\",\n");
+    fprintf(out, "  \"config\": {\n");
+    fprintf(out, "    \"ini\": \"%s\",\n", ini);
+    fprintf(out, "    \"channels\": %d,\n", det_channels);
+    fprintf(out, "    \"bins\": %d,\n", (int) mca_channels);
+    fprintf(out, "    \"pixels_per_buffer\": %d,\n", (int) num_map_pixels_per_buffer);
+    fprintf(out, "    \"pixels\": %lu,\n", (unsigned long) num_map_pixels);
+    fprintf(out, "    \"seconds\": %.3f,\n", n_secs);
+    fprintf(out, "    \"pixel_rate\": %.3f,\n", pixel_rate);
+    if (replay.file) {
+        fprintf(out, "    \"replay\": \"%s\",\n", replay.file);
+        fprintf(out, "    \"replay_timing\": \"%s\",\n",
+                strcmp(replay.operation, "replay_capture") == 0 ? "recorded" : "fast");
+    }
+    fprintf(out, "    \"poll_ms\": %.3f\n", wait_period * 1000.0);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"results\": {\n");
+    fprintf(out, "    \"elapsed_s\": %.6f,\n", elapsed);
+    fprintf(out, "    \"pixels\": %lu,\n", pixels);
+    fprintf(out, "    \"dropped_pixels\": %lu,\n", drops);
+    fprintf(out, "    \"buffers\": %lu,\n", buffers);
+    fprintf(out, "    \"overruns\": %lu,\n", overruns);
+    fprintf(out, "    \"pixels_per_s\": %.3f,\n", pixels / active_time);
+    fprintf(out, "    \"pixels_per_s_per_channel\": %.3f,\n",
+            pixels / active_time / det_channels);
+    if (pixel_rate > 0)
+        fprintf(out, "    \"rate_efficiency\": %.4f,\n",
+                pixels / active_time / det_channels / pixel_rate);
+    fprintf(out, "    \"mb_per_s\": %.6f,\n", bytes / active_time / 1.0e6);
+    fprintf(out, "    \"latency_ms\": {\n");
+    fprintf(out, "      \"samples\": %zu,\n", latency.count);
+    fprintf(out, "      \"p50\": %.3f,\n", samples_percentile(&latency, 50.0) * 1000.0);
+    fprintf(out, "      \"p90\": %.3f,\n", samples_percentile(&latency, 90.0) * 1000.0);
+    fprintf(out, "      \"p99\": %.3f,\n", samples_percentile(&latency, 99.0) * 1000.0);
+    fprintf(out, "      \"max\": %.3f\n", samples_percentile(&latency, 100.0) * 1000.0);
+    fprintf(out, "    },\n");
+    fprintf(out, "    \"channel_pixels\": [");
+    for (det = 0; det < det_channels; ++det)
+        fprintf(out, "%s%lu", det == 0 ? "" : ", ", det_pixels[det]);
+    fprintf(out, "],\n");
+    fprintf(out, "    \"threads\": [");
+    for (t = 0; t < num_threads; ++t) {
+        double cpu = threads[t].end - threads[t].start;
+        fprintf(out, "%s\n      { \"tid\": %d, \"name\": \"%s\", "
+                "\"cpu_s\": %.3f, \"cpu_pct\": %.1f }",
+                t == 0 ? "" : ",", threads[t].tid, threads[t].name,
+                cpu, elapsed > 0 ? (cpu * 100.0) / elapsed : 0.0);
+    }
+    fprintf(out, "%s]\n", num_threads ? "\n    " : "");
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    if (output)
+        fclose(out);
+
+    free(latency.values);
+    free(buffer);
+
+    xiaExit();
+
+    return 0;
+}
+
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1.0e9);
+}
+
+
+static int bench_sleep(double time)
+{
+    unsigned long secs = (unsigned long) time;
+    struct timespec req = {
+        .tv_sec = (time_t) secs,
+        .tv_nsec = (time_t) ((time - secs) * 1000000000.0)
+    };
+    struct timespec rem = {
+        .tv_sec = 0,
+        .tv_nsec = 0
+    };
+    while (TRUE_) {
+        if (nanosleep(&req, &rem) == 0)
+            break;
+        req = rem;
+    }
+    return XIA_SUCCESS;
+}
+
+
+static int samples_add(Samples* samples, double value)
+{
+    if (samples->count == samples->size) {
+        size_t size = samples->size ? samples->size * 2 : 1024;
+        double* values = realloc(samples->values, size * sizeof(double));
+        if (!values)
+            return -1;
+        samples->values = values;
+        samples->size = size;
+    }
+    samples->values[samples->count++] = value;
+    return 0;
+}
+
+
+static int compare_double(const void* a, const void* b)
+{
+    double da = *((const double*) a);
+    double db = *((const double*) b);
+    return (da > db) - (da < db);
+}
+
+
+/*
+ * Nearest rank percentile. Sorts the samples.
+ */
+static double samples_percentile(Samples* samples, double percent)
+{
+    size_t rank;
+
+    if (samples->count == 0)
+        return 0.0;
+
+    qsort(samples->values, samples->count, sizeof(double), compare_double);
+
+    rank = (size_t) ((percent / 100.0) * (double) samples->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > samples->count)
+        rank = samples->count;
+
+    return samples->values[rank - 1];
+}
+
+
+/*
+ * Read the CPU time of this process's threads from /proc. The start
+ * pass records the threads found, the end pass updates them and adds
+ * any threads created since. Returns the number of threads.
+ */
+static int thread_cpu_read(ThreadCPU* threads, int count, int start)
+{
+    DIR* dir;
+    struct dirent* entry;
+    double ticks = (double) sysconf(_SC_CLK_TCK);
+
+    dir = opendir("/proc/self/task");
+    if (!dir)
+        return count;
+
+    while ((entry = readdir(dir)) != NULL) {
+        char path[64];
+        char stat[512];
+        char* fields;
+        unsigned long utime = 0;
+        unsigned long stime = 0;
+        double cpu;
+        FILE* fp;
+        size_t len;
+        int tid;
+        int t;
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        tid = atoi(entry->d_name);
+
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+        fp = fopen(path, "r");
+        if (!fp)
+            continue;
+        len = fread(stat, 1, sizeof(stat) - 1, fp);
+        fclose(fp);
+        stat[len] = '\0';
+
+        /*
+         * The name can hold spaces so skip past its closing bracket. The
+         * user and system times are the 14th and 15th fields.
+         */
+        fields = strrchr(stat, ')');
+        if (!fields)
+            continue;
+        if (sscanf(fields + 2,
+                   "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                   &utime, &stime) != 2)
+            continue;
+
+        cpu = (double) (utime + stime) / ticks;
+
+        for (t = 0; t < count; ++t) {
+            if (threads[t].tid == tid)
+                break;
+        }
+
+        if (t == count) {
+            if (count == MAX_THREADS)
+                continue;
+            ++count;
+            threads[t].tid = tid;
+            threads[t].start = 0.0;
+            threads[t].name[0] = '\0';
+        }
+
+        if (start)
+            threads[t].start = cpu;
+        threads[t].end = cpu;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+        fp = fopen(path, "r");
+        if (fp) {
+            if (fgets(threads[t].name, sizeof(threads[t].name), fp)) {
+                char* nl = strchr(threads[t].name, '\n');
+                if (nl)
+                    *nl = '\0';
+            }
+            fclose(fp);
+        }
+    }
+
+    closedir(dir);
+
+    return count;
+}
+
+
+/*
+ * Replay the capture on the first detector channel's module.
+ */
+static void* replay_run(void* arg)
+{
+    Replay* replay = (Replay*) arg;
+
+    replay->status = xiaBoardOperation(0, replay->operation, (void*) replay->file);
+    replay->done = 1;
+
+    return NULL;
+}
+
+
+static void print_usage(void)
+{
+    fprintf(stdout,
+            "hd-mm1-bench [options]\n" \
+            "options and arguments: \n" \
+            " -?           : help\n" \
+            " -f file      : INI file\n" \
+            " -o file      : JSON results file, default stdout\n" \
+            " -S seconds   : seconds to run, overrides pixels\n" \
+            " -P pixels    : pixels to capture (10000)\n" \
+            " -B pixels    : pixels per buffer (64)\n" \
+            " -m mca_size  : number of MCA channels (1024)\n" \
+            " -d detectors : number of detector channels, default all\n" \
+            " -r rate      : pixel rate the box is set to, recorded only\n" \
+            " -w msecs     : wait period in milli-seconds (1)\n" \
+            " -q           : quiet, no progress output\n" \
+            " -R file      : replay a SINC capture in place of the box's data\n" \
+            " -T           : replay with the recorded timing, default fast\n" \
+            "Where:\n" \
+            " The run is gated so the box sets the pixel rate. Progress is\n" \
+            " printed to stderr and the results to stdout or the -o file.\n");
+    return;
+}
@@ -0,0 +1,2090 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * The device half of the SINC simulator. It answers the commands the
+ * FalconXN PSL sends and streams histograms for MCA and MM1 runs with a
+ * chosen spectrum shape and rate. Gated histograms can be dropped on
+ * purpose to exercise the PSL's pixel recovery.
+ *
+ * Everything runs on the thread calling sim_run. Connections come from
+ * the TCP listener or are added with sim_add_client.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "sinc.h"
+#include "sinc_internal.h"
+
+#include "sim_device.h"
+
+
+/* Non-paralysable dead time per pulse in seconds. */
+#define SIM_PULSE_DEADTIME 1.0e-6
+
+#define SIM_CALIBRATION_POINTS 64
+
+/*
+ * How long a capture takes on the box. The PSL waits for the channel
+ * to go back to ready after the command's response so the data cannot
+ * follow the response immediately.
+ */
+#define SIM_OSCILLOSCOPE_TIME 0.02
+#define SIM_CALIBRATION_TIME  0.5
+
+#define SIM_INT_TYPE    SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__INT_TYPE
+#define SIM_FLOAT_TYPE  SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__FLOAT_TYPE
+#define SIM_BOOL_TYPE   SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__BOOL_TYPE
+#define SIM_STRING_TYPE SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__STRING_TYPE
+#define SIM_OPTION_TYPE SI_TORO__SINC__KEY_VALUE__PARAM_TYPE__OPTION_TYPE
+
+#define SIM_INT(_k, _v)    { _k, SIM_INT_TYPE,    _v, 0.0, 0, "" }
+#define SIM_FLOAT(_k, _v)  { _k, SIM_FLOAT_TYPE,  0, _v, 0, "" }
+#define SIM_BOOL(_k, _v)   { _k, SIM_BOOL_TYPE,   0, 0.0, _v, "" }
+#define SIM_STRING(_k, _v) { _k, SIM_STRING_TYPE, 0, 0.0, 0, _v }
+#define SIM_OPTION(_k, _v) { _k, SIM_OPTION_TYPE, 0, 0.0, 0, _v }
+
+/*
+ * The parameters a channel starts with. Anything the PSL sets that is
+ * not listed is added to the channel when it is set.
+ */
+static const SimParam SIM_DEFAULT_PARAMS[] = {
+    SIM_OPTION("channel.state",                    "ready"),
+    SIM_INT("oscilloscope.samples",                8192),
+    SIM_BOOL("oscilloscope.runContinuously",       0),
+    SIM_BOOL("pulse.calibrated",                   1),
+    SIM_STRING("pulse.calibration.hash",           ""),
+    SIM_FLOAT("afe.dacGain",                       3.0),
+    SIM_FLOAT("afe.dacOffset",                     0.0),
+    SIM_FLOAT("afe.decayTime",                     2.0),
+    SIM_BOOL("afe.invert",                         0),
+    SIM_OPTION("afe.termination",                  "1kohm"),
+    SIM_OPTION("afe.attn",                         "0dB"),
+    SIM_OPTION("afe.coupling",                     "dc"),
+    SIM_INT("afe.sampleRate",                      250000000),
+    SIM_FLOAT("baseline.dcOffset",                 0.0),
+    SIM_BOOL("blanking.enable",                    1),
+    SIM_FLOAT("blanking.threshold",                -0.05),
+    SIM_INT("blanking.preSamples",                 50),
+    SIM_INT("blanking.postSamples",                50),
+    SIM_FLOAT("pulse.detectionThreshold",          0.01),
+    SIM_INT("pulse.minPulsePairSeparation",        25),
+    SIM_INT("pulse.riseTimeParameter",             124),
+    SIM_OPTION("pulse.sourceType",                 "lowEnergy"),
+    SIM_FLOAT("pulse.scaleFactor",                 2.0),
+    SIM_OPTION("histogram.mode",                   "continuous"),
+    SIM_FLOAT("histogram.refreshRate",             0.1),
+    SIM_INT("histogram.binSubRegion.lowIndex",     0),
+    SIM_INT("histogram.binSubRegion.highIndex",    4095),
+    SIM_BOOL("histogram.spectrumSelect.accepted",  1),
+    SIM_BOOL("histogram.spectrumSelect.rejected",  0),
+    SIM_FLOAT("histogram.fixedTime.duration",      1.0),
+    SIM_INT("histogram.fixedInputCount.count",     100000),
+    SIM_INT("histogram.fixedOutputCount.count",    100000),
+    SIM_BOOL("gate.veto",                          0),
+    SIM_OPTION("gate.statsCollectionMode",         "off"),
+    SIM_OPTION("instrument.sca.generationTrigger", "always"),
+    SIM_INT("instrument.sca.pulseDuration",        400),
+    SIM_INT("sca.numRegions",                      0),
+    SIM_INT("instrument.protocolVersion",          1),
+    SIM_STRING("instrument.productName",           "FalconX sim"),
+    SIM_STRING("instrument.firmwareVersion",       "sim-1.0"),
+    SIM_STRING("instrument.digital.serialNumber",  "SIM-DIG-0001"),
+    SIM_STRING("instrument.analog.serialNumber",   "SIM-ANA-0001"),
+    SIM_STRING("instrument.assembly.serialNumber", "SIM-ASM-0001"),
+    SIM_INT("instrument.numChannels",              0),
+};
+
+#define SIM_NUM_DEFAULT_PARAMS \
+    (sizeof(SIM_DEFAULT_PARAMS) / sizeof(SIM_DEFAULT_PARAMS[0]))
+
+
+static double sim_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1.0e9);
+}
+
+/*
+ * xorshift64* so filling a histogram is not dominated by rand().
+ */
+static double sim_random(Sim* sim)
+{
+    uint64_t x = sim->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    sim->rng = x;
+    return (double) ((x * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+/*
+ * Round to an integer count keeping the expected value, so small rates
+ * still produce the right totals over many updates.
+ */
+static uint64_t sim_round(Sim* sim, double expected)
+{
+    double whole = floor(expected);
+    return (uint64_t) whole + (sim_random(sim) < (expected - whole) ? 1 : 0);
+}
+
+/*
+ * Parameters
+ */
+
+static SimParam* sim_param_find(SimChannel* chan, const char* key)
+{
+    int p;
+    for (p = 0; p < chan->numParams; ++p) {
+        if (strcmp(chan->params[p].key, key) == 0)
+            return &chan->params[p];
+    }
+    return NULL;
+}
+
+/*
+ * Parameters the box reports and the host cannot set.
+ */
+static int sim_param_read_only(const char* key)
+{
+    return strcmp(key, "channel.state") == 0 ||
+        strcmp(key, "pulse.calibrated") == 0 ||
+        strcmp(key, "afe.sampleRate") == 0 ||
+        strncmp(key, "instrument.", 11) == 0;
+}
+
+static int64_t sim_param_int(SimChannel* chan, const char* key)
+{
+    SimParam* param = sim_param_find(chan, key);
+    if (param == NULL)
+        return 0;
+    if (param->type == SIM_FLOAT_TYPE)
+        return (int64_t) param->floatval;
+    return param->intval;
+}
+
+static double sim_param_float(SimChannel* chan, const char* key)
+{
+    SimParam* param = sim_param_find(chan, key);
+    if (param == NULL)
+        return 0.0;
+    if (param->type == SIM_INT_TYPE)
+        return (double) param->intval;
+    return param->floatval;
+}
+
+static int sim_param_bool(SimChannel* chan, const char* key)
+{
+    SimParam* param = sim_param_find(chan, key);
+    return param != NULL && param->boolval;
+}
+
+static const char* sim_param_option(SimChannel* chan, const char* key)
+{
+    SimParam* param = sim_param_find(chan, key);
+    return param != NULL ? param->str : "";
+}
+
+static void sim_param_set_option(SimChannel* chan, const char* key, const char* value)
+{
+    SimParam* param = sim_param_find(chan, key);
+    if (param != NULL) {
+        strncpy(param->str, value, SIM_STR_LEN - 1);
+        param->str[SIM_STR_LEN - 1] = '\0';
+    }
+}
+
+/*
+ * Store a value sent by the client. Unknown keys are added with the
+ * type of the value sent.
+ */
+static int sim_param_store(SimChannel* chan, const SiToro__Sinc__KeyValue* kv)
+{
+    SimParam* param = sim_param_find(chan, kv->key);
+
+    if (param == NULL) {
+        if (chan->numParams >= SIM_MAX_PARAMS)
+            return -1;
+        param = &chan->params[chan->numParams++];
+        memset(param, 0, sizeof(*param));
+        strncpy(param->key, kv->key, SIM_KEY_LEN - 1);
+        if (kv->has_paramtype)
+            param->type = kv->paramtype;
+        else if (kv->has_intval)
+            param->type = SIM_INT_TYPE;
+        else if (kv->has_floatval)
+            param->type = SIM_FLOAT_TYPE;
+        else if (kv->has_boolval)
+            param->type = SIM_BOOL_TYPE;
+        else if (kv->optionval != NULL)
+            param->type = SIM_OPTION_TYPE;
+        else
+            param->type = SIM_STRING_TYPE;
+    }
+
+    if (kv->has_intval) {
+        param->intval = kv->intval;
+        param->floatval = (double) kv->intval;
+    }
+    if (kv->has_floatval) {
+        param->floatval = kv->floatval;
+        param->intval = (int64_t) kv->floatval;
+    }
+    if (kv->has_boolval)
+        param->boolval = kv->boolval;
+    if (kv->optionval != NULL || kv->strval != NULL) {
+        strncpy(param->str, kv->optionval != NULL ? kv->optionval : kv->strval,
+                SIM_STR_LEN - 1);
+        param->str[SIM_STR_LEN - 1] = '\0';
+    }
+
+    return 0;
+}
+
+/*
+ * Fill a key value from a stored param. The string value is always set,
+ * as the box does, and the buffer must outlive the packing.
+ */
+static void sim_param_kv(const SimParam* param, int channel,
+                         SiToro__Sinc__KeyValue* kv, char* str, size_t strLen)
+{
+    si_toro__sinc__key_value__init(kv);
+    kv->key = (char*) param->key;
+    kv->has_channelid = 1;
+    kv->channelid = channel;
+    kv->has_paramtype = 1;
+    kv->paramtype = param->type;
+
+    switch (param->type) {
+    case SIM_INT_TYPE:
+        kv->has_intval = 1;
+        kv->intval = param->intval;
+        snprintf(str, strLen, "%lld", (long long) param->intval);
+        break;
+    case SIM_FLOAT_TYPE:
+        kv->has_floatval = 1;
+        kv->floatval = param->floatval;
+        snprintf(str, strLen, "%g", param->floatval);
+        break;
+    case SIM_BOOL_TYPE:
+        kv->has_boolval = 1;
+        kv->boolval = param->boolval;
+        snprintf(str, strLen, "%s", param->boolval ? "true" : "false");
+        break;
+    case SIM_OPTION_TYPE:
+        kv->optionval = (char*) param->str;
+        snprintf(str, strLen, "%s", param->str);
+        break;
+    default:
+        snprintf(str, strLen, "%s", param->str);
+        break;
+    }
+
+    kv->strval = str;
+}
+
+static void sim_channel_init(Sim* sim, SimChannel* chan)
+{
+    size_t p;
+
+    memset(chan, 0, sizeof(*chan));
+
+    for (p = 0; p < SIM_NUM_DEFAULT_PARAMS; ++p)
+        chan->params[chan->numParams++] = SIM_DEFAULT_PARAMS[p];
+
+    chan->params[chan->numParams - 1].intval = sim->numChannels;
+}
+
+/*
+ * Sending
+ */
+
+/*
+ * Runs are stopped once the last client has gone so a client that
+ * exits mid-run does not leave data streaming to the next one.
+ */
+static void sim_client_close(Sim* sim, SimClient* client)
+{
+    int c;
+
+    if (sim->verbose)
+        printf("sim: client %d closed\n", client->fd);
+    close(client->fd);
+    free(client->in);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+        if (sim->clients[c].fd >= 0)
+            return;
+    }
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        sim->channels[c].running = 0;
+        sim->channels[c].oscilloscopeDue = 0.0;
+        sim->channels[c].calibrationDue = 0.0;
+        sim_param_set_option(&sim->channels[c], "channel.state", "ready");
+    }
+}
+
+static void sim_send(Sim* sim, SimClient* client, SincBuffer* buf)
+{
+    size_t sent = 0;
+
+    while (client->fd >= 0 && sent < buf->cbuf.len) {
+        ssize_t n = send(client->fd, buf->cbuf.data + sent,
+                         buf->cbuf.len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            sim_client_close(sim, client);
+            break;
+        }
+        sent += (size_t) n;
+    }
+}
+
+/*
+ * Asynchronous data goes to every connection.
+ */
+static void sim_send_all(Sim* sim, SincBuffer* buf)
+{
+    int c;
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+        if (sim->clients[c].fd >= 0)
+            sim_send(sim, &sim->clients[c], buf);
+    }
+}
+
+static void sim_encode_header(SincBuffer* buf, size_t payloadLen,
+                              SiToro__Sinc__MessageType msgType)
+{
+    uint8_t header[SINC_HEADER_LENGTH];
+    SincProtocolEncodeHeaderGeneric(header, (int) payloadLen, msgType,
+                                    SINC_RESPONSE_MARKER);
+    buf->cbuf.base.append(&buf->cbuf.base, SINC_HEADER_LENGTH, header);
+}
+
+static void sim_success(SiToro__Sinc__SuccessResponse* success,
+                        SiToro__Sinc__ErrorCode errorCode, const char* message,
+                        int channel)
+{
+    si_toro__sinc__success_response__init(success);
+    if (errorCode != SI_TORO__SINC__ERROR_CODE__NO_ERROR) {
+        success->has_errorcode = 1;
+        success->errorcode = errorCode;
+    }
+    success->message = (char*) message;
+    success->has_channelid = 1;
+    success->channelid = channel;
+}
+
+static void sim_reply_success(Sim* sim, SimClient* client,
+                              SiToro__Sinc__ErrorCode errorCode,
+                              const char* message, int channel)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SincEncodeSuccessResponse(&buf, errorCode, (char*) message, channel);
+    sim_send(sim, client, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+static void sim_param_updated(Sim* sim, int channel, const char* key)
+{
+    uint8_t    pad[512];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+    char       str[SIM_STR_LEN];
+
+    SiToro__Sinc__ParamUpdatedResponse resp;
+    SiToro__Sinc__KeyValue             kv;
+    SiToro__Sinc__KeyValue*            kvs[1];
+
+    SimParam* param = sim_param_find(&sim->channels[channel], key);
+    if (param == NULL)
+        return;
+
+    sim_param_kv(param, channel, &kv, str, sizeof(str));
+    kvs[0] = &kv;
+
+    si_toro__sinc__param_updated_response__init(&resp);
+    resp.n_params = 1;
+    resp.params = kvs;
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__param_updated_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__PARAM_UPDATED_RESPONSE);
+    si_toro__sinc__param_updated_response__pack_to_buffer(&resp, &buf.cbuf.base);
+
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+static void sim_channel_state(Sim* sim, int channel, const char* state)
+{
+    sim_param_set_option(&sim->channels[channel], "channel.state", state);
+    sim_param_updated(sim, channel, "channel.state");
+}
+
+static void sim_asynchronous_error(Sim* sim, int channel,
+                                   SiToro__Sinc__ErrorCode errorCode,
+                                   const char* message)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__AsynchronousErrorResponse resp;
+    SiToro__Sinc__SuccessResponse           success;
+
+    sim_success(&success, errorCode, message, channel);
+
+    si_toro__sinc__asynchronous_error_response__init(&resp);
+    resp.success = &success;
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__asynchronous_error_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__ASYNCHRONOUS_ERROR_RESPONSE);
+    si_toro__sinc__asynchronous_error_response__pack_to_buffer(&resp, &buf.cbuf.base);
+
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+/*
+ * Histograms
+ */
+
+const char* sim_shape_name(SimShape shape)
+{
+    switch (shape) {
+    case SimShapeGauss: return "gauss";
+    case SimShapeRamp:  return "ramp";
+    default:            return "flat";
+    }
+}
+
+/*
+ * The normalised spectrum shape over the bins of the run. gauss is a
+ * main line at a third of the range with a smaller line above it on a
+ * low background.
+ */
+static void sim_shape_fill(SimShape shape, double* pdf, uint32_t bins)
+{
+    double   total = 0.0;
+    uint32_t b;
+
+    for (b = 0; b < bins; ++b) {
+        double x = (double) b;
+        double v;
+
+        switch (shape) {
+        case SimShapeGauss: {
+            double c1 = bins / 3.0;
+            double c2 = (bins * 2.0) / 3.0;
+            double s = bins / 100.0 + 1.0;
+            v = exp(-0.5 * ((x - c1) / s) * ((x - c1) / s)) +
+                0.3 * exp(-0.5 * ((x - c2) / s) * ((x - c2) / s)) +
+                0.01;
+            break;
+        }
+        case SimShapeRamp:
+            v = (double) (bins - b);
+            break;
+        default:
+            v = 1.0;
+            break;
+        }
+
+        pdf[b] = v;
+        total += v;
+    }
+
+    for (b = 0; b < bins; ++b)
+        pdf[b] /= total;
+}
+
+static void sim_spectrum_add(Sim* sim, const double* pdf, uint32_t* data,
+                             uint32_t bins, double counts)
+{
+    uint32_t b;
+    for (b = 0; b < bins; ++b)
+        data[b] += (uint32_t) sim_round(sim, counts * pdf[b]);
+}
+
+static void sim_histogram_free(SimChannel* chan)
+{
+    free(chan->pdf);
+    free(chan->accepted);
+    free(chan->rejected);
+    chan->pdf = NULL;
+    chan->accepted = NULL;
+    chan->rejected = NULL;
+    chan->bins = 0;
+}
+
+static void sim_histogram_clear(SimChannel* chan)
+{
+    if (chan->bins > 0) {
+        memset(chan->accepted, 0, chan->bins * sizeof(uint32_t));
+        memset(chan->rejected, 0, chan->bins * sizeof(uint32_t));
+    }
+    chan->triggers = 0;
+    chan->pulsesAccepted = 0;
+    chan->elapsed = 0.0;
+}
+
+static double sim_output_count_rate(double icr)
+{
+    return icr / (1.0 + (icr * SIM_PULSE_DEADTIME));
+}
+
+/*
+ * The time left until a fixed run completes, or a large value if the
+ * run does not end by itself.
+ */
+static double sim_run_remaining(Sim* sim, SimChannel* chan)
+{
+    double icr = sim->inputCountRate;
+    double ocr = sim_output_count_rate(icr);
+    double remaining = 1.0e9;
+
+    switch (chan->mode) {
+    case SimModeFixedTime:
+        remaining = sim_param_float(chan, "histogram.fixedTime.duration") - chan->elapsed;
+        break;
+    case SimModeFixedInputCount:
+        if (icr > 0)
+            remaining = ((double) sim_param_int(chan, "histogram.fixedInputCount.count") -
+                         (double) chan->triggers) / icr;
+        break;
+    case SimModeFixedOutputCount:
+        if (ocr > 0)
+            remaining = ((double) sim_param_int(chan, "histogram.fixedOutputCount.count") -
+                         (double) chan->pulsesAccepted) / ocr;
+        break;
+    default:
+        break;
+    }
+
+    return remaining < 0.0 ? 0.0 : remaining;
+}
+
+static void sim_histogram_encode(SincBuffer* buf, int channel, SimChannel* chan,
+                                 double elapsed, uint64_t accepted, uint64_t rejected,
+                                 SiToro__Sinc__HistogramTrigger trigger,
+                                 uint32_t gateState, double refreshRate,
+                                 double icr)
+{
+    SiToro__Sinc__HistogramDataResponse resp;
+    uint32_t plotLen[2];
+    size_t   headerLen;
+    size_t   dataLen;
+    uint16_t headerLen16;
+
+    si_toro__sinc__histogram_data_response__init(&resp);
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+    resp.has_datasetid = 1;
+    resp.datasetid = chan->dataSetId;
+    resp.has_timeelapsed = 1;
+    resp.timeelapsed = elapsed;
+    resp.has_samplesdetected = 1;
+    resp.samplesdetected = accepted + rejected;
+    resp.has_sampleserased = 1;
+    resp.sampleserased = 0;
+    resp.has_pulsesaccepted = 1;
+    resp.pulsesaccepted = accepted;
+    resp.has_pulsesrejected = 1;
+    resp.pulsesrejected = rejected;
+    resp.has_inputcountrate = 1;
+    resp.inputcountrate = icr;
+    resp.has_outputcountrate = 1;
+    resp.outputcountrate = elapsed > 0.0 ? (double) accepted / elapsed : 0.0;
+    resp.has_deadtimepercent = 1;
+    resp.deadtimepercent =
+        icr > 0.0 ? 100.0 * (1.0 - (sim_output_count_rate(icr) / icr)) : 0.0;
+    resp.has_gatestate = 1;
+    resp.gatestate = gateState;
+    resp.has_subregionstartindex = 1;
+    resp.subregionstartindex = chan->lowIndex;
+    resp.has_subregionendindex = 1;
+    resp.subregionendindex = chan->lowIndex + chan->bins;
+    resp.has_refreshrate = 1;
+    resp.refreshrate = (uint32_t) (refreshRate * 1000.0);
+    resp.has_trigger = 1;
+    resp.trigger = trigger;
+
+    resp.has_spectrumselectionmask = 1;
+    resp.spectrumselectionmask = 0;
+    resp.plotlen = plotLen;
+    resp.n_plotlen = 0;
+    if (chan->sendAccepted) {
+        resp.spectrumselectionmask |= SINC_SPECTRUMSELECT_ACCEPTED;
+        plotLen[resp.n_plotlen++] = chan->bins;
+    }
+    if (chan->sendRejected) {
+        resp.spectrumselectionmask |= SINC_SPECTRUMSELECT_REJECTED;
+        plotLen[resp.n_plotlen++] = chan->bins;
+    }
+
+    headerLen = si_toro__sinc__histogram_data_response__get_packed_size(&resp);
+    dataLen = resp.n_plotlen * chan->bins * sizeof(uint32_t);
+    headerLen16 = (uint16_t) headerLen;
+
+    sim_encode_header(buf, sizeof(headerLen16) + headerLen + dataLen,
+                      SI_TORO__SINC__MESSAGE_TYPE__HISTOGRAM_DATA_RESPONSE);
+    buf->cbuf.base.append(&buf->cbuf.base, sizeof(headerLen16),
+                          (const uint8_t*) &headerLen16);
+    si_toro__sinc__histogram_data_response__pack_to_buffer(&resp, &buf->cbuf.base);
+
+    if (chan->sendAccepted)
+        buf->cbuf.base.append(&buf->cbuf.base, chan->bins * sizeof(uint32_t),
+                              (const uint8_t*) chan->accepted);
+    if (chan->sendRejected)
+        buf->cbuf.base.append(&buf->cbuf.base, chan->bins * sizeof(uint32_t),
+                              (const uint8_t*) chan->rejected);
+}
+
+static void sim_run_end(Sim* sim, int channel)
+{
+    SimChannel* chan = &sim->channels[channel];
+
+    if (chan->running) {
+        chan->running = 0;
+        sim_channel_state(sim, channel, "ready");
+        if (sim->verbose)
+            printf("sim: channel %d: run ended after %" PRIu64 " histograms\n",
+                   channel, chan->dataSetId);
+    }
+}
+
+/*
+ * Advance a channel's run to now and send its update. Gated runs send
+ * the counts of one pixel, the other modes the counts since the start.
+ */
+static void sim_histogram_update(Sim* sim, int channel, double now,
+                                 SiToro__Sinc__HistogramTrigger trigger)
+{
+    uint8_t    pad[1024];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SimChannel* chan = &sim->channels[channel];
+
+    double   icr = sim->inputCountRate;
+    double   ocr = sim_output_count_rate(icr);
+    double   dt = now - chan->last;
+    double   refreshRate = sim_param_float(chan, "histogram.refreshRate");
+    double   remaining;
+    uint64_t triggers;
+    uint64_t accepted;
+    uint64_t rejected;
+    int      complete = 0;
+
+    if (chan->mode == SimModeGated) {
+        dt = 1.0 / sim->pixelRate;
+        sim_histogram_clear(chan);
+        trigger = SI_TORO__SINC__HISTOGRAM_TRIGGER__GATE_CHANGE;
+    } else {
+        remaining = sim_run_remaining(sim, chan);
+        if (dt >= remaining) {
+            dt = remaining;
+            complete = chan->mode != SimModeContinuous;
+            if (complete)
+                trigger = SI_TORO__SINC__HISTOGRAM_TRIGGER__CONDITION_COMPLETE;
+        }
+    }
+
+    if (dt < 0.0)
+        dt = 0.0;
+
+    triggers = sim_round(sim, icr * dt);
+    accepted = sim_round(sim, ocr * dt);
+    if (accepted > triggers)
+        accepted = triggers;
+
+    switch (chan->mode) {
+    case SimModeFixedInputCount:
+        if (complete)
+            triggers = (uint64_t) sim_param_int(chan, "histogram.fixedInputCount.count") -
+                chan->triggers;
+        break;
+    case SimModeFixedOutputCount:
+        if (complete) {
+            accepted = (uint64_t) sim_param_int(chan, "histogram.fixedOutputCount.count") -
+                chan->pulsesAccepted;
+            if (triggers < accepted)
+                triggers = accepted;
+        }
+        break;
+    default:
+        break;
+    }
+
+    rejected = triggers - accepted;
+
+    if (chan->sendAccepted)
+        sim_spectrum_add(sim, chan->pdf, chan->accepted, chan->bins, (double) accepted);
+    if (chan->sendRejected)
+        sim_spectrum_add(sim, chan->pdf, chan->rejected, chan->bins, (double) rejected);
+
+    chan->triggers += triggers;
+    chan->pulsesAccepted += accepted;
+    chan->elapsed += dt;
+    chan->last = now;
+
+    /*
+     * Inject a drop by skipping a gated pixel. The box reports it with an
+     * asynchronous error and the next pixel keeps its own data set id.
+     */
+    if (chan->mode == SimModeGated && sim->dropEvery > 0 &&
+        ((chan->dataSetId + 1) % sim->dropEvery) == 0) {
+        sim_asynchronous_error(sim, channel, SI_TORO__SINC__ERROR_CODE__DEVICE_ERROR,
+                               "1 Gated Histogram data dropped");
+        ++chan->dataSetId;
+        ++sim->pixelsDropped;
+        SINC_BUFFER_CLEAR(&buf);
+        return;
+    }
+
+    sim_histogram_encode(&buf, channel, chan, chan->elapsed,
+                         chan->pulsesAccepted, chan->triggers - chan->pulsesAccepted,
+                         trigger, chan->mode == SimModeGated ? 1 : 0,
+                         refreshRate, icr);
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+
+    ++chan->dataSetId;
+    ++sim->pixelsSent;
+
+    if (complete)
+        sim_run_end(sim, channel);
+}
+
+/*
+ * Schedule the next update of a running channel.
+ */
+static void sim_histogram_schedule(Sim* sim, SimChannel* chan)
+{
+    double refreshRate = sim_param_float(chan, "histogram.refreshRate");
+    double next = chan->last + 1.0e9;
+
+    if (chan->mode == SimModeGated) {
+        next = chan->last + (1.0 / sim->pixelRate);
+    } else {
+        if (refreshRate > 0.0)
+            next = chan->last + refreshRate;
+        if (chan->mode != SimModeContinuous) {
+            double end = chan->last + sim_run_remaining(sim, chan);
+            if (end < next)
+                next = end;
+        }
+    }
+
+    chan->next = next;
+}
+
+static int sim_histogram_start(Sim* sim, int channel)
+{
+    SimChannel* chan = &sim->channels[channel];
+    const char* mode = sim_param_option(chan, "histogram.mode");
+    int64_t     low = sim_param_int(chan, "histogram.binSubRegion.lowIndex");
+    int64_t     high = sim_param_int(chan, "histogram.binSubRegion.highIndex");
+
+    if (strcmp(mode, "gated") == 0)
+        chan->mode = SimModeGated;
+    else if (strcmp(mode, "fixedTime") == 0)
+        chan->mode = SimModeFixedTime;
+    else if (strcmp(mode, "fixedInputCount") == 0)
+        chan->mode = SimModeFixedInputCount;
+    else if (strcmp(mode, "fixedOutputCount") == 0)
+        chan->mode = SimModeFixedOutputCount;
+    else
+        chan->mode = SimModeContinuous;
+
+    if (high < low || low < 0)
+        return -1;
+
+    sim_histogram_free(chan);
+
+    chan->lowIndex = (uint32_t) low;
+    chan->bins = (uint32_t) (high - low + 1);
+    chan->pdf = malloc(chan->bins * sizeof(double));
+    chan->accepted = calloc(chan->bins, sizeof(uint32_t));
+    chan->rejected = calloc(chan->bins, sizeof(uint32_t));
+    if (chan->pdf == NULL || chan->accepted == NULL || chan->rejected == NULL) {
+        sim_histogram_free(chan);
+        return -1;
+    }
+
+    sim_shape_fill(sim->shape, chan->pdf, chan->bins);
+
+    chan->sendAccepted = sim_param_bool(chan, "histogram.spectrumSelect.accepted");
+    chan->sendRejected = sim_param_bool(chan, "histogram.spectrumSelect.rejected");
+
+    sim_histogram_clear(chan);
+    chan->dataSetId = 0;
+    chan->start = chan->last = sim_now();
+    chan->running = 1;
+
+    sim_histogram_schedule(sim, chan);
+
+    if (sim->verbose)
+        printf("sim: channel %d: start %s bins=%u\n", channel, mode, chan->bins);
+
+    return 0;
+}
+
+/*
+ * Commands
+ */
+
+static int sim_channel_valid(Sim* sim, int channel)
+{
+    return channel >= 0 && channel < sim->numChannels;
+}
+
+static void sim_cmd_get_param(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    uint8_t    pad[1024];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__GetParamCommand* cmd;
+    SiToro__Sinc__GetParamResponse resp;
+    SiToro__Sinc__SuccessResponse  success;
+
+    SiToro__Sinc__KeyValue*  kvs = NULL;
+    SiToro__Sinc__KeyValue** results = NULL;
+    char*                    strs = NULL;
+
+    size_t numKeys;
+    size_t k;
+    int    channel;
+    const char* missing = NULL;
+
+    cmd = si_toro__sinc__get_param_command__unpack(NULL, msg->cbuf.len, msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad get param command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : 0;
+    numKeys = cmd->key != NULL ? 1 : cmd->n_chankeys;
+
+    kvs = calloc(numKeys + 1, sizeof(*kvs));
+    results = calloc(numKeys + 1, sizeof(*results));
+    strs = calloc(numKeys + 1, SIM_STR_LEN);
+
+    si_toro__sinc__get_param_response__init(&resp);
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+    resp.results = results;
+
+    for (k = 0; kvs != NULL && results != NULL && strs != NULL && k < numKeys; ++k) {
+        const char* key = cmd->key != NULL ? cmd->key : cmd->chankeys[k]->key;
+        int keyChannel = channel;
+        SimParam* param = NULL;
+
+        if (cmd->key == NULL && cmd->chankeys[k]->has_channelid)
+            keyChannel = cmd->chankeys[k]->channelid;
+
+        if (sim_channel_valid(sim, keyChannel))
+            param = sim_param_find(&sim->channels[keyChannel], key);
+
+        if (param == NULL) {
+            missing = key;
+            break;
+        }
+
+        sim_param_kv(param, keyChannel, &kvs[k], &strs[k * SIM_STR_LEN], SIM_STR_LEN);
+        results[resp.n_results++] = &kvs[k];
+    }
+
+    if (kvs == NULL || results == NULL || strs == NULL) {
+        sim_success(&success, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY, NULL, channel);
+        resp.n_results = 0;
+    } else if (missing != NULL) {
+        if (sim->verbose)
+            printf("sim: channel %d: get param not found: %s\n", channel, missing);
+        sim_success(&success, SI_TORO__SINC__ERROR_CODE__NOT_FOUND, "parameter not found",
+                    channel);
+        resp.n_results = 0;
+    } else {
+        sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    }
+
+    resp.success = &success;
+
+    sim_encode_header(&buf, si_toro__sinc__get_param_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__GET_PARAM_RESPONSE);
+    si_toro__sinc__get_param_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send(sim, client, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+
+    free(strs);
+    free(results);
+    free(kvs);
+    si_toro__sinc__get_param_command__free_unpacked(cmd, NULL);
+}
+
+static void sim_cmd_set_param(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__SetParamCommand* cmd;
+    int    channel;
+    size_t p;
+    int    status = 0;
+
+    cmd = si_toro__sinc__set_param_command__unpack(NULL, msg->cbuf.len, msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad set param command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : 0;
+
+    if (!sim_channel_valid(sim, channel)) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        si_toro__sinc__set_param_command__free_unpacked(cmd, NULL);
+        return;
+    }
+
+    if (cmd->param != NULL)
+        status = sim_param_store(&sim->channels[channel], cmd->param);
+
+    for (p = 0; status == 0 && p < cmd->n_params; ++p)
+        status = sim_param_store(&sim->channels[channel], cmd->params[p]);
+
+    if (status == 0)
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    else
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__OUT_OF_RESOURCES,
+                          "too many parameters", channel);
+
+    /*
+     * Monitoring clients are told about every change.
+     */
+    if (status == 0) {
+        if (cmd->param != NULL)
+            sim_param_updated(sim, channel, cmd->param->key);
+        for (p = 0; p < cmd->n_params; ++p)
+            sim_param_updated(sim, channel, cmd->params[p]->key);
+    }
+
+    si_toro__sinc__set_param_command__free_unpacked(cmd, NULL);
+}
+
+/*
+ * List the parameters the PSL checks for channel features.
+ */
+static void sim_cmd_list_param_details(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    uint8_t    pad[1024];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    static char* terminationValues[] = { "1kohm", "50ohm" };
+    static char* attnValues[] = { "0dB", "-6dB", "ground" };
+
+    SiToro__Sinc__ListParamDetailsCommand* cmd;
+    SiToro__Sinc__ListParamDetailsResponse resp;
+    SiToro__Sinc__SuccessResponse          success;
+    SiToro__Sinc__ParamDetails             details[SIM_MAX_PARAMS];
+    SiToro__Sinc__ParamDetails*            detailPtrs[SIM_MAX_PARAMS];
+    SiToro__Sinc__KeyValue                 kvs[SIM_MAX_PARAMS];
+    char                                   strs[SIM_MAX_PARAMS][SIM_STR_LEN];
+
+    int    channel;
+    size_t k;
+
+    cmd = si_toro__sinc__list_param_details_command__unpack(NULL, msg->cbuf.len,
+                                                            msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad list param details command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : 0;
+    if (!sim_channel_valid(sim, channel))
+        channel = 0;
+
+    si_toro__sinc__list_param_details_response__init(&resp);
+    sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    resp.success = &success;
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+    resp.paramdetails = detailPtrs;
+
+    /*
+     * Every parameter is listed with its value as the box does.
+     */
+    for (k = 0; k < (size_t) sim->channels[channel].numParams; ++k) {
+        SimParam* param = &sim->channels[channel].params[k];
+
+        if (cmd->matchprefix != NULL &&
+            strncmp(param->key, cmd->matchprefix, strlen(cmd->matchprefix)) != 0)
+            continue;
+
+        si_toro__sinc__param_details__init(&details[resp.n_paramdetails]);
+        sim_param_kv(param, channel, &kvs[k], strs[k], SIM_STR_LEN);
+        details[resp.n_paramdetails].kv = &kvs[k];
+        details[resp.n_paramdetails].has_settable = 1;
+        details[resp.n_paramdetails].settable = !sim_param_read_only(param->key);
+
+        if (strcmp(param->key, "afe.termination") == 0) {
+            details[resp.n_paramdetails].valuelist = terminationValues;
+            details[resp.n_paramdetails].n_valuelist = 2;
+        } else if (strcmp(param->key, "afe.attn") == 0) {
+            details[resp.n_paramdetails].valuelist = attnValues;
+            details[resp.n_paramdetails].n_valuelist = 3;
+        }
+
+        detailPtrs[resp.n_paramdetails] = &details[resp.n_paramdetails];
+        ++resp.n_paramdetails;
+    }
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__list_param_details_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__LIST_PARAM_DETAILS_RESPONSE);
+    si_toro__sinc__list_param_details_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send(sim, client, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+
+    si_toro__sinc__list_param_details_command__free_unpacked(cmd, NULL);
+}
+
+static void sim_cmd_start_histogram(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__StartHistogramCommand* cmd;
+    int channel;
+
+    cmd = si_toro__sinc__start_histogram_command__unpack(NULL, msg->cbuf.len,
+                                                        msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad start histogram command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : 0;
+    si_toro__sinc__start_histogram_command__free_unpacked(cmd, NULL);
+
+    if (!sim_channel_valid(sim, channel)) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        return;
+    }
+
+    if (sim_histogram_start(sim, channel) != 0) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid histogram bin region", channel);
+        return;
+    }
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    sim_channel_state(sim, channel, "histo");
+}
+
+static void sim_cmd_stop(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__StopDataAcquisitionCommand* cmd;
+    int channel;
+    int c;
+
+    cmd = si_toro__sinc__stop_data_acquisition_command__unpack(NULL, msg->cbuf.len,
+                                                              msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad stop command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : -1;
+    si_toro__sinc__stop_data_acquisition_command__free_unpacked(cmd, NULL);
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        SimChannel* chan = &sim->channels[c];
+
+        if (channel >= 0 && c != channel)
+            continue;
+
+        if (chan->running) {
+            chan->running = 0;
+            if (sim->verbose)
+                printf("sim: channel %d: stopped after %" PRIu64 " histograms\n",
+                       c, chan->dataSetId);
+        }
+
+        chan->oscilloscopeDue = 0.0;
+        chan->calibrationDue = 0.0;
+
+        sim_channel_state(sim, c, "ready");
+    }
+}
+
+static void sim_cmd_clear_histogram(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__ClearHistogramCommand* cmd;
+    int channel;
+
+    cmd = si_toro__sinc__clear_histogram_command__unpack(NULL, msg->cbuf.len,
+                                                        msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__clear_histogram_command__free_unpacked(cmd, NULL);
+
+    if (sim_channel_valid(sim, channel))
+        sim_histogram_clear(&sim->channels[channel]);
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+}
+
+static void sim_cmd_oscilloscope(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__StartOscilloscopeCommand* cmd;
+    int channel;
+
+    cmd = si_toro__sinc__start_oscilloscope_command__unpack(NULL, msg->cbuf.len,
+                                                           msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__start_oscilloscope_command__free_unpacked(cmd, NULL);
+
+    if (!sim_channel_valid(sim, channel)) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        return;
+    }
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    sim_channel_state(sim, channel, "osc");
+
+    sim->channels[channel].oscilloscopeDue = sim_now() + SIM_OSCILLOSCOPE_TIME;
+}
+
+static void sim_oscilloscope_send(Sim* sim, int channel)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__OscilloscopeDataResponse  resp;
+    SiToro__Sinc__OscilloscopePlot          plots[2];
+    SiToro__Sinc__OscilloscopePlot*         plotPtrs[2];
+
+    int32_t* samples;
+    size_t   numSamples;
+    size_t   s;
+    size_t   headerLen;
+    uint16_t extended = 0xffff;
+    uint32_t headerLen32;
+
+    sim->channels[channel].oscilloscopeDue = 0.0;
+
+    numSamples = (size_t) sim_param_int(&sim->channels[channel], "oscilloscope.samples");
+    samples = malloc(numSamples * sizeof(int32_t));
+    if (samples == NULL) {
+        sim_asynchronous_error(sim, channel, SI_TORO__SINC__ERROR_CODE__OUT_OF_MEMORY,
+                               "oscilloscope capture failed");
+        sim_channel_state(sim, channel, "ready");
+        return;
+    }
+
+    /*
+     * A reset preamp ramp with a little noise.
+     */
+    for (s = 0; s < numSamples; ++s)
+        samples[s] = (int32_t) ((s % 2048) * 8) - 8192 +
+            (int32_t) (sim_random(sim) * 16.0);
+
+    si_toro__sinc__oscilloscope_plot__init(&plots[0]);
+    si_toro__sinc__oscilloscope_plot__init(&plots[1]);
+    plots[0].n_val = plots[1].n_val = numSamples;
+    plots[0].val = plots[1].val = samples;
+    plotPtrs[0] = &plots[0];
+    plotPtrs[1] = &plots[1];
+
+    si_toro__sinc__oscilloscope_data_response__init(&resp);
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+    resp.has_datasetid = 1;
+    resp.datasetid = 0;
+    resp.has_minvaluerange = 1;
+    resp.minvaluerange = -32768;
+    resp.has_maxvaluerange = 1;
+    resp.maxvaluerange = 32767;
+    resp.n_plots = 2;
+    resp.plots = plotPtrs;
+
+    headerLen = si_toro__sinc__oscilloscope_data_response__get_packed_size(&resp);
+    headerLen32 = (uint32_t) headerLen;
+
+    sim_encode_header(&buf, sizeof(extended) + sizeof(headerLen32) + headerLen,
+                      SI_TORO__SINC__MESSAGE_TYPE__OSCILLOSCOPE_DATA_RESPONSE);
+    buf.cbuf.base.append(&buf.cbuf.base, sizeof(extended), (const uint8_t*) &extended);
+    buf.cbuf.base.append(&buf.cbuf.base, sizeof(headerLen32),
+                         (const uint8_t*) &headerLen32);
+    si_toro__sinc__oscilloscope_data_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+
+    free(samples);
+
+    /*
+     * A continuous oscilloscope keeps capturing until it is stopped.
+     */
+    if (sim_param_bool(&sim->channels[channel], "oscilloscope.runContinuously"))
+        sim->channels[channel].oscilloscopeDue = sim_now() + SIM_OSCILLOSCOPE_TIME;
+    else
+        sim_channel_state(sim, channel, "ready");
+}
+
+static void sim_cmd_start_calibration(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__StartCalibrationCommand* cmd;
+    int channel;
+
+    cmd = si_toro__sinc__start_calibration_command__unpack(NULL, msg->cbuf.len,
+                                                          msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__start_calibration_command__free_unpacked(cmd, NULL);
+
+    if (!sim_channel_valid(sim, channel)) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        return;
+    }
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    sim_channel_state(sim, channel, "calibrate");
+
+    sim->channels[channel].calibrationDue = sim_now() + SIM_CALIBRATION_TIME;
+}
+
+static void sim_calibration_complete(Sim* sim, int channel)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__CalibrationProgressResponse resp;
+    SiToro__Sinc__SuccessResponse             success;
+    SiToro__Sinc__KeyValue                    kv;
+
+    sim->channels[channel].calibrationDue = 0.0;
+
+    si_toro__sinc__calibration_progress_response__init(&resp);
+    sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    resp.success = &success;
+    resp.has_progress = 1;
+    resp.progress = 100.0;
+    resp.has_complete = 1;
+    resp.complete = 1;
+    resp.stage = (char*) "done";
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__calibration_progress_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__CALIBRATION_PROGRESS_RESPONSE);
+    si_toro__sinc__calibration_progress_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+
+    if (sim->channels[channel].calibration != NULL) {
+        si_toro__sinc__set_calibration_command__free_unpacked(sim->channels[channel].calibration,
+                                                              NULL);
+        sim->channels[channel].calibration = NULL;
+    }
+
+    si_toro__sinc__key_value__init(&kv);
+    kv.key = (char*) "pulse.calibrated";
+    kv.has_boolval = 1;
+    kv.boolval = 1;
+    sim_param_store(&sim->channels[channel], &kv);
+    sim_param_updated(sim, channel, "pulse.calibrated");
+
+    sim_channel_state(sim, channel, "ready");
+}
+
+static void sim_cmd_set_calibration(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    SiToro__Sinc__SetCalibrationCommand* cmd;
+    SiToro__Sinc__KeyValue kv;
+    int channel;
+
+    cmd = si_toro__sinc__set_calibration_command__unpack(NULL, msg->cbuf.len,
+                                                        msg->cbuf.data);
+    if (cmd == NULL) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__INVALID_REQUEST,
+                          "bad set calibration command", -1);
+        return;
+    }
+
+    channel = cmd->has_channelid ? cmd->channelid : 0;
+    if (!sim_channel_valid(sim, channel)) {
+        si_toro__sinc__set_calibration_command__free_unpacked(cmd, NULL);
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        return;
+    }
+
+    if (sim->channels[channel].calibration != NULL)
+        si_toro__sinc__set_calibration_command__free_unpacked(sim->channels[channel].calibration,
+                                                              NULL);
+    sim->channels[channel].calibration = cmd;
+
+    si_toro__sinc__key_value__init(&kv);
+    kv.key = (char*) "pulse.calibrated";
+    kv.has_boolval = 1;
+    kv.boolval = 1;
+    sim_param_store(&sim->channels[channel], &kv);
+    sim_param_updated(sim, channel, "pulse.calibrated");
+
+    if (sim->verbose)
+        printf("sim: channel %d: calibration set, %d bytes\n",
+               channel, (int) cmd->data.len);
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+}
+
+/*
+ * Return the uploaded characterization or a generated one if nothing
+ * has been uploaded.
+ */
+static void sim_cmd_get_calibration(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    uint8_t    pad[1024];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__GetCalibrationCommand*  cmd;
+    SiToro__Sinc__GetCalibrationResponse  resp;
+    SiToro__Sinc__SuccessResponse         success;
+    SiToro__Sinc__SetCalibrationCommand*  cal;
+
+    double  x[SIM_CALIBRATION_POINTS];
+    double  y[SIM_CALIBRATION_POINTS];
+    uint8_t data[SIM_CALIBRATION_POINTS];
+    int     channel;
+    int     i;
+
+    cmd = si_toro__sinc__get_calibration_command__unpack(NULL, msg->cbuf.len,
+                                                        msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__get_calibration_command__free_unpacked(cmd, NULL);
+
+    if (!sim_channel_valid(sim, channel)) {
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__BAD_PARAMETERS,
+                          "invalid channel", channel);
+        return;
+    }
+
+    si_toro__sinc__get_calibration_response__init(&resp);
+    sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    resp.success = &success;
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+
+    cal = sim->channels[channel].calibration;
+    if (cal != NULL) {
+        resp.has_data = 1;
+        resp.data = cal->data;
+        resp.n_examplex = cal->n_examplex;
+        resp.examplex = cal->examplex;
+        resp.n_exampley = cal->n_exampley;
+        resp.exampley = cal->exampley;
+        resp.n_modelx = cal->n_modelx;
+        resp.modelx = cal->modelx;
+        resp.n_modely = cal->n_modely;
+        resp.modely = cal->modely;
+        resp.n_finalx = cal->n_finalx;
+        resp.finalx = cal->finalx;
+        resp.n_finaly = cal->n_finaly;
+        resp.finaly = cal->finaly;
+    } else {
+        for (i = 0; i < SIM_CALIBRATION_POINTS; ++i) {
+            x[i] = (double) i;
+            y[i] = exp(-(double) i / 16.0) - exp(-(double) i / 2.0);
+            data[i] = (uint8_t) (i * 7 + channel);
+        }
+
+        resp.has_data = 1;
+        resp.data.len = SIM_CALIBRATION_POINTS;
+        resp.data.data = data;
+        resp.n_examplex = resp.n_exampley = SIM_CALIBRATION_POINTS;
+        resp.n_modelx = resp.n_modely = SIM_CALIBRATION_POINTS;
+        resp.n_finalx = resp.n_finaly = SIM_CALIBRATION_POINTS;
+        resp.examplex = resp.modelx = resp.finalx = x;
+        resp.exampley = resp.modely = resp.finaly = y;
+    }
+
+    sim_encode_header(&buf, si_toro__sinc__get_calibration_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__GET_CALIBRATION_RESPONSE);
+    si_toro__sinc__get_calibration_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send(sim, client, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+static void sim_cmd_calculate_dc_offset(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__CalculateDcOffsetCommand*  cmd;
+    SiToro__Sinc__CalculateDcOffsetResponse  resp;
+    SiToro__Sinc__SuccessResponse            success;
+    int channel;
+
+    cmd = si_toro__sinc__calculate_dc_offset_command__unpack(NULL, msg->cbuf.len,
+                                                            msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__calculate_dc_offset_command__free_unpacked(cmd, NULL);
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+
+    si_toro__sinc__calculate_dc_offset_response__init(&resp);
+    sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    resp.success = &success;
+    resp.has_dcoffset = 1;
+    resp.dcoffset = 0.002;
+    resp.has_channelid = 1;
+    resp.channelid = channel;
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__calculate_dc_offset_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__CALCULATE_DC_OFFSET_RESPONSE);
+    si_toro__sinc__calculate_dc_offset_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send_all(sim, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+static void sim_cmd_check_param_consistency(Sim* sim, SimClient* client, SincBuffer* msg)
+{
+    uint8_t    pad[256];
+    SincBuffer buf = SINC_BUFFER_INIT(pad);
+
+    SiToro__Sinc__CheckParamConsistencyCommand*  cmd;
+    SiToro__Sinc__CheckParamConsistencyResponse  resp;
+    SiToro__Sinc__SuccessResponse                success;
+    int channel;
+
+    cmd = si_toro__sinc__check_param_consistency_command__unpack(NULL, msg->cbuf.len,
+                                                                msg->cbuf.data);
+    channel = (cmd != NULL && cmd->has_channelid) ? cmd->channelid : 0;
+    if (cmd != NULL)
+        si_toro__sinc__check_param_consistency_command__free_unpacked(cmd, NULL);
+
+    si_toro__sinc__check_param_consistency_response__init(&resp);
+    sim_success(&success, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, channel);
+    resp.success = &success;
+    resp.has_healthy = 1;
+    resp.healthy = 1;
+
+    sim_encode_header(&buf,
+                      si_toro__sinc__check_param_consistency_response__get_packed_size(&resp),
+                      SI_TORO__SINC__MESSAGE_TYPE__CHECK_PARAM_CONSISTENCY_RESPONSE);
+    si_toro__sinc__check_param_consistency_response__pack_to_buffer(&resp, &buf.cbuf.base);
+    sim_send(sim, client, &buf);
+    SINC_BUFFER_CLEAR(&buf);
+}
+
+static void sim_cmd_trigger_histogram(Sim* sim, SimClient* client)
+{
+    double now = sim_now();
+    int    c;
+
+    sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, -1);
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        SimChannel* chan = &sim->channels[c];
+        if (chan->running && chan->mode != SimModeGated) {
+            sim_histogram_update(sim, c, now,
+                                 SI_TORO__SINC__HISTOGRAM_TRIGGER__REFRESH_UPDATE);
+            if (chan->running)
+                sim_histogram_schedule(sim, chan);
+        }
+    }
+}
+
+static void sim_command(Sim* sim, SimClient* client,
+                        SiToro__Sinc__MessageType msgType, SincBuffer* msg)
+{
+    if (sim->verbose > 1)
+        printf("sim: command %d, %d bytes\n", (int) msgType, (int) msg->cbuf.len);
+
+    switch (msgType) {
+    case SI_TORO__SINC__MESSAGE_TYPE__PING_COMMAND:
+    case SI_TORO__SINC__MESSAGE_TYPE__MONITOR_CHANNELS_COMMAND:
+    case SI_TORO__SINC__MESSAGE_TYPE__SET_TIME_COMMAND:
+    case SI_TORO__SINC__MESSAGE_TYPE__SAVE_CONFIGURATION_COMMAND:
+    case SI_TORO__SINC__MESSAGE_TYPE__RESET_SPATIAL_SYSTEM_COMMAND:
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__NO_ERROR, NULL, -1);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__GET_PARAM_COMMAND:
+        sim_cmd_get_param(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__SET_PARAM_COMMAND:
+        sim_cmd_set_param(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__LIST_PARAM_DETAILS_COMMAND:
+        sim_cmd_list_param_details(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__START_HISTOGRAM_COMMAND:
+        sim_cmd_start_histogram(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__STOP_DATA_ACQUISITION_COMMAND:
+        sim_cmd_stop(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__CLEAR_HISTOGRAM_COMMAND:
+        sim_cmd_clear_histogram(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__START_OSCILLOSCOPE_COMMAND:
+        sim_cmd_oscilloscope(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__START_CALIBRATION_COMMAND:
+        sim_cmd_start_calibration(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__SET_CALIBRATION_COMMAND:
+        sim_cmd_set_calibration(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__GET_CALIBRATION_COMMAND:
+        sim_cmd_get_calibration(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__CALCULATE_DC_OFFSET_COMMAND:
+        sim_cmd_calculate_dc_offset(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__CHECK_PARAM_CONSISTENCY_COMMAND:
+        sim_cmd_check_param_consistency(sim, client, msg);
+        break;
+
+    case SI_TORO__SINC__MESSAGE_TYPE__TRIGGER_HISTOGRAM_COMMAND:
+        sim_cmd_trigger_histogram(sim, client);
+        break;
+
+    default:
+        if (sim->verbose)
+            printf("sim: unsupported command: %d\n", (int) msgType);
+        sim_reply_success(sim, client, SI_TORO__SINC__ERROR_CODE__UNIMPLEMENTED,
+                          "not supported by the simulator", -1);
+        break;
+    }
+}
+
+/*
+ * Connections
+ */
+
+int sim_listen(Sim* sim)
+{
+    struct sockaddr_in addr;
+    int one = 1;
+
+    sim->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sim->listenFd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    setsockopt(sim->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t) sim->port);
+
+    if (bind(sim->listenFd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return -1;
+    }
+
+    if (listen(sim->listenFd, SIM_MAX_CLIENTS) < 0) {
+        perror("listen");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void sim_attach(Sim* sim, int fd)
+{
+    int c;
+
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+        if (sim->clients[c].fd < 0) {
+            sim->clients[c].fd = fd;
+            if (sim->verbose)
+                printf("sim: client %d connected\n", fd);
+            return;
+        }
+    }
+
+    fprintf(stderr, "sim: too many clients\n");
+    close(fd);
+}
+
+static void sim_accept(Sim* sim)
+{
+    int fd;
+    int one = 1;
+
+    fd = accept(sim->listenFd, NULL, NULL);
+    if (fd < 0)
+        return;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sim_attach(sim, fd);
+}
+
+/*
+ * Requests written to the wake pipe in place of a connection's fd.
+ */
+#define SIM_WAKE_QUIT   (-2)
+#define SIM_WAKE_REBOOT (-3)
+
+/*
+ * Attach the connections other threads have added and take their
+ * requests. Any other negative fd only wakes the loop.
+ */
+static void sim_wake(Sim* sim)
+{
+    int fd;
+
+    while (read(sim->wakeFd[0], &fd, sizeof(fd)) == (ssize_t) sizeof(fd)) {
+        if (fd >= 0)
+            sim_attach(sim, fd);
+        else if (fd == SIM_WAKE_QUIT)
+            sim->quit = 1;
+        else if (fd == SIM_WAKE_REBOOT)
+            sim->reboot = 1;
+    }
+}
+
+static void sim_receive(Sim* sim, SimClient* client)
+{
+    ssize_t n;
+
+    if (client->inSize - client->inLen < 65536) {
+        size_t   size = client->inSize == 0 ? 65536 : client->inSize * 2;
+        uint8_t* in = realloc(client->in, size);
+        if (in == NULL) {
+            sim_client_close(sim, client);
+            return;
+        }
+        client->in = in;
+        client->inSize = size;
+    }
+
+    n = recv(client->fd, client->in + client->inLen, client->inSize - client->inLen, 0);
+    if (n <= 0) {
+        if (n < 0 && errno == EINTR)
+            return;
+        sim_client_close(sim, client);
+        return;
+    }
+
+    client->inLen += (size_t) n;
+
+    /*
+     * Handle every complete command in the buffer.
+     */
+    while (client->fd >= 0 && client->inLen > 0) {
+        uint8_t    pad[256];
+        SincBuffer msg = SINC_BUFFER_INIT(pad);
+        SincBuffer from = SINC_BUFFER_INIT(pad);
+
+        SiToro__Sinc__MessageType msgType;
+        int consumed = 0;
+        int responseCode = 0;
+        bool found;
+
+        from.cbuf.data = client->in;
+        from.cbuf.len = client->inLen;
+
+        found = SincDecodePacketEncapsulation(&from, &consumed, &responseCode, &msgType,
+                                              &msg, SINC_COMMAND_MARKER);
+
+        if (consumed > 0) {
+            memmove(client->in, client->in + consumed, client->inLen - (size_t) consumed);
+            client->inLen -= (size_t) consumed;
+        }
+
+        if (found)
+            sim_command(sim, client, msgType, &msg);
+
+        SINC_BUFFER_CLEAR(&msg);
+
+        if (!found)
+            break;
+    }
+}
+
+/*
+ * Send every update that is due and return the time to the next one
+ * in milli-seconds.
+ */
+static int sim_service_runs(Sim* sim)
+{
+    double now = sim_now();
+    double next = now + 1.0;
+    int    c;
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        SimChannel* chan = &sim->channels[c];
+
+        /*
+         * Catch up on all the pixels that are due so the mean rate holds
+         * when the loop falls behind.
+         */
+        while (chan->running && chan->next <= now) {
+            double due = chan->next;
+            sim_histogram_update(sim, c, due,
+                                 SI_TORO__SINC__HISTOGRAM_TRIGGER__REFRESH_UPDATE);
+            if (chan->running)
+                sim_histogram_schedule(sim, chan);
+        }
+
+        if (chan->running && chan->next < next)
+            next = chan->next;
+
+        if (chan->oscilloscopeDue > 0.0) {
+            if (chan->oscilloscopeDue <= now)
+                sim_oscilloscope_send(sim, c);
+            else if (chan->oscilloscopeDue < next)
+                next = chan->oscilloscopeDue;
+        }
+
+        if (chan->calibrationDue > 0.0) {
+            if (chan->calibrationDue <= now)
+                sim_calibration_complete(sim, c);
+            else if (chan->calibrationDue < next)
+                next = chan->calibrationDue;
+        }
+    }
+
+    return (int) ceil((next - now) * 1000.0);
+}
+
+/*
+ * A reboot closes every connection and the channels start again with
+ * the default parameters and no characterization.
+ */
+static void sim_reboot_now(Sim* sim)
+{
+    int c;
+
+    sim->reboot = 0;
+
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+        if (sim->clients[c].fd >= 0)
+            sim_client_close(sim, &sim->clients[c]);
+    }
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        sim_histogram_free(&sim->channels[c]);
+        if (sim->channels[c].calibration != NULL) {
+            si_toro__sinc__set_calibration_command__free_unpacked(sim->channels[c].calibration,
+                                                                  NULL);
+        }
+        sim_channel_init(sim, &sim->channels[c]);
+    }
+
+    ++sim->reboots;
+
+    if (sim->verbose)
+        printf("sim: rebooted\n");
+}
+
+void sim_run(Sim* sim)
+{
+    struct pollfd fds[SIM_MAX_CLIENTS + 2];
+    int    clientOf[SIM_MAX_CLIENTS + 2];
+    double reported = sim_now();
+    uint64_t lastSent = 0;
+
+    while (!sim->quit) {
+        int numFds = 0;
+        int timeout;
+        int n;
+        int f;
+        int c;
+
+        timeout = sim_service_runs(sim);
+
+        fds[numFds].fd = sim->wakeFd[0];
+        fds[numFds].events = POLLIN;
+        clientOf[numFds++] = -2;
+
+        if (sim->listenFd >= 0) {
+            fds[numFds].fd = sim->listenFd;
+            fds[numFds].events = POLLIN;
+            clientOf[numFds++] = -1;
+        }
+
+        for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+            if (sim->clients[c].fd >= 0) {
+                fds[numFds].fd = sim->clients[c].fd;
+                fds[numFds].events = POLLIN;
+                clientOf[numFds++] = c;
+            }
+        }
+
+        n = poll(fds, (nfds_t) numFds, timeout);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+
+        for (f = 0; f < numFds; ++f) {
+            if ((fds[f].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+                continue;
+            if (clientOf[f] == -2)
+                sim_wake(sim);
+            else if (clientOf[f] < 0)
+                sim_accept(sim);
+            else if (sim->clients[clientOf[f]].fd >= 0)
+                sim_receive(sim, &sim->clients[clientOf[f]]);
+        }
+
+        if (sim->reboot)
+            sim_reboot_now(sim);
+
+        if (sim->verbose && (sim_now() - reported) >= 5.0) {
+            double now = sim_now();
+            if (sim->pixelsSent != lastSent) {
+                printf("sim: %.0f histograms/s, %" PRIu64 " sent, %" PRIu64 " dropped\n",
+                       (double) (sim->pixelsSent - lastSent) / (now - reported),
+                       sim->pixelsSent, sim->pixelsDropped);
+            }
+            lastSent = sim->pixelsSent;
+            reported = now;
+        }
+    }
+}
+
+
+/*
+ * Set up and tear down
+ */
+
+void sim_init(Sim* sim)
+{
+    int c;
+
+    memset(sim, 0, sizeof(*sim));
+
+    sim->port = 8756;
+    sim->numChannels = 8;
+    sim->pixelRate = 100.0;
+    sim->inputCountRate = 100000.0;
+    sim->shape = SimShapeGauss;
+    sim->dropEvery = 0;
+    sim->verbose = 1;
+    sim->rng = 0x9e3779b97f4a7c15ULL;
+
+    sim->listenFd = -1;
+    sim->wakeFd[0] = -1;
+    sim->wakeFd[1] = -1;
+
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c)
+        sim->clients[c].fd = -1;
+}
+
+/*
+ * Call once the options are set.
+ */
+int sim_open(Sim* sim)
+{
+    int c;
+
+    if (pipe(sim->wakeFd) < 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    fcntl(sim->wakeFd[0], F_SETFL, fcntl(sim->wakeFd[0], F_GETFL) | O_NONBLOCK);
+
+    for (c = 0; c < sim->numChannels; ++c)
+        sim_channel_init(sim, &sim->channels[c]);
+
+    return 0;
+}
+
+void sim_close(Sim* sim)
+{
+    int c;
+
+    for (c = 0; c < SIM_MAX_CLIENTS; ++c) {
+        if (sim->clients[c].fd >= 0)
+            sim_client_close(sim, &sim->clients[c]);
+    }
+
+    for (c = 0; c < sim->numChannels; ++c) {
+        sim_histogram_free(&sim->channels[c]);
+        if (sim->channels[c].calibration != NULL) {
+            si_toro__sinc__set_calibration_command__free_unpacked(sim->channels[c].calibration,
+                                                                  NULL);
+            sim->channels[c].calibration = NULL;
+        }
+    }
+
+    if (sim->listenFd >= 0)
+        close(sim->listenFd);
+    if (sim->wakeFd[0] >= 0)
+        close(sim->wakeFd[0]);
+    if (sim->wakeFd[1] >= 0)
+        close(sim->wakeFd[1]);
+
+    sim->listenFd = -1;
+    sim->wakeFd[0] = -1;
+    sim->wakeFd[1] = -1;
+}
+
+/*
+ * Running in another program
+ */
+
+static void* sim_thread(void* arg)
+{
+    sim_run((Sim*) arg);
+    return NULL;
+}
+
+int sim_start(Sim* sim)
+{
+    sim->quit = 0;
+    if (pthread_create(&sim->thread, NULL, sim_thread, sim) != 0) {
+        fprintf(stderr, "sim: cannot create the thread\n");
+        return -1;
+    }
+    sim->threaded = 1;
+    return 0;
+}
+
+/*
+ * Safe to call from any thread. The simulator owns the fd once added.
+ */
+int sim_add_client(Sim* sim, int fd)
+{
+    if (write(sim->wakeFd[1], &fd, sizeof(fd)) != (ssize_t) sizeof(fd)) {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Safe to call from any thread or a signal handler.
+ */
+void sim_reboot(Sim* sim)
+{
+    sim_add_client(sim, SIM_WAKE_REBOOT);
+}
+
+/*
+ * Ask sim_run to return. Safe to call from any thread or a signal handler.
+ */
+void sim_quit(Sim* sim)
+{
+    sim_add_client(sim, SIM_WAKE_QUIT);
+}
+
+/*
+ * Read a channel's parameter. NULL if the channel does not have it.
+ */
+const SimParam* sim_param(Sim* sim, int channel, const char* key)
+{
+    if (!sim_channel_valid(sim, channel))
+        return NULL;
+    return sim_param_find(&sim->channels[channel], key);
+}
+
+void sim_stop(Sim* sim)
+{
+    sim_quit(sim);
+    if (sim->threaded) {
+        pthread_join(sim->thread, NULL);
+        sim->threaded = 0;
+    }
+}
+
+/*
+ * A SincLoopbackAccept for SincLoopbackSetPeer. The context is the Sim.
+ */
+void sim_loopback_accept(void* context, int fd, int port)
+{
+    (void) port;
+    sim_add_client((Sim*) context, fd);
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * The device half of the SINC simulator. sinc-sim runs it as a TCP
+ * server. A test can run it on a thread in its own process instead and
+ * have libsinc's loopback transport hand it connections:
+ *
+ *   sim_init(&sim);
+ *   sim.numChannels = 1;
+ *   sim_open(&sim);
+ *   sim_start(&sim);
+ *   SincLoopbackSetPeer(sim_loopback_accept, &sim);
+ *   ... inet_address = loopback ...
+ *   sim_stop(&sim);
+ *   sim_close(&sim);
+ */
+
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "sinc.h"
+
+
+#define SIM_MAX_CHANNELS 16
+#define SIM_MAX_CLIENTS  8
+#define SIM_MAX_PARAMS   128
+#define SIM_KEY_LEN      64
+#define SIM_STR_LEN      128
+
+typedef SiToro__Sinc__KeyValue__ParamType SimParamType;
+
+typedef struct {
+    char         key[SIM_KEY_LEN];
+    SimParamType type;
+    int64_t      intval;
+    double       floatval;
+    int          boolval;
+    char         str[SIM_STR_LEN];
+} SimParam;
+
+typedef enum {
+    SimModeContinuous,
+    SimModeGated,
+    SimModeFixedTime,
+    SimModeFixedInputCount,
+    SimModeFixedOutputCount
+} SimMode;
+
+typedef enum {
+    SimShapeFlat,
+    SimShapeGauss,
+    SimShapeRamp
+} SimShape;
+
+typedef struct {
+    SimParam  params[SIM_MAX_PARAMS];
+    int       numParams;
+
+    /* Histogram run */
+    int       running;
+    SimMode   mode;
+    double    start;
+    double    last;
+    double    next;
+    uint64_t  dataSetId;
+    int       sendAccepted;
+    int       sendRejected;
+    uint32_t  lowIndex;
+    uint32_t  bins;
+    double*   pdf;
+    uint32_t* accepted;
+    uint32_t* rejected;
+    uint64_t  triggers;
+    uint64_t  pulsesAccepted;
+    double    elapsed;
+
+    /* Captures in progress, 0 if none. */
+    double    oscilloscopeDue;
+    double    calibrationDue;
+
+    /* The last characterization uploaded with SetCalibration. */
+    SiToro__Sinc__SetCalibrationCommand* calibration;
+} SimChannel;
+
+typedef struct {
+    int      fd;
+    uint8_t* in;
+    size_t   inLen;
+    size_t   inSize;
+} SimClient;
+
+typedef struct {
+    int        port;
+    int        numChannels;
+    double     pixelRate;
+    double     inputCountRate;
+    SimShape   shape;
+    unsigned   dropEvery;
+    int        verbose;
+
+    /* The TCP listener, -1 when the simulator is embedded in a test. */
+    int        listenFd;
+    /* Connections to add and requests are written here and it wakes
+     * sim_run. Other threads and signal handlers only use this. */
+    int        wakeFd[2];
+    /* Only touched by the thread in sim_run. */
+    int        quit;
+    /* Set to drop every connection and reset as a box does when it reboots. */
+    int        reboot;
+    pthread_t  thread;
+    int        threaded;
+
+    SimClient  clients[SIM_MAX_CLIENTS];
+    SimChannel channels[SIM_MAX_CHANNELS];
+
+    uint64_t   rng;
+    uint64_t   pixelsSent;
+    uint64_t   pixelsDropped;
+    uint64_t   reboots;
+} Sim;
+
+void sim_init(Sim* sim);
+int sim_open(Sim* sim);
+void sim_close(Sim* sim);
+int sim_listen(Sim* sim);
+void sim_run(Sim* sim);
+int sim_start(Sim* sim);
+void sim_quit(Sim* sim);
+void sim_stop(Sim* sim);
+int sim_add_client(Sim* sim, int fd);
+void sim_reboot(Sim* sim);
+const SimParam* sim_param(Sim* sim, int channel, const char* key);
+void sim_loopback_accept(void* context, int fd, int port);
+const char* sim_shape_name(SimShape shape);
+
+#endif /* SIM_DEVICE_H */
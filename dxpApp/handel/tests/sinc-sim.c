@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2020 XIA LLC
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided
+ * that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the
+ *     following disclaimer.
+ *   * Redistributions in binary form must reproduce the
+ *     above copyright notice, this list of conditions and the
+ *     following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *   * Neither the name of XIA LLC
+ *     nor the names of its contributors may be used to endorse
+ *     or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A SINC device simulator so Handel and the hd-* tests can be run
+ * without a FalconX. It listens for TCP connections and serves them
+ * with the device in sim_device.c.
+ *
+ * Point the module's inet_address at 127.0.0.1 and inet_port at the
+ * simulator's port. SIGHUP simulates the box rebooting.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_device.h"
+
+
+static Sim sim;
+
+static void print_usage(void);
+
+
+static void sim_signal(int sig)
+{
+    (void) sig;
+    sim_quit(&sim);
+}
+
+static void sim_hangup(int sig)
+{
+    (void) sig;
+    sim_reboot(&sim);
+}
+
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+
+    sim_init(&sim);
+
+    while (arg < argc) {
+        if (argv[arg][0] == '-') {
+            if (strlen(argv[arg]) != 2) {
+                fprintf(stderr, "error: invalid option: %s\n", argv[arg]);
+                exit(1);
+            }
+
+            switch (argv[arg][1]) {
+            case 'p':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -p requires a port\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%d", &sim.port);
+                ++arg;
+                break;
+            case 'c':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -c requires the number of channels\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%d", &sim.numChannels);
+                ++arg;
+                break;
+            case 'r':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -r requires the pixel rate\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &sim.pixelRate);
+                ++arg;
+                break;
+            case 'i':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -i requires the input count rate\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%lf", &sim.inputCountRate);
+                ++arg;
+                break;
+            case 's':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -s requires a spectrum shape\n");
+                    exit(1);
+                }
+                if (strcmp(argv[arg], "flat") == 0)
+                    sim.shape = SimShapeFlat;
+                else if (strcmp(argv[arg], "gauss") == 0)
+                    sim.shape = SimShapeGauss;
+                else if (strcmp(argv[arg], "ramp") == 0)
+                    sim.shape = SimShapeRamp;
+                else {
+                    fprintf(stderr, "error: invalid spectrum shape: %s\n", argv[arg]);
+                    exit(1);
+                }
+                ++arg;
+                break;
+            case 'D':
+                ++arg;
+                if (arg >= argc) {
+                    fprintf(stderr, "error: -D requires the drop interval\n");
+                    exit(1);
+                }
+                sscanf(argv[arg], "%u", &sim.dropEvery);
+                ++arg;
+                break;
+            case 'q':
+                sim.verbose = 0;
+                ++arg;
+                break;
+            case 'v':
+                sim.verbose = 2;
+                ++arg;
+                break;
+            case '?':
+                print_usage();
+                exit(0);
+            default:
+                fprintf(stderr, "error: invalid option; try -?\n");
+                exit(1);
+            }
+        } else {
+            fprintf(stderr, "error: invalid option; try -?\n");
+            exit(1);
+        }
+    }
+
+    if (sim.numChannels < 1 || sim.numChannels > SIM_MAX_CHANNELS) {
+        fprintf(stderr, "error: channels must be 1 to %d\n", SIM_MAX_CHANNELS);
+        exit(1);
+    }
+
+    if (sim.pixelRate <= 0.0) {
+        fprintf(stderr, "error: the pixel rate must be positive\n");
+        exit(1);
+    }
+
+    if (sim_open(&sim) != 0)
+        exit(1);
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    signal(SIGINT, sim_signal);
+    signal(SIGTERM, sim_signal);
+    signal(SIGHUP, sim_hangup);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (sim_listen(&sim) != 0)
+        exit(1);
+
+    printf("sim: listening on 127.0.0.1:%d, %d channels, %s spectrum, "
+           "icr=%.0f pixels=%.0f/s drop every=%u\n",
+           sim.port, sim.numChannels, sim_shape_name(sim.shape),
+           sim.inputCountRate, sim.pixelRate, sim.dropEvery);
+    fflush(stdout);
+
+    sim_run(&sim);
+
+    sim_close(&sim);
+
+    printf("sim: %" PRIu64 " histograms sent, %" PRIu64 " dropped\n",
+           sim.pixelsSent, sim.pixelsDropped);
+
+    return 0;
+}
+
+static void print_usage(void)
+{
+    fprintf(stdout,
+            "sinc-sim [options]\n" \
+            "options and arguments: \n" \
+            " -?           : help\n" \
+            " -p port      : TCP port to listen on, default 8756\n" \
+            " -c channels  : number of channels, default 8\n" \
+            " -r rate      : gated pixels per second, default 100\n" \
+            " -i icr       : input count rate per channel, default 100000\n" \
+            " -s shape     : spectrum shape, flat, gauss or ramp, default gauss\n" \
+            " -D n         : drop every n'th gated pixel, default 0 (none)\n" \
+            " -q           : quiet\n" \
+            " -v           : verbose, log every command\n" \
+            "Where:\n" \
+            " The simulator listens on 127.0.0.1 only. Set the module's\n" \
+            " inet_address to 127.0.0.1 and inet_port to the port.\n" \
+            " Send SIGHUP to drop the connections and reset the channels\n" \
+            " as a box does when it reboots.\n");
+    return;
+}
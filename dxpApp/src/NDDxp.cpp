@@ -106,6 +106,12 @@ static void acquisitionTaskC(void *drvPvt)
     pNDDxp->acquisitionTask();
 }
 
+static void traceStreamTaskC(void *drvPvt)
+{
+    NDDxp *pNDDxp = (NDDxp *)drvPvt;
+    pNDDxp->traceStreamTask();
+}
+
 
 extern "C" int NDDxpConfig(const char *portName, int nChannels,
                             int maxBuffers, size_t maxMemory)
@@ -114,13 +120,14 @@ extern "C" int NDDxpConfig(const char *portName, int nChannels,
     return 0;
 }
 
-/* Note: we use nChannels+1 for maxAddr because the last address is used for "all" channels" */
+/* Note: we use nChannels+2 for maxAddr because address nChannels is used for "all" channels"
+ * and address nChannels+1 for the trace stream NDArrays */
 NDDxp::NDDxp(const char *portName, int nChannels, int maxBuffers, size_t maxMemory)
-    : asynNDArrayDriver(portName, nChannels + 1, maxBuffers, maxMemory,
+    : asynNDArrayDriver(portName, nChannels + 2, maxBuffers, maxMemory,
             asynInt32Mask | asynFloat64Mask | asynInt32ArrayMask | asynFloat64ArrayMask | asynGenericPointerMask | asynOctetMask | asynDrvUserMask,
             asynInt32Mask | asynFloat64Mask | asynInt32ArrayMask | asynFloat64ArrayMask | asynGenericPointerMask | asynOctetMask,
             ASYN_MULTIDEVICE | ASYN_CANBLOCK, 1, 0, 0),
-    uniqueId(0)
+    uniqueId(0), traceUniqueId(0)
 {
     int status = asynSuccess;
     int i;
@@ -181,6 +188,7 @@ NDDxp::NDDxp(const char *portName, int nChannels, int maxBuffers, size_t maxMemo
     createParam(NDDxpTraceTimeString,              asynParamFloat64, &NDDxpTraceTime);
     createParam(NDDxpTraceDataString,              asynParamInt32Array, &NDDxpTraceData);
     createParam(NDDxpTraceTimeArrayString,         asynParamFloat64Array, &NDDxpTraceTimeArray);
+    createParam(NDDxpTraceStreamString,            asynParamInt32,   &NDDxpTraceStream);
 
     /* Runtime statistics */
     createParam(NDDxpTriggerLiveTimeString,        asynParamFloat64, &NDDxpTriggerLiveTime);
@@ -268,6 +276,7 @@ NDDxp::NDDxp(const char *portName, int nChannels, int maxBuffers, size_t maxMemo
     this->cmdStartEvent = new epicsEvent();
     this->cmdStopEvent = new epicsEvent();
     this->stoppedEvent = new epicsEvent();
+    this->traceStreamEvent = new epicsEvent();
 
     /* Allocate a memory pointer for each of the channels */
     this->pMcaRaw = (epicsUInt32**) calloc(this->nChannels, sizeof(epicsUInt32*));
@@ -287,6 +296,10 @@ NDDxp::NDDxp(const char *portName, int nChannels, int maxBuffers, size_t maxMemo
     /* Allocate a buffer for the trace time array */
     this->traceTimeBuffer = (epicsFloat64 *)calloc(this->traceLength, sizeof(epicsFloat64));
 
+    /* Allocate a buffer for the latest streamed trace of each channel */
+    this->traceStreamBuffer = (epicsInt32 *)calloc(this->traceLength * this->nChannels, sizeof(epicsInt32));
+    this->traceStreaming = false;
+
     /* Allocate a temporary buffer for use in mapping mode. */
     this->pMapRaw = (epicsUInt16*)malloc(MAPPING_BUFFER_SIZE * sizeof(epicsUInt16) * this->nChannels);
     
@@ -321,6 +334,18 @@ NDDxp::NDDxp(const char *portName, int nChannels, int maxBuffers, size_t maxMemo
         return;
     }
 
+    /* Start up the trace streaming thread */
+    status = (epicsThreadCreate("traceStreamTask",
+                epicsThreadPriorityMedium,
+                epicsThreadGetStackSize(epicsThreadStackMedium),
+                (EPICSTHREADFUNC)traceStreamTaskC, this) == NULL);
+    if (status)
+    {
+        printf("%s:%s epicsThreadCreate failure for trace stream task\n",
+                driverName, functionName);
+        return;
+    }
+
     /* Set default values for parameters that cannot be read from Handel */
     /* Get the clock speed in MHz, traceTime is in microseconds */
     xiastatus = xiaGetAcquisitionValues(0, "clock_speed", &clockSpeed);
@@ -475,6 +500,10 @@ asynStatus NDDxp::writeInt32( asynUser *pasynUser, epicsInt32 value)
     {
         this->setSCAs(pasynUser, addr);
     }
+    else if (function == NDDxpTraceStream)
+    {
+        status = this->setTraceStream(pasynUser, value);
+    }
     else if (function == NDDxpSaveSystem) 
     {
         if (value) {
@@ -1594,6 +1623,11 @@ asynStatus NDDxp::getTrace(asynUser* pasynUser, int addr,
             /* Call ourselves recursively but with a specific channel */
             this->getTrace(pasynUser, i, data, maxLen, actualLen);
         }
+    } else if (this->traceStreaming) {
+        /* The oscilloscope is running continuously so return the latest trace */
+        *actualLen = this->traceLength;
+        if (maxLen < *actualLen) *actualLen = maxLen;
+        memcpy(data, this->traceStreamBuffer + channel * this->traceLength, *actualLen * sizeof(epicsInt32));
     } else {
         info[0] = this->traceLength;
         xiastatus = xiaDoSpecialRun(channel, "adc_trace", info);
@@ -1618,6 +1652,110 @@ asynStatus NDDxp::getTrace(asynUser* pasynUser, int addr,
 }
 
 
+/* Start or stop the oscilloscope running continuously on all channels */
+asynStatus NDDxp::setTraceStream(asynUser *pasynUser, int stream)
+{
+    asynStatus status = asynSuccess;
+    int xiastatus;
+    int channel;
+    double info[2];
+    const char *functionName = "setTraceStream";
+
+    asynPrint(pasynUser, ASYN_TRACE_FLOW,
+        "%s:%s: stream=%d streaming=%d\n",
+        driverName, functionName, stream, this->traceStreaming);
+
+    if ((stream != 0) == this->traceStreaming) return status;
+
+    if (stream) {
+        for (channel=0; channel<this->nChannels; channel++) {
+            info[0] = this->traceLength;
+            CALLHANDEL( xiaDoSpecialRun(channel, "adc_trace_stream_start", info), "adc_trace_stream_start" )
+            if (status == asynError) break;
+        }
+        if (status == asynError) {
+            /* Stop the channels that did start */
+            while (--channel >= 0) xiaDoSpecialRun(channel, "adc_trace_stream_stop", NULL);
+            setIntegerParam(NDDxpTraceStream, 0);
+            return status;
+        }
+        this->traceStreaming = true;
+        this->traceStreamEvent->signal();
+    } else {
+        asynStatus stopStatus = asynSuccess;
+        this->traceStreaming = false;
+        /* Stop every channel and return the first error */
+        for (channel=0; channel<this->nChannels; channel++) {
+            CALLHANDEL( xiaDoSpecialRun(channel, "adc_trace_stream_stop", NULL), "adc_trace_stream_stop" )
+            if (stopStatus == asynSuccess) stopStatus = status;
+        }
+        status = stopStatus;
+    }
+    setIntegerParam(NDDxpTraceStream, this->traceStreaming ? 1 : 0);
+    return status;
+}
+
+/** Publishes a trace NDArray of all the channels for each set of traces the channels have.
+  * The arrays are sent on address nChannels+1. */
+asynStatus NDDxp::pollTraceStream()
+{
+    asynStatus status = asynSuccess;
+    asynUser *pasynUser = this->pasynUserSelf;
+    int xiastatus;
+    int channel;
+    int available;
+    int frame, frames=0;
+    int arrayCallbacks;
+    size_t dims[2];
+    NDArray *pArray;
+    epicsInt32 *pOut;
+    const char *functionName = "pollTraceStream";
+
+    for (channel=0; channel<this->nChannels; channel++) {
+        CALLHANDEL( xiaGetSpecialRunData(channel, "adc_trace_available", &available), "adc_trace_available" )
+        if (status == asynError) return status;
+        if ((channel == 0) || (available < frames)) frames = available;
+    }
+
+    getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
+
+    for (frame=0; frame<frames; frame++) {
+        for (channel=0; channel<this->nChannels; channel++) {
+            pOut = this->traceStreamBuffer + channel * this->traceLength;
+            CALLHANDEL( xiaGetSpecialRunData(channel, "adc_trace_next", pOut), "adc_trace_next" )
+            if (status == asynError) return status;
+        }
+
+        asynPrint(pasynUser, ASYN_TRACEIO_DRIVER,
+            "%s::%s got traces for %d channels\n",
+            driverName, functionName, this->nChannels);
+
+        if (!arrayCallbacks) continue;
+
+        dims[0] = this->traceLength;
+        dims[1] = this->nChannels;
+        pArray = this->pNDArrayPool->alloc(2, dims, NDInt32, 0, NULL);
+        if (pArray == NULL) {
+            asynPrint(pasynUser, ASYN_TRACE_ERROR,
+                "%s::%s error allocating trace NDArray\n",
+                driverName, functionName);
+            return asynError;
+        }
+        memcpy(pArray->pData, this->traceStreamBuffer, this->traceLength * this->nChannels * sizeof(epicsInt32));
+        updateTimeStamp(&pArray->epicsTS);
+        pArray->timeStamp = pArray->epicsTS.secPastEpoch + pArray->epicsTS.nsec / 1.e9;
+        /* Get any attributes that have been defined for this driver */
+        this->getAttributes(pArray->pAttributeList);
+        /* Traces have their own address and counter so they do not mix with the mapping arrays */
+        pArray->uniqueId = this->traceUniqueId++;
+        doCallbacksGenericPointer(pArray, NDArrayData, this->nChannels + 1);
+        pArray->release();
+    }
+
+    return status;
+}
+
+
 asynStatus NDDxp::startAcquiring(asynUser *pasynUser)
 {
     asynStatus status = asynSuccess;
@@ -1766,6 +1904,40 @@ void NDDxp::acquisitionTask()
     }
 }
 
+/** Thread that publishes the traces while the oscilloscope runs continuously */
+void NDDxp::traceStreamTask()
+{
+    double pollTime;
+    const char* functionName = "traceStreamTask";
+
+    asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
+        "%s:%s trace stream task started!\n",
+        driverName, functionName);
+
+    this->lock();
+
+    while (this->polling)
+    {
+        if (!this->traceStreaming)
+        {
+            /* Release the lock while we wait for the stream to start, then lock again */
+            this->unlock();
+            this->traceStreamEvent->wait();
+            this->lock();
+            continue;
+        }
+
+        this->pollTraceStream();
+
+        getDoubleParam(NDDxpPollTime, &pollTime);
+        this->unlock();
+        epicsThreadSleep(pollTime);
+        this->lock();
+    }
+
+    this->unlock();
+}
+
 /** Check if the current mapping buffer is full in which case it reads out the data */
 asynStatus NDDxp::pollMappingMode()
 {
@@ -1853,6 +2025,13 @@ void NDDxp::shutdown()
     asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW, 
         "%s: shutting down in %f seconds\n", driverName, 2*pollTime);
     this->polling = 0;
+    if (this->traceStreaming) {
+        this->lock();
+        this->setTraceStream(this->pasynUserSelf, 0);
+        this->unlock();
+    }
+    /* Wake the trace stream task so it sees polling is off and exits */
+    this->traceStreamEvent->signal();
     epicsThreadSleep(2*pollTime);
     status = xiaExit();
     if (status == XIA_SUCCESS)
@@ -1914,6 +2093,14 @@ static void xiaLogOutputCallFunc(const iocshArgBuf *args)
     xiaSetLogOutput(args[0].sval);
 }
 
+static const iocshArg xiaLogAsynchronousArg0 = { "asynchronous logging",iocshArgInt};
+static const iocshArg * const xiaLogAsynchronousArgs[1] = {&xiaLogAsynchronousArg0};
+static const iocshFuncDef xiaLogAsynchronousFuncDef = {"xiaSetLogAsynchronous",1,xiaLogAsynchronousArgs};
+static void xiaLogAsynchronousCallFunc(const iocshArgBuf *args)
+{
+    xiaSetLogAsynchronous(args[0].ival);
+}
+
 static const iocshArg xiaInitArg0 = { "ini file",iocshArgString};
 static const iocshArg * const xiaInitArgs[1] = {&xiaInitArg0};
 static const iocshFuncDef xiaInitFuncDef = {"xiaInit",1,xiaInitArgs};
@@ -1944,6 +2131,7 @@ static void NDDxpRegister(void)
     iocshRegister(&xiaInitFuncDef,xiaInitCallFunc);
     iocshRegister(&xiaLogLevelFuncDef,xiaLogLevelCallFunc);
     iocshRegister(&xiaLogOutputFuncDef,xiaLogOutputCallFunc);
+    iocshRegister(&xiaLogAsynchronousFuncDef,xiaLogAsynchronousCallFunc);
     iocshRegister(&xiaStartSystemFuncDef,xiaStartSystemCallFunc);
     iocshRegister(&xiaSaveSystemFuncDef,xiaSaveSystemCallFunc);
 }
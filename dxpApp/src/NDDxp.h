@@ -94,6 +94,7 @@ typedef struct falconMCAPixelHeader {
 #define NDDxpTraceTimeString                "DxpTraceTime"
 #define NDDxpTraceDataString                "DxpTraceData"
 #define NDDxpTraceTimeArrayString           "DxpTraceTimeArray"
+#define NDDxpTraceStreamString              "DxpTraceStream"
 
 /* Runtime statistics */
 #define NDDxpTriggerLiveTimeString          "DxpTriggerLiveTime"
@@ -159,6 +160,7 @@ public:
     void shutdown();
 
     void acquisitionTask();
+    void traceStreamTask();
     asynStatus pollMappingMode();
     int getChannel(asynUser *pasynUser, int *addr);
     void getModuleInfo();
@@ -174,6 +176,8 @@ public:
     asynStatus getMappingData();
     asynStatus getTrace(asynUser* pasynUser, int addr,
                         epicsInt32* data, size_t maxLen, size_t *actualLen);
+    asynStatus setTraceStream(asynUser *pasynUser, int stream);
+    asynStatus pollTraceStream();
     asynStatus configureCollectMode();
     asynStatus setNumChannels(asynUser *pasynUser, epicsInt32 newsize, epicsInt32 *rbValue);
     asynStatus startAcquiring(asynUser *pasynUser);
@@ -219,6 +223,7 @@ protected:
     int NDDxpTraceTime;            /** < Set the trace sample time in us. */
     int NDDxpTraceData;            /** < The trace array data (read) */
     int NDDxpTraceTimeArray;       /** < The trace timebase array (read) */
+    int NDDxpTraceStream;          /** < Stream ADC traces from all channels as NDArrays (0=stop; 1=stream) */
 
     /* High-level DXP parameters */
     int NDDxpDetectionThreshold;
@@ -294,17 +299,21 @@ private:
     epicsEvent *cmdStartEvent;
     epicsEvent *cmdStopEvent;
     epicsEvent *stoppedEvent;
+    epicsEvent *traceStreamEvent;
 
     epicsUInt32 *currentBuf;
     int traceLength;
     epicsInt32 *traceBuffer;
     epicsFloat64 *traceTimeBuffer;
+    epicsInt32 *traceStreamBuffer;
+    bool traceStreaming;
     epicsFloat64 *spectrumXAxisBuffer;
     
     moduleStatistics moduleStats[MAX_CHANNELS_PER_SYSTEM];
 
     bool polling;
     int uniqueId;
+    int traceUniqueId;
     char attrRealTimeName           [MAX_CHANNELS_PER_SYSTEM][MAX_ATTR_NAME_LEN];
     char attrRealTimeDescription    [MAX_CHANNELS_PER_SYSTEM][MAX_ATTR_NAME_LEN];
     char attrLiveTimeName           [MAX_CHANNELS_PER_SYSTEM][MAX_ATTR_NAME_LEN];